@@ -0,0 +1,394 @@
+/**
+ * @file bench.c
+ * @brief Shared benchmark helpers
+ *
+ * The timer reads the TSC when the CPU reports it as invariant (constant
+ * rate across P-states and C-states) and converts ticks with a ratio
+ * calibrated against CLOCK_MONOTONIC; otherwise it reads CLOCK_MONOTONIC
+ * directly. Either way a timestamp costs tens of nanoseconds, so single
+ * operations can be timed individually.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+/* Calibration window for the TSC frequency */
+#define BENCH_CALIBRATE_SEC 0.05
+
+static bench_timer_kind timer_kind = BENCH_TIMER_MONOTONIC;
+static double ns_per_tick = 1.0;
+
+/* ============================================================================
+ * Timer
+ * ============================================================================
+ */
+
+double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double bench_thread_cpu(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(BENCH_HAVE_TSC)
+static int tsc_invariant(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000u, &eax, &ebx, &ecx, &edx) || eax < 0x80000007u) return 0;
+    if (!__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx)) return 0;
+    return (edx >> 8) & 1;
+}
+#endif
+
+int bench_timer_init(bench_timer_kind kind) {
+    timer_kind = BENCH_TIMER_MONOTONIC;
+    ns_per_tick = 1.0;
+    if (kind == BENCH_TIMER_MONOTONIC) return 0;
+
+#if defined(BENCH_HAVE_TSC)
+    if (kind == BENCH_TIMER_AUTO && !tsc_invariant()) return 0;
+
+    uint64_t n0 = monotonic_ns();
+    uint64_t c0 = __rdtsc();
+    uint64_t n1;
+    do {
+        n1 = monotonic_ns();
+    } while ((double)(n1 - n0) < BENCH_CALIBRATE_SEC * 1e9);
+    uint64_t c1 = __rdtsc();
+
+    if (c1 <= c0) return kind == BENCH_TIMER_TSC ? -1 : 0;
+    ns_per_tick = (double)(n1 - n0) / (double)(c1 - c0);
+    timer_kind = BENCH_TIMER_TSC;
+    return 0;
+#else
+    return kind == BENCH_TIMER_TSC ? -1 : 0;
+#endif
+}
+
+const char *bench_timer_name(void) {
+    return timer_kind == BENCH_TIMER_TSC ? "tsc" : "monotonic";
+}
+
+double bench_timer_ghz(void) {
+    return timer_kind == BENCH_TIMER_TSC ? 1.0 / ns_per_tick : 0.0;
+}
+
+uint64_t bench_ticks(void) {
+#if defined(BENCH_HAVE_TSC)
+    if (timer_kind == BENCH_TIMER_TSC) return __rdtsc();
+#endif
+    return monotonic_ns();
+}
+
+double bench_ticks_to_ns(uint64_t ticks) {
+    return (double)ticks * ns_per_tick;
+}
+
+/* ============================================================================
+ * Samples and Statistics
+ * ============================================================================
+ */
+
+int bench_samples_push(bench_samples *s, double value) {
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 4096;
+        double *v = (double *)realloc(s->v, cap * sizeof(double));
+        if (!v) return -1;
+        s->v = v;
+        s->cap = cap;
+    }
+    s->v[s->n++] = value;
+    return 0;
+}
+
+void bench_samples_reset(bench_samples *s) {
+    s->n = 0;
+}
+
+void bench_samples_free(bench_samples *s) {
+    free(s->v);
+    s->v = NULL;
+    s->n = s->cap = 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted values */
+static double percentile(const double *v, size_t n, double p) {
+    size_t rank = (size_t)ceil(p / 100.0 * (double)n);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return v[rank - 1];
+}
+
+void bench_stats_compute(bench_samples *s, bench_stats *st) {
+    memset(st, 0, sizeof(*st));
+    if (s->n == 0) return;
+
+    qsort(s->v, s->n, sizeof(double), cmp_double);
+    const double *v = s->v;
+    size_t n = s->n;
+
+    st->count = n;
+    st->min = v[0];
+    st->max = v[n - 1];
+    st->p50 = percentile(v, n, 50.0);
+    st->p90 = percentile(v, n, 90.0);
+    st->p99 = percentile(v, n, 99.0);
+    st->p999 = percentile(v, n, 99.9);
+
+    /* Interrupts and migrations show up as a far tail; keep them out of the mean */
+    double q1 = percentile(v, n, 25.0);
+    double q3 = percentile(v, n, 75.0);
+    double fence = q3 + 3.0 * (q3 - q1);
+
+    double sum = 0.0, sq = 0.0;
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (v[i] > fence) continue;
+        sum += v[i];
+        kept++;
+    }
+    st->outliers = n - kept;
+    st->mean = sum / (double)kept;
+    for (size_t i = 0; i < kept; i++) sq += (v[i] - st->mean) * (v[i] - st->mean);
+    st->stddev = kept > 1 ? sqrt(sq / (double)(kept - 1)) : 0.0;
+}
+
+/* ============================================================================
+ * Latency Histogram
+ * ============================================================================
+ */
+
+static unsigned int hist_index(uint64_t v) {
+    if (v < BENCH_HIST_SUB) return (unsigned int)v;
+    unsigned int e = 63 - (unsigned int)__builtin_clzll(v);      /* e >= 5 */
+    unsigned int i = (e - 4) * BENCH_HIST_SUB + (unsigned int)((v >> (e - 5)) & (BENCH_HIST_SUB - 1));
+    return i < BENCH_HIST_BUCKETS ? i : BENCH_HIST_BUCKETS - 1;
+}
+
+/* Midpoint of bucket i */
+static double hist_value(unsigned int i) {
+    if (i < BENCH_HIST_SUB) return (double)i;
+    unsigned int e = i / BENCH_HIST_SUB + 4;
+    double low = (double)(BENCH_HIST_SUB + i % BENCH_HIST_SUB) * ldexp(1.0, (int)e - 5);
+    return low + 0.5 * ldexp(1.0, (int)e - 5);
+}
+
+void bench_hist_reset(bench_hist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void bench_hist_add(bench_hist *h, uint64_t ns) {
+    h->bucket[hist_index(ns)]++;
+    h->count++;
+}
+
+void bench_hist_merge(bench_hist *dst, const bench_hist *src) {
+    if (src->count == 0) return;
+    for (unsigned int i = 0; i < BENCH_HIST_BUCKETS; i++) dst->bucket[i] += src->bucket[i];
+    dst->count += src->count;
+}
+
+double bench_hist_quantile(const bench_hist *h, double q) {
+    if (h->count == 0) return NAN;
+    uint64_t rank = (uint64_t)ceil(q * (double)h->count), seen = 0;
+    if (rank == 0) rank = 1;
+    for (unsigned int i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += h->bucket[i];
+        if (seen >= rank) return hist_value(i);
+    }
+    return hist_value(BENCH_HIST_BUCKETS - 1);
+}
+
+/* ============================================================================
+ * Process
+ * ============================================================================
+ */
+
+double bench_rss_bytes(void) {
+#if defined(__linux__)
+    unsigned long size, resident;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return NAN;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? (double)resident * (double)sysconf(_SC_PAGESIZE) : NAN;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#if defined(__APPLE__)
+    return (double)ru.ru_maxrss;
+#else
+    return (double)ru.ru_maxrss * 1024.0;
+#endif
+#endif
+}
+
+/* ============================================================================
+ * Reports
+ * ============================================================================
+ */
+
+int bench_format_parse(const char *name, bench_format *format) {
+    if (strcmp(name, "text") == 0) *format = BENCH_FORMAT_TEXT;
+    else if (strcmp(name, "json") == 0) *format = BENCH_FORMAT_JSON;
+    else if (strcmp(name, "csv") == 0) *format = BENCH_FORMAT_CSV;
+    else return -1;
+    return 0;
+}
+
+static int field_width(const bench_field *f) {
+    int w = (int)strlen(f->name);
+    return w < 8 ? 8 : w;
+}
+
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        if ((unsigned char)*s < 0x20) fprintf(out, "\\u%04x", (unsigned char)*s);
+        else fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void json_number(FILE *out, const bench_field *f) {
+    if (isfinite(f->num)) fprintf(out, "%.*f", f->precision, f->num);
+    else fprintf(out, "null");
+}
+
+void bench_report_begin(bench_report *r, bench_format format, FILE *out, const char *tool) {
+    r->format = format;
+    r->out = out;
+    r->rows = 0;
+    r->summary = 0;
+
+    if (format == BENCH_FORMAT_JSON) {
+        fprintf(out, "{\n  \"tool\": ");
+        json_string(out, tool);
+        fprintf(out, ",\n  \"timer\": \"%s\",\n  \"tsc_ghz\": %.4f,\n  \"results\": [",
+                bench_timer_name(), bench_timer_ghz());
+    }
+}
+
+void bench_report_row(bench_report *r, const bench_field *fields, size_t n) {
+    FILE *out = r->out;
+
+    switch (r->format) {
+    case BENCH_FORMAT_JSON:
+        fprintf(out, "%s\n    {", r->rows ? "," : "");
+        for (size_t i = 0; i < n; i++) {
+            fprintf(out, "%s", i ? ", " : "");
+            json_string(out, fields[i].name);
+            fprintf(out, ": ");
+            if (fields[i].str) json_string(out, fields[i].str);
+            else json_number(out, &fields[i]);
+        }
+        fprintf(out, "}");
+        break;
+
+    case BENCH_FORMAT_CSV:
+        if (r->rows == 0) {
+            for (size_t i = 0; i < n; i++) fprintf(out, "%s%s", i ? "," : "", fields[i].name);
+            fprintf(out, "\n");
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (i) fputc(',', out);
+            if (fields[i].str) fprintf(out, "%s", fields[i].str);
+            else if (isfinite(fields[i].num)) fprintf(out, "%.*f", fields[i].precision, fields[i].num);
+        }
+        fprintf(out, "\n");
+        break;
+
+    default:
+        if (r->rows == 0) {
+            for (size_t i = 0; i < n; i++) {
+                int w = field_width(&fields[i]);
+                if (fields[i].str) fprintf(out, "%-*s ", w, fields[i].name);
+                else fprintf(out, "%*s ", w, fields[i].name);
+            }
+            fprintf(out, "\n");
+        }
+        for (size_t i = 0; i < n; i++) {
+            int w = field_width(&fields[i]);
+            if (fields[i].str) fprintf(out, "%-*s ", w, fields[i].str);
+            else fprintf(out, "%*.*f ", w, fields[i].precision, fields[i].num);
+        }
+        fprintf(out, "\n");
+        break;
+    }
+
+    r->rows++;
+    fflush(out);
+}
+
+void bench_report_summary(bench_report *r, const bench_field *fields, size_t n) {
+    FILE *out = r->out;
+
+    switch (r->format) {
+    case BENCH_FORMAT_JSON:
+        fprintf(out, "\n  ],\n  \"summary\": {");
+        for (size_t i = 0; i < n; i++) {
+            fprintf(out, "%s", i ? ", " : "");
+            json_string(out, fields[i].name);
+            fprintf(out, ": ");
+            if (fields[i].str) json_string(out, fields[i].str);
+            else json_number(out, &fields[i]);
+        }
+        fprintf(out, "}");
+        break;
+
+    case BENCH_FORMAT_CSV:
+        for (size_t i = 0; i < n; i++) {
+            if (fields[i].str) fprintf(out, "# %s=%s\n", fields[i].name, fields[i].str);
+            else fprintf(out, "# %s=%.*f\n", fields[i].name, fields[i].precision, fields[i].num);
+        }
+        break;
+
+    default:
+        fprintf(out, "\n");
+        for (size_t i = 0; i < n; i++) {
+            if (fields[i].str) fprintf(out, "%s: %s\n", fields[i].name, fields[i].str);
+            else fprintf(out, "%s: %.*f\n", fields[i].name, fields[i].precision, fields[i].num);
+        }
+        break;
+    }
+
+    r->summary = 1;
+    fflush(out);
+}
+
+void bench_report_end(bench_report *r) {
+    if (r->format == BENCH_FORMAT_JSON) fprintf(r->out, r->summary ? "\n}\n" : "\n  ]\n}\n");
+    fflush(r->out);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file bench.h
+ * @brief Shared benchmark helpers: calibrated timer, sample statistics and
+ *        text/JSON/CSV reports
+ */
+
+#ifndef FPE_BENCH_H
+#define FPE_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* ============================================================================
+ * Timer
+ * ============================================================================
+ */
+
+typedef enum {
+    BENCH_TIMER_AUTO = 0,    /* TSC when invariant, else CLOCK_MONOTONIC */
+    BENCH_TIMER_MONOTONIC,
+    BENCH_TIMER_TSC
+} bench_timer_kind;
+
+/**
+ * Select and calibrate the tick source. TSC ticks are calibrated against
+ * CLOCK_MONOTONIC; requesting TSC where it is unavailable fails.
+ *
+ * @return 0 on success, -1 if the requested timer is unavailable
+ */
+int bench_timer_init(bench_timer_kind kind);
+
+/** Name of the active timer ("tsc" or "monotonic") */
+const char *bench_timer_name(void);
+
+/** TSC frequency in GHz, or 0 when the monotonic clock is used */
+double bench_timer_ghz(void);
+
+/** Current tick count of the active timer */
+uint64_t bench_ticks(void);
+
+/** Convert a tick interval to nanoseconds */
+double bench_ticks_to_ns(uint64_t ticks);
+
+/** CLOCK_MONOTONIC in seconds */
+double bench_now(void);
+
+/** CPU time consumed by the calling thread, in seconds */
+double bench_thread_cpu(void);
+
+/* ============================================================================
+ * Samples and Statistics
+ * ============================================================================
+ */
+
+typedef struct {
+    double *v;
+    size_t n;
+    size_t cap;
+} bench_samples;
+
+/** Append a sample; returns -1 when out of memory */
+int bench_samples_push(bench_samples *s, double value);
+
+void bench_samples_reset(bench_samples *s);
+void bench_samples_free(bench_samples *s);
+
+typedef struct {
+    size_t count;      /* Samples */
+    size_t outliers;   /* Samples above Q3 + 3 * IQR, excluded from mean */
+    double min;
+    double max;
+    double mean;       /* Mean without outliers */
+    double stddev;     /* Standard deviation without outliers */
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+} bench_stats;
+
+/** Compute statistics (sorts the samples in place) */
+void bench_stats_compute(bench_samples *s, bench_stats *st);
+
+/* ============================================================================
+ * Latency Histogram
+ * ============================================================================
+ */
+
+/*
+ * Log-linear histogram of nanosecond values: exact below 32, then 32
+ * buckets per power of two, so a quantile is within ~3% of the true value
+ * at any magnitude. Fixed size, so threads can keep one each and merge.
+ */
+#define BENCH_HIST_SUB 32
+#define BENCH_HIST_BUCKETS (60 * BENCH_HIST_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t bucket[BENCH_HIST_BUCKETS];
+} bench_hist;
+
+void bench_hist_reset(bench_hist *h);
+void bench_hist_add(bench_hist *h, uint64_t ns);
+void bench_hist_merge(bench_hist *dst, const bench_hist *src);
+
+/** Value at quantile q (0..1), the midpoint of its bucket; NaN when empty */
+double bench_hist_quantile(const bench_hist *h, double q);
+
+/* ============================================================================
+ * Process
+ * ============================================================================
+ */
+
+/**
+ * Resident set size of the process in bytes: /proc/self/statm on Linux,
+ * peak RSS (getrusage) elsewhere.
+ */
+double bench_rss_bytes(void);
+
+/* ============================================================================
+ * Reports
+ * ============================================================================
+ */
+
+typedef enum {
+    BENCH_FORMAT_TEXT = 0,
+    BENCH_FORMAT_JSON,
+    BENCH_FORMAT_CSV
+} bench_format;
+
+/** Parse "text", "json" or "csv"; returns -1 on anything else */
+int bench_format_parse(const char *name, bench_format *format);
+
+typedef struct {
+    const char *name;
+    const char *str;   /* String value, or NULL for a number */
+    double num;
+    int precision;     /* Decimals for numbers in text and CSV */
+} bench_field;
+
+#define BENCH_STR(n, v) { (n), (v), 0.0, 0 }
+#define BENCH_NUM(n, v, p) { (n), NULL, (double)(v), (p) }
+
+typedef struct {
+    bench_format format;
+    FILE *out;
+    unsigned int rows;
+    int summary;       /* bench_report_summary was called */
+} bench_report;
+
+/** Start a report; JSON output records the tool name and the timer */
+void bench_report_begin(bench_report *r, bench_format format, FILE *out, const char *tool);
+
+/** Write one result row; every row of a report has the same fields */
+void bench_report_row(bench_report *r, const bench_field *fields, size_t n);
+
+/**
+ * Write figures derived from all rows, after the last row: a "summary"
+ * object in JSON, "name: value" lines in text, "# name=value" lines in CSV.
+ * Call at most once per report.
+ */
+void bench_report_summary(bench_report *r, const bench_field *fields, size_t n);
+
+void bench_report_end(bench_report *r);
+
+#endif /* FPE_BENCH_H */
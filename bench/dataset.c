@@ -0,0 +1,374 @@
+/**
+ * @file dataset.c
+ * @brief Deterministic synthetic datasets for the benchmarks
+ */
+
+#include "dataset.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char alphabet62[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+static const char *const kind_names[4] = {"pan", "ssn", "phone", "id"};
+static const char *const dist_names[3] = {"fixed", "uniform", "normal"};
+
+/* Longest record of any kind */
+#define DATA_MAX_LEN 4096
+
+/* ============================================================================
+ * Random Numbers
+ * ============================================================================
+ */
+
+/* splitmix64: small state, good enough statistics, trivially seedable */
+static uint64_t next(uint64_t *s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static unsigned int below(uint64_t *s, unsigned int n) {
+    return (unsigned int)(next(s) % n);
+}
+
+/* Uniform on [0, 1) */
+static double unit(uint64_t *s) {
+    return (double)(next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static unsigned int draw_len(uint64_t *s, const bench_dataset_spec *spec) {
+    unsigned int lo = spec->min_len, hi = spec->max_len;
+    switch (spec->dist) {
+    case BENCH_DIST_FIXED:
+        return lo;
+    case BENCH_DIST_UNIFORM:
+        return lo + below(s, hi - lo + 1);
+    case BENCH_DIST_NORMAL: {
+        /* Box-Muller */
+        double u1 = 1.0 - unit(s), u2 = unit(s);
+        double z = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+        double x = floor(0.5 * (lo + hi) + z * (hi - lo) / 6.0 + 0.5);
+        return x < lo ? lo : x > hi ? hi : (unsigned int)x;
+    }
+    }
+    return lo;
+}
+
+/* ============================================================================
+ * Record Kinds
+ * ============================================================================
+ */
+
+static unsigned int put_digits(unsigned int *v, unsigned int at, unsigned int value,
+                               unsigned int count) {
+    for (unsigned int i = count; i > 0; i--) {
+        v[at + i - 1] = value % 10;
+        value /= 10;
+    }
+    return at + count;
+}
+
+/* Check digit making v[0..len-1] pass the Luhn check */
+static unsigned int luhn_check_digit(const unsigned int *v, unsigned int len) {
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i + 1 < len; i++) {
+        unsigned int d = v[len - 2 - i];
+        if (i % 2 == 0) d = d * 2 > 9 ? d * 2 - 9 : d * 2;
+        sum += d;
+    }
+    return (10 - sum % 10) % 10;
+}
+
+/* Brand mix roughly like card traffic: Visa, Mastercard, Amex, Discover */
+static unsigned int gen_pan(uint64_t *s, const bench_dataset_spec *spec, unsigned int *v) {
+    unsigned int len, at;
+    if (spec->min_len) {
+        len = draw_len(s, spec);
+        at = put_digits(v, 0, 4, 1);
+    } else {
+        double u = unit(s);
+        len = 16;
+        if (u < 0.55) {
+            at = put_digits(v, 0, 4, 1);
+        } else if (u < 0.72) {
+            at = put_digits(v, 0, 51 + below(s, 5), 2);
+        } else if (u < 0.80) {
+            at = put_digits(v, 0, 2221 + below(s, 500), 4);
+        } else if (u < 0.92) {
+            at = put_digits(v, 0, below(s, 2) ? 37 : 34, 2);
+            len = 15;
+        } else {
+            at = below(s, 2) ? put_digits(v, 0, 6011, 4) : put_digits(v, 0, 65, 2);
+        }
+    }
+    while (at < len - 1) v[at++] = below(s, 10);
+    v[len - 1] = luhn_check_digit(v, len);
+    return len;
+}
+
+/* Area 001-899 except 666, group 01-99, serial 0001-9999 */
+static unsigned int gen_ssn(uint64_t *s, unsigned int *v) {
+    unsigned int area;
+    do {
+        area = 1 + below(s, 899);
+    } while (area == 666);
+    unsigned int at = put_digits(v, 0, area, 3);
+    at = put_digits(v, at, 1 + below(s, 99), 2);
+    return put_digits(v, at, 1 + below(s, 9999), 4);
+}
+
+/* NXX with N = 2-9 and not N11 */
+static unsigned int nxx(uint64_t *s) {
+    unsigned int x;
+    do {
+        x = 200 + below(s, 800);
+    } while (x % 100 == 11);
+    return x;
+}
+
+/* NANP: area code NXX, exchange NXX, line 0000-9999 */
+static unsigned int gen_phone(uint64_t *s, unsigned int *v) {
+    unsigned int at = put_digits(v, 0, nxx(s), 3);
+    at = put_digits(v, at, nxx(s), 3);
+    return put_digits(v, at, below(s, 10000), 4);
+}
+
+static unsigned int gen_id(uint64_t *s, const bench_dataset_spec *spec, unsigned int *v) {
+    unsigned int len = draw_len(s, spec);
+    for (unsigned int i = 0; i < len; i++) v[i] = below(s, spec->radix);
+    return len;
+}
+
+static unsigned int gen_record(uint64_t *s, const bench_dataset_spec *spec, unsigned int *v) {
+    switch (spec->kind) {
+    case BENCH_DATA_PAN: return gen_pan(s, spec, v);
+    case BENCH_DATA_SSN: return gen_ssn(s, v);
+    case BENCH_DATA_PHONE: return gen_phone(s, v);
+    case BENCH_DATA_ID: return gen_id(s, spec, v);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Spec Parsing
+ * ============================================================================
+ */
+
+static int parse_uint(const char *s, size_t len, unsigned long max, unsigned long *out) {
+    char *stop;
+    if (len == 0 || *s < '0' || *s > '9') return -1;
+    *out = strtoul(s, &stop, 10);
+    return stop == s + len && *out <= max ? 0 : -1;
+}
+
+static int parse_name(const char *s, size_t len, const char *const *names, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(names[i]) == len && strncmp(s, names[i], len) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static int parse_key(bench_dataset_spec *spec, const char *key, size_t key_len,
+                     const char *val, size_t val_len) {
+    unsigned long n;
+    if (key_len == 1 && *key == 'n') {
+        if (parse_uint(val, val_len, 1ul << 28, &n) != 0 || n == 0) return -1;
+        spec->count = n;
+    } else if (key_len == 3 && strncmp(key, "len", 3) == 0) {
+        const char *dash = memchr(val, '-', val_len);
+        size_t lo_len = dash ? (size_t)(dash - val) : val_len;
+        if (parse_uint(val, lo_len, DATA_MAX_LEN, &n) != 0 || n == 0) return -1;
+        spec->min_len = spec->max_len = (unsigned int)n;
+        if (dash) {
+            if (parse_uint(dash + 1, val_len - lo_len - 1, DATA_MAX_LEN, &n) != 0) return -1;
+            spec->max_len = (unsigned int)n;
+            if (spec->dist == BENCH_DIST_FIXED) spec->dist = BENCH_DIST_UNIFORM;
+        }
+    } else if (key_len == 4 && strncmp(key, "dist", 4) == 0) {
+        int d = parse_name(val, val_len, dist_names, 3);
+        if (d < 0) return -1;
+        spec->dist = (bench_len_dist)d;
+    } else if (key_len == 5 && strncmp(key, "radix", 5) == 0) {
+        if (parse_uint(val, val_len, 62, &n) != 0 || (n != 10 && n != 36 && n != 62)) return -1;
+        spec->radix = (unsigned int)n;
+    } else if (key_len == 4 && strncmp(key, "zipf", 4) == 0) {
+        char buf[32], *stop;
+        if (val_len == 0 || val_len >= sizeof(buf)) return -1;
+        memcpy(buf, val, val_len);
+        buf[val_len] = '\0';
+        spec->zipf = strtod(buf, &stop);
+        if (*stop || !(spec->zipf >= 0.0 && spec->zipf <= 10.0)) return -1;
+    } else if (key_len == 8 && strncmp(key, "distinct", 8) == 0) {
+        if (parse_uint(val, val_len, 1ul << 24, &n) != 0 || n == 0) return -1;
+        spec->distinct = (unsigned int)n;
+    } else if (key_len == 4 && strncmp(key, "seed", 4) == 0) {
+        if (parse_uint(val, val_len, ~0ul, &n) != 0) return -1;
+        spec->seed = n;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int bench_dataset_parse(const char *arg, bench_dataset_spec *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->count = 4096;
+    spec->radix = 10;
+    spec->distinct = 1024;
+    spec->seed = 1;
+
+    const char *colon = strchr(arg, ':');
+    size_t kind_len = colon ? (size_t)(colon - arg) : strlen(arg);
+    int kind = parse_name(arg, kind_len, kind_names, 4);
+    if (kind < 0) return -1;
+    spec->kind = (bench_data_kind)kind;
+    if (spec->kind == BENCH_DATA_ID) {
+        spec->radix = 36;
+        spec->min_len = 8;
+        spec->max_len = 24;
+        spec->dist = BENCH_DIST_UNIFORM;
+    }
+
+    const char *p = colon ? colon + 1 : arg + kind_len;
+    while (*p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char *eq = memchr(p, '=', len);
+        if (!eq || parse_key(spec, p, (size_t)(eq - p), eq + 1, len - (size_t)(eq - p) - 1) != 0) {
+            return -1;
+        }
+        p += len + (end ? 1 : 0);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * Generation
+ * ============================================================================
+ */
+
+void bench_dataset_free(bench_dataset *d) {
+    free(d->text);
+    free(d->digits);
+    free(d->offset);
+    free(d->len);
+    memset(d, 0, sizeof(*d));
+}
+
+/* First index whose cumulative weight exceeds u * total */
+static size_t zipf_pick(const double *cdf, size_t n, double u) {
+    double target = u * cdf[n - 1];
+    size_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cdf[mid] > target) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+int bench_dataset_generate(bench_dataset *d, const bench_dataset_spec *spec) {
+    memset(d, 0, sizeof(*d));
+    d->spec = *spec;
+
+    /* Natural lengths of PANs, SSNs and phone numbers are fixed by the kind */
+    if (spec->count == 0 || spec->min_len > spec->max_len) return -1;
+    if (spec->kind == BENCH_DATA_PAN && spec->min_len &&
+        (spec->min_len < 12 || spec->max_len > 19)) return -1;
+    if ((spec->kind == BENCH_DATA_SSN || spec->kind == BENCH_DATA_PHONE) &&
+        (spec->min_len || spec->radix != 10)) return -1;
+    if (spec->kind == BENCH_DATA_ID && spec->min_len == 0) return -1;
+    if (spec->kind != BENCH_DATA_ID && spec->radix != 10) return -1;
+
+    memcpy(d->alphabet, alphabet62, spec->radix);
+    d->alphabet[spec->radix] = '\0';
+
+    /* Values: one per record, or a pool of distinct ones to repeat from */
+    size_t values = spec->zipf > 0.0 ? spec->distinct : spec->count;
+    unsigned int *pool_len = (unsigned int *)malloc(values * sizeof(unsigned int));
+    size_t *pool_off = (size_t *)malloc(values * sizeof(size_t));
+    unsigned int *pool = NULL, v[DATA_MAX_LEN];
+    size_t *pick = (size_t *)malloc(spec->count * sizeof(size_t));
+    char *used = (char *)calloc(values, 1);
+    size_t pool_size = 0, pool_cap = 0;
+    uint64_t s = spec->seed;
+    int ret = -1;
+    if (!pool_len || !pool_off || !pick || !used) goto done;
+
+    for (size_t i = 0; i < values; i++) {
+        unsigned int len = gen_record(&s, spec, v);
+        if (pool_size + len > pool_cap) {
+            pool_cap = pool_cap * 2 + len + 1024;
+            unsigned int *grown = (unsigned int *)realloc(pool, pool_cap * sizeof(unsigned int));
+            if (!grown) goto done;
+            pool = grown;
+        }
+        memcpy(pool + pool_size, v, len * sizeof(unsigned int));
+        pool_off[i] = pool_size;
+        pool_len[i] = len;
+        pool_size += len;
+    }
+
+    if (spec->zipf > 0.0) {
+        /* Rank k has weight 1 / k^s; ranks are independent of the values */
+        double *cdf = (double *)malloc(values * sizeof(double)), sum = 0.0;
+        if (!cdf) goto done;
+        for (size_t k = 0; k < values; k++) {
+            sum += 1.0 / pow((double)(k + 1), spec->zipf);
+            cdf[k] = sum;
+        }
+        for (size_t r = 0; r < spec->count; r++) pick[r] = zipf_pick(cdf, values, unit(&s));
+        free(cdf);
+    } else {
+        for (size_t r = 0; r < spec->count; r++) pick[r] = r;
+    }
+
+    size_t total = 0;
+    for (size_t r = 0; r < spec->count; r++) total += pool_len[pick[r]] + 1;
+    d->count = spec->count;
+    d->text = (char *)malloc(total);
+    d->digits = (unsigned int *)malloc(total * sizeof(unsigned int));
+    d->offset = (size_t *)malloc(d->count * sizeof(size_t));
+    d->len = (unsigned int *)malloc(d->count * sizeof(unsigned int));
+    if (!d->text || !d->digits || !d->offset || !d->len) goto done;
+
+    size_t at = 0;
+    d->min_len = DATA_MAX_LEN;
+    for (size_t r = 0; r < d->count; r++) {
+        size_t p = pick[r];
+        unsigned int len = pool_len[p];
+        memcpy(d->digits + at, pool + pool_off[p], len * sizeof(unsigned int));
+        for (unsigned int k = 0; k < len; k++) d->text[at + k] = alphabet62[d->digits[at + k]];
+        d->text[at + len] = '\0';
+        d->digits[at + len] = 0;
+        d->offset[r] = at;
+        d->len[r] = len;
+        at += len + 1;
+
+        if (len < d->min_len) d->min_len = len;
+        if (len > d->max_len) d->max_len = len;
+        d->mean_len += len;
+        if (!used[p]) {
+            used[p] = 1;
+            d->unique++;
+        }
+    }
+    d->mean_len /= (double)d->count;
+    ret = 0;
+
+done:
+    free(pool);
+    free(pool_len);
+    free(pool_off);
+    free(pick);
+    free(used);
+    if (ret != 0) bench_dataset_free(d);
+    return ret;
+}
+
+const char *bench_data_kind_label(bench_data_kind kind) {
+    return kind_names[kind];
+}
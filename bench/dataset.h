@@ -0,0 +1,82 @@
+/**
+ * @file dataset.h
+ * @brief Deterministic synthetic datasets for the benchmarks
+ *
+ * A dataset is a seeded list of records that look like production data:
+ * card numbers with valid Luhn digits and real brand prefixes, SSNs,
+ * NANP phone numbers and alphanumeric IDs, with lengths drawn from a
+ * distribution and values optionally repeated with Zipf skew. The same
+ * spec and seed always give the same records.
+ *
+ * Spec strings are KIND[:key=value,...], e.g.
+ *   pan
+ *   ssn:n=100000,zipf=1.1,distinct=5000
+ *   id:len=8-24,dist=normal,radix=62
+ *
+ * Keys: n (records, default 4096), len=MIN[-MAX], dist=fixed|uniform|normal,
+ * radix (10, 36 or 62; ids only), zipf (skew exponent, 0 = no repeats),
+ * distinct (values repeated values are drawn from, default 1024), seed.
+ */
+
+#ifndef FPE_BENCH_DATASET_H
+#define FPE_BENCH_DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    BENCH_DATA_PAN = 0,    /* Card numbers, brand mix of 15/16-digit PANs */
+    BENCH_DATA_SSN,        /* 9-digit SSNs from the valid area/group/serial ranges */
+    BENCH_DATA_PHONE,      /* 10-digit NANP numbers */
+    BENCH_DATA_ID          /* Alphanumeric IDs */
+} bench_data_kind;
+
+typedef enum {
+    BENCH_DIST_FIXED = 0,  /* Always min_len */
+    BENCH_DIST_UNIFORM,    /* Uniform on min_len..max_len */
+    BENCH_DIST_NORMAL      /* Centred in the range, sd = range / 6, clamped */
+} bench_len_dist;
+
+typedef struct {
+    bench_data_kind kind;
+    size_t count;
+    unsigned int radix;
+    unsigned int min_len;      /* 0 = the kind's natural lengths */
+    unsigned int max_len;
+    bench_len_dist dist;
+    double zipf;
+    unsigned int distinct;
+    uint64_t seed;
+} bench_dataset_spec;
+
+typedef struct {
+    bench_dataset_spec spec;
+    char alphabet[63];         /* Prefix of 0-9a-zA-Z, radix characters */
+    size_t count;
+    char *text;                /* Records, NUL-terminated, back to back */
+    unsigned int *digits;      /* The same records as alphabet indices */
+    size_t *offset;            /* Record r is at text + offset[r] and digits + offset[r] */
+    unsigned int *len;
+    unsigned int min_len;
+    unsigned int max_len;
+    double mean_len;
+    size_t unique;             /* Distinct values among the records */
+} bench_dataset;
+
+/**
+ * Parse a spec string, filling in defaults for the keys it omits.
+ * @return 0 on success, -1 on an unknown kind, key or bad value
+ */
+int bench_dataset_parse(const char *arg, bench_dataset_spec *spec);
+
+/**
+ * Generate the records of a spec.
+ * @return 0 on success, -1 on an inconsistent spec or OOM
+ */
+int bench_dataset_generate(bench_dataset *d, const bench_dataset_spec *spec);
+
+void bench_dataset_free(bench_dataset *d);
+
+const char *bench_data_kind_label(bench_data_kind kind);
+
+#endif /* FPE_BENCH_DATASET_H */
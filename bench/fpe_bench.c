@@ -0,0 +1,336 @@
+/**
+ * @file fpe_bench.c
+ * @brief fpe_bench: latency and throughput over a parameter matrix
+ *
+ * Every cell of mode x algorithm x key bits x radix x length x API is
+ * warmed up, then timed one call at a time with the calibrated timer until
+ * its time budget is spent. Each cell reports ops/s and the p50/p90/p99/
+ * p99.9 latency per operation; for the batch API one call covers -B
+ * records and latency is per record. Cells the library rejects (e.g. SM4
+ * with a 256-bit key, or a length outside FF3's range) are skipped.
+ *
+ * Usage:
+ *   fpe_bench [-m MODES] [-a ALGOS] [-b BITS] [-r RADIXES] [-l LENGTHS]
+ *             [-A APIS] [-t SEC] [-w SEC] [-B N] [-d] [-T TIMER]
+ *             [-D SPEC] [-P] [-f text|json|csv] [-o FILE] [-v]
+ *
+ * Lists are comma-separated, e.g. -m ff1,ff3-1 -l 9,16 -A array,batch.
+ *
+ * With -D SPEC the cells cycle through a synthetic dataset (see dataset.h)
+ * instead of uniform random inputs of one length: -r and -l are replaced
+ * by the dataset's radix and lengths, "len" reports the mean length, and
+ * batches of mixed lengths go through FPE_encrypt_iov.
+ *
+ * With -P each cell is run a second time, untimed and for as many calls,
+ * inside Linux perf_event_open counters, and reports cycles, instructions,
+ * branch misses and L1D misses per operation plus IPC. Counters the system
+ * does not provide are reported as null.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "perf.h"
+#include "workload.h"
+
+/* Calls between deadline checks */
+#define BENCH_CHECK_EVERY 16
+
+/* Bound on samples kept per cell */
+#define BENCH_MAX_SAMPLES (1u << 22)
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================
+ */
+
+typedef struct {
+    bench_list modes;
+    bench_list algos;
+    bench_list bits;
+    bench_list radixes;
+    bench_list lengths;
+    bench_list apis;
+    double time;
+    double warmup;
+    unsigned int batch;
+    int decrypt;
+    int verbose;
+    int perf;
+    bench_timer_kind timer;
+    bench_format format;
+    const char *output;
+    const char *dataset;
+} bench_config;
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_bench [options]\n"
+        "\n"
+        "  -m MODES    ff1,ff3,ff3-1 (default: all)\n"
+        "  -a ALGOS    aes,sm4 (default: both)\n"
+        "  -b BITS     Key sizes (default: 128,256)\n"
+        "  -r RADIXES  Radixes (default: 10,16)\n"
+        "  -l LENGTHS  Input lengths (default: 8,16,32)\n"
+        "  -A APIS     array,str,oneshot,batch (default: all)\n"
+        "  -t SEC      Measured time per cell (default 0.1)\n"
+        "  -w SEC      Warmup time per cell (default 0.02)\n"
+        "  -B N        Records per batch call (default 64)\n"
+        "  -d          Benchmark decryption instead of encryption\n"
+        "  -T TIMER    auto, tsc or monotonic (default auto)\n"
+        "  -D SPEC     Cycle through a synthetic dataset, e.g. pan, ssn, phone or\n"
+        "              id:len=8-24,dist=normal,zipf=1.1 (replaces -r and -l)\n"
+        "  -P          Report hardware counters per operation (Linux perf)\n"
+        "  -f FORMAT   text, json or csv (default text)\n"
+        "  -o FILE     Output file (default: stdout)\n"
+        "  -v          Report skipped cells on stderr\n");
+}
+
+/* ============================================================================
+ * Measurement
+ * ============================================================================
+ */
+
+typedef struct {
+    bench_stats stats;     /* Per-operation latency, ns */
+    double ops_per_sec;
+    size_t ops;
+    double counters[BENCH_PERF_COUNT];   /* Per operation, with -P */
+} cell_result;
+
+/**
+ * Warm up, then time calls one at a time until the budget is spent.
+ * @return 0 on success, 1 if the library rejects the cell, -1 on error
+ */
+static int run_cell(const bench_config *cfg, const bench_cell *c, bench_samples *samples,
+                    bench_perf *perf, cell_result *res) {
+    bench_workload w;
+    if (bench_workload_init(&w, c, 0) != 0 || bench_workload_call(&w, 0) != 0) {
+        bench_workload_free(&w);
+        return 1;
+    }
+
+    size_t i = 0;
+    double end = bench_now() + cfg->warmup;
+    while (bench_now() < end) {
+        for (int k = 0; k < BENCH_CHECK_EVERY; k++) bench_workload_call(&w, i++);
+    }
+
+    bench_samples_reset(samples);
+    uint64_t total = 0;
+    int ret = 0;
+    end = bench_now() + cfg->time;
+    while (bench_now() < end && samples->n < BENCH_MAX_SAMPLES) {
+        for (int k = 0; k < BENCH_CHECK_EVERY; k++) {
+            uint64_t t0 = bench_ticks();
+            ret |= bench_workload_call(&w, i++);
+            uint64_t t1 = bench_ticks();
+            total += t1 - t0;
+            if (bench_samples_push(samples, bench_ticks_to_ns(t1 - t0) / w.per_call) != 0) {
+                bench_workload_free(&w);
+                return -1;
+            }
+        }
+    }
+
+    res->ops = samples->n * w.per_call;
+    res->ops_per_sec = (double)res->ops / (bench_ticks_to_ns(total) * 1e-9);
+
+    /* Counted pass: as many calls again, without timer reads in the loop */
+    for (int k = 0; k < BENCH_PERF_COUNT; k++) res->counters[k] = NAN;
+    if (cfg->perf) {
+        bench_perf_start(perf);
+        for (size_t k = 0; k < samples->n; k++) ret |= bench_workload_call(&w, i++);
+        bench_perf_stop(perf);
+        for (int k = 0; k < BENCH_PERF_COUNT; k++) {
+            res->counters[k] = perf->value[k] / (double)res->ops;
+        }
+    }
+    bench_workload_free(&w);
+    if (ret != 0) return -1;
+
+    bench_stats_compute(samples, &res->stats);
+    return 0;
+}
+
+static void report_cell(bench_report *report, const bench_cell *c, const cell_result *res,
+                        int with_counters) {
+    const bench_stats *st = &res->stats;
+    double len = c->data ? c->data->mean_len : c->len;
+    bench_field fields[] = {
+        BENCH_STR("mode", bench_mode_label(c->mode)),
+        BENCH_STR("algo", bench_algo_label(c->algo)),
+        BENCH_NUM("bits", c->bits, 0),
+        BENCH_NUM("radix", c->radix, 0),
+        BENCH_NUM("len", len, c->data ? 1 : 0),
+        BENCH_STR("api", bench_api_names[c->api]),
+        BENCH_STR("op", c->decrypt ? "decrypt" : "encrypt"),
+        BENCH_NUM("samples", st->count, 0),
+        BENCH_NUM("ops_per_sec", res->ops_per_sec, 0),
+        BENCH_NUM("mean_ns", st->mean, 1),
+        BENCH_NUM("stddev_ns", st->stddev, 1),
+        BENCH_NUM("p50_ns", st->p50, 1),
+        BENCH_NUM("p90_ns", st->p90, 1),
+        BENCH_NUM("p99_ns", st->p99, 1),
+        BENCH_NUM("p999_ns", st->p999, 1),
+        BENCH_NUM("min_ns", st->min, 1),
+        BENCH_NUM("max_ns", st->max, 1),
+        BENCH_NUM("outliers", st->outliers, 0),
+        BENCH_NUM("cycles_per_op", res->counters[BENCH_PERF_CYCLES], 1),
+        BENCH_NUM("instructions_per_op", res->counters[BENCH_PERF_INSTRUCTIONS], 1),
+        BENCH_NUM("ipc", res->counters[BENCH_PERF_INSTRUCTIONS] /
+                         res->counters[BENCH_PERF_CYCLES], 2),
+        BENCH_NUM("branch_misses_per_op", res->counters[BENCH_PERF_BRANCH_MISSES], 2),
+        BENCH_NUM("l1d_misses_per_op", res->counters[BENCH_PERF_L1D_MISSES], 2),
+    };
+    size_t n = sizeof(fields) / sizeof(fields[0]);
+    bench_report_row(report, fields, with_counters ? n : n - BENCH_PERF_COUNT - 1);
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+int main(int argc, char **argv) {
+    bench_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    bench_parse_list("ff1,ff3,ff3-1", &cfg.modes, bench_mode_names, bench_mode_values, 3);
+    bench_parse_list("aes,sm4", &cfg.algos, bench_algo_names, bench_algo_values, 2);
+    bench_parse_list("128,256", &cfg.bits, NULL, NULL, 0);
+    bench_parse_list("10,16", &cfg.radixes, NULL, NULL, 0);
+    bench_parse_list("8,16,32", &cfg.lengths, NULL, NULL, 0);
+    bench_parse_list("array,str,oneshot,batch", &cfg.apis, bench_api_names,
+                     bench_api_values, 4);
+    cfg.time = 0.1;
+    cfg.warmup = 0.02;
+    cfg.batch = 64;
+    cfg.timer = BENCH_TIMER_AUTO;
+    cfg.format = BENCH_FORMAT_TEXT;
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "m:a:b:r:l:A:t:w:B:dD:PT:f:o:vh")) != -1) {
+        switch (opt) {
+        case 'm':
+            bad |= bench_parse_list(optarg, &cfg.modes, bench_mode_names, bench_mode_values, 3);
+            break;
+        case 'a':
+            bad |= bench_parse_list(optarg, &cfg.algos, bench_algo_names, bench_algo_values, 2);
+            break;
+        case 'b': bad |= bench_parse_list(optarg, &cfg.bits, NULL, NULL, 0); break;
+        case 'r': bad |= bench_parse_list(optarg, &cfg.radixes, NULL, NULL, 0); break;
+        case 'l': bad |= bench_parse_list(optarg, &cfg.lengths, NULL, NULL, 0); break;
+        case 'A':
+            bad |= bench_parse_list(optarg, &cfg.apis, bench_api_names, bench_api_values, 4);
+            break;
+        case 't': cfg.time = atof(optarg); bad |= cfg.time <= 0.0; break;
+        case 'w': cfg.warmup = atof(optarg); bad |= cfg.warmup < 0.0; break;
+        case 'B': cfg.batch = (unsigned int)atoi(optarg); bad |= cfg.batch == 0; break;
+        case 'd': cfg.decrypt = 1; break;
+        case 'D': cfg.dataset = optarg; break;
+        case 'P': cfg.perf = 1; break;
+        case 'T':
+            if (strcmp(optarg, "auto") == 0) cfg.timer = BENCH_TIMER_AUTO;
+            else if (strcmp(optarg, "tsc") == 0) cfg.timer = BENCH_TIMER_TSC;
+            else if (strcmp(optarg, "monotonic") == 0) cfg.timer = BENCH_TIMER_MONOTONIC;
+            else bad = 1;
+            break;
+        case 'f': bad |= bench_format_parse(optarg, &cfg.format); break;
+        case 'o': cfg.output = optarg; break;
+        case 'v': cfg.verbose = 1; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    if (bad || optind != argc) {
+        usage(stderr);
+        return 2;
+    }
+
+    bench_dataset data;
+    memset(&data, 0, sizeof(data));
+    if (cfg.dataset) {
+        bench_dataset_spec spec;
+        if (bench_dataset_parse(cfg.dataset, &spec) != 0 ||
+            bench_dataset_generate(&data, &spec) != 0) {
+            fprintf(stderr, "fpe_bench: bad dataset spec '%s'\n", cfg.dataset);
+            return 2;
+        }
+        cfg.radixes.n = cfg.lengths.n = 1;
+        cfg.radixes.v[0] = spec.radix;
+        cfg.lengths.v[0] = (unsigned int)(data.mean_len + 0.5);
+    }
+
+    if (bench_timer_init(cfg.timer) != 0) {
+        fprintf(stderr, "fpe_bench: timer not available on this machine\n");
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (cfg.output && !(out = fopen(cfg.output, "w"))) {
+        perror(cfg.output);
+        return 1;
+    }
+
+    bench_perf perf;
+    if (cfg.perf && bench_perf_open(&perf) < BENCH_PERF_COUNT) {
+        fprintf(stderr, "fpe_bench: some hardware counters are unavailable (%s); "
+                "they are reported as null\n",
+                perf.error > 0 ? strerror(perf.error) : "not supported on this platform");
+    }
+
+    bench_report report;
+    bench_samples samples = {NULL, 0, 0};
+    bench_report_begin(&report, cfg.format, out, "fpe_bench");
+
+    int status = 0;
+    for (unsigned int m = 0; m < cfg.modes.n; m++)
+    for (unsigned int a = 0; a < cfg.algos.n; a++)
+    for (unsigned int b = 0; b < cfg.bits.n; b++)
+    for (unsigned int r = 0; r < cfg.radixes.n; r++)
+    for (unsigned int l = 0; l < cfg.lengths.n; l++)
+    for (unsigned int p = 0; p < cfg.apis.n; p++) {
+        bench_cell cell = {
+            (FPE_MODE)cfg.modes.v[m], (FPE_ALGO)cfg.algos.v[a], cfg.bits.v[b],
+            cfg.radixes.v[r], cfg.lengths.v[l], (bench_api)cfg.apis.v[p], cfg.batch,
+            cfg.decrypt, cfg.dataset ? &data : NULL
+        };
+        cell_result res;
+        int ret = run_cell(&cfg, &cell, &samples, &perf, &res);
+        if (ret == 0) {
+            report_cell(&report, &cell, &res, cfg.perf);
+        } else if (ret > 0) {
+            if (cfg.verbose) {
+                fprintf(stderr, "skip: %s %s-%u radix %u len %u %s\n",
+                        bench_mode_label(cell.mode), bench_algo_label(cell.algo), cell.bits,
+                        cell.radix, cell.len, bench_api_names[cell.api]);
+            }
+        } else {
+            fprintf(stderr, "fpe_bench: %s %s-%u radix %u len %u %s failed while timing\n",
+                    bench_mode_label(cell.mode), bench_algo_label(cell.algo),
+                    cell.bits, cell.radix, cell.len, bench_api_names[cell.api]);
+            status = 1;
+        }
+    }
+
+    if (cfg.dataset) {
+        bench_field summary[] = {
+            BENCH_STR("dataset", cfg.dataset),
+            BENCH_NUM("records", data.count, 0),
+            BENCH_NUM("unique", data.unique, 0),
+            BENCH_NUM("min_len", data.min_len, 0),
+            BENCH_NUM("mean_len", data.mean_len, 2),
+            BENCH_NUM("max_len", data.max_len, 0),
+        };
+        bench_report_summary(&report, summary, 6);
+    }
+    bench_report_end(&report);
+    bench_dataset_free(&data);
+    if (cfg.perf) bench_perf_close(&perf);
+    bench_samples_free(&samples);
+    if (out != stdout) fclose(out);
+    return status;
+}
@@ -0,0 +1,364 @@
+/**
+ * @file fpe_coldstart.c
+ * @brief fpe_coldstart: cold-start latency and context lifecycle costs
+ *
+ * Short-lived processes (CLI tools, serverless handlers, per-request
+ * workers) pay for FPE_CTX_new + FPE_CTX_init + the first FPE_encrypt
+ * before any steady-state number applies: OpenSSL cipher lookup, first
+ * touches of the library's pages and caches. Services that hold one
+ * context per key pay the per-context memory and the create/destroy cost.
+ * For every mode x algorithm x key bits cell this tool reports:
+ *
+ *   - cold start: new, init and first-call latency in a fresh process,
+ *     median and p90 over -c runs, and the second call for comparison
+ *   - lifecycle: FPE_CTX_new, FPE_CTX_init and FPE_CTX_free latency over
+ *     -n contexts with distinct keys, and the resident memory they hold
+ *     (RSS delta / contexts)
+ *   - steady state: median FPE_encrypt latency on a warm context
+ *
+ * Both fresh-process measurements run in child processes: the tool
+ * re-executes itself with the hidden option -X cold or -X contexts, so the
+ * parent's warm library, allocator and page state never leak into them.
+ *
+ * Usage:
+ *   fpe_coldstart [-m MODES] [-a ALGOS] [-b BITS] [-r RADIX] [-l LEN]
+ *                 [-c RUNS] [-n CONTEXTS] [-f text|json|csv] [-o FILE]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "workload.h"
+
+/* Steady-state timing per cell */
+#define COLD_STEADY_SEC 0.05
+#define COLD_CHECK_EVERY 16
+
+/* ============================================================================
+ * Child Processes
+ * ============================================================================
+ */
+
+static void cell_key(unsigned char *key, size_t index) {
+    for (unsigned int i = 0; i < 32; i++) key[i] = (unsigned char)(i * 7 + 1);
+    memcpy(key, &index, sizeof(index));
+}
+
+static void cell_input(const bench_cell *c, unsigned int *in) {
+    for (unsigned int i = 0; i < c->len; i++) in[i] = (i * 7 + 3) % c->radix;
+}
+
+/*
+ * -X cold: print "new_ns init_ns first_ns second_ns" for one context in
+ * this (fresh) process. The monotonic clock needs no calibration, which
+ * would otherwise run first and warm the process up.
+ */
+static int child_cold(const bench_cell *c) {
+    unsigned char key[32], tweak[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    unsigned int tweak_len = c->mode == FPE_MODE_FF3_1 ? 7 : 8;
+    unsigned int *in = (unsigned int *)malloc(c->len * sizeof(unsigned int));
+    unsigned int *out = (unsigned int *)malloc(c->len * sizeof(unsigned int));
+    if (!in || !out) return 1;
+    cell_key(key, 0);
+    cell_input(c, in);
+    bench_timer_init(BENCH_TIMER_MONOTONIC);
+
+    uint64_t t0 = bench_ticks();
+    FPE_CTX *ctx = FPE_CTX_new();
+    uint64_t t1 = bench_ticks();
+    int ret = ctx ? FPE_CTX_init(ctx, c->mode, c->algo, key, c->bits, c->radix) : -1;
+    uint64_t t2 = bench_ticks();
+    ret |= ret == 0 ? FPE_encrypt(ctx, in, out, c->len, tweak, tweak_len) : -1;
+    uint64_t t3 = bench_ticks();
+    ret |= ret == 0 ? FPE_encrypt(ctx, out, in, c->len, tweak, tweak_len) : -1;
+    uint64_t t4 = bench_ticks();
+
+    FPE_CTX_free(ctx);
+    free(in);
+    free(out);
+    if (ret != 0) return 1;
+    printf("%.1f %.1f %.1f %.1f\n", bench_ticks_to_ns(t1 - t0), bench_ticks_to_ns(t2 - t1),
+           bench_ticks_to_ns(t3 - t2), bench_ticks_to_ns(t4 - t3));
+    return 0;
+}
+
+/*
+ * -X contexts: create count contexts with distinct keys, then free them.
+ * Prints "new_p50 init_p50 init_p99 free_p50 bytes_per_ctx". One context
+ * is created and freed first so one-time library setup is not counted.
+ */
+static int child_contexts(const bench_cell *c, size_t count) {
+    FPE_CTX **ctx = (FPE_CTX **)calloc(count, sizeof(FPE_CTX *));
+    bench_samples new_s = {NULL, 0, 0}, init_s = {NULL, 0, 0}, free_s = {NULL, 0, 0};
+    unsigned char key[32];
+    int ret = ctx ? 0 : -1;
+    bench_timer_init(BENCH_TIMER_AUTO);
+
+    cell_key(key, count);
+    FPE_CTX *warm = FPE_CTX_new();
+    if (!warm || FPE_CTX_init(warm, c->mode, c->algo, key, c->bits, c->radix) != 0) ret = -1;
+    FPE_CTX_free(warm);
+
+    /* Sample buffers are sized before the baseline so they do not count */
+    for (size_t i = 0; i < count && ret == 0; i++) {
+        ret |= bench_samples_push(&new_s, 0.0) | bench_samples_push(&init_s, 0.0) |
+               bench_samples_push(&free_s, 0.0);
+    }
+    bench_samples_reset(&new_s);
+    bench_samples_reset(&init_s);
+    bench_samples_reset(&free_s);
+
+    double rss0 = bench_rss_bytes();
+    for (size_t i = 0; i < count && ret == 0; i++) {
+        cell_key(key, i);
+        uint64_t t0 = bench_ticks();
+        ctx[i] = FPE_CTX_new();
+        uint64_t t1 = bench_ticks();
+        if (!ctx[i] || FPE_CTX_init(ctx[i], c->mode, c->algo, key, c->bits, c->radix) != 0) {
+            ret = -1;
+        }
+        uint64_t t2 = bench_ticks();
+        bench_samples_push(&new_s, bench_ticks_to_ns(t1 - t0));
+        bench_samples_push(&init_s, bench_ticks_to_ns(t2 - t1));
+    }
+    double rss1 = bench_rss_bytes();
+
+    for (size_t i = 0; i < count && ctx; i++) {
+        uint64_t t0 = bench_ticks();
+        FPE_CTX_free(ctx[i]);
+        uint64_t t1 = bench_ticks();
+        bench_samples_push(&free_s, bench_ticks_to_ns(t1 - t0));
+    }
+    free(ctx);
+
+    if (ret == 0) {
+        bench_stats ns, is, fs;
+        bench_stats_compute(&new_s, &ns);
+        bench_stats_compute(&init_s, &is);
+        bench_stats_compute(&free_s, &fs);
+        printf("%.1f %.1f %.1f %.1f %.1f\n", ns.p50, is.p50, is.p99, fs.p50,
+               (rss1 - rss0) / (double)count);
+    }
+    bench_samples_free(&new_s);
+    bench_samples_free(&init_s);
+    bench_samples_free(&free_s);
+    return ret != 0;
+}
+
+static const char *option_name(unsigned int value, const char *const *names,
+                               const unsigned int *values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (values[i] == value) return names[i];
+    }
+    return names[0];
+}
+
+/*
+ * Run this program as a child with the cell's options and read its one
+ * line of numbers. Returns the count of numbers read, 0 on failure.
+ */
+static int run_child(const char *self, const char *what, const bench_cell *c, size_t contexts,
+                     double *v, int count) {
+    char cmd[4200];
+    snprintf(cmd, sizeof(cmd), "'%s' -X %s -m %s -a %s -b %u -r %u -l %u -n %zu", self, what,
+             option_name(c->mode, bench_mode_names, bench_mode_values, 3),
+             option_name(c->algo, bench_algo_names, bench_algo_values, 2),
+             c->bits, c->radix, c->len, contexts);
+    FILE *p = popen(cmd, "r");
+    if (!p) return 0;
+    int n = 0;
+    while (n < count && fscanf(p, "%lf", &v[n]) == 1) n++;
+    return pclose(p) == 0 && n == count ? n : 0;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_coldstart [options]\n"
+        "\n"
+        "  -m MODES     ff1,ff3,ff3-1 (default: all)\n"
+        "  -a ALGOS     aes,sm4 (default: both)\n"
+        "  -b BITS      Key sizes (default: 128)\n"
+        "  -r RADIX     Radix (default 10)\n"
+        "  -l LEN       Input length (default 16)\n"
+        "  -c RUNS      Fresh processes per cell for cold-start latency (default 20)\n"
+        "  -n CONTEXTS  Contexts created per cell for lifecycle costs (default 100000)\n"
+        "  -f FORMAT    text, json or csv (default text)\n"
+        "  -o FILE      Output file (default: stdout)\n");
+}
+
+static double steady_ns(const bench_cell *c, bench_samples *samples) {
+    bench_workload w;
+    if (bench_workload_init(&w, c, 0) != 0) {
+        bench_workload_free(&w);
+        return -1.0;
+    }
+    size_t i = 0;
+    bench_samples_reset(samples);
+    double end = bench_now() + COLD_STEADY_SEC;
+    while (bench_now() < end) {
+        for (int k = 0; k < COLD_CHECK_EVERY; k++) {
+            uint64_t t0 = bench_ticks();
+            bench_workload_call(&w, i++);
+            uint64_t t1 = bench_ticks();
+            bench_samples_push(samples, bench_ticks_to_ns(t1 - t0));
+        }
+    }
+    bench_workload_free(&w);
+    bench_stats st;
+    bench_stats_compute(samples, &st);
+    return st.p50;
+}
+
+int main(int argc, char **argv) {
+    bench_list modes, algos, bits, one;
+    bench_parse_list("ff1,ff3,ff3-1", &modes, bench_mode_names, bench_mode_values, 3);
+    bench_parse_list("aes,sm4", &algos, bench_algo_names, bench_algo_values, 2);
+    bench_parse_list("128", &bits, NULL, NULL, 0);
+    unsigned int radix = 10, len = 16, runs = 20;
+    unsigned long contexts = 100000;
+    const char *child = NULL, *output = NULL;
+    bench_format format = BENCH_FORMAT_TEXT;
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "m:a:b:r:l:c:n:X:f:o:h")) != -1) {
+        switch (opt) {
+        case 'm': bad |= bench_parse_list(optarg, &modes, bench_mode_names, bench_mode_values, 3); break;
+        case 'a': bad |= bench_parse_list(optarg, &algos, bench_algo_names, bench_algo_values, 2); break;
+        case 'b': bad |= bench_parse_list(optarg, &bits, NULL, NULL, 0); break;
+        case 'r':
+            bad |= bench_parse_list(optarg, &one, NULL, NULL, 0) || one.n != 1;
+            radix = one.v[0];
+            break;
+        case 'l':
+            bad |= bench_parse_list(optarg, &one, NULL, NULL, 0) || one.n != 1;
+            len = one.v[0];
+            break;
+        case 'c':
+            bad |= bench_parse_list(optarg, &one, NULL, NULL, 0) || one.n != 1;
+            runs = one.v[0];
+            break;
+        case 'n': contexts = strtoul(optarg, NULL, 10); bad |= contexts == 0; break;
+        case 'X': child = optarg; break;
+        case 'f': bad |= bench_format_parse(optarg, &format); break;
+        case 'o': output = optarg; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    if (bad || optind != argc) {
+        usage(stderr);
+        return 2;
+    }
+
+    if (child) {
+        bench_cell c = {(FPE_MODE)modes.v[0], (FPE_ALGO)algos.v[0], bits.v[0], radix, len,
+                        BENCH_API_ARRAY, 1, 0, NULL};
+        if (strcmp(child, "cold") == 0) return child_cold(&c);
+        if (strcmp(child, "contexts") == 0) return child_contexts(&c, contexts);
+        return 2;
+    }
+
+    char self[4096];
+#if defined(__linux__)
+    ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (n <= 0) return 1;
+    self[n] = '\0';
+#else
+    snprintf(self, sizeof(self), "%s", argv[0]);
+#endif
+    if (strchr(self, '\'')) {
+        fprintf(stderr, "fpe_coldstart: cannot re-execute %s\n", self);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (output && !(out = fopen(output, "w"))) {
+        perror(output);
+        return 1;
+    }
+
+    bench_timer_init(BENCH_TIMER_AUTO);
+    bench_samples cold = {NULL, 0, 0}, samples = {NULL, 0, 0};
+    bench_report report;
+    bench_report_begin(&report, format, out, "fpe_coldstart");
+
+    int status = 0;
+    for (unsigned int m = 0; m < modes.n; m++)
+    for (unsigned int a = 0; a < algos.n; a++)
+    for (unsigned int b = 0; b < bits.n; b++) {
+        bench_cell c = {(FPE_MODE)modes.v[m], (FPE_ALGO)algos.v[a], bits.v[b], radix, len,
+                        BENCH_API_ARRAY, 1, 0, NULL};
+        double steady = steady_ns(&c, &samples);
+        if (steady < 0.0) continue;   /* Rejected by the library */
+
+        /* Cold runs: medians of each phase, and the distribution of the total */
+        double v[4], p50[4] = {0.0, 0.0, 0.0, 0.0};
+        bench_samples phase[4] = {{NULL, 0, 0}, {NULL, 0, 0}, {NULL, 0, 0}, {NULL, 0, 0}};
+        bench_samples_reset(&cold);
+        int ok = 1;
+        for (unsigned int r = 0; r < runs && ok; r++) {
+            ok = run_child(self, "cold", &c, 1, v, 4) == 4;
+            for (int k = 0; k < 4 && ok; k++) bench_samples_push(&phase[k], v[k]);
+            if (ok) bench_samples_push(&cold, v[0] + v[1] + v[2]);
+        }
+        bench_stats total, st;
+        for (int k = 0; k < 4; k++) {
+            if (ok) {
+                bench_stats_compute(&phase[k], &st);
+                p50[k] = st.p50;
+            }
+            bench_samples_free(&phase[k]);
+        }
+        if (ok) bench_stats_compute(&cold, &total);
+
+        double life[5];
+        if (!ok || run_child(self, "contexts", &c, contexts, life, 5) != 5) {
+            fprintf(stderr, "fpe_coldstart: %s %s-%u: child process failed\n",
+                    bench_mode_label(c.mode), bench_algo_label(c.algo), c.bits);
+            status = 1;
+            continue;
+        }
+
+        bench_field fields[] = {
+            BENCH_STR("mode", bench_mode_label(c.mode)),
+            BENCH_STR("algo", bench_algo_label(c.algo)),
+            BENCH_NUM("bits", c.bits, 0),
+            BENCH_NUM("radix", c.radix, 0),
+            BENCH_NUM("len", c.len, 0),
+            BENCH_NUM("cold_new_ns", p50[0], 0),
+            BENCH_NUM("cold_init_ns", p50[1], 0),
+            BENCH_NUM("cold_first_ns", p50[2], 0),
+            BENCH_NUM("cold_second_ns", p50[3], 0),
+            BENCH_NUM("cold_total_p50_ns", total.p50, 0),
+            BENCH_NUM("cold_total_p90_ns", total.p90, 0),
+            BENCH_NUM("new_ns", life[0], 1),
+            BENCH_NUM("init_ns", life[1], 1),
+            BENCH_NUM("init_p99_ns", life[2], 1),
+            BENCH_NUM("free_ns", life[3], 1),
+            BENCH_NUM("bytes_per_ctx", life[4], 0),
+            BENCH_NUM("steady_ns", steady, 1),
+            BENCH_NUM("first_vs_steady", p50[2] / steady, 1),
+        };
+        bench_report_row(&report, fields, sizeof(fields) / sizeof(fields[0]));
+    }
+
+    bench_field summary[] = {
+        BENCH_NUM("cold_runs", runs, 0),
+        BENCH_NUM("contexts", contexts, 0),
+    };
+    bench_report_summary(&report, summary, 2);
+    bench_report_end(&report);
+    bench_samples_free(&cold);
+    bench_samples_free(&samples);
+    if (out != stdout) fclose(out);
+    return status;
+}
@@ -0,0 +1,461 @@
+/**
+ * @file fpe_microbench.c
+ * @brief fpe_microbench: per-kernel timings of the library's internal hot functions
+ *
+ * Links against fpe_internal, a static build of src/ with
+ * FPE_BENCH_INTERNALS defined, which exports the static round functions,
+ * numeral conversions and Feistel add/subtract through bench_internals.h.
+ * Each kernel is swept over radix x length. Kernels take tens of
+ * nanoseconds, so a sample times a batch of calls sized to about 2 us and
+ * reports the per-call time.
+ *
+ * Usage:
+ *   fpe_microbench [-k KERNELS] [-r RADIXES] [-l LENGTHS] [-a aes|sm4]
+ *                  [-t SEC] [-T TIMER] [-P] [-f text|json|csv] [-o FILE] [-v]
+ *
+ * Kernels:
+ *   num_to_bytes, bytes_to_num, num_to_bytes_rev, bytes_to_num_rev
+ *       FF3/FF3-1 numeral string <-> NUM conversions; len digits,
+ *       ceil(len * log2(radix) / 8) bytes
+ *   ff1_prf             FF1 round function for a len-digit input
+ *   ff3_round_encrypt, ff3_1_round_encrypt
+ *                       FF3/FF3-1 round functions over len/2 digits
+ *   num_add_rev, num_sub_rev
+ *                       FF3/FF3-1 Feistel add/subtract over (len+1)/2 digits
+ *   bn_add, bn_sub      FF1 multi-precision add/subtract of a len-digit NUM
+ *   str_to_array        fpe_str_to_array over len characters (radix <= 62)
+ *   validate_alphabet   fpe_validate_alphabet of a radix-character alphabet;
+ *                       independent of length, reported once with len 0
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "perf.h"
+#include "workload.h"
+#include "bench_internals.h"
+#include "bignum.h"
+#include "utils.h"
+
+/* Longest numeral string; the byte conversions work in a 256-byte buffer */
+#define MICRO_MAX_LEN 256
+#define MICRO_MAX_BYTES 256
+#define MICRO_MAX_LIMBS 160
+
+/* Target time of one sample (one batch of calls) */
+#define MICRO_BATCH_NS 2000.0
+
+/* Bound on samples kept per row */
+#define MICRO_MAX_SAMPLES (1u << 20)
+
+static const char alphabet62[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/* ============================================================================
+ * Kernels
+ * ============================================================================
+ */
+
+typedef struct {
+    unsigned int radix;
+    unsigned int len;
+    unsigned int nbytes;             /* Bytes of NUM for len digits */
+    FPE_CTX *ctx;
+    unsigned int x[MICRO_MAX_LEN];
+    unsigned int y[MICRO_MAX_LEN];
+    unsigned char bytes[MICRO_MAX_BYTES];
+    unsigned char P[16];
+    unsigned char Q[MICRO_MAX_BYTES + 32];
+    unsigned char S[MICRO_MAX_BYTES + 16];
+    unsigned int q_len;
+    unsigned int s_len;
+    unsigned char T[4];
+    unsigned char W[16];
+    fpe_limb a[MICRO_MAX_LIMBS];
+    fpe_limb b[MICRO_MAX_LIMBS];
+    unsigned int limbs;
+    char alphabet[63];
+    char str[MICRO_MAX_LEN + 1];
+} micro_state;
+
+typedef struct {
+    const char *name;
+    int (*run)(micro_state *s);
+    int mode;                        /* Context mode, or -1 for none */
+    int per_length;                  /* 0: depends on radix only */
+    int max_radix;                   /* 0: any radix */
+} micro_kernel;
+
+static int k_num_to_bytes(micro_state *s) {
+    fpe_bench_num_to_bytes(s->x, s->len, s->radix, s->bytes, s->nbytes);
+    return 0;
+}
+
+static int k_bytes_to_num(micro_state *s) {
+    fpe_bench_bytes_to_num(s->bytes, s->nbytes, s->y, s->len, s->radix);
+    return 0;
+}
+
+static int k_num_to_bytes_rev(micro_state *s) {
+    fpe_bench_num_to_bytes_rev(s->x, s->len, s->radix, s->bytes, s->nbytes);
+    return 0;
+}
+
+static int k_bytes_to_num_rev(micro_state *s) {
+    fpe_bench_bytes_to_num_rev(s->bytes, s->nbytes, s->y, s->len, s->radix);
+    return 0;
+}
+
+static int k_ff1_prf(micro_state *s) {
+    return fpe_bench_ff1_prf(s->ctx, s->P, 16, s->Q, s->q_len, s->S, s->s_len);
+}
+
+static int k_ff3_round(micro_state *s) {
+    return fpe_bench_ff3_round_encrypt(s->ctx, s->T, 3, s->x, s->len / 2, s->radix, s->W, 16);
+}
+
+static int k_ff3_1_round(micro_state *s) {
+    return fpe_bench_ff3_1_round_encrypt(s->ctx, s->T, 3, s->x, s->len / 2, s->radix, s->W, 16);
+}
+
+static int k_num_add_rev(micro_state *s) {
+    fpe_bench_num_add_rev(s->x, s->y, (s->len + 1) / 2, s->radix);
+    return 0;
+}
+
+static int k_num_sub_rev(micro_state *s) {
+    fpe_bench_num_sub_rev(s->x, s->y, (s->len + 1) / 2, s->radix);
+    return 0;
+}
+
+static int k_bn_add(micro_state *s) {
+    fpe_bn_add(s->a, s->a, s->limbs, s->b, s->limbs);
+    return 0;
+}
+
+static int k_bn_sub(micro_state *s) {
+    fpe_bn_sub(s->a, s->a, s->limbs, s->b, s->limbs);
+    return 0;
+}
+
+static int k_str_to_array(micro_state *s) {
+    return fpe_str_to_array(s->alphabet, s->str, s->y, s->len);
+}
+
+static int k_validate_alphabet(micro_state *s) {
+    return fpe_validate_alphabet(s->alphabet) == s->radix ? 0 : -1;
+}
+
+static const micro_kernel kernels[] = {
+    {"num_to_bytes", k_num_to_bytes, -1, 1, 0},
+    {"bytes_to_num", k_bytes_to_num, -1, 1, 0},
+    {"num_to_bytes_rev", k_num_to_bytes_rev, -1, 1, 0},
+    {"bytes_to_num_rev", k_bytes_to_num_rev, -1, 1, 0},
+    {"ff1_prf", k_ff1_prf, FPE_MODE_FF1, 1, 0},
+    {"ff3_round_encrypt", k_ff3_round, FPE_MODE_FF3, 1, 0},
+    {"ff3_1_round_encrypt", k_ff3_1_round, FPE_MODE_FF3_1, 1, 0},
+    {"num_add_rev", k_num_add_rev, -1, 1, 0},
+    {"num_sub_rev", k_num_sub_rev, -1, 1, 0},
+    {"bn_add", k_bn_add, -1, 1, 0},
+    {"bn_sub", k_bn_sub, -1, 1, 0},
+    {"str_to_array", k_str_to_array, -1, 1, 62},
+    {"validate_alphabet", k_validate_alphabet, -1, 0, 62},
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+/**
+ * Fill the state for one radix and length.
+ * @return 0 on success, 1 if the kernel does not apply, -1 on error
+ */
+static int state_init(micro_state *s, const micro_kernel *k, FPE_ALGO algo,
+                      unsigned int radix, unsigned int len) {
+    memset(s, 0, sizeof(*s));
+    s->radix = radix;
+    s->len = len;
+    if (k->max_radix && radix > (unsigned int)k->max_radix) return 1;
+
+    double bits = (double)len * log2((double)radix);
+    s->nbytes = (unsigned int)ceil(bits / 8.0);
+    if (s->nbytes == 0) s->nbytes = 1;
+    if (s->nbytes > MICRO_MAX_BYTES) return 1;
+    s->limbs = (unsigned int)fpe_bn_limbs_for_digits(radix, len);
+    if (s->limbs > MICRO_MAX_LIMBS) return 1;
+
+    uint64_t r = 0x9E3779B97F4A7C15ull;
+    for (unsigned int i = 0; i < len; i++) {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        s->x[i] = (unsigned int)(r % radix);
+        s->y[i] = (unsigned int)((r >> 32) % radix);
+    }
+    for (unsigned int i = 0; i < MICRO_MAX_LIMBS; i++) {
+        s->a[i] = (fpe_limb)(0x9E3779B9u * (i + 1));
+        s->b[i] = (fpe_limb)(0x7F4A7C15u * (i + 1));
+    }
+    fpe_bench_num_to_bytes(s->x, len, radix, s->bytes, s->nbytes);
+    for (unsigned int i = 0; i < 16; i++) s->P[i] = (unsigned char)i;
+    for (unsigned int i = 0; i < 4; i++) s->T[i] = (unsigned char)(0xA0 + i);
+
+    if (radix <= 62) {
+        memcpy(s->alphabet, alphabet62, radix);
+        s->alphabet[radix] = '\0';
+        for (unsigned int i = 0; i < len; i++) s->str[i] = alphabet62[s->x[i]];
+        s->str[len] = '\0';
+    }
+
+    /* FF1 sizes for a len-digit input: Q = T || pad || [i] || NUM(B), S = d bytes */
+    unsigned int v = len - len / 2;
+    unsigned int b = (unsigned int)ceil(ceil((double)v * log2((double)radix)) / 8.0);
+    unsigned int pad = (16 - (8 + b + 1) % 16) % 16;
+    s->q_len = 8 + pad + 1 + b;
+    s->s_len = 4 * ((b + 3) / 4) + 4;
+    if (s->q_len > sizeof(s->Q) || s->s_len > sizeof(s->S)) return 1;
+    for (unsigned int i = 0; i < s->q_len; i++) s->Q[i] = (unsigned char)(i * 7);
+
+    if (k->mode >= 0) {
+        unsigned char key[16];
+        for (unsigned int i = 0; i < 16; i++) key[i] = (unsigned char)i;
+        s->ctx = FPE_CTX_new();
+        if (!s->ctx) return -1;
+        if (FPE_CTX_init(s->ctx, (FPE_MODE)k->mode, algo, key, 128, radix) != 0) {
+            FPE_CTX_free(s->ctx);
+            s->ctx = NULL;
+            return 1;
+        }
+    }
+    return k->run(s) == 0 ? 0 : 1;
+}
+
+static void state_free(micro_state *s) {
+    FPE_CTX_free(s->ctx);
+    s->ctx = NULL;
+}
+
+/* ============================================================================
+ * Measurement
+ * ============================================================================
+ */
+
+typedef struct {
+    bench_stats stats;               /* Per call, ns */
+    unsigned int reps;               /* Calls per sample */
+    double ops_per_sec;
+    double counters[BENCH_PERF_COUNT];
+} micro_result;
+
+static uint64_t time_batch(const micro_kernel *k, micro_state *s, unsigned int reps) {
+    uint64_t t0 = bench_ticks();
+    for (unsigned int i = 0; i < reps; i++) k->run(s);
+    return bench_ticks() - t0;
+}
+
+static int run_kernel(const micro_kernel *k, micro_state *s, double time, bench_samples *samples,
+                      bench_perf *perf, micro_result *res) {
+    /* Size the batch to MICRO_BATCH_NS; this also warms up */
+    unsigned int reps = 1;
+    while (reps < (1u << 20) && bench_ticks_to_ns(time_batch(k, s, reps)) < MICRO_BATCH_NS) {
+        reps *= 2;
+    }
+
+    bench_samples_reset(samples);
+    uint64_t total = 0;
+    double end = bench_now() + time;
+    while (bench_now() < end && samples->n < MICRO_MAX_SAMPLES) {
+        for (int i = 0; i < 16; i++) {
+            uint64_t t = time_batch(k, s, reps);
+            total += t;
+            if (bench_samples_push(samples, bench_ticks_to_ns(t) / reps) != 0) return -1;
+        }
+    }
+
+    double calls = (double)samples->n * reps;
+    res->reps = reps;
+    res->ops_per_sec = calls / (bench_ticks_to_ns(total) * 1e-9);
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) res->counters[i] = NAN;
+    if (perf) {
+        bench_perf_start(perf);
+        for (size_t i = 0; i < samples->n; i++) time_batch(k, s, reps);
+        bench_perf_stop(perf);
+        for (int i = 0; i < BENCH_PERF_COUNT; i++) res->counters[i] = perf->value[i] / calls;
+    }
+    bench_stats_compute(samples, &res->stats);
+    return 0;
+}
+
+static void report_kernel(bench_report *report, const micro_kernel *k, const micro_state *s,
+                          FPE_ALGO algo, const micro_result *res, int with_counters) {
+    const bench_stats *st = &res->stats;
+    double ghz = bench_timer_ghz();
+    bench_field fields[] = {
+        BENCH_STR("kernel", k->name),
+        BENCH_STR("algo", k->mode >= 0 ? bench_algo_label(algo) : "-"),
+        BENCH_NUM("radix", s->radix, 0),
+        BENCH_NUM("len", k->per_length ? s->len : 0, 0),
+        BENCH_NUM("reps", res->reps, 0),
+        BENCH_NUM("samples", st->count, 0),
+        BENCH_NUM("ops_per_sec", res->ops_per_sec, 0),
+        BENCH_NUM("mean_ns", st->mean, 2),
+        BENCH_NUM("p50_ns", st->p50, 2),
+        BENCH_NUM("p90_ns", st->p90, 2),
+        BENCH_NUM("p99_ns", st->p99, 2),
+        BENCH_NUM("min_ns", st->min, 2),
+        BENCH_NUM("tsc_cycles", ghz > 0.0 ? st->p50 * ghz : NAN, 1),
+        BENCH_NUM("cycles_per_op", res->counters[BENCH_PERF_CYCLES], 1),
+        BENCH_NUM("instructions_per_op", res->counters[BENCH_PERF_INSTRUCTIONS], 1),
+        BENCH_NUM("ipc", res->counters[BENCH_PERF_INSTRUCTIONS] /
+                         res->counters[BENCH_PERF_CYCLES], 2),
+        BENCH_NUM("branch_misses_per_op", res->counters[BENCH_PERF_BRANCH_MISSES], 2),
+        BENCH_NUM("l1d_misses_per_op", res->counters[BENCH_PERF_L1D_MISSES], 2),
+    };
+    size_t n = sizeof(fields) / sizeof(fields[0]);
+    bench_report_row(report, fields, with_counters ? n : n - BENCH_PERF_COUNT - 1);
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_microbench [options]\n"
+        "\n"
+        "  -k KERNELS  Comma-separated kernel names (default: all)\n"
+        "  -r RADIXES  Radixes (default: 10,16,62)\n"
+        "  -l LENGTHS  Input lengths in digits, <= %d (default: 8,16,32,64)\n"
+        "  -a ALGO     aes or sm4, for the round functions (default aes)\n"
+        "  -t SEC      Measured time per row (default 0.05)\n"
+        "  -T TIMER    auto, tsc or monotonic (default auto)\n"
+        "  -P          Report hardware counters per call (Linux perf)\n"
+        "  -f FORMAT   text, json or csv (default text)\n"
+        "  -o FILE     Output file (default: stdout)\n"
+        "  -v          Report skipped rows on stderr\n"
+        "\n"
+        "Kernels:", MICRO_MAX_LEN);
+    for (size_t i = 0; i < NUM_KERNELS; i++) fprintf(f, " %s", kernels[i].name);
+    fprintf(f, "\n");
+}
+
+int main(int argc, char **argv) {
+    const char *kernel_names[NUM_KERNELS];
+    unsigned int kernel_values[NUM_KERNELS];
+    for (size_t i = 0; i < NUM_KERNELS; i++) {
+        kernel_names[i] = kernels[i].name;
+        kernel_values[i] = (unsigned int)i;
+    }
+
+    bench_list ks, radixes, lengths;
+    ks.n = NUM_KERNELS;
+    for (size_t i = 0; i < NUM_KERNELS; i++) ks.v[i] = (unsigned int)i;
+    bench_parse_list("10,16,62", &radixes, NULL, NULL, 0);
+    bench_parse_list("8,16,32,64", &lengths, NULL, NULL, 0);
+
+    unsigned int algo = FPE_ALGO_AES;
+    double time = 0.05;
+    int use_perf = 0, verbose = 0;
+    bench_timer_kind timer = BENCH_TIMER_AUTO;
+    bench_format format = BENCH_FORMAT_TEXT;
+    const char *output = NULL;
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "k:r:l:a:t:T:Pf:o:vh")) != -1) {
+        switch (opt) {
+        case 'k':
+            bad |= bench_parse_list(optarg, &ks, kernel_names, kernel_values, NUM_KERNELS);
+            break;
+        case 'r': bad |= bench_parse_list(optarg, &radixes, NULL, NULL, 0); break;
+        case 'l': bad |= bench_parse_list(optarg, &lengths, NULL, NULL, 0); break;
+        case 'a': {
+            bench_list l;
+            bad |= bench_parse_list(optarg, &l, bench_algo_names, bench_algo_values, 2);
+            bad |= l.n != 1;
+            algo = l.v[0];
+            break;
+        }
+        case 't': time = atof(optarg); bad |= time <= 0.0; break;
+        case 'T':
+            if (strcmp(optarg, "auto") == 0) timer = BENCH_TIMER_AUTO;
+            else if (strcmp(optarg, "tsc") == 0) timer = BENCH_TIMER_TSC;
+            else if (strcmp(optarg, "monotonic") == 0) timer = BENCH_TIMER_MONOTONIC;
+            else bad = 1;
+            break;
+        case 'P': use_perf = 1; break;
+        case 'f': bad |= bench_format_parse(optarg, &format); break;
+        case 'o': output = optarg; break;
+        case 'v': verbose = 1; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    for (unsigned int i = 0; i < lengths.n; i++) {
+        bad |= lengths.v[i] < 2 || lengths.v[i] > MICRO_MAX_LEN;
+    }
+    for (unsigned int i = 0; i < radixes.n; i++) bad |= radixes.v[i] < 2;
+    if (bad || optind != argc) {
+        usage(stderr);
+        return 2;
+    }
+
+    if (bench_timer_init(timer) != 0) {
+        fprintf(stderr, "fpe_microbench: timer not available on this machine\n");
+        return 1;
+    }
+
+    bench_perf perf;
+    if (use_perf && bench_perf_open(&perf) < BENCH_PERF_COUNT) {
+        fprintf(stderr, "fpe_microbench: some hardware counters are unavailable (%s); "
+                "they are reported as null\n",
+                perf.error > 0 ? strerror(perf.error) : "not supported on this platform");
+    }
+
+    FILE *out = stdout;
+    if (output && !(out = fopen(output, "w"))) {
+        perror(output);
+        return 1;
+    }
+
+    micro_state *s = (micro_state *)malloc(sizeof(micro_state));
+    bench_samples samples = {NULL, 0, 0};
+    bench_report report;
+    int status = 0;
+    if (!s) {
+        if (out != stdout) fclose(out);
+        return 1;
+    }
+    bench_report_begin(&report, format, out, "fpe_microbench");
+
+    for (unsigned int ki = 0; ki < ks.n; ki++) {
+        const micro_kernel *k = &kernels[ks.v[ki]];
+        for (unsigned int r = 0; r < radixes.n; r++)
+        for (unsigned int l = 0; l < (k->per_length ? lengths.n : 1); l++) {
+            unsigned int len = k->per_length ? lengths.v[l] : lengths.v[0];
+            micro_result res;
+            int ret = state_init(s, k, (FPE_ALGO)algo, radixes.v[r], len);
+            if (ret == 0) ret = run_kernel(k, s, time, &samples, use_perf ? &perf : NULL, &res);
+            if (ret == 0) {
+                report_kernel(&report, k, s, (FPE_ALGO)algo, &res, use_perf);
+            } else if (ret > 0) {
+                if (verbose) {
+                    fprintf(stderr, "skip: %s radix %u len %u\n", k->name, radixes.v[r], len);
+                }
+            } else {
+                fprintf(stderr, "fpe_microbench: %s radix %u len %u failed\n",
+                        k->name, radixes.v[r], len);
+                status = 1;
+            }
+            state_free(s);
+        }
+    }
+
+    bench_report_end(&report);
+    if (use_perf) bench_perf_close(&perf);
+    bench_samples_free(&samples);
+    free(s);
+    if (out != stdout) fclose(out);
+    return status;
+}
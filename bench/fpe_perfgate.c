@@ -0,0 +1,463 @@
+/**
+ * @file fpe_perfgate.c
+ * @brief fpe_perfgate: performance regression gate against a stored baseline
+ *
+ * Raw nanoseconds do not carry from one machine to another, so each cell is
+ * measured as a ratio: median time per operation divided by the time of
+ * one block-cipher call (same algorithm and key size) through OpenSSL,
+ * calibrated right before each round. The matrix is measured in
+ * GATE_PASSES whole passes and each cell keeps its median pass. The calibration loop is pure
+ * compute, so its fastest sample is its cost; anything slower is
+ * interference from the host. The ratio, blocks_per_op, counts how
+ * many block encryptions one operation costs, and moves only when the
+ * library's own overhead moves.
+ *
+ * Usage:
+ *   fpe_perfgate -u FILE [-m MODES] [-a ALGOS] [-b BITS] [-r RADIXES]
+ *                [-l LENGTHS] [-A APIS] [-B N] [-t SEC]
+ *       Measure the matrix and write it as the baseline.
+ *   fpe_perfgate -c FILE [-x TOL] [-X CELL_TOL] [-t SEC] [-f text|json|csv] [-o FILE]
+ *       Measure every cell of the baseline; exit 1 if the geometric mean of
+ *       the cells' changes exceeds TOL, or (with -X) any one cell's exceeds
+ *       CELL_TOL.
+ *
+ * A cell on its own moves by tens of percent between processes on a busy
+ * host (memory layout, neighbours), while a slowdown in shared code moves
+ * many cells together; hence only the mean gates by default. Cells past
+ * TOL are still reported, as "slower".
+ *
+ * The baseline is the JSON report this tool writes with -u, one result per
+ * line; it is read back with a line-oriented scanner, not a JSON parser.
+ */
+
+#include <openssl/evp.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "workload.h"
+
+/* Blocks per calibration sample and calls between deadline checks */
+#define GATE_BLOCKS_PER_SAMPLE 256
+#define GATE_CHECK_EVERY 16
+
+/* Calibration time before each cell */
+#define GATE_CALIBRATE_SEC 0.02
+
+/* Rounds per pass (odd); a pass's value is its median round */
+#define GATE_ROUNDS 5
+
+/* Passes over the whole matrix (odd); a cell's value is its median pass */
+#define GATE_PASSES 3
+
+#define GATE_MAX_CELLS 512
+
+static const char *const status_names[] = {"ok", "improved", "REGRESSED", "slower"};
+
+/* ============================================================================
+ * Measurement
+ * ============================================================================
+ */
+
+static const EVP_CIPHER *block_cipher(FPE_ALGO algo, unsigned int bits) {
+    if (algo == FPE_ALGO_AES) {
+        return bits == 128 ? EVP_aes_128_ecb() : bits == 192 ? EVP_aes_192_ecb()
+             : bits == 256 ? EVP_aes_256_ecb() : NULL;
+    }
+#if defined(HAVE_OPENSSL_SM4)
+    if (algo == FPE_ALGO_SM4 && bits == 128) return EVP_sm4_ecb();
+#endif
+    return NULL;
+}
+
+/* Fastest ns of one block encryption; each block encrypts the previous output */
+static double calibrate_block(const EVP_CIPHER *cipher, bench_samples *samples) {
+    unsigned char key[32] = {0}, block[16] = {0};
+    int outlen;
+    EVP_CIPHER_CTX *c = EVP_CIPHER_CTX_new();
+    if (!c || EVP_EncryptInit_ex(c, cipher, NULL, key, NULL) != 1) {
+        EVP_CIPHER_CTX_free(c);
+        return NAN;
+    }
+    EVP_CIPHER_CTX_set_padding(c, 0);
+
+    bench_samples_reset(samples);
+    double end = bench_now() + GATE_CALIBRATE_SEC;
+    while (bench_now() < end) {
+        uint64_t t0 = bench_ticks();
+        for (int i = 0; i < GATE_BLOCKS_PER_SAMPLE; i++) {
+            EVP_EncryptUpdate(c, block, &outlen, block, 16);
+        }
+        uint64_t t1 = bench_ticks();
+        bench_samples_push(samples, bench_ticks_to_ns(t1 - t0) / GATE_BLOCKS_PER_SAMPLE);
+    }
+    EVP_CIPHER_CTX_free(c);
+
+    bench_stats st;
+    bench_stats_compute(samples, &st);
+    return st.min;
+}
+
+/* Median ns per record over one round of calls */
+static double time_round(bench_workload *w, double time, size_t *i, bench_samples *samples) {
+    bench_samples_reset(samples);
+    double end = bench_now() + time;
+    while (bench_now() < end) {
+        for (int k = 0; k < GATE_CHECK_EVERY; k++) {
+            uint64_t t0 = bench_ticks();
+            bench_workload_call(w, (*i)++);
+            uint64_t t1 = bench_ticks();
+            bench_samples_push(samples, bench_ticks_to_ns(t1 - t0) / w->per_call);
+        }
+    }
+    bench_stats st;
+    bench_stats_compute(samples, &st);
+    return st.p50;
+}
+
+typedef struct {
+    bench_cell cell;
+    double op_ns;
+    double block_ns;
+    double blocks_per_op;
+    double baseline;        /* blocks_per_op from the baseline, gate mode */
+    int rejected;           /* The library or OpenSSL rejects the cell */
+    double pass_op[GATE_PASSES], pass_block[GATE_PASSES], pass_ratio[GATE_PASSES];
+} gate_cell;
+
+/* Index of the median of v[0..n), n odd */
+static int median_index(const double *v, int n) {
+    int order[GATE_ROUNDS > GATE_PASSES ? GATE_ROUNDS : GATE_PASSES];
+    for (int r = 0; r < n; r++) {
+        int k = r;
+        for (; k > 0 && v[order[k - 1]] > v[r]; k--) order[k] = order[k - 1];
+        order[k] = r;
+    }
+    return order[n / 2];
+}
+
+/**
+ * Measure pass p of one cell: GATE_ROUNDS rounds, each after its own calibration.
+ * @return 0 on success, 1 if the library or OpenSSL rejects the cell
+ */
+static int measure(gate_cell *g, int p, double time, bench_samples *samples) {
+    const EVP_CIPHER *cipher = block_cipher(g->cell.algo, g->cell.bits);
+    bench_workload w;
+    if (!cipher || bench_workload_init(&w, &g->cell, 0) != 0 ||
+        bench_workload_call(&w, 0) != 0) {
+        bench_workload_free(&w);
+        return 1;
+    }
+
+    double op[GATE_ROUNDS], block[GATE_ROUNDS], ratio[GATE_ROUNDS];
+    size_t i = 0;
+    time_round(&w, time / GATE_ROUNDS, &i, samples);   /* Warmup */
+    for (int r = 0; r < GATE_ROUNDS; r++) {
+        block[r] = calibrate_block(cipher, samples);
+        op[r] = time_round(&w, time / GATE_ROUNDS, &i, samples);
+        ratio[r] = op[r] / block[r];
+    }
+    bench_workload_free(&w);
+
+    /* The best round swings with turbo and cache state from run to run; the
+     * median round is stable enough to compare against a baseline */
+    int mid = median_index(ratio, GATE_ROUNDS);
+    g->pass_op[p] = op[mid];
+    g->pass_block[p] = block[mid];
+    g->pass_ratio[p] = ratio[mid];
+    return isfinite(ratio[mid]) ? 0 : 1;
+}
+
+/* Settle a measured cell on its median pass */
+static void settle(gate_cell *g) {
+    int mid = median_index(g->pass_ratio, GATE_PASSES);
+    g->op_ns = g->pass_op[mid];
+    g->block_ns = g->pass_block[mid];
+    g->blocks_per_op = g->pass_ratio[mid];
+}
+
+/* ============================================================================
+ * Baseline File
+ * ============================================================================
+ */
+
+/* Value of "key": "..." on a line */
+static int line_str(const char *line, const char *key, char *out, size_t size) {
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\": \"", key);
+    const char *p = strstr(line, pat);
+    if (!p) return -1;
+    p += strlen(pat);
+    const char *e = strchr(p, '"');
+    if (!e || (size_t)(e - p) >= size) return -1;
+    memcpy(out, p, (size_t)(e - p));
+    out[e - p] = '\0';
+    return 0;
+}
+
+/* Value of "key": number on a line */
+static int line_num(const char *line, const char *key, double *out) {
+    char pat[64];
+    snprintf(pat, sizeof(pat), "\"%s\": ", key);
+    const char *p = strstr(line, pat);
+    if (!p) return -1;
+    char *e;
+    *out = strtod(p + strlen(pat), &e);
+    return e == p + strlen(pat) ? -1 : 0;
+}
+
+static int label_value(const char *label, const char *const *labels, const unsigned int *values,
+                       size_t count, unsigned int *out) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(label, labels[i]) == 0) {
+            *out = values[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static const char *const mode_labels[3] = {"FF1", "FF3", "FF3-1"};
+static const char *const algo_labels[2] = {"AES", "SM4"};
+
+/**
+ * Read the cells of a baseline written with -u.
+ * @return Number of cells, or -1 if the file cannot be read or a line is malformed
+ */
+static int read_baseline(const char *path, gate_cell *cells, unsigned int batch) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[1024], mode[16], algo[16], api[16];
+    int n = 0, lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        if (!strstr(line, "\"blocks_per_op\"")) continue;
+
+        gate_cell *g = &cells[n];
+        double bits, radix, len;
+        unsigned int mode_v, algo_v, api_v;
+        memset(g, 0, sizeof(*g));
+        if (n == GATE_MAX_CELLS ||
+            line_str(line, "mode", mode, sizeof(mode)) != 0 ||
+            line_str(line, "algo", algo, sizeof(algo)) != 0 ||
+            line_str(line, "api", api, sizeof(api)) != 0 ||
+            line_num(line, "bits", &bits) != 0 || line_num(line, "radix", &radix) != 0 ||
+            line_num(line, "len", &len) != 0 ||
+            line_num(line, "blocks_per_op", &g->baseline) != 0 ||
+            label_value(mode, mode_labels, bench_mode_values, 3, &mode_v) != 0 ||
+            label_value(algo, algo_labels, bench_algo_values, 2, &algo_v) != 0 ||
+            label_value(api, bench_api_names, bench_api_values, 4, &api_v) != 0) {
+            fprintf(stderr, "%s:%d: malformed baseline entry\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+        g->cell.mode = (FPE_MODE)mode_v;
+        g->cell.algo = (FPE_ALGO)algo_v;
+        g->cell.bits = (unsigned int)bits;
+        g->cell.radix = (unsigned int)radix;
+        g->cell.len = (unsigned int)len;
+        g->cell.api = (bench_api)api_v;
+        g->cell.batch = batch;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_perfgate -u FILE [matrix options] [-t SEC]\n"
+        "       fpe_perfgate -c FILE [-x TOL] [-X TOL] [-t SEC] [-f FORMAT] [-o FILE]\n"
+        "\n"
+        "  -u FILE     Measure the matrix and write it as the baseline\n"
+        "  -c FILE     Compare against the baseline; exit 1 on a regression\n"
+        "  -x TOL      Allowed slowdown of the geometric mean, as a fraction (default 0.25)\n"
+        "  -X TOL      Also fail on any one cell slower by more than TOL (default: off)\n"
+        "  -t SEC      Measured time per cell and pass (default 0.25)\n"
+        "  -f FORMAT   Report format: text, json or csv (default text)\n"
+        "  -o FILE     Report file (default: stdout)\n"
+        "\n"
+        "Matrix options (with -u):\n"
+        "  -m MODES    ff1,ff3,ff3-1 (default: ff1,ff3-1)\n"
+        "  -a ALGOS    aes,sm4 (default: aes)\n"
+        "  -b BITS     Key sizes (default: 128)\n"
+        "  -r RADIXES  Radixes (default: 10,62)\n"
+        "  -l LENGTHS  Input lengths (default: 16,32)\n"
+        "  -A APIS     array,str,oneshot,batch (default: array,str,batch)\n"
+        "  -B N        Records per batch call (default 64)\n");
+}
+
+static void report_cell(bench_report *r, const gate_cell *g, int compare, double tolerance,
+                        double cell_tolerance, int *status) {
+    const bench_cell *c = &g->cell;
+    double change = g->blocks_per_op / g->baseline - 1.0;
+    int s = change < -tolerance ? 1 : 0;
+    if (cell_tolerance > 0.0 && change > cell_tolerance)
+        s = 2;
+    else if (change > tolerance)
+        s = 3;
+    if (compare && s == 2) *status = 1;
+
+    bench_field fields[] = {
+        BENCH_STR("mode", bench_mode_label(c->mode)),
+        BENCH_STR("algo", bench_algo_label(c->algo)),
+        BENCH_NUM("bits", c->bits, 0),
+        BENCH_NUM("radix", c->radix, 0),
+        BENCH_NUM("len", c->len, 0),
+        BENCH_STR("api", bench_api_names[c->api]),
+        BENCH_NUM("op_ns", g->op_ns, 1),
+        BENCH_NUM("block_ns", g->block_ns, 2),
+        BENCH_NUM("blocks_per_op", g->blocks_per_op, 2),
+        BENCH_NUM("baseline", g->baseline, 2),
+        BENCH_NUM("change_pct", change * 100.0, 1),
+        BENCH_STR("status", status_names[s]),
+    };
+    bench_report_row(r, fields, compare ? 12 : 9);
+}
+
+int main(int argc, char **argv) {
+    bench_list modes, algos, bits, radixes, lengths, apis;
+    bench_parse_list("ff1,ff3-1", &modes, bench_mode_names, bench_mode_values, 3);
+    bench_parse_list("aes", &algos, bench_algo_names, bench_algo_values, 2);
+    bench_parse_list("128", &bits, NULL, NULL, 0);
+    bench_parse_list("10,62", &radixes, NULL, NULL, 0);
+    bench_parse_list("16,32", &lengths, NULL, NULL, 0);
+    bench_parse_list("array,str,batch", &apis, bench_api_names, bench_api_values, 4);
+
+    const char *update = NULL, *compare = NULL, *output = NULL;
+    double tolerance = 0.25, cell_tolerance = 0.0, time = 0.25;
+    unsigned int batch = 64;
+    bench_format format = BENCH_FORMAT_TEXT;
+
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "u:c:x:X:t:f:o:m:a:b:r:l:A:B:h")) != -1) {
+        switch (opt) {
+        case 'u': update = optarg; break;
+        case 'c': compare = optarg; break;
+        case 'x': tolerance = atof(optarg); bad |= tolerance <= 0.0; break;
+        case 'X': cell_tolerance = atof(optarg); bad |= cell_tolerance <= 0.0; break;
+        case 't': time = atof(optarg); bad |= time <= 0.0; break;
+        case 'f': bad |= bench_format_parse(optarg, &format); break;
+        case 'o': output = optarg; break;
+        case 'm': bad |= bench_parse_list(optarg, &modes, bench_mode_names, bench_mode_values, 3); break;
+        case 'a': bad |= bench_parse_list(optarg, &algos, bench_algo_names, bench_algo_values, 2); break;
+        case 'b': bad |= bench_parse_list(optarg, &bits, NULL, NULL, 0); break;
+        case 'r': bad |= bench_parse_list(optarg, &radixes, NULL, NULL, 0); break;
+        case 'l': bad |= bench_parse_list(optarg, &lengths, NULL, NULL, 0); break;
+        case 'A': bad |= bench_parse_list(optarg, &apis, bench_api_names, bench_api_values, 4); break;
+        case 'B': batch = (unsigned int)atoi(optarg); bad |= batch == 0; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    if (bad || optind != argc || !update == !compare) {
+        usage(stderr);
+        return 2;
+    }
+
+    gate_cell *cells = (gate_cell *)calloc(GATE_MAX_CELLS, sizeof(gate_cell));
+    if (!cells) return 1;
+    int n = 0;
+    if (compare) {
+        if ((n = read_baseline(compare, cells, batch)) <= 0) {
+            if (n == 0) fprintf(stderr, "%s: no baseline entries\n", compare);
+            free(cells);
+            return 2;
+        }
+    } else {
+        for (unsigned int m = 0; m < modes.n; m++)
+        for (unsigned int a = 0; a < algos.n; a++)
+        for (unsigned int b = 0; b < bits.n; b++)
+        for (unsigned int r = 0; r < radixes.n; r++)
+        for (unsigned int l = 0; l < lengths.n; l++)
+        for (unsigned int p = 0; p < apis.n && n < GATE_MAX_CELLS; p++) {
+            bench_cell c = {
+                .mode = (FPE_MODE)modes.v[m],
+                .algo = (FPE_ALGO)algos.v[a],
+                .bits = bits.v[b],
+                .radix = radixes.v[r],
+                .len = lengths.v[l],
+                .api = (bench_api)apis.v[p],
+                .batch = batch,
+            };
+            cells[n].cell = c;
+            cells[n].baseline = NAN;
+            n++;
+        }
+    }
+
+    const char *path = update ? update : output;
+    FILE *out = stdout;
+    if (path && !(out = fopen(path, "w"))) {
+        perror(path);
+        free(cells);
+        return 1;
+    }
+
+    bench_timer_init(BENCH_TIMER_AUTO);
+    bench_samples samples = {NULL, 0, 0};
+    bench_report report;
+    bench_report_begin(&report, update ? BENCH_FORMAT_JSON : format, out, "fpe_perfgate");
+
+    /* Whole passes over the matrix: a burst of host load lands in one pass
+     * of a cell instead of in every round of it */
+    for (int p = 0; p < GATE_PASSES; p++) {
+        for (int i = 0; i < n; i++) {
+            if (!cells[i].rejected && measure(&cells[i], p, time, &samples) != 0) {
+                cells[i].rejected = 1;
+            }
+        }
+    }
+
+    int status = 0, measured = 0;
+    double log_change = 0.0;
+    for (int i = 0; i < n; i++) {
+        gate_cell *g = &cells[i];
+        if (g->rejected) {
+            /* Cells the library rejects are left out of a new baseline */
+            if (compare) {
+                fprintf(stderr, "fpe_perfgate: baseline cell %s %s-%u radix %u len %u %s "
+                        "is rejected by this build\n", bench_mode_label(g->cell.mode),
+                        bench_algo_label(g->cell.algo), g->cell.bits, g->cell.radix,
+                        g->cell.len, bench_api_names[g->cell.api]);
+                status = 1;
+            }
+            continue;
+        }
+        settle(g);
+        report_cell(&report, g, compare != NULL, tolerance, cell_tolerance, &status);
+        log_change += log(g->blocks_per_op / g->baseline);
+        measured++;
+    }
+
+    if (compare) {
+        double mean_change = measured ? exp(log_change / measured) - 1.0 : NAN;
+        if (!(mean_change <= tolerance)) status = 1;
+        bench_field summary[] = {
+            BENCH_STR("baseline", compare),
+            BENCH_NUM("cells", measured, 0),
+            BENCH_NUM("geomean_change_pct", mean_change * 100.0, 1),
+            BENCH_NUM("tolerance_pct", tolerance * 100.0, 1),
+            BENCH_NUM("cell_tolerance_pct", cell_tolerance * 100.0, 1),
+            BENCH_STR("result", status ? "FAIL" : "PASS"),
+        };
+        bench_report_summary(&report, summary, 6);
+    }
+    bench_report_end(&report);
+
+    bench_samples_free(&samples);
+    free(cells);
+    if (out != stdout) fclose(out);
+    return status;
+}
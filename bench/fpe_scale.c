@@ -0,0 +1,457 @@
+/**
+ * @file fpe_scale.c
+ * @brief fpe_scale: multi-threaded throughput over a sweep of thread counts
+ *
+ * For each thread count every thread builds its own context and inputs,
+ * warms up, and waits on a barrier; then all threads run the same call for
+ * the step's duration. Elapsed time is wall-clock (CLOCK_MONOTONIC) from the
+ * first thread's start to the last thread's end, and each thread's CPU time
+ * (CLOCK_THREAD_CPUTIME_ID) is recorded alongside, so oversubscription and
+ * descheduling show up as CPU utilization below 100% instead of as
+ * inflated elapsed time.
+ *
+ * Each step reports speedup over the smallest thread count and parallel
+ * efficiency (speedup / threads). After the sweep Amdahl's law,
+ * S(n) = 1 / (s + (1 - s) / n), is fitted to the speedups by least
+ * squares; the serial fraction s bounds the achievable speedup at 1 / s.
+ *
+ * Usage:
+ *   fpe_scale [-m MODE] [-a ALGO] [-b BITS] [-r RADIX] [-l LEN] [-A API]
+ *             [-B N] [-d] [-D SPEC] [-n THREADS] [-t SEC] [-w SEC] [-p]
+ *             [-f text|json|csv] [-o FILE]
+ *
+ * -n N sweeps 1..N threads; -n 1,2,4,8 runs the listed counts. -D SPEC
+ * runs every thread over a shared synthetic dataset (see dataset.h), each
+ * starting at a different record, in place of -r and -l.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "workload.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#define SCALE_HAVE_AFFINITY 1
+#endif
+
+#ifdef __APPLE__
+#include "pthread_barrier_compat.h"
+#endif
+
+/* Calls between deadline checks */
+#define SCALE_CHECK_EVERY 16
+
+#define SCALE_MAX_THREADS 1024
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================
+ */
+
+typedef struct {
+    bench_cell cell;
+    bench_list threads;
+    double time;
+    double warmup;
+    int pin;
+    bench_format format;
+    const char *output;
+} scale_config;
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_scale [options]\n"
+        "\n"
+        "  -m MODE     ff1, ff3 or ff3-1 (default ff1)\n"
+        "  -a ALGO     aes or sm4 (default aes)\n"
+        "  -b BITS     Key size (default 128)\n"
+        "  -r RADIX    Radix (default 10)\n"
+        "  -l LEN      Input length (default 16)\n"
+        "  -A API      array, str, oneshot or batch (default array)\n"
+        "  -B N        Records per batch call (default 64)\n"
+        "  -d          Benchmark decryption instead of encryption\n"
+        "  -D SPEC     Synthetic dataset, e.g. pan or id:len=8-24 (replaces -r and -l)\n"
+        "  -n THREADS  Sweep 1..N, or a list such as 1,2,4,8 (default: online CPUs)\n"
+        "  -t SEC      Measured time per thread count (default 1.0)\n"
+        "  -w SEC      Warmup time per thread (default 0.1)\n"
+        "  -p          Pin thread i to the i-th allowed CPU (Linux)\n"
+        "  -f FORMAT   text, json or csv (default text)\n"
+        "  -o FILE     Output file (default: stdout)\n");
+}
+
+/* Parse a one-item option through bench_parse_list */
+static int parse_one(const char *arg, unsigned int *out, const char *const *names,
+                     const unsigned int *values, size_t count) {
+    bench_list list;
+    if (bench_parse_list(arg, &list, names, values, count) != 0 || list.n != 1) return -1;
+    *out = list.v[0];
+    return 0;
+}
+
+/* ============================================================================
+ * CPU Pinning
+ * ============================================================================
+ */
+
+static unsigned int allowed_cpus[SCALE_MAX_THREADS];
+static unsigned int num_allowed_cpus;
+
+static unsigned int online_cpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned int)n : 1;
+}
+
+static int pin_init(void) {
+#if defined(SCALE_HAVE_AFFINITY)
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+    num_allowed_cpus = 0;
+    for (unsigned int c = 0; c < CPU_SETSIZE && num_allowed_cpus < SCALE_MAX_THREADS; c++) {
+        if (CPU_ISSET(c, &set)) allowed_cpus[num_allowed_cpus++] = c;
+    }
+    return num_allowed_cpus > 0 ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+/* Pin the calling thread; threads beyond the allowed CPUs wrap around */
+static int pin_self(unsigned int index) {
+#if defined(SCALE_HAVE_AFFINITY)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(allowed_cpus[index % num_allowed_cpus], &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)index;
+    return -1;
+#endif
+}
+
+/* ============================================================================
+ * Measurement
+ * ============================================================================
+ */
+
+typedef struct {
+    const scale_config *cfg;
+    unsigned int index;
+    pthread_barrier_t *start;
+    uint64_t records;
+    double t_start;       /* Wall clock, seconds */
+    double t_end;
+    double cpu;           /* Thread CPU time over the measured interval */
+    int error;
+} scale_thread;
+
+typedef struct {
+    unsigned int threads;
+    uint64_t records;
+    double wall;
+    double cpu;           /* Sum over threads */
+    double ops_per_sec;
+    double imbalance;     /* Most records / fewest records of any thread */
+} scale_step;
+
+static void *scale_worker(void *arg) {
+    scale_thread *t = (scale_thread *)arg;
+    const scale_config *cfg = t->cfg;
+    bench_workload w;
+
+    /* Pin before allocating so the inputs are first touched on the pinned CPU */
+    if (cfg->pin && pin_self(t->index) != 0) t->error = 1;
+    if (bench_workload_init(&w, &cfg->cell, t->index) != 0) t->error = 1;
+
+    size_t i = 0;
+    if (!t->error) {
+        double end = bench_now() + cfg->warmup;
+        do {
+            for (int k = 0; k < SCALE_CHECK_EVERY; k++) {
+                t->error |= bench_workload_call(&w, i++) != 0;
+            }
+        } while (bench_now() < end);
+    }
+
+    /* Every thread reaches the barrier, failed or not, so none is left waiting */
+    pthread_barrier_wait(t->start);
+
+    if (!t->error) {
+        uint64_t calls = 0;
+        double cpu0 = bench_thread_cpu();
+        t->t_start = bench_now();
+        double end = t->t_start + cfg->time;
+        do {
+            for (int k = 0; k < SCALE_CHECK_EVERY; k++) {
+                t->error |= bench_workload_call(&w, i++) != 0;
+            }
+            calls += SCALE_CHECK_EVERY;
+        } while ((t->t_end = bench_now()) < end);
+        t->cpu = bench_thread_cpu() - cpu0;
+        t->records = calls * w.per_call;
+    }
+
+    bench_workload_free(&w);
+    return NULL;
+}
+
+static int run_step(const scale_config *cfg, unsigned int n, scale_step *step) {
+    scale_thread *t = (scale_thread *)calloc(n, sizeof(scale_thread));
+    pthread_t *tid = (pthread_t *)calloc(n, sizeof(pthread_t));
+    pthread_barrier_t start;
+    unsigned int created = 0;
+    int ret = -1;
+
+    if (!t || !tid || pthread_barrier_init(&start, NULL, n) != 0) {
+        free(t);
+        free(tid);
+        return -1;
+    }
+    for (; created < n; created++) {
+        t[created].cfg = cfg;
+        t[created].index = created;
+        t[created].start = &start;
+        if (pthread_create(&tid[created], NULL, scale_worker, &t[created]) != 0) break;
+    }
+    /* A thread that failed to start would leave the others on the barrier */
+    if (created < n) {
+        fprintf(stderr, "fpe_scale: could not create %u threads\n", n);
+        exit(1);
+    }
+    for (unsigned int i = 0; i < n; i++) pthread_join(tid[i], NULL);
+    pthread_barrier_destroy(&start);
+
+    memset(step, 0, sizeof(*step));
+    step->threads = n;
+    double first = 0.0, last = 0.0;
+    uint64_t lo = UINT64_MAX, hi = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        if (t[i].error) goto done;
+        if (i == 0 || t[i].t_start < first) first = t[i].t_start;
+        if (i == 0 || t[i].t_end > last) last = t[i].t_end;
+        step->records += t[i].records;
+        step->cpu += t[i].cpu;
+        if (t[i].records < lo) lo = t[i].records;
+        if (t[i].records > hi) hi = t[i].records;
+    }
+    step->wall = last - first;
+    step->ops_per_sec = (double)step->records / step->wall;
+    step->imbalance = lo ? (double)hi / (double)lo : INFINITY;
+    ret = 0;
+
+done:
+    free(t);
+    free(tid);
+    return ret;
+}
+
+/*
+ * Least-squares fit of Amdahl's law. With x = 1 - 1/n and y = 1 - 1/S the
+ * law is y = p * x, p the parallel fraction, so p = sum(xy) / sum(x^2)
+ * over the steps with n > 1. Returns the serial fraction 1 - p, or NaN
+ * when no such step exists.
+ */
+static double amdahl_fit(const scale_step *steps, unsigned int count, double base,
+                         double *rmse) {
+    double sxy = 0.0, sxx = 0.0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (steps[i].threads < 2) continue;
+        double x = 1.0 - 1.0 / steps[i].threads;
+        double y = 1.0 - base / steps[i].ops_per_sec;
+        sxy += x * y;
+        sxx += x * x;
+    }
+    *rmse = NAN;
+    if (sxx == 0.0) return NAN;
+
+    double p = sxy / sxx;
+    if (p < 0.0) p = 0.0;
+    if (p > 1.0) p = 1.0;
+
+    double se = 0.0;
+    for (unsigned int i = 0; i < count; i++) {
+        double n = steps[i].threads;
+        double model = 1.0 / ((1.0 - p) + p / n);
+        double d = steps[i].ops_per_sec / base - model;
+        se += d * d;
+    }
+    *rmse = sqrt(se / count);
+    return 1.0 - p;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+int main(int argc, char **argv) {
+    scale_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.cell.mode = FPE_MODE_FF1;
+    cfg.cell.algo = FPE_ALGO_AES;
+    cfg.cell.bits = 128;
+    cfg.cell.radix = 10;
+    cfg.cell.len = 16;
+    cfg.cell.api = BENCH_API_ARRAY;
+    cfg.cell.batch = 64;
+    cfg.time = 1.0;
+    cfg.warmup = 0.1;
+    cfg.format = BENCH_FORMAT_TEXT;
+
+    const char *dataset = NULL;
+    unsigned int v = 0;
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "m:a:b:r:l:A:B:dD:n:t:w:pf:o:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            bad |= parse_one(optarg, &v, bench_mode_names, bench_mode_values, 3);
+            cfg.cell.mode = (FPE_MODE)v;
+            break;
+        case 'a':
+            bad |= parse_one(optarg, &v, bench_algo_names, bench_algo_values, 2);
+            cfg.cell.algo = (FPE_ALGO)v;
+            break;
+        case 'A':
+            bad |= parse_one(optarg, &v, bench_api_names, bench_api_values, 4);
+            cfg.cell.api = (bench_api)v;
+            break;
+        case 'b': bad |= parse_one(optarg, &cfg.cell.bits, NULL, NULL, 0); break;
+        case 'r': bad |= parse_one(optarg, &cfg.cell.radix, NULL, NULL, 0); break;
+        case 'l': bad |= parse_one(optarg, &cfg.cell.len, NULL, NULL, 0); break;
+        case 'B': bad |= parse_one(optarg, &cfg.cell.batch, NULL, NULL, 0); break;
+        case 'd': cfg.cell.decrypt = 1; break;
+        case 'D': dataset = optarg; break;
+        case 'n': bad |= bench_parse_list(optarg, &cfg.threads, NULL, NULL, 0); break;
+        case 't': cfg.time = atof(optarg); bad |= cfg.time <= 0.0; break;
+        case 'w': cfg.warmup = atof(optarg); bad |= cfg.warmup < 0.0; break;
+        case 'p': cfg.pin = 1; break;
+        case 'f': bad |= bench_format_parse(optarg, &cfg.format); break;
+        case 'o': cfg.output = optarg; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    if (bad || optind != argc) {
+        usage(stderr);
+        return 2;
+    }
+
+    bench_dataset data;
+    memset(&data, 0, sizeof(data));
+    if (dataset) {
+        bench_dataset_spec spec;
+        if (bench_dataset_parse(dataset, &spec) != 0 || bench_dataset_generate(&data, &spec) != 0) {
+            fprintf(stderr, "fpe_scale: bad dataset spec '%s'\n", dataset);
+            return 2;
+        }
+        cfg.cell.radix = spec.radix;
+        cfg.cell.data = &data;
+    }
+
+    unsigned int cpus = online_cpus();
+    unsigned int counts[SCALE_MAX_THREADS];
+    unsigned int num_counts = 0;
+    if (cfg.threads.n <= 1) {
+        unsigned int max = cfg.threads.n ? cfg.threads.v[0] : cpus;
+        if (max > SCALE_MAX_THREADS) max = SCALE_MAX_THREADS;
+        for (unsigned int n = 1; n <= max; n++) counts[num_counts++] = n;
+    } else {
+        for (unsigned int i = 0; i < cfg.threads.n; i++) {
+            if (cfg.threads.v[i] > SCALE_MAX_THREADS) {
+                fprintf(stderr, "fpe_scale: at most %d threads\n", SCALE_MAX_THREADS);
+                return 2;
+            }
+            counts[num_counts++] = cfg.threads.v[i];
+        }
+    }
+
+    if (cfg.pin && pin_init() != 0) {
+        fprintf(stderr, "fpe_scale: CPU pinning is not supported on this platform\n");
+        return 1;
+    }
+
+    /* Reject the configuration up front rather than from inside a thread */
+    bench_workload probe;
+    if (bench_workload_init(&probe, &cfg.cell, 0) != 0 || bench_workload_call(&probe, 0) != 0) {
+        bench_workload_free(&probe);
+        fprintf(stderr, "fpe_scale: the library rejects this configuration\n");
+        return 1;
+    }
+    bench_workload_free(&probe);
+
+    FILE *out = stdout;
+    if (cfg.output && !(out = fopen(cfg.output, "w"))) {
+        perror(cfg.output);
+        return 1;
+    }
+
+    scale_step *steps = (scale_step *)calloc(num_counts, sizeof(scale_step));
+    if (!steps) {
+        if (out != stdout) fclose(out);
+        return 1;
+    }
+
+    bench_report report;
+    bench_timer_init(BENCH_TIMER_MONOTONIC);
+    bench_report_begin(&report, cfg.format, out, "fpe_scale");
+
+    /* Speedups are relative to the per-thread rate of the first step */
+    double base = 0.0;
+    int status = 0;
+    for (unsigned int i = 0; i < num_counts; i++) {
+        scale_step *s = &steps[i];
+        if (run_step(&cfg, counts[i], s) != 0) {
+            fprintf(stderr, "fpe_scale: %u threads failed while timing\n", counts[i]);
+            status = 1;
+            break;
+        }
+        if (i == 0) base = s->ops_per_sec / s->threads;
+
+        double speedup = s->ops_per_sec / base;
+        bench_field fields[] = {
+            BENCH_STR("mode", bench_mode_label(cfg.cell.mode)),
+            BENCH_STR("algo", bench_algo_label(cfg.cell.algo)),
+            BENCH_NUM("bits", cfg.cell.bits, 0),
+            BENCH_NUM("radix", cfg.cell.radix, 0),
+            BENCH_NUM("len", dataset ? data.mean_len : cfg.cell.len, dataset ? 1 : 0),
+            BENCH_STR("api", bench_api_names[cfg.cell.api]),
+            BENCH_STR("op", cfg.cell.decrypt ? "decrypt" : "encrypt"),
+            BENCH_NUM("threads", s->threads, 0),
+            BENCH_NUM("records", s->records, 0),
+            BENCH_NUM("wall_s", s->wall, 3),
+            BENCH_NUM("ops_per_sec", s->ops_per_sec, 0),
+            BENCH_NUM("per_thread_ops_per_sec", s->ops_per_sec / s->threads, 0),
+            BENCH_NUM("speedup", speedup, 2),
+            BENCH_NUM("efficiency_pct", speedup / s->threads * 100.0, 1),
+            BENCH_NUM("cpu_util_pct", s->cpu / (s->wall * s->threads) * 100.0, 1),
+            BENCH_NUM("imbalance", s->imbalance, 3),
+        };
+        bench_report_row(&report, fields, sizeof(fields) / sizeof(fields[0]));
+    }
+
+    if (status == 0) {
+        double rmse;
+        double serial = amdahl_fit(steps, num_counts, base, &rmse);
+        bench_field summary[] = {
+            BENCH_NUM("online_cpus", cpus, 0),
+            BENCH_STR("pinned", cfg.pin ? "yes" : "no"),
+            BENCH_NUM("amdahl_serial_fraction", serial, 4),
+            BENCH_NUM("amdahl_max_speedup", serial > 0.0 ? 1.0 / serial : NAN, 1),
+            BENCH_NUM("amdahl_fit_rmse", rmse, 3),
+            BENCH_STR("dataset", dataset ? dataset : ""),
+        };
+        bench_report_summary(&report, summary, sizeof(summary) / sizeof(summary[0]));
+    }
+
+    bench_report_end(&report);
+    bench_dataset_free(&data);
+    free(steps);
+    if (out != stdout) fclose(out);
+    return status;
+}
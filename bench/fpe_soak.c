@@ -0,0 +1,490 @@
+/**
+ * @file fpe_soak.c
+ * @brief fpe_soak: long-running mixed workload with drift and RSS tracking
+ *
+ * Runs N threads of mixed encryption and decryption for minutes to hours
+ * and prints one row per interval: throughput, p50/p99/p99.9 latency and
+ * process RSS. Rows are flushed as they are written, so a long run can be
+ * followed live or cut short with Ctrl-C and still get its summary.
+ *
+ * At the end the run is checked for the ways a long-lived process degrades
+ * where a short benchmark cannot see it:
+ *
+ *   - throughput drift: mean ops/s of the last quarter of the intervals
+ *     against the first quarter (the first interval is warmup and is left
+ *     out); a drop beyond -x fails
+ *   - p99 drift: median p99 of the last quarter against the first; a rise
+ *     beyond -y fails
+ *   - RSS growth: RSS at the end against the end of the first interval; more
+ *     than -G bytes fails. The least-squares slope is reported as well
+ *   - errors: any call that returned failure
+ *
+ * The exit status is 1 when any check fails, so a soak run can gate a
+ * release the way fpe_perfgate gates a commit.
+ *
+ * Usage:
+ *   fpe_soak [-m MODE] [-a ALGO] [-b BITS] [-r RADIX] [-l LEN] [-A API]
+ *            [-B N] [-D SPEC] [-n THREADS] [-T DURATION] [-i INTERVAL]
+ *            [-M DECRYPT_FRACTION] [-x TOL] [-y TOL] [-G BYTES]
+ *            [-f text|json|csv] [-o FILE]
+ *
+ * Durations take an s, m or h suffix: -T 2h -i 1m.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+#include "workload.h"
+
+/* Calls between checks of the flush deadline */
+#define SOAK_CHECK_EVERY 16
+
+/* How often threads fold their local histogram into the shared one */
+#define SOAK_FLUSH_SEC 0.005
+
+#define SOAK_MAX_THREADS 1024
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================
+ */
+
+typedef struct {
+    bench_cell cell;
+    unsigned int threads;
+    double duration;
+    double interval;
+    double decrypt_fraction;
+    double throughput_tol;
+    double p99_tol;
+    double rss_growth;
+    bench_format format;
+    const char *output;
+    const char *dataset;
+} soak_config;
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe_soak [options]\n"
+        "\n"
+        "  -m MODE      ff1, ff3 or ff3-1 (default ff1)\n"
+        "  -a ALGO      aes or sm4 (default aes)\n"
+        "  -b BITS      Key size (default 128)\n"
+        "  -r RADIX     Radix (default 10)\n"
+        "  -l LEN       Input length (default 16)\n"
+        "  -A API       array, str, oneshot or batch (default array)\n"
+        "  -B N         Records per batch call (default 64)\n"
+        "  -D SPEC      Synthetic dataset, e.g. pan or id:len=8-24 (replaces -r and -l)\n"
+        "  -n THREADS   Worker threads (default: online CPUs)\n"
+        "  -T DURATION  Run time, e.g. 90s, 30m, 4h (default 60s)\n"
+        "  -i INTERVAL  Sampling interval (default 5s)\n"
+        "  -M FRACTION  Share of calls that decrypt (default 0.5)\n"
+        "  -x TOL       Allowed throughput drop, first to last quarter (default 0.1)\n"
+        "  -y TOL       Allowed p99 rise, first to last quarter (default 0.25)\n"
+        "  -G BYTES     Allowed RSS growth after the first interval (default 8388608)\n"
+        "  -f FORMAT    text, json or csv (default text)\n"
+        "  -o FILE      Output file (default: stdout)\n");
+}
+
+/* "90", "90s", "15m", "2h"; returns seconds, or -1 */
+static double parse_duration(const char *s) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v <= 0.0) return -1.0;
+    if (*end == '\0' || strcmp(end, "s") == 0) return v;
+    if (strcmp(end, "m") == 0) return v * 60.0;
+    if (strcmp(end, "h") == 0) return v * 3600.0;
+    return -1.0;
+}
+
+/* ============================================================================
+ * Worker Threads
+ * ============================================================================
+ */
+
+/* Totals of the current interval, shared by the workers and the sampler */
+typedef struct {
+    pthread_mutex_t lock;
+    bench_hist hist;
+    uint64_t ops;
+    uint64_t errors;
+    int stop;
+} soak_shared;
+
+typedef struct {
+    const soak_config *cfg;
+    soak_shared *shared;
+    unsigned int index;
+    int error;
+    bench_hist local;
+} soak_thread;
+
+static void *soak_worker(void *arg) {
+    soak_thread *t = (soak_thread *)arg;
+    const soak_config *cfg = t->cfg;
+    bench_cell enc = cfg->cell, dec = cfg->cell;
+    bench_workload we, wd;
+    enc.decrypt = 0;
+    dec.decrypt = 1;
+    int ok = bench_workload_init(&we, &enc, t->index) == 0;
+    ok = ok && bench_workload_init(&wd, &dec, t->index + SOAK_MAX_THREADS) == 0;
+    if (!ok) {
+        t->error = 1;
+        pthread_mutex_lock(&t->shared->lock);
+        t->shared->stop = 1;
+        pthread_mutex_unlock(&t->shared->lock);
+        bench_workload_free(&we);
+        return NULL;
+    }
+
+    /* Each call decrypts with probability decrypt_fraction */
+    uint64_t x = 0x9E3779B97F4A7C15ull * (t->index + 1);
+    uint64_t threshold = (uint64_t)(cfg->decrypt_fraction * 18446744073709551615.0);
+    uint64_t ops = 0, errors = 0;
+    size_t ie = 0, id = 0;
+    int stop = 0;
+    bench_hist_reset(&t->local);
+
+    double flush = bench_now() + SOAK_FLUSH_SEC;
+    while (!stop) {
+        for (int k = 0; k < SOAK_CHECK_EVERY; k++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            int decrypt = x < threshold;
+            uint64_t t0 = bench_ticks();
+            int ret = decrypt ? bench_workload_call(&wd, id++) : bench_workload_call(&we, ie++);
+            uint64_t t1 = bench_ticks();
+            errors += ret != 0;
+            ops += we.per_call;
+            bench_hist_add(&t->local, (uint64_t)(bench_ticks_to_ns(t1 - t0) / we.per_call));
+        }
+        if (bench_now() < flush) continue;
+
+        pthread_mutex_lock(&t->shared->lock);
+        bench_hist_merge(&t->shared->hist, &t->local);
+        t->shared->ops += ops;
+        t->shared->errors += errors;
+        stop = t->shared->stop;
+        pthread_mutex_unlock(&t->shared->lock);
+        bench_hist_reset(&t->local);
+        ops = errors = 0;
+        flush = bench_now() + SOAK_FLUSH_SEC;
+    }
+
+    bench_workload_free(&we);
+    bench_workload_free(&wd);
+    return NULL;
+}
+
+/* ============================================================================
+ * Sampling and Checks
+ * ============================================================================
+ */
+
+typedef struct {
+    double t;
+    double ops_per_sec;
+    double p50;
+    double p99;
+    double p999;
+    double rss;
+} soak_sample;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    interrupted = 1;
+}
+
+/* Sleep until the monotonic clock reaches when, or a signal arrives */
+static void sleep_until(double when) {
+    double now;
+    while (!interrupted && (now = bench_now()) < when) {
+        double left = when - now > 0.1 ? 0.1 : when - now;
+        struct timespec ts = {0, (long)(left * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Mean throughput over samples [from, to) */
+static double mean_throughput(const soak_sample *s, size_t from, size_t to) {
+    double sum = 0.0;
+    for (size_t i = from; i < to; i++) sum += s[i].ops_per_sec;
+    return sum / (double)(to - from);
+}
+
+/* Median p99 over samples [from, to); a single bad interval does not count */
+static double median_p99(const soak_sample *s, size_t from, size_t to) {
+    size_t n = to - from;
+    double *v = (double *)malloc(n * sizeof(double));
+    if (!v) return NAN;
+    for (size_t i = 0; i < n; i++) v[i] = s[from + i].p99;
+    qsort(v, n, sizeof(double), cmp_double);
+    double m = n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    free(v);
+    return m;
+}
+
+/* Least-squares slope of RSS against time, bytes per second */
+static double rss_slope(const soak_sample *s, size_t from, size_t to) {
+    double n = 0.0, st = 0.0, sr = 0.0, stt = 0.0, str = 0.0;
+    for (size_t i = from; i < to; i++) {
+        n += 1.0;
+        st += s[i].t;
+        sr += s[i].rss;
+        stt += s[i].t * s[i].t;
+        str += s[i].t * s[i].rss;
+    }
+    double d = n * stt - st * st;
+    return n < 2.0 || d == 0.0 ? NAN : (n * str - st * sr) / d;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+static int parse_one(const char *arg, unsigned int *out, const char *const *names,
+                     const unsigned int *values, size_t count) {
+    bench_list list;
+    if (bench_parse_list(arg, &list, names, values, count) != 0 || list.n != 1) return -1;
+    *out = list.v[0];
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    soak_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.cell.mode = FPE_MODE_FF1;
+    cfg.cell.algo = FPE_ALGO_AES;
+    cfg.cell.bits = 128;
+    cfg.cell.radix = 10;
+    cfg.cell.len = 16;
+    cfg.cell.api = BENCH_API_ARRAY;
+    cfg.cell.batch = 64;
+    cfg.duration = 60.0;
+    cfg.interval = 5.0;
+    cfg.decrypt_fraction = 0.5;
+    cfg.throughput_tol = 0.1;
+    cfg.p99_tol = 0.25;
+    cfg.rss_growth = 8.0 * 1024 * 1024;
+    cfg.format = BENCH_FORMAT_TEXT;
+
+    unsigned int v = 0;
+    int opt, bad = 0;
+    while ((opt = getopt(argc, argv, "m:a:b:r:l:A:B:D:n:T:i:M:x:y:G:f:o:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            bad |= parse_one(optarg, &v, bench_mode_names, bench_mode_values, 3);
+            cfg.cell.mode = (FPE_MODE)v;
+            break;
+        case 'a':
+            bad |= parse_one(optarg, &v, bench_algo_names, bench_algo_values, 2);
+            cfg.cell.algo = (FPE_ALGO)v;
+            break;
+        case 'A':
+            bad |= parse_one(optarg, &v, bench_api_names, bench_api_values, 4);
+            cfg.cell.api = (bench_api)v;
+            break;
+        case 'b': bad |= parse_one(optarg, &cfg.cell.bits, NULL, NULL, 0); break;
+        case 'r': bad |= parse_one(optarg, &cfg.cell.radix, NULL, NULL, 0); break;
+        case 'l': bad |= parse_one(optarg, &cfg.cell.len, NULL, NULL, 0); break;
+        case 'B': bad |= parse_one(optarg, &cfg.cell.batch, NULL, NULL, 0); break;
+        case 'D': cfg.dataset = optarg; break;
+        case 'n': bad |= parse_one(optarg, &cfg.threads, NULL, NULL, 0); break;
+        case 'T': cfg.duration = parse_duration(optarg); bad |= cfg.duration <= 0.0; break;
+        case 'i': cfg.interval = parse_duration(optarg); bad |= cfg.interval <= 0.0; break;
+        case 'M':
+            cfg.decrypt_fraction = atof(optarg);
+            bad |= cfg.decrypt_fraction < 0.0 || cfg.decrypt_fraction > 1.0;
+            break;
+        case 'x': cfg.throughput_tol = atof(optarg); bad |= cfg.throughput_tol <= 0.0; break;
+        case 'y': cfg.p99_tol = atof(optarg); bad |= cfg.p99_tol <= 0.0; break;
+        case 'G': cfg.rss_growth = atof(optarg); bad |= cfg.rss_growth <= 0.0; break;
+        case 'f': bad |= bench_format_parse(optarg, &cfg.format); break;
+        case 'o': cfg.output = optarg; break;
+        case 'h': usage(stdout); return 0;
+        default: bad = 1; break;
+        }
+    }
+    if (bad || optind != argc || cfg.interval > cfg.duration) {
+        usage(stderr);
+        return 2;
+    }
+
+    bench_dataset data;
+    memset(&data, 0, sizeof(data));
+    if (cfg.dataset) {
+        bench_dataset_spec spec;
+        if (bench_dataset_parse(cfg.dataset, &spec) != 0 || bench_dataset_generate(&data, &spec) != 0) {
+            fprintf(stderr, "fpe_soak: bad dataset spec '%s'\n", cfg.dataset);
+            return 2;
+        }
+        cfg.cell.radix = spec.radix;
+        cfg.cell.data = &data;
+    }
+    if (cfg.threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        cfg.threads = n > 0 ? (unsigned int)n : 1;
+    }
+    if (cfg.threads > SOAK_MAX_THREADS) cfg.threads = SOAK_MAX_THREADS;
+
+    bench_workload probe;
+    if (bench_workload_init(&probe, &cfg.cell, 0) != 0 || bench_workload_call(&probe, 0) != 0) {
+        bench_workload_free(&probe);
+        fprintf(stderr, "fpe_soak: the library rejects this configuration\n");
+        return 1;
+    }
+    bench_workload_free(&probe);
+
+    size_t max_samples = (size_t)ceil(cfg.duration / cfg.interval) + 1;
+    soak_sample *samples = (soak_sample *)calloc(max_samples, sizeof(soak_sample));
+    soak_thread *threads = (soak_thread *)calloc(cfg.threads, sizeof(soak_thread));
+    pthread_t *tids = (pthread_t *)calloc(cfg.threads, sizeof(pthread_t));
+    soak_shared *shared = (soak_shared *)calloc(1, sizeof(soak_shared));
+    bench_hist *snap = (bench_hist *)malloc(sizeof(bench_hist));
+    if (!samples || !threads || !tids || !shared || !snap) return 1;
+
+    FILE *out = stdout;
+    if (cfg.output && !(out = fopen(cfg.output, "w"))) {
+        perror(cfg.output);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    bench_timer_init(BENCH_TIMER_AUTO);
+    pthread_mutex_init(&shared->lock, NULL);
+
+    bench_report report;
+    bench_report_begin(&report, cfg.format, out, "fpe_soak");
+
+    unsigned int started = 0;
+    for (; started < cfg.threads; started++) {
+        threads[started].cfg = &cfg;
+        threads[started].shared = shared;
+        threads[started].index = started;
+        if (pthread_create(&tids[started], NULL, soak_worker, &threads[started]) != 0) break;
+    }
+
+    double start = bench_now(), last = start;
+    uint64_t total_ops = 0, total_errors = 0;
+    size_t n = 0;
+    int worker_failed = started < cfg.threads;
+    while (!interrupted && !worker_failed && n < max_samples) {
+        double next = start + (double)(n + 1) * cfg.interval;
+        if (next > start + cfg.duration + 1e-9) break;
+        sleep_until(next);
+
+        pthread_mutex_lock(&shared->lock);
+        *snap = shared->hist;
+        uint64_t ops = shared->ops, errors = shared->errors;
+        bench_hist_reset(&shared->hist);
+        shared->ops = shared->errors = 0;
+        worker_failed = shared->stop;
+        pthread_mutex_unlock(&shared->lock);
+
+        double now = bench_now();
+        soak_sample *s = &samples[n++];
+        s->t = now - start;
+        s->ops_per_sec = (double)ops / (now - last);
+        s->p50 = bench_hist_quantile(snap, 0.50);
+        s->p99 = bench_hist_quantile(snap, 0.99);
+        s->p999 = bench_hist_quantile(snap, 0.999);
+        s->rss = bench_rss_bytes();
+        last = now;
+        total_ops += ops;
+        total_errors += errors;
+
+        bench_field fields[] = {
+            BENCH_NUM("t_s", s->t, 1),
+            BENCH_NUM("ops_per_sec", s->ops_per_sec, 0),
+            BENCH_NUM("p50_ns", s->p50, 0),
+            BENCH_NUM("p99_ns", s->p99, 0),
+            BENCH_NUM("p999_ns", s->p999, 0),
+            BENCH_NUM("rss_kb", s->rss / 1024.0, 0),
+            BENCH_NUM("errors", errors, 0),
+        };
+        bench_report_row(&report, fields, sizeof(fields) / sizeof(fields[0]));
+        fflush(out);
+    }
+
+    pthread_mutex_lock(&shared->lock);
+    shared->stop = 1;
+    pthread_mutex_unlock(&shared->lock);
+    for (unsigned int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+    for (unsigned int i = 0; i < started; i++) worker_failed |= threads[i].error;
+
+    /* Quarters of the run after the warmup interval */
+    size_t from = n > 1 ? 1 : 0, q = (n - from) / 4;
+    double tp_drift = NAN, p99_drift = NAN, growth = NAN, slope = NAN;
+    if (q >= 1) {
+        tp_drift = mean_throughput(samples, n - q, n) / mean_throughput(samples, from, from + q) - 1.0;
+        p99_drift = median_p99(samples, n - q, n) / median_p99(samples, from, from + q) - 1.0;
+    }
+    if (n >= 2) {
+        growth = samples[n - 1].rss - samples[0].rss;
+        slope = rss_slope(samples, from, n);
+    }
+    /* NaN compares false, so a run too short to measure must fail explicitly */
+    int too_short = q < 1;
+    int tp_fail = tp_drift < -cfg.throughput_tol;
+    int p99_fail = p99_drift > cfg.p99_tol;
+    int rss_fail = growth > cfg.rss_growth;
+    int status = too_short || tp_fail || p99_fail || rss_fail || total_errors || worker_failed;
+
+    bench_field summary[] = {
+        BENCH_STR("mode", bench_mode_label(cfg.cell.mode)),
+        BENCH_STR("algo", bench_algo_label(cfg.cell.algo)),
+        BENCH_NUM("bits", cfg.cell.bits, 0),
+        BENCH_NUM("radix", cfg.cell.radix, 0),
+        BENCH_NUM("len", cfg.dataset ? data.mean_len : cfg.cell.len, cfg.dataset ? 1 : 0),
+        BENCH_STR("api", bench_api_names[cfg.cell.api]),
+        BENCH_STR("dataset", cfg.dataset ? cfg.dataset : ""),
+        BENCH_NUM("threads", cfg.threads, 0),
+        BENCH_NUM("decrypt_fraction", cfg.decrypt_fraction, 2),
+        BENCH_NUM("intervals", n, 0),
+        BENCH_NUM("total_ops", total_ops, 0),
+        BENCH_NUM("errors", total_errors, 0),
+        BENCH_NUM("throughput_drift_pct", tp_drift * 100.0, 1),
+        BENCH_NUM("p99_drift_pct", p99_drift * 100.0, 1),
+        BENCH_NUM("rss_growth_kb", growth / 1024.0, 0),
+        BENCH_NUM("rss_slope_kb_per_hour", slope * 3600.0 / 1024.0, 1),
+        BENCH_STR("throughput", too_short ? "insufficient samples" : tp_fail ? "DRIFT" : "ok"),
+        BENCH_STR("latency", too_short ? "insufficient samples" : p99_fail ? "DRIFT" : "ok"),
+        BENCH_STR("memory", n < 2 ? "insufficient samples" : rss_fail ? "GROWTH" : "ok"),
+        BENCH_STR("result", status ? "FAIL" : "PASS"),
+    };
+    bench_report_summary(&report, summary, sizeof(summary) / sizeof(summary[0]));
+    bench_report_end(&report);
+
+    if (worker_failed) fprintf(stderr, "fpe_soak: a worker thread failed to start\n");
+    if (too_short) {
+        fprintf(stderr, "fpe_soak: %zu intervals, the drift checks need at least 5 "
+                        "(raise -T or lower -i)\n", n);
+    }
+    pthread_mutex_destroy(&shared->lock);
+    bench_dataset_free(&data);
+    free(samples);
+    free(threads);
+    free(tids);
+    free(shared);
+    free(snap);
+    if (out != stdout) fclose(out);
+    return status;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file perf.c
+ * @brief Hardware performance counters for benchmarks
+ *
+ * Each counter is a separate perf event rather than one group, so a PMU
+ * that lacks one event (L1D misses are often missing in VMs) still yields
+ * the others. When the kernel multiplexes counters, values are scaled by
+ * time enabled / time running.
+ */
+
+#define _GNU_SOURCE
+
+#include "perf.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCH_HAVE_PERF 1
+#endif
+
+#if defined(BENCH_HAVE_PERF)
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[BENCH_PERF_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+static int perf_event_open(struct perf_event_attr *attr) {
+    return (int)syscall(SYS_perf_event_open, attr, 0, -1, -1, 0);
+}
+#endif
+
+int bench_perf_open(bench_perf *p) {
+    int opened = 0;
+    p->error = 0;
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        p->fd[i] = -1;
+        p->value[i] = NAN;
+    }
+
+#if defined(BENCH_HAVE_PERF)
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        p->fd[i] = perf_event_open(&attr);
+        if (p->fd[i] >= 0) opened++;
+        else if (!p->error) p->error = errno;
+    }
+#else
+    p->error = -1;
+#endif
+    return opened;
+}
+
+void bench_perf_start(bench_perf *p) {
+#if defined(BENCH_HAVE_PERF)
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] < 0) continue;
+        ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)p;
+#endif
+}
+
+void bench_perf_stop(bench_perf *p) {
+#if defined(BENCH_HAVE_PERF)
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] >= 0) ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        uint64_t v[3];   /* value, time enabled, time running */
+        p->value[i] = NAN;
+        if (p->fd[i] < 0 || read(p->fd[i], v, sizeof(v)) != (ssize_t)sizeof(v)) continue;
+        if (v[2] == 0) continue;
+        p->value[i] = v[2] < v[1] ? (double)v[0] * ((double)v[1] / (double)v[2]) : (double)v[0];
+    }
+#else
+    (void)p;
+#endif
+}
+
+void bench_perf_close(bench_perf *p) {
+#if defined(BENCH_HAVE_PERF)
+    for (int i = 0; i < BENCH_PERF_COUNT; i++) {
+        if (p->fd[i] >= 0) close(p->fd[i]);
+        p->fd[i] = -1;
+    }
+#else
+    (void)p;
+#endif
+}
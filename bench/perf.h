@@ -0,0 +1,43 @@
+/**
+ * @file perf.h
+ * @brief Hardware performance counters (Linux perf_event_open) for benchmarks
+ *
+ * Counters that cannot be opened (no PMU in a VM or container,
+ * perf_event_paranoid, non-Linux systems) read as NaN rather than failing,
+ * so a benchmark run with counters requested still produces its timings.
+ */
+
+#ifndef FPE_BENCH_PERF_H
+#define FPE_BENCH_PERF_H
+
+#include <stdint.h>
+
+typedef enum {
+    BENCH_PERF_CYCLES = 0,
+    BENCH_PERF_INSTRUCTIONS,
+    BENCH_PERF_BRANCH_MISSES,
+    BENCH_PERF_L1D_MISSES,       /* L1 data cache read misses */
+    BENCH_PERF_COUNT
+} bench_perf_counter;
+
+typedef struct {
+    int fd[BENCH_PERF_COUNT];        /* -1 when the counter is unavailable */
+    double value[BENCH_PERF_COUNT];  /* Last interval, scaled for multiplexing */
+    int error;                       /* errno of the first counter that failed */
+} bench_perf;
+
+/**
+ * Open the counters for the calling thread, user space only.
+ * @return Number of counters opened (0 when none are available)
+ */
+int bench_perf_open(bench_perf *p);
+
+/** Reset and start the open counters */
+void bench_perf_start(bench_perf *p);
+
+/** Stop the counters and read the interval into p->value (NaN if unavailable) */
+void bench_perf_stop(bench_perf *p);
+
+void bench_perf_close(bench_perf *p);
+
+#endif /* FPE_BENCH_PERF_H */
@@ -0,0 +1,244 @@
+/**
+ * @file workload.c
+ * @brief Benchmark workloads shared by the benchmark tools
+ */
+
+#include "workload.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char alphabet62[] =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+const char *const bench_mode_names[3] = {"ff1", "ff3", "ff3-1"};
+const unsigned int bench_mode_values[3] = {FPE_MODE_FF1, FPE_MODE_FF3, FPE_MODE_FF3_1};
+const char *const bench_algo_names[2] = {"aes", "sm4"};
+const unsigned int bench_algo_values[2] = {FPE_ALGO_AES, FPE_ALGO_SM4};
+const char *const bench_api_names[4] = {"array", "str", "oneshot", "batch"};
+const unsigned int bench_api_values[4] = {
+    BENCH_API_ARRAY, BENCH_API_STR, BENCH_API_ONESHOT, BENCH_API_BATCH
+};
+
+/* ============================================================================
+ * Workload
+ * ============================================================================
+ */
+
+void bench_workload_free(bench_workload *w) {
+    FPE_CTX_free(w->ctx);
+    free(w->in);
+    free(w->out);
+    free(w->str_in);
+    free(w->str_out);
+    free(w->iov);
+    free(w->scratch);
+    memset(w, 0, sizeof(*w));
+}
+
+/* Dataset records in place of the ring, checked once per distinct length */
+static int init_dataset(bench_workload *w, uint64_t seed) {
+    const bench_dataset *d = w->cell.data;
+    size_t width = (size_t)d->max_len + 1;
+    w->start = (size_t)(seed * 0x9E3779B97F4A7C15ull % d->count);
+    w->out = (unsigned int *)malloc(width * sizeof(unsigned int));
+    w->str_out = (char *)malloc(width);
+    w->iov = (FPE_IOV *)malloc(w->per_call * sizeof(FPE_IOV));
+    w->scratch = (char *)malloc(w->per_call * width);
+    char *seen = (char *)calloc(width, 1);
+    int ret = w->out && w->str_out && w->iov && w->scratch && seen ? 0 : -1;
+
+    for (size_t r = 0; r < d->count && ret == 0; r++) {
+        if (seen[d->len[r]]) continue;
+        seen[d->len[r]] = 1;
+        ret = FPE_encrypt(w->ctx, d->digits + d->offset[r], w->out, d->len[r],
+                          w->tweak, w->tweak_len);
+    }
+    free(seen);
+    return ret;
+}
+
+static int call_dataset(bench_workload *w, size_t i) {
+    const bench_cell *c = &w->cell;
+    const bench_dataset *d = c->data;
+    size_t r = (w->start + i * w->per_call) % d->count;
+    const unsigned int *in = d->digits + d->offset[r];
+    unsigned int len = d->len[r];
+
+    switch (c->api) {
+    case BENCH_API_ARRAY:
+        return c->decrypt
+            ? FPE_decrypt(w->ctx, in, w->out, len, w->tweak, w->tweak_len)
+            : FPE_encrypt(w->ctx, in, w->out, len, w->tweak, w->tweak_len);
+    case BENCH_API_STR:
+        return c->decrypt
+            ? FPE_decrypt_str(w->ctx, w->alphabet, d->text + d->offset[r], w->str_out,
+                              w->tweak, w->tweak_len)
+            : FPE_encrypt_str(w->ctx, w->alphabet, d->text + d->offset[r], w->str_out,
+                              w->tweak, w->tweak_len);
+    case BENCH_API_ONESHOT:
+        return c->decrypt
+            ? FPE_decrypt_oneshot(c->mode, c->algo, w->key, c->bits, c->radix, in, w->out,
+                                  len, w->tweak, w->tweak_len)
+            : FPE_encrypt_oneshot(c->mode, c->algo, w->key, c->bits, c->radix, in, w->out,
+                                  len, w->tweak, w->tweak_len);
+    case BENCH_API_BATCH: {
+        /* Records differ in length, so batches go through the iov API */
+        char *p = w->scratch;
+        for (unsigned int k = 0; k < w->per_call; k++, r = (r + 1) % d->count) {
+            memcpy(p, d->text + d->offset[r], d->len[r]);
+            w->iov[k].base = p;
+            w->iov[k].len = d->len[r];
+            w->iov[k].tweak = w->tweak;
+            w->iov[k].tweak_len = w->tweak_len;
+            p += d->len[r];
+        }
+        return c->decrypt ? FPE_decrypt_iov(w->ctx, w->alphabet, w->iov, w->per_call)
+                          : FPE_encrypt_iov(w->ctx, w->alphabet, w->iov, w->per_call);
+    }
+    }
+    return -1;
+}
+
+int bench_workload_init(bench_workload *w, const bench_cell *c, uint64_t seed) {
+    memset(w, 0, sizeof(*w));
+    w->cell = *c;
+    w->per_call = c->api == BENCH_API_BATCH ? c->batch : 1;
+    for (unsigned int i = 0; i < 32; i++) w->key[i] = (unsigned char)i;
+    for (unsigned int i = 0; i < 8; i++) w->tweak[i] = (unsigned char)(i + 1);
+    w->tweak_len = c->mode == FPE_MODE_FF3_1 ? 7 : 8;
+
+    if (c->data) {
+        if (w->per_call == 0 || c->radix != c->data->spec.radix) return -1;
+        memcpy(w->alphabet, c->data->alphabet, sizeof(w->alphabet));
+        w->ctx = FPE_CTX_new();
+        if (!w->ctx || FPE_CTX_init(w->ctx, c->mode, c->algo, w->key, c->bits, c->radix) != 0 ||
+            init_dataset(w, seed) != 0) {
+            bench_workload_free(w);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (w->per_call == 0 || c->len == 0 || c->radix < 2) return -1;
+    if (c->api == BENCH_API_STR) {
+        if (c->radix > 62) return -1;
+        memcpy(w->alphabet, alphabet62, c->radix);
+        w->alphabet[c->radix] = '\0';
+    }
+
+    w->ctx = FPE_CTX_new();
+    if (!w->ctx) return -1;
+    if (FPE_CTX_init(w->ctx, c->mode, c->algo, w->key, c->bits, c->radix) != 0) {
+        bench_workload_free(w);
+        return -1;
+    }
+
+    size_t nums = (size_t)BENCH_RING * w->per_call * c->len;
+    w->in = (unsigned int *)malloc(nums * sizeof(unsigned int));
+    w->out = (unsigned int *)malloc(nums * sizeof(unsigned int));
+    w->str_in = (char *)malloc((size_t)BENCH_RING * (c->len + 1));
+    w->str_out = (char *)malloc(c->len + 1);
+    if (!w->in || !w->out || !w->str_in || !w->str_out) {
+        bench_workload_free(w);
+        return -1;
+    }
+
+    uint64_t x = 0x9E3779B97F4A7C15ull ^ (seed * 0xBF58476D1CE4E5B9ull);
+    for (size_t i = 0; i < nums; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        w->in[i] = (unsigned int)(x % c->radix);
+    }
+    for (size_t r = 0; r < BENCH_RING; r++) {
+        char *s = w->str_in + r * (c->len + 1);
+        for (unsigned int k = 0; k < c->len; k++) s[k] = alphabet62[w->in[r * c->len + k] % 62];
+        s[c->len] = '\0';
+    }
+    return 0;
+}
+
+int bench_workload_call(bench_workload *w, size_t i) {
+    const bench_cell *c = &w->cell;
+    size_t r = i % BENCH_RING;
+    if (c->data) return call_dataset(w, i);
+
+    switch (c->api) {
+    case BENCH_API_ARRAY: {
+        const unsigned int *in = w->in + r * c->len;
+        return c->decrypt
+            ? FPE_decrypt(w->ctx, in, w->out, c->len, w->tweak, w->tweak_len)
+            : FPE_encrypt(w->ctx, in, w->out, c->len, w->tweak, w->tweak_len);
+    }
+    case BENCH_API_STR: {
+        const char *in = w->str_in + r * (c->len + 1);
+        return c->decrypt
+            ? FPE_decrypt_str(w->ctx, w->alphabet, in, w->str_out, w->tweak, w->tweak_len)
+            : FPE_encrypt_str(w->ctx, w->alphabet, in, w->str_out, w->tweak, w->tweak_len);
+    }
+    case BENCH_API_ONESHOT: {
+        const unsigned int *in = w->in + r * c->len;
+        return c->decrypt
+            ? FPE_decrypt_oneshot(c->mode, c->algo, w->key, c->bits, c->radix, in, w->out,
+                                  c->len, w->tweak, w->tweak_len)
+            : FPE_encrypt_oneshot(c->mode, c->algo, w->key, c->bits, c->radix, in, w->out,
+                                  c->len, w->tweak, w->tweak_len);
+    }
+    case BENCH_API_BATCH: {
+        const unsigned int *in = w->in + r * w->per_call * c->len;
+        return c->decrypt
+            ? FPE_decrypt_batch(w->ctx, in, w->out, c->len, w->per_call,
+                                w->tweak, w->tweak_len, 0)
+            : FPE_encrypt_batch(w->ctx, in, w->out, c->len, w->per_call,
+                                w->tweak, w->tweak_len, 0);
+    }
+    }
+    return -1;
+}
+
+/* ============================================================================
+ * Names and Option Lists
+ * ============================================================================
+ */
+
+static int parse_name(const char *s, size_t len, const char *const *names,
+                      const unsigned int *values, size_t count, unsigned int *out) {
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(names[i]) == len && strncmp(s, names[i], len) == 0) {
+            *out = values[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int bench_parse_list(const char *arg, bench_list *list, const char *const *names,
+                     const unsigned int *values, size_t count) {
+    list->n = 0;
+    while (*arg) {
+        const char *end = strchr(arg, ',');
+        size_t len = end ? (size_t)(end - arg) : strlen(arg);
+        unsigned int v;
+
+        if (list->n == BENCH_MAX_LIST || len == 0) return -1;
+        if (names) {
+            if (parse_name(arg, len, names, values, count, &v) != 0) return -1;
+        } else {
+            char *stop;
+            unsigned long n = strtoul(arg, &stop, 10);
+            if (stop != arg + len || n == 0 || n > 0xFFFFu) return -1;
+            v = (unsigned int)n;
+        }
+        list->v[list->n++] = v;
+        arg += len + (end ? 1 : 0);
+    }
+    return list->n > 0 ? 0 : -1;
+}
+
+const char *bench_mode_label(FPE_MODE mode) {
+    return mode == FPE_MODE_FF1 ? "FF1" : mode == FPE_MODE_FF3 ? "FF3" : "FF3-1";
+}
+
+const char *bench_algo_label(FPE_ALGO algo) {
+    return algo == FPE_ALGO_SM4 ? "SM4" : "AES";
+}
@@ -0,0 +1,99 @@
+/**
+ * @file workload.h
+ * @brief Benchmark workloads: one FPE call on pre-generated inputs
+ */
+
+#ifndef FPE_BENCH_WORKLOAD_H
+#define FPE_BENCH_WORKLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dataset.h"
+#include "fpe.h"
+
+/* Distinct inputs cycled through so every call does not see the same data */
+#define BENCH_RING 64
+
+/* Longest comma-separated option list */
+#define BENCH_MAX_LIST 16
+
+typedef enum {
+    BENCH_API_ARRAY = 0,   /* FPE_encrypt on a context */
+    BENCH_API_STR,         /* FPE_encrypt_str on a context */
+    BENCH_API_ONESHOT,     /* FPE_encrypt_oneshot: context setup on every call */
+    BENCH_API_BATCH        /* FPE_encrypt_batch, batch records per call */
+} bench_api;
+
+typedef struct {
+    FPE_MODE mode;
+    FPE_ALGO algo;
+    unsigned int bits;
+    unsigned int radix;
+    unsigned int len;
+    bench_api api;
+    unsigned int batch;    /* Records per call for BENCH_API_BATCH */
+    int decrypt;
+    const bench_dataset *data;  /* Records to cycle through instead of the
+                                   uniform ring; radix must match, len unused */
+} bench_cell;
+
+typedef struct {
+    bench_cell cell;
+    FPE_CTX *ctx;
+    unsigned char key[32];
+    unsigned char tweak[8];
+    unsigned int tweak_len;
+    char alphabet[63];
+    unsigned int per_call;     /* Records per call */
+    unsigned int *in;          /* BENCH_RING calls' worth of records */
+    unsigned int *out;
+    char *str_in;              /* BENCH_RING NUL-terminated records */
+    char *str_out;
+    size_t start;              /* First dataset record; differs per seed */
+    FPE_IOV *iov;              /* Dataset batches, through FPE_encrypt_iov */
+    char *scratch;
+} bench_workload;
+
+/**
+ * Create the context and inputs for a cell. Inputs differ per seed; with a
+ * dataset, the seed picks where in the dataset calls start. Every record
+ * length in the dataset must be valid for the cell.
+ * @return 0 on success, -1 if the library rejects the cell or on OOM
+ */
+int bench_workload_init(bench_workload *w, const bench_cell *cell, uint64_t seed);
+
+/** One call on input i of the ring; returns the library's result */
+int bench_workload_call(bench_workload *w, size_t i);
+
+void bench_workload_free(bench_workload *w);
+
+/* ============================================================================
+ * Names and Option Lists
+ * ============================================================================
+ */
+
+typedef struct {
+    unsigned int n;
+    unsigned int v[BENCH_MAX_LIST];
+} bench_list;
+
+/* Name tables for bench_parse_list */
+extern const char *const bench_mode_names[3];
+extern const unsigned int bench_mode_values[3];
+extern const char *const bench_algo_names[2];
+extern const unsigned int bench_algo_values[2];
+extern const char *const bench_api_names[4];
+extern const unsigned int bench_api_values[4];
+
+/**
+ * Parse a comma-separated list, e.g. "ff1,ff3-1" or "9,16". With names,
+ * items are matched against them; without, items are numbers 1..65535.
+ * @return 0 on success, -1 on a bad item or an empty list
+ */
+int bench_parse_list(const char *arg, bench_list *list, const char *const *names,
+                     const unsigned int *values, size_t count);
+
+const char *bench_mode_label(FPE_MODE mode);
+const char *bench_algo_label(FPE_ALGO algo);
+
+#endif /* FPE_BENCH_WORKLOAD_H */
@@ -38,7 +38,8 @@
 typedef struct {
     int thread_id;
     int operations_completed;
-    double elapsed_seconds;
+    double elapsed_seconds;            /* Wall-clock time */
+    double cpu_seconds;                /* CPU time of this thread */
     FPE_MODE mode;
     FPE_ALGO algo;
     int key_bits;
@@ -51,6 +52,24 @@ typedef struct {
     double duration_seconds;           /* How long to run */
 } thread_benchmark_args_t;
 
+/*
+ * Elapsed time must come from a wall clock. clock() returns CPU time of the
+ * whole process, summed over all threads, so with N busy threads it runs N
+ * times faster than real time: each thread stops after 1/N of the intended
+ * duration and the computed TPS is N times too low.
+ */
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double thread_cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
 void* benchmark_thread_worker(void* arg) {
     thread_benchmark_args_t* args = (thread_benchmark_args_t*)arg;
     
@@ -83,7 +102,8 @@ void* benchmark_thread_worker(void* arg) {
     pthread_barrier_wait(args->start_barrier);
     
     /* Start timing */
-    clock_t start = clock();
+    double start = wall_seconds();
+    double cpu_start = thread_cpu_seconds();
     
     /* Run operations for specified duration */
     int ops = 0;
@@ -94,14 +114,13 @@ void* benchmark_thread_worker(void* arg) {
             FPE_encrypt(ctx, plaintext, ciphertext, args->length, tweak, tweak_len);
             ops++;
             
-            clock_t current = clock();
-            elapsed = (double)(current - start) / CLOCKS_PER_SEC;
+            elapsed = wall_seconds() - start;
         } while (elapsed < args->duration_seconds && !(*args->should_stop));
     }
     
     /* Stop timing */
-    clock_t end = clock();
-    double elapsed = (double)(end - start) / CLOCKS_PER_SEC;
+    double elapsed = wall_seconds() - start;
+    double cpu = thread_cpu_seconds() - cpu_start;
     
     /* Wait at end barrier for all threads to finish */
     pthread_barrier_wait(args->end_barrier);
@@ -109,6 +128,7 @@ void* benchmark_thread_worker(void* arg) {
     /* Record results */
     args->operations_completed = ops;
     args->elapsed_seconds = elapsed;
+    args->cpu_seconds = cpu;
     
     /* Cleanup */
     free(plaintext);
@@ -166,7 +186,8 @@ void example1_single_threaded_baseline(void) {
     
     printf("Results:\n");
     printf("• Operations: %d\n", args.operations_completed);
-    printf("• Elapsed: %.3f seconds\n", args.elapsed_seconds);
+    printf("• Elapsed: %.3f seconds (CPU %.3f seconds)\n",
+           args.elapsed_seconds, args.cpu_seconds);
     printf("• TPS: %.0f operations/second\n", tps);
     printf("• Latency: %.2f µs/operation\n", 
            (args.elapsed_seconds * 1000000.0) / args.operations_completed);
@@ -192,10 +213,11 @@ void example2_multi_threaded_scaling(void) {
     printf("• Length: 16\n");
     printf("• Duration: 2 seconds per test\n\n");
     
-    printf("%-10s %15s %15s %15s\n", 
-           "Threads", "Total TPS", "Per-Thread TPS", "Efficiency");
-    printf("%-10s %15s %15s %15s\n", 
-           "----------", "---------------", "---------------", "---------------");
+    printf("%-10s %15s %15s %15s %10s\n", 
+           "Threads", "Total TPS", "Per-Thread TPS", "Efficiency", "CPU Util");
+    printf("%-10s %15s %15s %15s %10s\n", 
+           "----------", "---------------", "---------------", "---------------",
+           "----------");
     
     unsigned char key[32];
     for (int i = 0; i < 32; i++) key[i] = i;
@@ -241,8 +263,10 @@ void example2_multi_threaded_scaling(void) {
         /* Calculate total TPS */
         int total_ops = 0;
         double max_elapsed = 0;
+        double total_cpu = 0;
         for (int i = 0; i < num_threads; i++) {
             total_ops += args[i].operations_completed;
+            total_cpu += args[i].cpu_seconds;
             if (args[i].elapsed_seconds > max_elapsed) {
                 max_elapsed = args[i].elapsed_seconds;
             }
@@ -256,9 +280,11 @@ void example2_multi_threaded_scaling(void) {
         }
         
         double efficiency = (total_tps / baseline_tps) / num_threads * 100.0;
+        /* Below 100% means threads waited for a core */
+        double cpu_util = total_cpu / (max_elapsed * num_threads) * 100.0;
         
-        printf("%-10d %15.0f %15.0f %14.1f%%\n", 
-               num_threads, total_tps, per_thread_tps, efficiency);
+        printf("%-10d %15.0f %15.0f %14.1f%% %9.1f%%\n", 
+               num_threads, total_tps, per_thread_tps, efficiency, cpu_util);
         
         /* Cleanup */
         free(threads);
@@ -459,7 +485,7 @@ void print_mt_benchmark_best_practices(void) {
     
     printf("✓ DO:\n");
     printf("  • Use pthread_barrier to synchronize thread start\n");
-    printf("  • Measure wall-clock time (not CPU time)\n");
+    printf("  • Measure wall-clock time (CLOCK_MONOTONIC, not clock())\n");
     printf("  • Run for sufficient duration (1-2+ seconds)\n");
     printf("  • Test multiple thread counts\n");
     printf("  • Use thread-local FPE_CTX instances\n");
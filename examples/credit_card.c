@@ -178,28 +178,19 @@ int main(void) {
     printf("---------------------------------------------\n");
     
     char full_card[] = "4111111111111111";
-    char iin[7];
-    char account_number[11];
-    char encrypted_account[11] = {0};
     char result_card[17] = {0};
+    char restored_card[17] = {0};
     
-    // Extract IIN (first 6 digits) and account number (remaining digits)
-    strncpy(iin, full_card, 6);
-    iin[6] = '\0';
-    strcpy(account_number, full_card + 6);
+    // The library keeps the IIN in clear, encrypts the account digits and
+    // recomputes the Luhn check digit so the token is still a valid PAN
+    FPE_encrypt_pan(ctx, full_card, result_card, FPE_PAN_KEEP_BIN, tweak_user_123, 4);
+    FPE_decrypt_pan(ctx, result_card, restored_card, FPE_PAN_KEEP_BIN, tweak_user_123, 4);
     
     printf("Original card:   %s (%s)\n", full_card, get_card_type(full_card));
-    printf("IIN (preserved): %s\n", iin);
-    printf("Account number:  %s\n", account_number);
-    
-    // Encrypt only the account number portion
-    FPE_encrypt_str(ctx, alphabet, account_number, encrypted_account, tweak_user_123, 4);
-    
-    // Reconstruct card with preserved IIN
-    strcpy(result_card, iin);
-    strcat(result_card, encrypted_account);
-    
     printf("Encrypted card:  %s (%s)\n", result_card, get_card_type(result_card));
+    printf("Luhn check:      %c (expected %c)\n",
+           result_card[15], calculate_luhn(result_card, 16));
+    printf("Decrypted card:  %s\n", restored_card);
     printf("✓ Card type still identifiable\n\n");
     
     /* ========================================================================
@@ -25,6 +25,13 @@
 #include <time.h>
 #include "fpe.h"
 
+/* Wall-clock seconds; clock() would sum CPU time over all threads */
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
 /* ============================================================================
  * Example 1: Thread-Local Context (Recommended Approach)
  * ============================================================================
@@ -113,7 +120,7 @@ void example1_thread_local_context(void) {
     printf("• Approach: Thread-local context (no synchronization needed)\n\n");
     
     /* Start timing */
-    clock_t start = clock();
+    double start = wall_seconds();
     
     /* Create threads */
     for (int i = 0; i < NUM_THREADS; i++) {
@@ -135,8 +142,7 @@ void example1_thread_local_context(void) {
     }
     
     /* Calculate performance */
-    clock_t end = clock();
-    double elapsed = (double)(end - start) / CLOCKS_PER_SEC;
+    double elapsed = wall_seconds() - start;
     double total_ops = NUM_THREADS * OPS_PER_THREAD;
     double tps = total_ops / elapsed;
     
@@ -246,7 +252,7 @@ void example2_shared_context_with_mutex(void) {
     printf("• Approach: Shared context with mutex (lock contention expected)\n\n");
     
     /* Start timing */
-    clock_t start = clock();
+    double start = wall_seconds();
     
     /* Create threads */
     for (int i = 0; i < NUM_THREADS; i++) {
@@ -270,8 +276,7 @@ void example2_shared_context_with_mutex(void) {
     }
     
     /* Calculate performance */
-    clock_t end = clock();
-    double elapsed = (double)(end - start) / CLOCKS_PER_SEC;
+    double elapsed = wall_seconds() - start;
     double total_ops = NUM_THREADS * OPS_PER_THREAD;
     double tps = total_ops / elapsed;
     
@@ -390,7 +395,7 @@ void example3_thread_pool_pattern(void) {
     printf("• Approach: Thread pool with work queue\n\n");
     
     /* Start timing */
-    clock_t start = clock();
+    double start = wall_seconds();
     
     /* Create worker threads */
     for (int i = 0; i < NUM_WORKERS; i++) {
@@ -411,8 +416,7 @@ void example3_thread_pool_pattern(void) {
     }
     
     /* Calculate performance */
-    clock_t end = clock();
-    double elapsed = (double)(end - start) / CLOCKS_PER_SEC;
+    double elapsed = wall_seconds() - start;
     double tps = NUM_WORK_ITEMS / elapsed;
     
     printf("\nPerformance:\n");
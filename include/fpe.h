@@ -14,6 +14,7 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @brief Supported Underlying Encryption Algorithms
@@ -123,6 +124,706 @@ int FPE_decrypt_str(FPE_CTX *ctx, const char *alphabet,
                     const char *in, char *out,
                     const unsigned char *tweak, unsigned int tweak_len);
 
+/* ========================================================================= */
+/*                           Byte-String Interface                           */
+/* ========================================================================= */
+
+/**
+ * @brief Encrypt a raw byte string (radix 256)
+ *
+ * Each byte is one radix-256 numeral, so binary tokens such as 16-byte IDs
+ * or UUIDs need no numeral conversion. With FF1 the byte string is used
+ * directly as NUM and the length is not capped; FF3/FF3-1 contexts fall back
+ * to the numeral array path and keep its length limits.
+ *
+ * @param ctx Initialized FPE context. (Radix must be 256)
+ * @param in Input bytes.
+ * @param out Output buffer of len bytes (may equal in).
+ * @param len Number of bytes (>= 2).
+ * @param tweak Tweak bytes.
+ * @param tweak_len Length of tweak.
+ * @return 0 on success, -1 on failure.
+ */
+int FPE_encrypt_bytes(FPE_CTX *ctx,
+                      const unsigned char *in, unsigned char *out, unsigned int len,
+                      const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Decrypt a raw byte string (radix 256)
+ */
+int FPE_decrypt_bytes(FPE_CTX *ctx,
+                      const unsigned char *in, unsigned char *out, unsigned int len,
+                      const unsigned char *tweak, unsigned int tweak_len);
+
+/* ========================================================================= */
+/*                           Batch Interface                                 */
+/* ========================================================================= */
+
+/**
+ * @brief Encrypt many equal-length numeral strings under one context
+ *
+ * Record r occupies in[r * len .. r * len + len - 1] and is written to the
+ * same position in out (out may equal in). Its tweak starts at
+ * tweaks + r * tweak_stride; pass tweak_stride 0 to share one tweak.
+ *
+ * Short FF1 records (e.g. up to 76 decimal digits; 114 with AVX2 builds)
+ * are processed several at a time with lane-parallel radix conversion and
+ * batched cipher calls. Longer FF1 records, trailing groups of fewer than
+ * 4 FF1 records, and FF3-1 records go through a pipelined kernel that
+ * keeps 8 records in flight; FF3 records run through FPE_encrypt one at a
+ * time. Output matches FPE_encrypt per record, except that an FF3-1 batch
+ * rejects a numeral >= radix, which FPE_encrypt accepts.
+ *
+ * @param ctx Initialized FPE context.
+ * @param in Input records, count * len numerals.
+ * @param out Output buffer, count * len numerals.
+ * @param len Numerals per record.
+ * @param count Number of records.
+ * @param tweaks Tweak bytes (NULL if tweak_len is 0).
+ * @param tweak_len Length of each tweak.
+ * @param tweak_stride Bytes between consecutive tweaks (0 = shared tweak).
+ * @return 0 on success, -1 on failure (output is unspecified on failure).
+ */
+int FPE_encrypt_batch(FPE_CTX *ctx,
+                      const unsigned int *in, unsigned int *out,
+                      unsigned int len, size_t count,
+                      const unsigned char *tweaks, unsigned int tweak_len,
+                      size_t tweak_stride);
+
+/**
+ * @brief Decrypt many equal-length numeral strings under one context
+ */
+int FPE_decrypt_batch(FPE_CTX *ctx,
+                      const unsigned int *in, unsigned int *out,
+                      unsigned int len, size_t count,
+                      const unsigned char *tweaks, unsigned int tweak_len,
+                      size_t tweak_stride);
+
+/* ========================================================================= */
+/*                           Scatter/Gather Interface                        */
+/* ========================================================================= */
+
+/**
+ * @brief One field to encrypt in place (no NUL terminator needed)
+ */
+typedef struct {
+    char *base;                  /**< First character of the field */
+    unsigned int len;            /**< Characters in the field */
+    const unsigned char *tweak;  /**< Tweak for this field (NULL if tweak_len is 0) */
+    unsigned int tweak_len;      /**< Tweak length */
+} FPE_IOV;
+
+/**
+ * @brief Encrypt count fields in place, wherever they sit in memory
+ *
+ * Each field is len characters of alphabet at base, e.g. a slice of a
+ * network buffer; nothing outside the slice is read or written. Fields of
+ * equal length and tweak length are grouped and run through the batch
+ * kernel (FF1), so this is also the fast path for many short fields.
+ * Fields must not overlap.
+ *
+ * @param ctx Context whose radix equals strlen(alphabet).
+ * @param alphabet Alphabet of every field.
+ * @param iov Array of count fields.
+ * @param count Number of fields (0 is a no-op).
+ * @return 0 on success, -1 on failure. Every field is validated first
+ *         (pointers, characters, tweak length and the mode's length
+ *         limits), so on an invalid field nothing has been modified.
+ */
+int FPE_encrypt_iov(FPE_CTX *ctx, const char *alphabet, const FPE_IOV *iov, size_t count);
+
+/**
+ * @brief Decrypt count fields in place
+ */
+int FPE_decrypt_iov(FPE_CTX *ctx, const char *alphabet, const FPE_IOV *iov, size_t count);
+
+/* ========================================================================= */
+/*                           Card Number (PAN) Interface                     */
+/* ========================================================================= */
+
+/* Accepted PAN lengths in digits */
+#define FPE_PAN_MIN_LEN 12
+#define FPE_PAN_MAX_LEN 19
+
+/**
+ * @brief Digits a PAN function leaves in clear
+ */
+typedef enum {
+    FPE_PAN_KEEP_NONE  = 0,      /**< Encrypt everything but the fix-up digit */
+    FPE_PAN_KEEP_BIN   = 1 << 0, /**< Keep the first 6 digits (BIN/IIN) */
+    FPE_PAN_KEEP_LAST4 = 1 << 1  /**< Keep the last 4 digits */
+} FPE_PAN_FLAGS;
+
+/**
+ * @brief Tokenize a card number, keeping it Luhn-valid
+ *
+ * The digits not kept by flags are encrypted, except the last of them,
+ * which is recomputed so the result passes the Luhn check. Without
+ * FPE_PAN_KEEP_LAST4 that is the check digit itself.
+ *
+ * @param ctx Context initialized with radix 10.
+ * @param in Luhn-valid PAN of FPE_PAN_MIN_LEN..FPE_PAN_MAX_LEN digits.
+ * @param out Output buffer of strlen(in) + 1 bytes (may equal in).
+ * @param flags Bitwise OR of FPE_PAN_FLAGS.
+ * @param tweak Tweak bytes.
+ * @param tweak_len Tweak length.
+ * @return 0 on success, -1 on failure (including a failing Luhn check).
+ */
+int FPE_encrypt_pan(FPE_CTX *ctx, const char *in, char *out, unsigned int flags,
+                    const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Recover a card number tokenized with FPE_encrypt_pan
+ */
+int FPE_decrypt_pan(FPE_CTX *ctx, const char *in, char *out, unsigned int flags,
+                    const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Tokenize many equal-length card numbers
+ *
+ * Record r is the len characters at in + r * len (no terminators) and is
+ * written to the same position in out (out may equal in). Tweaks follow
+ * the FPE_encrypt_batch layout. Luhn sums are computed with SIMD and the
+ * encrypted spans go through the batch kernel.
+ *
+ * @return 0 on success, -1 on failure. Every record is checked before any
+ *         is written, so a record that is not a Luhn-valid PAN leaves out
+ *         unchanged.
+ */
+int FPE_encrypt_pan_batch(FPE_CTX *ctx, const char *in, char *out,
+                          unsigned int len, size_t count, unsigned int flags,
+                          const unsigned char *tweaks, unsigned int tweak_len,
+                          size_t tweak_stride);
+
+/**
+ * @brief Recover many card numbers tokenized with FPE_encrypt_pan_batch
+ */
+int FPE_decrypt_pan_batch(FPE_CTX *ctx, const char *in, char *out,
+                          unsigned int len, size_t count, unsigned int flags,
+                          const unsigned char *tweaks, unsigned int tweak_len,
+                          size_t tweak_stride);
+
+/* ========================================================================= */
+/*                           Format Mask Interface                           */
+/* ========================================================================= */
+
+/* Longest formatted string a mask can describe */
+#define FPE_MASK_MAX_LEN 256
+
+/**
+ * @struct fpe_mask_st
+ * @brief Opaque compiled format mask
+ */
+typedef struct fpe_mask_st FPE_MASK;
+
+/**
+ * @brief Compile a format pattern
+ *
+ * Each pattern character describes one position of the formatted string:
+ * '#' is encrypted, '=' is copied unchanged (e.g. a kept BIN or last 4),
+ * and any other character is a literal the input must match. '\' makes
+ * the next character a literal, so "\#" matches a '#'.
+ *
+ * Examples: "####-####-####-####", "(###) ###-####", "======-##-####".
+ *
+ * @param pattern Format pattern (at most FPE_MASK_MAX_LEN positions).
+ * @param alphabet Alphabet of the encrypted positions.
+ * @return Compiled mask, or NULL if the pattern or alphabet is invalid or
+ *         has fewer than 2 encrypted positions.
+ */
+FPE_MASK *FPE_MASK_new(const char *pattern, const char *alphabet);
+
+/**
+ * @brief Free a compiled mask
+ */
+void FPE_MASK_free(FPE_MASK *mask);
+
+/**
+ * @brief Length of the strings a mask matches
+ */
+unsigned int FPE_MASK_len(const FPE_MASK *mask);
+
+/**
+ * @brief Encrypt the '#' positions of a formatted string
+ *
+ * The '#' positions are encrypted together as one numeral string, so
+ * separators do not split the FPE input. No heap memory is used.
+ *
+ * @param ctx Context whose radix equals the mask's alphabet length.
+ * @param mask Compiled mask.
+ * @param in Formatted input of exactly FPE_MASK_len(mask) characters.
+ * @param out Output buffer of FPE_MASK_len(mask) + 1 bytes (may equal in).
+ * @param tweak Tweak bytes.
+ * @param tweak_len Tweak length.
+ * @return 0 on success, -1 on failure (including a literal mismatch or a
+ *         character outside the alphabet at a '#' position).
+ */
+int FPE_encrypt_mask(FPE_CTX *ctx, const FPE_MASK *mask,
+                     const char *in, char *out,
+                     const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Decrypt the '#' positions of a formatted string
+ */
+int FPE_decrypt_mask(FPE_CTX *ctx, const FPE_MASK *mask,
+                     const char *in, char *out,
+                     const unsigned char *tweak, unsigned int tweak_len);
+
+/* ========================================================================= */
+/*                          JSON Field Tokenizer                             */
+/* ========================================================================= */
+
+/* Most key paths one FPE_JSON can select */
+#define FPE_JSON_MAX_PATHS 64
+
+/* Deepest nesting of documents and key paths */
+#define FPE_JSON_MAX_DEPTH 64
+
+/* Longest key path, in characters */
+#define FPE_JSON_MAX_PATH_LEN 256
+
+/**
+ * @struct fpe_json_st
+ * @brief Opaque set of compiled JSON key paths
+ */
+typedef struct fpe_json_st FPE_JSON;
+
+/**
+ * @brief Compile the key paths whose values are tokenized
+ *
+ * A path is a dot-separated list of object keys from the document root,
+ * e.g. "pan" or "payment.card.pan". Arrays on the way are transparent, so
+ * "items.sku" selects the "sku" of every object in an "items" array. Keys
+ * are compared with their raw bytes as they appear in the document.
+ *
+ * @param paths Array of npaths key paths.
+ * @param npaths Number of paths (1 to FPE_JSON_MAX_PATHS).
+ * @param alphabet Alphabet of string values. It must not contain '"',
+ *        '\' or control characters, so encrypted values stay valid JSON.
+ * @return Compiled paths, or NULL if a path or the alphabet is invalid.
+ */
+FPE_JSON *FPE_JSON_new(const char *const *paths, size_t npaths, const char *alphabet);
+
+/**
+ * @brief Free compiled key paths
+ */
+void FPE_JSON_free(FPE_JSON *json);
+
+/**
+ * @brief Encrypt the selected values of JSON documents in place
+ *
+ * buf holds one or more complete JSON documents (e.g. newline-delimited
+ * events). Selected string values are encrypted character for character
+ * with the alphabet; selected integer values are encrypted as decimal
+ * digits (ctx radix 10) with their sign kept and a nonzero leading digit,
+ * so they stay valid JSON numbers. Selected arrays have each string or
+ * integer element encrypted; null and other values are left alone. Every
+ * value keeps its length, so nothing outside the values moves.
+ *
+ * The scanner does not allocate and does not fully validate JSON: it only
+ * checks the structure it needs to find the selected values.
+ *
+ * @param ctx Context used for every value.
+ * @param json Compiled key paths.
+ * @param buf Documents to rewrite (need not be NUL-terminated).
+ * @param len Length of buf in bytes.
+ * @param tweak Tweak bytes, shared by every value.
+ * @param tweak_len Tweak length.
+ * @return Number of values encrypted, or -1 on failure (malformed
+ *         structure, or a selected value that is too short, has
+ *         characters outside the alphabet, or is a non-integer number).
+ *         Every value is checked before any is rewritten, so after a
+ *         failure buf is unchanged.
+ */
+int FPE_encrypt_json(FPE_CTX *ctx, const FPE_JSON *json, char *buf, size_t len,
+                     const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Decrypt the selected values of JSON documents in place
+ */
+int FPE_decrypt_json(FPE_CTX *ctx, const FPE_JSON *json, char *buf, size_t len,
+                     const unsigned char *tweak, unsigned int tweak_len);
+
+/* ========================================================================= */
+/*                           Streaming Interface                             */
+/* ========================================================================= */
+
+/* Chunk size used when FPE_STREAM_new is given 0 */
+#define FPE_STREAM_DEFAULT_CHUNK (64 * 1024)
+
+/**
+ * @brief FPE_STREAM_new flags
+ */
+typedef enum {
+    FPE_STREAM_ENCRYPT = 0,  /**< Encrypt records (default) */
+    FPE_STREAM_DECRYPT = 1,  /**< Decrypt records */
+    FPE_STREAM_ASYNC = 2     /**< Process chunks on a background thread */
+} FPE_STREAM_FLAGS;
+
+/**
+ * @struct fpe_stream_st
+ * @brief Opaque record stream
+ */
+typedef struct fpe_stream_st FPE_STREAM;
+
+/**
+ * @brief Create a stream of newline-separated records
+ *
+ * Each record is one line; it is encrypted as FPE_encrypt_str would
+ * encrypt it, and a trailing '\r' and empty lines pass through unchanged.
+ * Input is buffered in two chunks of chunk_size bytes, which bounds memory
+ * and the longest record (chunk_size - 1 bytes). A full chunk is encrypted
+ * as soon as the other chunk has been read out; with FPE_STREAM_ASYNC that
+ * happens on a background thread while the caller keeps writing into the
+ * other chunk.
+ *
+ * The stream uses ctx until FPE_STREAM_free; the caller must not use the
+ * context meanwhile.
+ *
+ * @param ctx Context whose radix equals the alphabet length.
+ * @param alphabet Alphabet of the records.
+ * @param tweak Tweak bytes, shared by every record (copied).
+ * @param tweak_len Tweak length.
+ * @param chunk_size Bytes per chunk (0 = FPE_STREAM_DEFAULT_CHUNK).
+ * @param flags FPE_STREAM_FLAGS.
+ * @return New stream, or NULL on invalid arguments or allocation failure.
+ */
+FPE_STREAM *FPE_STREAM_new(FPE_CTX *ctx, const char *alphabet,
+                           const unsigned char *tweak, unsigned int tweak_len,
+                           size_t chunk_size, unsigned int flags);
+
+/**
+ * @brief Feed input bytes
+ *
+ * Records may be split anywhere across calls. When both chunks are in use
+ * fewer than len bytes are taken; read output, then write the rest.
+ *
+ * @param consumed Set to the number of bytes taken from in.
+ * @return 0 on success, -1 on failure (invalid record, record longer than
+ *         a chunk, or writing after FPE_STREAM_finish).
+ */
+int FPE_STREAM_write(FPE_STREAM *stream, const char *in, size_t len, size_t *consumed);
+
+/**
+ * @brief Mark the end of input; a final record without a newline is kept
+ */
+int FPE_STREAM_finish(FPE_STREAM *stream);
+
+/**
+ * @brief Take processed output, in input order
+ *
+ * Waits for a chunk that is still being processed in the background.
+ * Output appears one chunk at a time, so *produced can be 0 before the
+ * stream is finished; once finished, 0 means all output has been read.
+ *
+ * @param produced Set to the number of bytes written to out.
+ * @return 0 on success, -1 on failure.
+ */
+int FPE_STREAM_read(FPE_STREAM *stream, char *out, size_t cap, size_t *produced);
+
+/**
+ * @brief Stop the background thread, wipe the buffers, and free the stream
+ */
+void FPE_STREAM_free(FPE_STREAM *stream);
+
+/* ========================================================================= */
+/*                           Arrow Column Interface                          */
+/* ========================================================================= */
+
+/*
+ * Apache Arrow C Data Interface structures, as published in the Arrow
+ * specification. The guard lets them coexist with Arrow's own headers.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/**
+ * @brief Encrypt a string column ("u" utf8 or "U" large utf8)
+ *
+ * Reads the validity bitmap, offsets and data buffers of in directly and
+ * exports a new array of the same type into out. The validity bitmap and
+ * offsets are copied (rebased to offset 0, so they equal the input's when
+ * in->offset is 0); every non-null cell is encrypted as FPE_encrypt_str
+ * would encrypt it, with all cells of the column batched through
+ * FPE_encrypt_iov. Null cells keep their length and are zeroed; empty
+ * cells stay empty. The result owns its buffers and must be released with
+ * out->release.
+ *
+ * @param ctx Context whose radix equals strlen(alphabet).
+ * @param alphabet Alphabet of every non-null cell.
+ * @param schema Schema of in (format "u" or "U").
+ * @param in Input column; not modified.
+ * @param out Receives the encrypted column.
+ * @param tweak Tweak bytes, shared by every cell.
+ * @param tweak_len Tweak length.
+ * @return 0 on success, -1 on failure (out->release is then NULL).
+ */
+int FPE_encrypt_arrow_utf8(FPE_CTX *ctx, const char *alphabet,
+                           const struct ArrowSchema *schema, const struct ArrowArray *in,
+                           struct ArrowArray *out,
+                           const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Decrypt a string column produced by FPE_encrypt_arrow_utf8
+ */
+int FPE_decrypt_arrow_utf8(FPE_CTX *ctx, const char *alphabet,
+                           const struct ArrowSchema *schema, const struct ArrowArray *in,
+                           struct ArrowArray *out,
+                           const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Encrypt an int64 column ("l")
+ *
+ * Each non-null value is encrypted on its decimal digits: the sign and the
+ * number of digits are kept, and the result is cycle-walked until it has
+ * no leading zero and fits in int64. Values between -9 and 9 have too few
+ * digits and fail the call. Requires a radix-10 context. Null slots are
+ * written as 0.
+ *
+ * @param schema Schema of in (format "l").
+ * @return 0 on success, -1 on failure (out->release is then NULL).
+ */
+int FPE_encrypt_arrow_int64(FPE_CTX *ctx, const struct ArrowSchema *schema,
+                            const struct ArrowArray *in, struct ArrowArray *out,
+                            const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Decrypt an int64 column produced by FPE_encrypt_arrow_int64
+ */
+int FPE_decrypt_arrow_int64(FPE_CTX *ctx, const struct ArrowSchema *schema,
+                            const struct ArrowArray *in, struct ArrowArray *out,
+                            const unsigned char *tweak, unsigned int tweak_len);
+
+/* ========================================================================= */
+/*                           Operation Statistics                            */
+/* ========================================================================= */
+
+/**
+ * @brief Operation counters of a context (or of the whole process)
+ *
+ * Counting is compiled in only when the library is built with ENABLE_STATS;
+ * otherwise the getters below return -1 and cost nothing on the hot paths.
+ * The cycle fields additionally need ENABLE_STATS_CYCLES and are in TSC
+ * ticks on x86 (nanoseconds elsewhere); they stay zero otherwise.
+ */
+typedef struct {
+    uint64_t encrypt_calls;   /**< Records encrypted (batch records count one each) */
+    uint64_t decrypt_calls;   /**< Records decrypted */
+    uint64_t cipher_blocks;   /**< 16-byte AES/SM4 block invocations */
+    uint64_t digits;          /**< Numerals processed by encrypt/decrypt */
+    uint64_t bytes;           /**< Bytes and string characters converted */
+    uint64_t rejected;        /**< Calls that failed (bad length, tweak, digit, character) */
+    uint64_t cache_hits;      /**< Alphabet and radix-power table reuses */
+    uint64_t cache_misses;    /**< Alphabet compiles and radix-power table builds */
+    uint64_t prf_cycles;      /**< Round function: block cipher calls and their input */
+    uint64_t convert_cycles;  /**< NUM/STR conversions and alphabet mapping */
+    uint64_t arith_cycles;    /**< Modular reduction and add/subtract */
+} FPE_STATS;
+
+/**
+ * @brief Read the counters of a context
+ *
+ * @return 0 on success, -1 if ctx or stats is NULL or stats are compiled out
+ */
+int FPE_CTX_get_stats(const FPE_CTX *ctx, FPE_STATS *stats);
+
+/**
+ * @brief Fold the counters of a context into the global aggregate and zero them
+ */
+void FPE_CTX_reset_stats(FPE_CTX *ctx);
+
+/**
+ * @brief Read the process-wide aggregate
+ *
+ * Contexts add their counters to the aggregate when they are freed or
+ * reset, so live contexts are not included until then. Thread-safe.
+ *
+ * @return 0 on success, -1 if stats is NULL or stats are compiled out
+ */
+int FPE_get_global_stats(FPE_STATS *stats);
+
+/**
+ * @brief Zero the process-wide aggregate
+ */
+void FPE_reset_global_stats(void);
+
+/* ========================================================================= */
+/*                           Latency Histograms                              */
+/* ========================================================================= */
+
+/**
+ * @brief Log-linear latency histogram (opaque)
+ *
+ * Buckets are exact below 32 timer ticks and then 32 per power of two, so
+ * any quantile is within ~3% of the true value. Recording is lock-free:
+ * every context of a pool may share one histogram across threads.
+ */
+typedef struct fpe_latency_st FPE_LATENCY;
+
+/**
+ * @brief Create an empty histogram
+ */
+FPE_LATENCY *FPE_LATENCY_new(void);
+
+/**
+ * @brief Free a histogram; detach it from every context first
+ */
+void FPE_LATENCY_free(FPE_LATENCY *h);
+
+/**
+ * @brief Record the latency of every FPE_encrypt/FPE_decrypt call on ctx into h
+ *
+ * One sample is taken per record that runs through FPE_encrypt/FPE_decrypt
+ * or FPE_PLAN_encrypt/FPE_PLAN_decrypt: the string, oneshot and mask calls,
+ * FF3 batches, FF3/FF3-1 radix-256 byte calls, and the iov fields (and
+ * JSON, stream and Arrow values) handled one at a time. Not timed: FF1
+ * and FF3-1 batches and the PAN calls built on them, FF1 iov lane groups
+ * and the FF1 byte kernel. Pass NULL to detach. The histogram is not owned
+ * by the context.
+ *
+ * @return 0 on success, -1 if ctx is NULL
+ */
+int FPE_CTX_set_latency(FPE_CTX *ctx, FPE_LATENCY *h);
+
+/**
+ * @brief Copy h into snap, optionally resetting h in the same pass
+ *
+ * With reset set, every call recorded concurrently lands either in this
+ * snapshot or in h afterwards; none is lost or counted twice.
+ *
+ * @return 0 on success, -1 on NULL arguments or snap == h
+ */
+int FPE_LATENCY_snapshot(FPE_LATENCY *h, FPE_LATENCY *snap, int reset);
+
+/**
+ * @brief Add the counts of src to dst (e.g. per-thread histograms into one)
+ *
+ * @return 0 on success, -1 on NULL arguments or dst == src
+ */
+int FPE_LATENCY_merge(FPE_LATENCY *dst, const FPE_LATENCY *src);
+
+/**
+ * @brief Zero a histogram
+ */
+void FPE_LATENCY_reset(FPE_LATENCY *h);
+
+/**
+ * @brief Number of calls recorded
+ */
+uint64_t FPE_LATENCY_count(const FPE_LATENCY *h);
+
+/**
+ * @brief Latency at quantile q (0..1) in nanoseconds
+ *
+ * Read from a snapshot rather than a histogram that is being recorded
+ * into. q = 1 gives the maximum bucket.
+ *
+ * @return Bucket midpoint in nanoseconds, or -1.0 if h is NULL or empty
+ */
+double FPE_LATENCY_quantile(const FPE_LATENCY *h, double q);
+
+/* ========================================================================= */
+/*                              Prepared Plans                               */
+/* ========================================================================= */
+
+/**
+ * @brief Validated operation shape bound to a context (opaque)
+ *
+ * A plan fixes the record length, tweak length and optionally an alphabet
+ * for one context. Everything FPE_encrypt derives from those on each call
+ * (tweak validation, mode dispatch, the Feistel split, byte counts, the
+ * FF1 header block and moduli) is computed once by FPE_PLAN_new. It is
+ * the prepared-statement counterpart of FPE_encrypt for fixed-schema data.
+ *
+ * A plan borrows its context: it must not outlive it, and it becomes
+ * invalid if the context is re-initialized. Like the context, it must not
+ * be used by two threads at once.
+ */
+typedef struct fpe_plan_st FPE_PLAN;
+
+/**
+ * @brief Prepare a plan for records of len numerals with tweak_len-byte tweaks
+ *
+ * @param ctx Initialized context
+ * @param len Record length in numerals (characters for the string calls)
+ * @param tweak_len Tweak length every call will pass
+ * @param alphabet Alphabet for FPE_PLAN_encrypt_str/decrypt_str, whose size
+ *                 must equal the context radix, or NULL for numerals only
+ * @return The plan, or NULL if the shape is invalid for the context's mode
+ */
+FPE_PLAN *FPE_PLAN_new(FPE_CTX *ctx, unsigned int len, unsigned int tweak_len,
+                       const char *alphabet);
+
+/**
+ * @brief Free a plan (the context is not affected)
+ */
+void FPE_PLAN_free(FPE_PLAN *plan);
+
+/**
+ * @brief Encrypt one record of the plan's length
+ *
+ * Only the data is checked per call: numerals must be below the radix
+ * (FF1). The tweak must be plan-tweak_len bytes (may be NULL if that is 0).
+ *
+ * @return 0 on success, -1 on error
+ */
+int FPE_PLAN_encrypt(FPE_PLAN *plan, const unsigned int *in, unsigned int *out,
+                     const unsigned char *tweak);
+
+/**
+ * @brief Decrypt one record of the plan's length
+ */
+int FPE_PLAN_decrypt(FPE_PLAN *plan, const unsigned int *in, unsigned int *out,
+                     const unsigned char *tweak);
+
+/**
+ * @brief Encrypt a string of exactly the plan's length over its alphabet
+ *
+ * out must hold len + 1 bytes.
+ *
+ * @return 0 on success, -1 on error (no alphabet, wrong length, or a
+ *         character outside the alphabet)
+ */
+int FPE_PLAN_encrypt_str(FPE_PLAN *plan, const char *in, char *out,
+                         const unsigned char *tweak);
+
+/**
+ * @brief Decrypt a string of exactly the plan's length over its alphabet
+ */
+int FPE_PLAN_decrypt_str(FPE_PLAN *plan, const char *in, char *out,
+                         const unsigned char *tweak);
+
 /* ========================================================================= */
 /*                           Convenience / Stateless Interface               */
 /* ========================================================================= */
@@ -0,0 +1,361 @@
+/**
+ * @file fpe_sqlite.c
+ * @brief SQLite loadable extension exposing FPE as SQL functions
+ *
+ * SQL functions:
+ *   fpe_set_key(KEYID, KEY [, ALGO])
+ *       Register a key (BLOB of 16, 24 or 32 bytes; ALGO 'AES' or 'SM4')
+ *       for this connection. Registering an existing KEYID replaces it.
+ *   fpe_encrypt(MODE, KEYID, ALPHABET, VALUE [, TWEAK])
+ *   fpe_decrypt(MODE, KEYID, ALPHABET, VALUE [, TWEAK])
+ *       MODE is 'FF1', 'FF3' or 'FF3-1'; TWEAK is a BLOB (or text bytes).
+ *       A NULL VALUE gives NULL; results match FPE_encrypt_str.
+ *
+ * Each connection keeps its keys and a cache of initialized contexts,
+ * one per (key, mode, alphabet), so an alphabet is compiled once per
+ * context. The resolved cache entry is also attached to the MODE, KEYID
+ * and ALPHABET arguments as SQLite auxiliary data: while those arguments
+ * are constant in a statement, each row goes straight to the encryption
+ * call without parsing or lookups.
+ *
+ * Load with:
+ *   .load ./libfpe_sqlite          (entry point sqlite3_fpesqlite_init)
+ */
+
+#include <sqlite3ext.h>
+SQLITE_EXTENSION_INIT1
+
+#include <string.h>
+#include "fpe.h"
+
+/* Values up to this length are encrypted through a stack buffer */
+#define FPE_SQLITE_STACK_LEN 256
+
+typedef struct fpe_sqlite_key {
+    char *id;
+    FPE_ALGO algo;
+    unsigned char key[32];
+    unsigned int bits;
+    unsigned int generation;      /* Bumped when the key is replaced */
+    struct fpe_sqlite_key *next;
+} fpe_sqlite_key;
+
+typedef struct fpe_sqlite_entry {
+    fpe_sqlite_key *key;
+    FPE_MODE mode;
+    char *alphabet;
+    FPE_CTX *ctx;
+    unsigned int generation;      /* Key generation ctx was initialized with */
+    struct fpe_sqlite_entry *next;
+} fpe_sqlite_entry;
+
+typedef struct {
+    fpe_sqlite_key *keys;
+    fpe_sqlite_entry *entries;
+    int refs;                     /* Registered functions sharing this state */
+} fpe_sqlite_conn;
+
+/* ============================================================================
+ * Connection State
+ * ============================================================================
+ */
+
+static void fpe_sqlite_wipe(void *p, size_t n) {
+    volatile unsigned char *v = (volatile unsigned char *)p;
+    while (n--) *v++ = 0;
+}
+
+static void fpe_sqlite_conn_release(void *arg) {
+    fpe_sqlite_conn *conn = (fpe_sqlite_conn *)arg;
+    if (--conn->refs > 0) return;
+
+    while (conn->entries) {
+        fpe_sqlite_entry *e = conn->entries;
+        conn->entries = e->next;
+        FPE_CTX_free(e->ctx);
+        sqlite3_free(e->alphabet);
+        sqlite3_free(e);
+    }
+    while (conn->keys) {
+        fpe_sqlite_key *k = conn->keys;
+        conn->keys = k->next;
+        fpe_sqlite_wipe(k->key, sizeof(k->key));
+        sqlite3_free(k->id);
+        sqlite3_free(k);
+    }
+    sqlite3_free(conn);
+}
+
+static fpe_sqlite_key *fpe_sqlite_find_key(fpe_sqlite_conn *conn, const char *id) {
+    for (fpe_sqlite_key *k = conn->keys; k; k = k->next) {
+        if (strcmp(k->id, id) == 0) return k;
+    }
+    return NULL;
+}
+
+static int fpe_sqlite_parse_mode(const char *text, FPE_MODE *mode) {
+    if (!text) return -1;
+    if (sqlite3_stricmp(text, "FF1") == 0) *mode = FPE_MODE_FF1;
+    else if (sqlite3_stricmp(text, "FF3") == 0) *mode = FPE_MODE_FF3;
+    else if (sqlite3_stricmp(text, "FF3-1") == 0 || sqlite3_stricmp(text, "FF3_1") == 0)
+        *mode = FPE_MODE_FF3_1;
+    else return -1;
+    return 0;
+}
+
+/**
+ * @brief (Re)initialize an entry's context with the current key
+ */
+static int fpe_sqlite_entry_init(fpe_sqlite_entry *e) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    if (!ctx) return -1;
+    if (FPE_CTX_init(ctx, e->mode, e->key->algo, e->key->key, e->key->bits,
+                     (unsigned int)strlen(e->alphabet)) != 0) {
+        FPE_CTX_free(ctx);
+        return -1;
+    }
+    FPE_CTX_free(e->ctx);
+    e->ctx = ctx;
+    e->generation = e->key->generation;
+    return 0;
+}
+
+/**
+ * @brief Find or create the cache entry for the MODE, KEYID, ALPHABET arguments
+ *
+ * Reports errors through the SQLite context and returns NULL.
+ */
+static fpe_sqlite_entry *fpe_sqlite_resolve(sqlite3_context *context, sqlite3_value **argv) {
+    fpe_sqlite_entry *e = (fpe_sqlite_entry *)sqlite3_get_auxdata(context, 0);
+    if (e && sqlite3_get_auxdata(context, 1) == e && sqlite3_get_auxdata(context, 2) == e) {
+        if (e->generation == e->key->generation) return e;
+        if (fpe_sqlite_entry_init(e) == 0) return e;
+        sqlite3_result_error(context, "fpe: cannot initialize context", -1);
+        return NULL;
+    }
+
+    fpe_sqlite_conn *conn = (fpe_sqlite_conn *)sqlite3_user_data(context);
+    FPE_MODE mode;
+    const char *id = (const char *)sqlite3_value_text(argv[1]);
+    const char *alphabet = (const char *)sqlite3_value_text(argv[2]);
+
+    if (fpe_sqlite_parse_mode((const char *)sqlite3_value_text(argv[0]), &mode) != 0) {
+        sqlite3_result_error(context, "fpe: mode must be 'FF1', 'FF3' or 'FF3-1'", -1);
+        return NULL;
+    }
+    fpe_sqlite_key *key = id ? fpe_sqlite_find_key(conn, id) : NULL;
+    if (!key) {
+        sqlite3_result_error(context, "fpe: unknown key id", -1);
+        return NULL;
+    }
+    if (!alphabet || strlen(alphabet) < 2 || strlen(alphabet) > 256) {
+        sqlite3_result_error(context, "fpe: invalid alphabet", -1);
+        return NULL;
+    }
+
+    for (e = conn->entries; e; e = e->next) {
+        if (e->key == key && e->mode == mode && strcmp(e->alphabet, alphabet) == 0) break;
+    }
+
+    if (!e) {
+        e = (fpe_sqlite_entry *)sqlite3_malloc(sizeof(fpe_sqlite_entry));
+        if (!e) {
+            sqlite3_result_error_nomem(context);
+            return NULL;
+        }
+        memset(e, 0, sizeof(*e));
+        e->key = key;
+        e->mode = mode;
+        e->alphabet = sqlite3_mprintf("%s", alphabet);
+        if (!e->alphabet || fpe_sqlite_entry_init(e) != 0) {
+            sqlite3_free(e->alphabet);
+            sqlite3_free(e);
+            sqlite3_result_error(context, "fpe: invalid alphabet or key for mode", -1);
+            return NULL;
+        }
+        e->next = conn->entries;
+        conn->entries = e;
+    } else if (e->generation != key->generation && fpe_sqlite_entry_init(e) != 0) {
+        sqlite3_result_error(context, "fpe: cannot initialize context", -1);
+        return NULL;
+    }
+
+    /* Entries live as long as the connection, so no destructor is needed */
+    sqlite3_set_auxdata(context, 0, e, NULL);
+    sqlite3_set_auxdata(context, 1, e, NULL);
+    sqlite3_set_auxdata(context, 2, e, NULL);
+    return e;
+}
+
+/* ============================================================================
+ * SQL Functions
+ * ============================================================================
+ */
+
+static void fpe_sqlite_crypt(sqlite3_context *context, int argc, sqlite3_value **argv,
+                             int encrypt) {
+    if (sqlite3_value_type(argv[3]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    fpe_sqlite_entry *e = fpe_sqlite_resolve(context, argv);
+    if (!e) return;
+
+    const char *value = (const char *)sqlite3_value_text(argv[3]);
+    int len = sqlite3_value_bytes(argv[3]);
+    if (!value) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    if ((size_t)len != strlen(value)) {
+        sqlite3_result_error(context, "fpe: value contains NUL", -1);
+        return;
+    }
+
+    const unsigned char *tweak = NULL;
+    unsigned int tweak_len = 0;
+    if (argc > 4 && sqlite3_value_type(argv[4]) != SQLITE_NULL) {
+        tweak = (const unsigned char *)sqlite3_value_blob(argv[4]);
+        tweak_len = (unsigned int)sqlite3_value_bytes(argv[4]);
+    }
+
+    char stack[FPE_SQLITE_STACK_LEN + 1];
+    char *out = stack;
+    if (len > FPE_SQLITE_STACK_LEN) {
+        out = (char *)sqlite3_malloc(len + 1);
+        if (!out) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+    }
+
+    int ret = encrypt
+        ? FPE_encrypt_str(e->ctx, e->alphabet, value, out, tweak, tweak_len)
+        : FPE_decrypt_str(e->ctx, e->alphabet, value, out, tweak, tweak_len);
+
+    if (ret != 0) {
+        sqlite3_result_error(context, encrypt
+            ? "fpe_encrypt: value outside the alphabet, too short, or bad tweak length"
+            : "fpe_decrypt: value outside the alphabet, too short, or bad tweak length", -1);
+    } else {
+        sqlite3_result_text(context, out, len, SQLITE_TRANSIENT);
+    }
+
+    fpe_sqlite_wipe(out, (size_t)len + 1);
+    if (out != stack) sqlite3_free(out);
+}
+
+static void fpe_sqlite_encrypt(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    fpe_sqlite_crypt(context, argc, argv, 1);
+}
+
+static void fpe_sqlite_decrypt(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    fpe_sqlite_crypt(context, argc, argv, 0);
+}
+
+static void fpe_sqlite_set_key(sqlite3_context *context, int argc, sqlite3_value **argv) {
+    fpe_sqlite_conn *conn = (fpe_sqlite_conn *)sqlite3_user_data(context);
+    const char *id = (const char *)sqlite3_value_text(argv[0]);
+    const unsigned char *bytes = (const unsigned char *)sqlite3_value_blob(argv[1]);
+    int n = sqlite3_value_bytes(argv[1]);
+    FPE_ALGO algo = FPE_ALGO_AES;
+
+    if (argc > 2) {
+        const char *name = (const char *)sqlite3_value_text(argv[2]);
+        if (name && sqlite3_stricmp(name, "AES") == 0) algo = FPE_ALGO_AES;
+        else if (name && sqlite3_stricmp(name, "SM4") == 0) algo = FPE_ALGO_SM4;
+        else {
+            sqlite3_result_error(context, "fpe_set_key: algorithm must be 'AES' or 'SM4'", -1);
+            return;
+        }
+    }
+    if (!id || sqlite3_value_type(argv[1]) != SQLITE_BLOB || !bytes ||
+        (n != 16 && n != 24 && n != 32)) {
+        sqlite3_result_error(context, "fpe_set_key: key must be a 16, 24 or 32 byte BLOB", -1);
+        return;
+    }
+
+    /* Reject keys the cipher would refuse before storing anything */
+    FPE_CTX *probe = FPE_CTX_new();
+    int ok = probe && FPE_CTX_init(probe, FPE_MODE_FF1, algo, bytes, (unsigned int)n * 8, 10) == 0;
+    FPE_CTX_free(probe);
+    if (!ok) {
+        sqlite3_result_error(context, "fpe_set_key: key size not supported by algorithm", -1);
+        return;
+    }
+
+    fpe_sqlite_key *k = fpe_sqlite_find_key(conn, id);
+    if (!k) {
+        k = (fpe_sqlite_key *)sqlite3_malloc(sizeof(fpe_sqlite_key));
+        if (!k) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+        memset(k, 0, sizeof(*k));
+        k->id = sqlite3_mprintf("%s", id);
+        if (!k->id) {
+            sqlite3_free(k);
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+        k->next = conn->keys;
+        conn->keys = k;
+    }
+
+    /* Cached contexts notice the new generation and re-initialize */
+    fpe_sqlite_wipe(k->key, sizeof(k->key));
+    memcpy(k->key, bytes, (size_t)n);
+    k->bits = (unsigned int)n * 8;
+    k->algo = algo;
+    k->generation++;
+
+    sqlite3_result_int(context, 1);
+}
+
+/* ============================================================================
+ * Registration
+ * ============================================================================
+ */
+
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+int sqlite3_fpesqlite_init(sqlite3 *db, char **pzErrMsg, const sqlite3_api_routines *pApi) {
+    SQLITE_EXTENSION_INIT2(pApi);
+    (void)pzErrMsg;
+
+    static const struct {
+        const char *name;
+        int nargs;
+        void (*fn)(sqlite3_context *, int, sqlite3_value **);
+    } funcs[] = {
+        {"fpe_set_key", 2, fpe_sqlite_set_key},
+        {"fpe_set_key", 3, fpe_sqlite_set_key},
+        {"fpe_encrypt", 4, fpe_sqlite_encrypt},
+        {"fpe_encrypt", 5, fpe_sqlite_encrypt},
+        {"fpe_decrypt", 4, fpe_sqlite_decrypt},
+        {"fpe_decrypt", 5, fpe_sqlite_decrypt},
+    };
+
+    fpe_sqlite_conn *conn = (fpe_sqlite_conn *)sqlite3_malloc(sizeof(fpe_sqlite_conn));
+    if (!conn) return SQLITE_NOMEM;
+    memset(conn, 0, sizeof(*conn));
+
+    /* One reference for this function, released at the end */
+    conn->refs = 1;
+    int rc = SQLITE_OK;
+    for (size_t i = 0; rc == SQLITE_OK && i < sizeof(funcs) / sizeof(funcs[0]); i++) {
+        int flags = SQLITE_UTF8;
+#ifdef SQLITE_DIRECTONLY
+        /* Keys are set from top-level SQL only, never from triggers or views */
+        if (funcs[i].fn == fpe_sqlite_set_key) flags |= SQLITE_DIRECTONLY;
+#endif
+        /* The destructor runs even when registration fails */
+        conn->refs++;
+        rc = sqlite3_create_function_v2(db, funcs[i].name, funcs[i].nargs, flags, conn,
+                                        funcs[i].fn, NULL, NULL, fpe_sqlite_conn_release);
+    }
+    fpe_sqlite_conn_release(conn);
+    return rc;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file bench_internals.h
+ * @brief Entry points into static hot functions, for microbenchmarks
+ *
+ * Only compiled when FPE_BENCH_INTERNALS is defined, which the bench build
+ * does for its private static copy of the library (fpe_internal). The
+ * shipped library does not contain these symbols.
+ */
+
+#ifndef FPE_BENCH_INTERNALS_H
+#define FPE_BENCH_INTERNALS_H
+
+#include "fpe_internal.h"
+
+#ifdef FPE_BENCH_INTERNALS
+
+/* FF1 round function: S = PRF(P || Q) extended to S_len bytes */
+int fpe_bench_ff1_prf(FPE_CTX *ctx, const unsigned char *P, unsigned int P_len,
+                      const unsigned char *Q, unsigned int Q_len,
+                      unsigned char *S, unsigned int S_len);
+
+/* FF3 numeral string <-> big-endian bytes, most / least significant digit first */
+void fpe_bench_num_to_bytes(const unsigned int *x, unsigned int len, unsigned int radix,
+                            unsigned char *out, unsigned int out_len);
+void fpe_bench_bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
+                            unsigned int *x, unsigned int len, unsigned int radix);
+void fpe_bench_num_to_bytes_rev(const unsigned int *x, unsigned int len, unsigned int radix,
+                                unsigned char *out, unsigned int out_len);
+void fpe_bench_bytes_to_num_rev(const unsigned char *bytes, unsigned int byte_len,
+                                unsigned int *x, unsigned int len, unsigned int radix);
+
+/* FF3 / FF3-1 round functions: W = CIPH(T ^ [round] || NUM_rev(B)) */
+int fpe_bench_ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
+                                const unsigned int *B, unsigned int B_len,
+                                unsigned int radix, unsigned char *W, unsigned int W_len);
+int fpe_bench_ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
+                                  const unsigned int *B, unsigned int B_len,
+                                  unsigned int radix, unsigned char *W, unsigned int W_len);
+
+/* FF3 Feistel add / subtract: a = (a +/- y) mod radix^m */
+void fpe_bench_num_add_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                           unsigned int radix);
+void fpe_bench_num_sub_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                           unsigned int radix);
+
+#endif /* FPE_BENCH_INTERNALS */
+
+#endif /* FPE_BENCH_INTERNALS_H */
@@ -0,0 +1,808 @@
+/**
+ * @file bignum.c
+ * @brief Internal multi-precision arithmetic for long numeral strings
+ *
+ * Only what FF1 needs for long inputs: schoolbook/Karatsuba multiplication,
+ * Knuth long division, Barrett division by precomputed powers of the radix
+ * and divide-and-conquer NUM/STR conversion on top of them.
+ */
+
+#include "bignum.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define LIMB_BITS 32
+#define LIMB_BASE ((uint64_t)1 << LIMB_BITS)
+
+struct fpe_bn_level {
+    fpe_limb *pow;      /**< radix^digits */
+    size_t n;           /**< Limbs of pow (top limb non-zero) */
+    fpe_limb *mu;       /**< floor(B^(2n) / pow) for Barrett division */
+    size_t nmu;         /**< Limbs of mu */
+    size_t digits;      /**< Exponent: base_digits * 2^level */
+};
+
+struct fpe_bn_powers {
+    unsigned int radix;
+    unsigned int chunk_digits;  /**< Largest c with radix^c < 2^32 */
+    fpe_limb chunk_base;        /**< radix^chunk_digits */
+    size_t base_digits;         /**< Leaf size of the divide and conquer */
+    unsigned int levels;
+    struct fpe_bn_level lvl[FPE_BN_MAX_LEVELS];
+};
+
+/* ========================================================================= */
+/*                               Arena / Sizing                              */
+/* ========================================================================= */
+
+void fpe_bn_arena_init(fpe_bn_arena *ar, void *mem, size_t bytes) {
+    ar->base = (fpe_limb *)mem;
+    ar->size = bytes / sizeof(fpe_limb);
+    ar->used = 0;
+    ar->peak = 0;
+}
+
+fpe_limb *fpe_bn_alloc(fpe_bn_arena *ar, size_t n) {
+    if (n > ar->size - ar->used) return NULL;
+    fpe_limb *p = ar->base + ar->used;
+    ar->used += n;
+    if (ar->used > ar->peak) ar->peak = ar->used;
+    return p;
+}
+
+size_t fpe_bn_limbs_for_digits(unsigned int radix, size_t ndigits) {
+    double bits = (double)ndigits * log2((double)radix);
+    return (size_t)(bits / LIMB_BITS) + 2;
+}
+
+size_t fpe_bn_workspace_limbs(unsigned int radix, size_t ndigits) {
+    /* Conversions peak at about 5N live limbs plus O(log N) per level */
+    return 12 * fpe_bn_limbs_for_digits(radix, ndigits) + 64 * FPE_BN_MAX_LEVELS;
+}
+
+/* ========================================================================= */
+/*                            Limb-Level Helpers                             */
+/* ========================================================================= */
+
+size_t fpe_bn_trim(const fpe_limb *x, size_t n) {
+    while (n > 0 && x[n - 1] == 0) n--;
+    return n;
+}
+
+int fpe_bn_cmp(const fpe_limb *a, size_t na, const fpe_limb *b, size_t nb) {
+    na = fpe_bn_trim(a, na);
+    nb = fpe_bn_trim(b, nb);
+    if (na != nb) return (na < nb) ? -1 : 1;
+
+    for (size_t i = na; i > 0; i--) {
+        if (a[i - 1] != b[i - 1]) return (a[i - 1] < b[i - 1]) ? -1 : 1;
+    }
+    return 0;
+}
+
+fpe_limb fpe_bn_add(fpe_limb *r, const fpe_limb *a, size_t n,
+                    const fpe_limb *b, size_t nb) {
+    uint64_t carry = 0;
+    size_t i = 0;
+
+    for (; i < nb; i++) {
+        uint64_t t = (uint64_t)a[i] + b[i] + carry;
+        r[i] = (fpe_limb)t;
+        carry = t >> LIMB_BITS;
+    }
+    for (; i < n; i++) {
+        uint64_t t = (uint64_t)a[i] + carry;
+        r[i] = (fpe_limb)t;
+        carry = t >> LIMB_BITS;
+    }
+    return (fpe_limb)carry;
+}
+
+fpe_limb fpe_bn_sub(fpe_limb *r, const fpe_limb *a, size_t n,
+                    const fpe_limb *b, size_t nb) {
+    fpe_limb borrow = 0;
+    size_t i = 0;
+
+    for (; i < nb; i++) {
+        uint64_t t = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (fpe_limb)t;
+        borrow = (fpe_limb)((t >> LIMB_BITS) & 1);
+    }
+    for (; i < n; i++) {
+        uint64_t t = (uint64_t)a[i] - borrow;
+        r[i] = (fpe_limb)t;
+        borrow = (fpe_limb)((t >> LIMB_BITS) & 1);
+    }
+    return borrow;
+}
+
+/**
+ * @brief r[n] = a[n] * m + carry, returns the carry-out limb
+ */
+static fpe_limb bn_mul_1(fpe_limb *r, const fpe_limb *a, size_t n,
+                         fpe_limb m, fpe_limb carry) {
+    uint64_t c = carry;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t t = (uint64_t)a[i] * m + c;
+        r[i] = (fpe_limb)t;
+        c = t >> LIMB_BITS;
+    }
+    return (fpe_limb)c;
+}
+
+/**
+ * @brief q[n] = a[n] / d, returns a mod d
+ */
+static fpe_limb bn_divmod_1(fpe_limb *q, const fpe_limb *a, size_t n, fpe_limb d) {
+    uint64_t rem = 0;
+    for (size_t i = n; i > 0; i--) {
+        uint64_t cur = (rem << LIMB_BITS) | a[i - 1];
+        q[i - 1] = (fpe_limb)(cur / d);
+        rem = cur % d;
+    }
+    return (fpe_limb)rem;
+}
+
+/**
+ * @brief Add a[na] into r at position 0, propagating carry up to rn limbs
+ */
+static void bn_add_into(fpe_limb *r, size_t rn, const fpe_limb *a, size_t na) {
+    if (na > rn) na = rn;
+    fpe_limb carry = fpe_bn_add(r, r, na, a, na);
+    for (size_t i = na; carry && i < rn; i++) {
+        r[i] += 1;
+        carry = (r[i] == 0);
+    }
+}
+
+/* ========================================================================= */
+/*                              Multiplication                               */
+/* ========================================================================= */
+
+static void bn_mul_basecase(fpe_limb *r, const fpe_limb *a, size_t na,
+                            const fpe_limb *b, size_t nb) {
+    memset(r, 0, (na + nb) * sizeof(fpe_limb));
+
+    for (size_t i = 0; i < nb; i++) {
+        uint64_t carry = 0;
+        uint64_t bi = b[i];
+        if (bi == 0) continue;
+        for (size_t j = 0; j < na; j++) {
+            uint64_t t = (uint64_t)a[j] * bi + r[i + j] + carry;
+            r[i + j] = (fpe_limb)t;
+            carry = t >> LIMB_BITS;
+        }
+        r[i + na] = (fpe_limb)carry;
+    }
+}
+
+/**
+ * @brief Balanced Karatsuba: r[2n] = a[n] * b[n]
+ *
+ * Scratch use is about 4n limbs across the recursion.
+ */
+static int bn_kmul(fpe_limb *r, const fpe_limb *a, const fpe_limb *b, size_t n,
+                   fpe_bn_arena *ar) {
+    if (n < FPE_BN_KARATSUBA_THRESHOLD) {
+        bn_mul_basecase(r, a, n, b, n);
+        return 0;
+    }
+
+    size_t h = n / 2;       /* Low half */
+    size_t h2 = n - h;      /* High half (h2 >= h) */
+    size_t mark = ar->used;
+
+    /* z0 = a0 * b0 -> r[0..2h), z2 = a1 * b1 -> r[2h..2n) */
+    if (bn_kmul(r, a, b, h, ar) != 0) return -1;
+    if (bn_kmul(r + 2 * h, a + h, b + h, h2, ar) != 0) return -1;
+
+    /* z1 = (a0 + a1)(b0 + b1) - z0 - z2 */
+    fpe_limb *sa = fpe_bn_alloc(ar, h2 + 1);
+    fpe_limb *sb = fpe_bn_alloc(ar, h2 + 1);
+    fpe_limb *z1 = fpe_bn_alloc(ar, 2 * (h2 + 1));
+    if (!sa || !sb || !z1) {
+        ar->used = mark;
+        return -1;
+    }
+
+    sa[h2] = fpe_bn_add(sa, a + h, h2, a, h);
+    sb[h2] = fpe_bn_add(sb, b + h, h2, b, h);
+
+    if (bn_kmul(z1, sa, sb, h2 + 1, ar) != 0) {
+        ar->used = mark;
+        return -1;
+    }
+
+    size_t nz1 = 2 * (h2 + 1);
+    fpe_bn_sub(z1, z1, nz1, r, 2 * h);
+    fpe_bn_sub(z1, z1, nz1, r + 2 * h, 2 * h2);
+
+    /* r += z1 * B^h; the true z1 fits in 2n - h limbs */
+    bn_add_into(r + h, 2 * n - h, z1, fpe_bn_trim(z1, nz1));
+
+    ar->used = mark;
+    return 0;
+}
+
+int fpe_bn_mul(fpe_limb *r, const fpe_limb *a, size_t na,
+               const fpe_limb *b, size_t nb, fpe_bn_arena *ar) {
+    size_t nr = na + nb;
+
+    /* Work on the significant parts only */
+    size_t ta = fpe_bn_trim(a, na);
+    size_t tb = fpe_bn_trim(b, nb);
+    if (ta == 0 || tb == 0) {
+        memset(r, 0, nr * sizeof(fpe_limb));
+        return 0;
+    }
+
+    if (ta < tb) {
+        const fpe_limb *tp = a; a = b; b = tp;
+        size_t tn = ta; ta = tb; tb = tn;
+    }
+
+    if (tb < FPE_BN_KARATSUBA_THRESHOLD) {
+        bn_mul_basecase(r, a, ta, b, tb);
+        memset(r + ta + tb, 0, (nr - ta - tb) * sizeof(fpe_limb));
+        return 0;
+    }
+
+    if (ta == tb) {
+        if (bn_kmul(r, a, b, ta, ar) != 0) return -1;
+        memset(r + ta + tb, 0, (nr - ta - tb) * sizeof(fpe_limb));
+        return 0;
+    }
+
+    /* Unbalanced: multiply tb-limb slices of a by b and accumulate */
+    size_t mark = ar->used;
+    fpe_limb *prod = fpe_bn_alloc(ar, 2 * tb);
+    if (!prod) return -1;
+
+    memset(r, 0, nr * sizeof(fpe_limb));
+    for (size_t off = 0; off < ta; off += tb) {
+        size_t chunk = (ta - off < tb) ? ta - off : tb;
+        if (chunk == tb) {
+            if (bn_kmul(prod, a + off, b, tb, ar) != 0) {
+                ar->used = mark;
+                return -1;
+            }
+        } else if (fpe_bn_mul(prod, a + off, chunk, b, tb, ar) != 0) {
+            ar->used = mark;
+            return -1;
+        }
+        bn_add_into(r + off, nr - off, prod, chunk + tb);
+    }
+
+    ar->used = mark;
+    return 0;
+}
+
+/* ========================================================================= */
+/*                                 Division                                  */
+/* ========================================================================= */
+
+static unsigned int bn_clz(fpe_limb x) {
+    unsigned int n = 0;
+    while (!(x & 0x80000000u)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+
+int fpe_bn_divmod(fpe_limb *q, fpe_limb *r, const fpe_limb *a, size_t na,
+                  const fpe_limb *m, size_t nm, fpe_bn_arena *ar) {
+    size_t nr = nm;
+    nm = fpe_bn_trim(m, nm);
+    if (nm == 0) return -1;
+
+    size_t qn = (na >= nm) ? na - nm + 1 : 0;
+    na = fpe_bn_trim(a, na);
+
+    if (na < nm) {
+        if (q) memset(q, 0, qn * sizeof(fpe_limb));
+        memset(r, 0, nr * sizeof(fpe_limb));
+        memcpy(r, a, na * sizeof(fpe_limb));
+        return 0;
+    }
+
+    size_t mark = ar->used;
+
+    if (nm == 1) {
+        fpe_limb *tq = q ? q : fpe_bn_alloc(ar, na);
+        if (!tq) return -1;
+        if (q) memset(q, 0, qn * sizeof(fpe_limb));
+        memset(r, 0, nr * sizeof(fpe_limb));
+        r[0] = bn_divmod_1(tq, a, na, m[0]);
+        ar->used = mark;
+        return 0;
+    }
+
+    /* Knuth algorithm D (Hacker's Delight divmnu) on normalized operands */
+    fpe_limb *vn = fpe_bn_alloc(ar, nm);
+    fpe_limb *un = fpe_bn_alloc(ar, na + 1);
+    if (!vn || !un) {
+        ar->used = mark;
+        return -1;
+    }
+
+    unsigned int s = bn_clz(m[nm - 1]);
+    for (size_t i = nm - 1; i > 0; i--) {
+        vn[i] = (m[i] << s) | (s ? (fpe_limb)((uint64_t)m[i - 1] >> (LIMB_BITS - s)) : 0);
+    }
+    vn[0] = m[0] << s;
+
+    un[na] = s ? (fpe_limb)((uint64_t)a[na - 1] >> (LIMB_BITS - s)) : 0;
+    for (size_t i = na - 1; i > 0; i--) {
+        un[i] = (a[i] << s) | (s ? (fpe_limb)((uint64_t)a[i - 1] >> (LIMB_BITS - s)) : 0);
+    }
+    un[0] = a[0] << s;
+
+    if (q) memset(q, 0, qn * sizeof(fpe_limb));
+
+    for (size_t jj = na - nm + 1; jj > 0; jj--) {
+        size_t j = jj - 1;
+
+        /* Estimate qhat from the top two limbs, then correct */
+        uint64_t num = ((uint64_t)un[j + nm] << LIMB_BITS) | un[j + nm - 1];
+        uint64_t qhat = num / vn[nm - 1];
+        uint64_t rhat = num % vn[nm - 1];
+
+        while (qhat >= LIMB_BASE ||
+               qhat * vn[nm - 2] > ((rhat << LIMB_BITS) | un[j + nm - 2])) {
+            qhat--;
+            rhat += vn[nm - 1];
+            if (rhat >= LIMB_BASE) break;
+        }
+
+        /* Multiply and subtract */
+        int64_t t;
+        uint64_t k = 0;
+        for (size_t i = 0; i < nm; i++) {
+            uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - (int64_t)k - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (fpe_limb)t;
+            k = (p >> LIMB_BITS) - (uint64_t)(t >> LIMB_BITS);
+        }
+        t = (int64_t)un[j + nm] - (int64_t)k;
+        un[j + nm] = (fpe_limb)t;
+
+        /* Add back if we subtracted too much */
+        if (t < 0) {
+            qhat--;
+            uint64_t c = 0;
+            for (size_t i = 0; i < nm; i++) {
+                uint64_t sum = (uint64_t)un[i + j] + vn[i] + c;
+                un[i + j] = (fpe_limb)sum;
+                c = sum >> LIMB_BITS;
+            }
+            un[j + nm] += (fpe_limb)c;
+        }
+
+        if (q && j < qn) q[j] = (fpe_limb)qhat;
+    }
+
+    /* Unnormalize the remainder */
+    memset(r, 0, nr * sizeof(fpe_limb));
+    for (size_t i = 0; i < nm; i++) {
+        r[i] = (un[i] >> s) | (s ? (fpe_limb)((uint64_t)un[i + 1] << (LIMB_BITS - s)) : 0);
+    }
+
+    ar->used = mark;
+    return 0;
+}
+
+int fpe_bn_pow_ui(fpe_limb *r, size_t nr, unsigned int base, size_t exp,
+                  fpe_bn_arena *ar) {
+    if (nr == 0) return -1;
+
+    size_t mark = ar->used;
+    fpe_limb *sq = fpe_bn_alloc(ar, 2 * nr);
+    if (!sq) return -1;
+
+    memset(r, 0, nr * sizeof(fpe_limb));
+    r[0] = 1;
+    size_t len = 1;
+
+    /* Left-to-right binary exponentiation */
+    int top = 0;
+    for (size_t e = exp; e > 1; e >>= 1) top++;
+
+    for (int bit = top; bit >= 0 && exp > 0; bit--) {
+        if (fpe_bn_mul(sq, r, len, r, len, ar) != 0) {
+            ar->used = mark;
+            return -1;
+        }
+        len = fpe_bn_trim(sq, 2 * len);
+        if (len > nr) {
+            ar->used = mark;
+            return -1;
+        }
+        memcpy(r, sq, len * sizeof(fpe_limb));
+
+        if ((exp >> bit) & 1) {
+            fpe_limb carry = bn_mul_1(r, r, len, base, 0);
+            if (carry) {
+                if (len >= nr) {
+                    ar->used = mark;
+                    return -1;
+                }
+                r[len++] = carry;
+            }
+        }
+    }
+    memset(r + len, 0, (nr - len) * sizeof(fpe_limb));
+
+    ar->used = mark;
+    return 0;
+}
+
+/* ========================================================================= */
+/*                               Power Table                                 */
+/* ========================================================================= */
+
+fpe_bn_powers *fpe_bn_powers_new(unsigned int radix) {
+    if (radix < 2) return NULL;
+
+    fpe_bn_powers *p = (fpe_bn_powers *)calloc(1, sizeof(fpe_bn_powers));
+    if (!p) return NULL;
+
+    p->radix = radix;
+
+    /* Pack as many digits as fit below 2^32 into one limb */
+    uint64_t cb = radix;
+    p->chunk_digits = 1;
+    while (cb * radix < LIMB_BASE) {
+        cb *= radix;
+        p->chunk_digits++;
+    }
+    p->chunk_base = (fpe_limb)cb;
+    p->base_digits = (size_t)p->chunk_digits * FPE_BN_DC_THRESHOLD;
+
+    return p;
+}
+
+/**
+ * @brief Compute level->mu = floor(B^(2n) / pow) with a one-off Knuth division
+ */
+static int bn_level_set_mu(struct fpe_bn_level *lv, fpe_bn_arena *ar) {
+    size_t n = lv->n;
+    size_t mark = ar->used;
+
+    fpe_limb *num = fpe_bn_alloc(ar, 2 * n + 1);
+    fpe_limb *rem = fpe_bn_alloc(ar, n);
+    if (!num || !rem) return -1;
+    memset(num, 0, (2 * n + 1) * sizeof(fpe_limb));
+    num[2 * n] = 1;
+
+    size_t nq = n + 2;
+    lv->mu = (fpe_limb *)malloc(nq * sizeof(fpe_limb));
+    if (!lv->mu) return -1;
+
+    if (fpe_bn_divmod(lv->mu, rem, num, 2 * n + 1, lv->pow, n, ar) != 0) {
+        ar->used = mark;
+        return -1;
+    }
+    lv->nmu = fpe_bn_trim(lv->mu, nq);
+
+    ar->used = mark;
+    return 0;
+}
+
+int fpe_bn_powers_reserve(fpe_bn_powers *p, size_t ndigits) {
+    if (!p) return -1;
+
+    while (p->levels < FPE_BN_MAX_LEVELS &&
+           (p->base_digits << p->levels) < ndigits) {
+        unsigned int j = p->levels;
+        struct fpe_bn_level *lv = &p->lvl[j];
+        size_t digits = p->base_digits << j;
+        size_t cap = fpe_bn_limbs_for_digits(p->radix, digits) + 1;
+
+        /* Temporary workspace for one squaring and one division */
+        size_t ws_limbs = 10 * cap + 64 * FPE_BN_MAX_LEVELS;
+        fpe_limb *ws = (fpe_limb *)malloc(ws_limbs * sizeof(fpe_limb));
+        if (!ws) return -1;
+        fpe_bn_arena ar;
+        fpe_bn_arena_init(&ar, ws, ws_limbs * sizeof(fpe_limb));
+
+        lv->pow = (fpe_limb *)malloc(cap * sizeof(fpe_limb));
+        int ret = lv->pow ? 0 : -1;
+
+        if (ret == 0 && j == 0) {
+            ret = fpe_bn_pow_ui(lv->pow, cap, p->radix, digits, &ar);
+        } else if (ret == 0) {
+            const struct fpe_bn_level *prev = &p->lvl[j - 1];
+            fpe_limb *sq = fpe_bn_alloc(&ar, 2 * prev->n);
+            ret = sq ? fpe_bn_mul(sq, prev->pow, prev->n, prev->pow, prev->n, &ar) : -1;
+            if (ret == 0) {
+                size_t nsq = fpe_bn_trim(sq, 2 * prev->n);
+                if (nsq > cap) {
+                    ret = -1;
+                } else {
+                    memset(lv->pow, 0, cap * sizeof(fpe_limb));
+                    memcpy(lv->pow, sq, nsq * sizeof(fpe_limb));
+                }
+            }
+        }
+
+        if (ret == 0) {
+            lv->n = fpe_bn_trim(lv->pow, cap);
+            lv->digits = digits;
+            ret = bn_level_set_mu(lv, &ar);
+        }
+
+        free(ws);
+        if (ret != 0) {
+            free(lv->pow);
+            free(lv->mu);
+            memset(lv, 0, sizeof(*lv));
+            return -1;
+        }
+        p->levels++;
+    }
+
+    return 0;
+}
+
+void fpe_bn_powers_free(fpe_bn_powers *p) {
+    if (!p) return;
+
+    for (unsigned int j = 0; j < p->levels; j++) {
+        free(p->lvl[j].pow);
+        free(p->lvl[j].mu);
+    }
+    free(p);
+}
+
+/**
+ * @brief Largest table level whose exponent is below n, or -1
+ */
+static int bn_pick_level(const fpe_bn_powers *p, size_t n) {
+    for (int j = (int)p->levels - 1; j >= 0; j--) {
+        if (p->lvl[j].digits < n) return j;
+    }
+    return -1;
+}
+
+/**
+ * @brief Barrett division of x (nx <= 2n limbs) by a table power
+ *
+ * q gets nx - n + 2 limbs, r gets n limbs.
+ */
+static int bn_barrett_divmod(fpe_limb *q, fpe_limb *r, const fpe_limb *x, size_t nx,
+                             const struct fpe_bn_level *lv, fpe_bn_arena *ar) {
+    size_t n = lv->n;
+    size_t qcap = nx - n + 2;
+    size_t mark = ar->used;
+
+    /* q1 = floor(x / B^(n-1)), q3 = floor(q1 * mu / B^(n+1)) */
+    size_t nq1 = nx - (n - 1);
+    fpe_limb *q2 = fpe_bn_alloc(ar, nq1 + lv->nmu);
+    if (!q2) return -1;
+    if (fpe_bn_mul(q2, x + (n - 1), nq1, lv->mu, lv->nmu, ar) != 0) {
+        ar->used = mark;
+        return -1;
+    }
+
+    size_t nq3 = (nq1 + lv->nmu > n + 1) ? nq1 + lv->nmu - (n + 1) : 0;
+    fpe_limb *q3 = q2 + (n + 1);
+    nq3 = fpe_bn_trim(q3, nq3);
+    if (nq3 + 1 > qcap) {
+        ar->used = mark;
+        return -1;
+    }
+    memset(q, 0, qcap * sizeof(fpe_limb));
+    memcpy(q, q3, nq3 * sizeof(fpe_limb));
+
+    /* rr = x - q3 * pow; the estimate is short by at most 2 */
+    fpe_limb *rr = fpe_bn_alloc(ar, nx);
+    if (!rr) {
+        ar->used = mark;
+        return -1;
+    }
+    memcpy(rr, x, nx * sizeof(fpe_limb));
+
+    if (nq3 > 0) {
+        fpe_limb *t = fpe_bn_alloc(ar, nq3 + n);
+        if (!t || fpe_bn_mul(t, q, nq3, lv->pow, n, ar) != 0) {
+            ar->used = mark;
+            return -1;
+        }
+        size_t nt = fpe_bn_trim(t, nq3 + n);
+        if (nt > nx || fpe_bn_sub(rr, rr, nx, t, nt) != 0) {
+            ar->used = mark;
+            return -1;
+        }
+    }
+
+    while (fpe_bn_cmp(rr, nx, lv->pow, n) >= 0) {
+        fpe_bn_sub(rr, rr, nx, lv->pow, n);
+        for (size_t i = 0; i < qcap; i++) {
+            if (++q[i] != 0) break;
+        }
+    }
+
+    memcpy(r, rr, n * sizeof(fpe_limb));
+    ar->used = mark;
+    return 0;
+}
+
+/* ========================================================================= */
+/*                            Radix Conversion                               */
+/* ========================================================================= */
+
+static fpe_limb bn_small_pow(unsigned int radix, unsigned int e) {
+    fpe_limb r = 1;
+    while (e--) r *= radix;
+    return r;
+}
+
+/**
+ * @brief Horner's method one limb-sized chunk of digits at a time
+ */
+static int bn_from_digits_base(fpe_limb *x, size_t nx, const unsigned int *d, size_t n,
+                               const fpe_bn_powers *p) {
+    memset(x, 0, nx * sizeof(fpe_limb));
+    if (n == 0) return 0;
+
+    unsigned int c = p->chunk_digits;
+    size_t first = n % c ? n % c : c;
+    size_t len = 0;
+
+    for (size_t i = 0; i < n;) {
+        size_t cnt = (i == 0) ? first : c;
+        fpe_limb val = 0;
+        for (size_t t = 0; t < cnt; t++) {
+            val = val * p->radix + d[i + t];
+        }
+        fpe_limb mult = (cnt == c) ? p->chunk_base : bn_small_pow(p->radix, (unsigned int)cnt);
+
+        fpe_limb carry = bn_mul_1(x, x, len, mult, val);
+        if (carry) {
+            if (len >= nx) return -1;
+            x[len++] = carry;
+        }
+        i += cnt;
+    }
+    return 0;
+}
+
+/**
+ * @brief Repeated division by radix^chunk, emitting digits right to left
+ */
+static int bn_to_digits_base(unsigned int *d, size_t n, const fpe_limb *x, size_t nx,
+                             const fpe_bn_powers *p, fpe_bn_arena *ar) {
+    size_t mark = ar->used;
+    fpe_limb *t = fpe_bn_alloc(ar, nx ? nx : 1);
+    if (!t) return -1;
+    memcpy(t, x, nx * sizeof(fpe_limb));
+    size_t len = fpe_bn_trim(t, nx);
+
+    size_t pos = n;
+    while (pos > 0) {
+        unsigned int cnt = (pos < p->chunk_digits) ? (unsigned int)pos : p->chunk_digits;
+        fpe_limb div = (cnt == p->chunk_digits) ? p->chunk_base : bn_small_pow(p->radix, cnt);
+        fpe_limb rem = 0;
+
+        if (len > 0) {
+            rem = bn_divmod_1(t, t, len, div);
+            len = fpe_bn_trim(t, len);
+        }
+        for (unsigned int k = 0; k < cnt; k++) {
+            d[--pos] = rem % p->radix;
+            rem /= p->radix;
+        }
+    }
+
+    ar->used = mark;
+    return 0;
+}
+
+int fpe_bn_from_digits(fpe_limb *x, size_t nx, const unsigned int *d, size_t n,
+                       const fpe_bn_powers *p, fpe_bn_arena *ar) {
+    int j = (n > 2 * p->base_digits) ? bn_pick_level(p, n) : -1;
+    if (j < 0) return bn_from_digits_base(x, nx, d, n, p);
+
+    const struct fpe_bn_level *lv = &p->lvl[j];
+    size_t h = lv->digits;
+    size_t mark = ar->used;
+
+    /* x = NUM(high n-h digits) * radix^h + NUM(low h digits) */
+    size_t nh = fpe_bn_limbs_for_digits(p->radix, n - h);
+    size_t nl = fpe_bn_limbs_for_digits(p->radix, h);
+    fpe_limb *xh = fpe_bn_alloc(ar, nh);
+    fpe_limb *xl = fpe_bn_alloc(ar, nl);
+    if (!xh || !xl) {
+        ar->used = mark;
+        return -1;
+    }
+
+    if (fpe_bn_from_digits(xh, nh, d, n - h, p, ar) != 0 ||
+        fpe_bn_from_digits(xl, nl, d + (n - h), h, p, ar) != 0) {
+        ar->used = mark;
+        return -1;
+    }
+    nh = fpe_bn_trim(xh, nh);
+    nl = fpe_bn_trim(xl, nl);
+
+    fpe_limb *prod = fpe_bn_alloc(ar, nh + lv->n);
+    if (!prod || fpe_bn_mul(prod, xh, nh, lv->pow, lv->n, ar) != 0) {
+        ar->used = mark;
+        return -1;
+    }
+    size_t np = fpe_bn_trim(prod, nh + lv->n);
+    if (np > nx || nl > nx) {
+        ar->used = mark;
+        return -1;
+    }
+
+    memset(x, 0, nx * sizeof(fpe_limb));
+    memcpy(x, prod, np * sizeof(fpe_limb));
+    bn_add_into(x, nx, xl, nl);
+
+    ar->used = mark;
+    return 0;
+}
+
+int fpe_bn_to_digits(unsigned int *d, size_t n, const fpe_limb *x, size_t nx,
+                     const fpe_bn_powers *p, fpe_bn_arena *ar) {
+    nx = fpe_bn_trim(x, nx);
+
+    int j = (n > 2 * p->base_digits && nx > FPE_BN_DC_THRESHOLD) ? bn_pick_level(p, n) : -1;
+    if (j < 0) return bn_to_digits_base(d, n, x, nx, p, ar);
+
+    const struct fpe_bn_level *lv = &p->lvl[j];
+    size_t h = lv->digits;
+
+    /* x < radix^h: the high n-h digits are all zero */
+    if (fpe_bn_cmp(x, nx, lv->pow, lv->n) < 0) {
+        for (size_t i = 0; i < n - h; i++) d[i] = 0;
+        return fpe_bn_to_digits(d + (n - h), h, x, nx, p, ar);
+    }
+
+    size_t mark = ar->used;
+    size_t nq = nx - lv->n + 2;
+    fpe_limb *q = fpe_bn_alloc(ar, nq);
+    fpe_limb *r = fpe_bn_alloc(ar, lv->n);
+    if (!q || !r) {
+        ar->used = mark;
+        return -1;
+    }
+
+    int ret;
+    if (nx <= 2 * lv->n) {
+        ret = bn_barrett_divmod(q, r, x, nx, lv, ar);
+    } else {
+        /* Out-of-range input (x >= radix^n): fall back to long division */
+        ret = fpe_bn_divmod(q, r, x, nx, lv->pow, lv->n, ar);
+    }
+
+    if (ret == 0) ret = fpe_bn_to_digits(d, n - h, q, nq, p, ar);
+    if (ret == 0) ret = fpe_bn_to_digits(d + (n - h), h, r, lv->n, p, ar);
+
+    ar->used = mark;
+    return ret;
+}
+
+void fpe_bn_from_bytes(fpe_limb *x, size_t nx, const unsigned char *in, size_t len) {
+    memset(x, 0, nx * sizeof(fpe_limb));
+
+    for (size_t i = 0; i < len; i++) {
+        size_t bit = (len - 1 - i) * 8;
+        size_t limb = bit / LIMB_BITS;
+        if (limb < nx) {
+            x[limb] |= (fpe_limb)in[i] << (bit % LIMB_BITS);
+        }
+    }
+}
+
+void fpe_bn_to_bytes(unsigned char *out, size_t len, const fpe_limb *x, size_t nx) {
+    for (size_t i = 0; i < len; i++) {
+        size_t bit = (len - 1 - i) * 8;
+        size_t limb = bit / LIMB_BITS;
+        out[i] = (limb < nx) ? (unsigned char)(x[limb] >> (bit % LIMB_BITS)) : 0;
+    }
+}
@@ -0,0 +1,183 @@
+/**
+ * @file bignum.h
+ * @brief Internal multi-precision arithmetic for long numeral strings
+ *
+ * Numbers are little-endian arrays of 32-bit limbs with explicit lengths.
+ * All temporaries come from a caller-provided arena, so no function here
+ * allocates except the per-context power table.
+ */
+
+#ifndef FPE_BIGNUM_H
+#define FPE_BIGNUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t fpe_limb;
+
+/* Below this many limbs multiplication uses the schoolbook method */
+#define FPE_BN_KARATSUBA_THRESHOLD 32
+
+/* Leaf size (in limbs) of the divide-and-conquer radix conversion */
+#define FPE_BN_DC_THRESHOLD 32
+
+/* Maximum number of squarings kept in the power table */
+#define FPE_BN_MAX_LEVELS 40
+
+/**
+ * @brief Bump allocator over a caller-owned block of limbs
+ */
+typedef struct {
+    fpe_limb *base;
+    size_t size;    /**< Capacity in limbs */
+    size_t used;    /**< Limbs handed out so far */
+    size_t peak;    /**< High-water mark of used (what needs wiping) */
+} fpe_bn_arena;
+
+/**
+ * @brief Precomputed powers radix^(base_digits * 2^j) with Barrett constants
+ */
+typedef struct fpe_bn_powers fpe_bn_powers;
+
+/* ========================================================================= */
+/*                               Arena / Sizing                              */
+/* ========================================================================= */
+
+/**
+ * @brief Initialize an arena over bytes of memory (aligned down to limbs)
+ */
+void fpe_bn_arena_init(fpe_bn_arena *ar, void *mem, size_t bytes);
+
+/**
+ * @brief Take n limbs from the arena
+ *
+ * @return Pointer to uninitialized limbs, or NULL if the arena is exhausted
+ */
+fpe_limb *fpe_bn_alloc(fpe_bn_arena *ar, size_t n);
+
+/**
+ * @brief Upper bound on the limbs needed to hold radix^ndigits - 1
+ */
+size_t fpe_bn_limbs_for_digits(unsigned int radix, size_t ndigits);
+
+/**
+ * @brief Arena size (in limbs) sufficient for conversions of ndigits digits
+ */
+size_t fpe_bn_workspace_limbs(unsigned int radix, size_t ndigits);
+
+/* ========================================================================= */
+/*                                Arithmetic                                 */
+/* ========================================================================= */
+
+/**
+ * @brief Length of x without leading zero limbs
+ */
+size_t fpe_bn_trim(const fpe_limb *x, size_t n);
+
+/**
+ * @brief Compare a[na] with b[nb]
+ *
+ * @return -1, 0 or 1
+ */
+int fpe_bn_cmp(const fpe_limb *a, size_t na, const fpe_limb *b, size_t nb);
+
+/**
+ * @brief r[n] = a[n] + b[nb] (nb <= n)
+ *
+ * @return Carry out of the top limb
+ */
+fpe_limb fpe_bn_add(fpe_limb *r, const fpe_limb *a, size_t n,
+                    const fpe_limb *b, size_t nb);
+
+/**
+ * @brief r[n] = a[n] - b[nb] (nb <= n)
+ *
+ * @return Borrow out of the top limb
+ */
+fpe_limb fpe_bn_sub(fpe_limb *r, const fpe_limb *a, size_t n,
+                    const fpe_limb *b, size_t nb);
+
+/**
+ * @brief r[na + nb] = a[na] * b[nb] (Karatsuba above the threshold)
+ *
+ * r must not overlap a or b.
+ *
+ * @return 0 on success, -1 if the arena is exhausted
+ */
+int fpe_bn_mul(fpe_limb *r, const fpe_limb *a, size_t na,
+               const fpe_limb *b, size_t nb, fpe_bn_arena *ar);
+
+/**
+ * @brief Knuth long division: q = a / m, r = a mod m
+ *
+ * q (na - nm + 1 limbs) may be NULL. r has nm limbs. The cost is
+ * O((na - nm + 1) * nm), i.e. linear when the quotient is short.
+ *
+ * @return 0 on success, -1 on division by zero or arena exhaustion
+ */
+int fpe_bn_divmod(fpe_limb *q, fpe_limb *r, const fpe_limb *a, size_t na,
+                  const fpe_limb *m, size_t nm, fpe_bn_arena *ar);
+
+/**
+ * @brief r[nr] = base^exp
+ *
+ * @return 0 on success, -1 if the result does not fit or the arena is exhausted
+ */
+int fpe_bn_pow_ui(fpe_limb *r, size_t nr, unsigned int base, size_t exp,
+                  fpe_bn_arena *ar);
+
+/* ========================================================================= */
+/*                            Radix Conversion                               */
+/* ========================================================================= */
+
+/**
+ * @brief Create an (empty) power table for radix
+ */
+fpe_bn_powers *fpe_bn_powers_new(unsigned int radix);
+
+/**
+ * @brief Grow the power table so numbers of ndigits digits can be converted
+ *
+ * Each level costs one squaring and one division; levels are kept for the
+ * lifetime of the table, so repeated calls with the same length are free.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int fpe_bn_powers_reserve(fpe_bn_powers *p, size_t ndigits);
+
+/**
+ * @brief Free a power table (NULL-safe)
+ */
+void fpe_bn_powers_free(fpe_bn_powers *p);
+
+/**
+ * @brief NUM_radix(d[0..n-1]) into x[nx] (most significant digit first)
+ *
+ * Divide and conquer over the power table: O(M(n) log n).
+ *
+ * @return 0 on success, -1 on arena exhaustion
+ */
+int fpe_bn_from_digits(fpe_limb *x, size_t nx, const unsigned int *d, size_t n,
+                       const fpe_bn_powers *p, fpe_bn_arena *ar);
+
+/**
+ * @brief STR^n_radix(x[nx]) into d[0..n-1]; requires x < radix^n
+ *
+ * Divide and conquer with Barrett division by table powers: O(M(n) log n).
+ *
+ * @return 0 on success, -1 on arena exhaustion
+ */
+int fpe_bn_to_digits(unsigned int *d, size_t n, const fpe_limb *x, size_t nx,
+                     const fpe_bn_powers *p, fpe_bn_arena *ar);
+
+/**
+ * @brief x[nx] = big-endian bytes in[0..len-1]
+ */
+void fpe_bn_from_bytes(fpe_limb *x, size_t nx, const unsigned char *in, size_t len);
+
+/**
+ * @brief Big-endian bytes out[0..len-1] = x mod 256^len
+ */
+void fpe_bn_to_bytes(unsigned char *out, size_t len, const fpe_limb *x, size_t nx);
+
+#endif /* FPE_BIGNUM_H */
@@ -8,6 +8,11 @@
 
 #include "ff1.h"
 #include "utils.h"
+#include "bignum.h"
+#include "lanes.h"
+#include "stats.h"
+#include "pipeline.h"
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
@@ -22,52 +27,6 @@ static inline unsigned int ceildiv(unsigned int a, unsigned int b) {
     return (a + b - 1) / b;
 }
 
-/**
- * @brief Convert numeral string to big integer (big-endian byte array)
- * 
- * Converts X[0..n-1] in radix to a big-endian byte representation
- */
-static void num_to_bytes(const unsigned int *x, unsigned int len, unsigned int radix,
-                         unsigned char *out, unsigned int out_len) {
-    /* Start with zero */
-    memset(out, 0, out_len);
-    
-    /* Convert numeral string to big integer using Horner's method */
-    for (unsigned int i = 0; i < len; i++) {
-        /* Multiply current result by radix and add next digit */
-        unsigned int carry = x[i];
-        for (int j = (int)out_len - 1; j >= 0; j--) {
-            unsigned long long tmp = (unsigned long long)out[j] * radix + carry;
-            out[j] = (unsigned char)(tmp & 0xFF);
-            carry = (unsigned int)(tmp >> 8);
-        }
-    }
-}
-
-/**
- * @brief Convert big integer (big-endian byte array) to numeral string
- */
-static void bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
-                         unsigned int *x, unsigned int len, unsigned int radix) {
-    /* Start with zero */
-    memset(x, 0, len * sizeof(unsigned int));
-    
-    /* Convert big integer to numeral string */
-    unsigned char temp[256];
-    memcpy(temp, bytes, byte_len);
-    
-    for (int i = (int)len - 1; i >= 0; i--) {
-        /* Divide temp by radix, remainder goes to x[i] */
-        unsigned int remainder = 0;
-        for (unsigned int j = 0; j < byte_len; j++) {
-            unsigned long long tmp = ((unsigned long long)remainder << 8) | temp[j];
-            temp[j] = (unsigned char)(tmp / radix);
-            remainder = (unsigned int)(tmp % radix);
-        }
-        x[i] = remainder;
-    }
-}
-
 /**
  * @brief FF1 Round Function using AES-ECB + CBC-MAC (not CMAC!)
  * 
@@ -92,6 +51,7 @@ static int ff1_prf(FPE_CTX *ctx, const unsigned char *P, unsigned int P_len,
     
     /* Step 2: CBC-MAC over Q */
     unsigned int num_q_blocks = Q_len / 16;
+    FPE_STAT_ADD(ctx, cipher_blocks, 1 + num_q_blocks);
     for (unsigned int i = 0; i < num_q_blocks; i++) {
         unsigned char Ri[16];
         /* XOR current Q block with R */
@@ -112,6 +72,7 @@ static int ff1_prf(FPE_CTX *ctx, const unsigned char *P, unsigned int P_len,
         memcpy(S, R, 16);
         
         unsigned int num_extra_blocks = ceildiv(S_len, 16) - 1;
+        FPE_STAT_ADD(ctx, cipher_blocks, num_extra_blocks);
         for (unsigned int j = 1; j <= num_extra_blocks; j++) {
             unsigned char tmp[16];
             memset(tmp, 0, 16);
@@ -143,39 +104,12 @@ static int ff1_prf(FPE_CTX *ctx, const unsigned char *P, unsigned int P_len,
 }
 
 /**
- * @brief FF1 Encryption
+ * @brief Build the FF1 header block P
+ * 
+ * P = [1]^1 || [2]^1 || [1]^1 || [radix]^3 || [10]^1 || [u mod 256]^1 || [n]^4 || [t]^4
  */
-int ff1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2 || len > 0xFFFFFFFF) return -1;  /* Minimum length requirement */
-    
-    unsigned int radix = ctx->radix;
-    
-    /* Compute split point */
-    unsigned int u = len / 2;
-    unsigned int v = len - u;
-    
-    /* Allocate working buffers for A and B */
-    unsigned int A[256], B[256];
-    if (len > 256) return -1;  /* Practical limit */
-    
-    memcpy(A, in, u * sizeof(unsigned int));
-    memcpy(B, in + u, v * sizeof(unsigned int));
-    
-    /* Use pointers to track current A and B for swapping */
-    unsigned int *pA = A;
-    unsigned int *pB = B;
-    
-    /* Compute b = ceiling(ceiling(v * log2(radix)) / 8) */
-    double log2_radix = log2((double)radix);
-    unsigned int b = ceildiv((unsigned int)ceil(v * log2_radix), 8);
-    
-    /* Compute d = 4 * ceiling(b / 4) + 4 */
-    unsigned int d = 4 * ceildiv(b, 4) + 4;
-    
-    /* Build P: [1][2][1][radix][10][u%256][len][tweak_len] */
-    unsigned char P[16];
+static void ff1_build_p(unsigned char P[16], unsigned int radix, unsigned int u,
+                        unsigned int len, unsigned int tweak_len) {
     P[0] = 1;  /* version */
     P[1] = 2;  /* method (CMAC) */
     P[2] = 1;  /* addition */
@@ -192,271 +126,898 @@ int ff1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
     P[13] = (unsigned char)((tweak_len >> 16) & 0xFF);
     P[14] = (unsigned char)((tweak_len >> 8) & 0xFF);
     P[15] = (unsigned char)(tweak_len & 0xFF);
+}
+
+/* ========================================================================= */
+/*                          Integer Feistel Kernel                           */
+/* ========================================================================= */
+
+int ff1_shape_init(ff1_shape *s, unsigned int radix, unsigned int len,
+                   unsigned int tweak_len) {
+    if (len < 2) return -1;  /* Minimum length requirement */
     
-    #ifdef FF1_DEBUG
-    printf("P vector: ");
-    for (int i = 0; i < 16; i++) printf("%02x ", P[i]);
-    printf("\n");
-    printf("u=%u, v=%u, b=%u, d=%u\n", u, v, b, d);
-    #endif
+    memset(s, 0, sizeof(*s));
+    s->len = len;
+    s->tweak_len = tweak_len;
+    s->u = len / 2;
+    s->v = len - s->u;
     
-    /* 10 rounds */
-    for (unsigned int i = 0; i < FF1_ROUNDS; i++) {
-        /* m alternates between u and v based on round number */
-        unsigned int m = (i & 1) ? v : u;
-        unsigned int other_len = len - m;  /* Length of the B part */
-        
-        #ifdef FF1_DEBUG
-        printf("Round %u: m=%u, other_len=%u\n", i, m, other_len);
-        printf("  pA points to %s (size %u), first %u elements: ", 
-               (pA == A) ? "A" : "B", (pA == A) ? u : v, m);
-        for (unsigned int j = 0; j < m; j++) printf("%u", pA[j]);
-        printf("\n  pB points to %s (size %u), first %u elements: ", 
-               (pB == A) ? "A" : "B", (pB == A) ? u : v, other_len);
-        for (unsigned int j = 0; j < other_len; j++) printf("%u", pB[j]);
-        printf("\n");
-        #endif
-        
-        /* Compute Q = T || [0]^(-t-b-1) || [i] || NUMradix(B) */
-        unsigned char Q[256];
-        unsigned int Q_len = 0;
+    /* b and d must stay representable (b < 2^29 bytes) */
+    double b_bits = ceil((double)s->v * log2((double)radix));
+    if (b_bits > 4294967040.0) return -1;
+    s->b = ceildiv((unsigned int)b_bits, 8);
+    s->d = 4 * ceildiv(s->b, 4) + 4;
+    
+    s->q_len = ((size_t)tweak_len + s->b + 1 + 15) & ~(size_t)15;
+    if (s->q_len > 0xFFFFFFFFu) return -1;
+    s->padding_len = (unsigned int)(s->q_len - tweak_len - s->b - 1);
+    
+    s->ku = fpe_bn_limbs_for_digits(radix, s->u);
+    s->kv = fpe_bn_limbs_for_digits(radix, s->v) + 1;
+    s->ky = (s->d + 3) / 4 + 1;
+    s->ws = fpe_bn_workspace_limbs(radix, len);
+    
+    ff1_build_p(s->P, radix, s->u, len, tweak_len);
+    return 0;
+}
+
+int ff1_shape_moduli(FPE_CTX *ctx, ff1_shape *s) {
+    fpe_limb *M = (fpe_limb *)malloc((s->ku + s->kv) * sizeof(fpe_limb));
+    void *ws = fpe_ctx_scratch(ctx, s->ws * sizeof(fpe_limb));
+    if (!M || !ws) {
+        free(M);
+        return -1;
+    }
+    
+    fpe_bn_arena ar;
+    fpe_bn_arena_init(&ar, ws, s->ws * sizeof(fpe_limb));
+    if (fpe_bn_pow_ui(M, s->ku, ctx->radix, s->u, &ar) != 0 ||
+        fpe_bn_pow_ui(M + s->ku, s->kv, ctx->radix, s->v, &ar) != 0) {
+        free(M);
+        return -1;
+    }
+    
+    s->Mu = M;
+    s->Mv = M + s->ku;
+    s->nMu = fpe_bn_trim(s->Mu, s->ku);
+    s->nMv = fpe_bn_trim(s->Mv, s->kv);
+    return 0;
+}
+
+void ff1_shape_release(ff1_shape *s) {
+    free(s->Mu);
+    s->Mu = s->Mv = NULL;
+}
+
+/**
+ * @brief Shared FF1 Feistel loop for numeral strings of any length
+ * 
+ * A and B are kept as integers for the whole Feistel network: NUM(B) for Q
+ * is a byte export, y mod radix^m is a Knuth division with a short quotient
+ * and the modular add is a limb add with one conditional subtraction. The
+ * only radix conversions are NUM at entry and STR at exit, both divide and
+ * conquer over a per-context power table, so cost stays O(M(n) log n).
+ * 
+ * All working memory is carved from the context scratch arena, sized by
+ * the shape. If the shape carries precomputed moduli, they are used as is.
+ */
+int ff1_crypt_shaped(FPE_CTX *ctx, const ff1_shape *s, const unsigned int *in,
+                     unsigned int *out, const unsigned char *tweak, int encrypt) {
+    unsigned int radix = ctx->radix;
+    unsigned int len = s->len, tweak_len = s->tweak_len;
+    unsigned int u = s->u, v = s->v, b = s->b, d = s->d;
+    size_t q_len = s->q_len;
+    size_t ku = s->ku, kv = s->kv, ky = s->ky, ws = s->ws;
+    if (tweak_len > 0 && !tweak) return -1;
+    
+    /* Digits must be in range for NUM/STR to be inverse of each other */
+    for (unsigned int i = 0; i < len; i++) {
+        if (in[i] >= radix) return -1;
+    }
+    
+    /* Powers of the radix for divide-and-conquer conversion */
+    if (!ctx->bn_powers) {
+        FPE_STAT_ADD(ctx, cache_misses, 1);
+        ctx->bn_powers = fpe_bn_powers_new(radix);
+        if (!ctx->bn_powers) return -1;
+    } else {
+        FPE_STAT_ADD(ctx, cache_hits, 1);
+    }
+    if (fpe_bn_powers_reserve(ctx->bn_powers, v) != 0) return -1;
+    
+    /* Scratch layout: A | B | Mu | Mv | Y | R | workspace (limbs), Q | S (bytes) */
+    size_t limbs = 2 * kv + ku + kv + ky + kv + ws;
+    size_t scratch_len = limbs * sizeof(fpe_limb) + q_len + d;
+    
+    unsigned char *scratch = (unsigned char *)fpe_ctx_scratch(ctx, scratch_len);
+    if (!scratch) return -1;
+    
+    fpe_limb *pA = (fpe_limb *)scratch;
+    fpe_limb *pB = pA + kv;
+    fpe_limb *Mu = pB + kv;
+    fpe_limb *Mv = Mu + ku;
+    fpe_limb *Y = Mv + kv;
+    fpe_limb *R = Y + ky;
+    unsigned char *Q = (unsigned char *)(R + kv + ws);
+    unsigned char *S = Q + q_len;
+    
+    fpe_bn_arena ar;
+    fpe_bn_arena_init(&ar, R + kv, ws * sizeof(fpe_limb));
+    
+    int ret = -1;
+    FPE_STAT_TIMER(t);
+    
+    /* Moduli radix^u and radix^v */
+    size_t nMu, nMv;
+    if (s->Mu) {
+        Mu = s->Mu;
+        Mv = s->Mv;
+        nMu = s->nMu;
+        nMv = s->nMv;
+    } else {
+        if (fpe_bn_pow_ui(Mu, ku, radix, u, &ar) != 0) goto cleanup;
+        if (fpe_bn_pow_ui(Mv, kv, radix, v, &ar) != 0) goto cleanup;
+        nMu = fpe_bn_trim(Mu, ku);
+        nMv = fpe_bn_trim(Mv, kv);
+    }
+    
+    /* A = NUM(X[1..u]), B = NUM(X[u+1..n]) */
+    if (fpe_bn_from_digits(pA, kv, in, u, ctx->bn_powers, &ar) != 0) goto cleanup;
+    if (fpe_bn_from_digits(pB, kv, in + u, v, ctx->bn_powers, &ar) != 0) goto cleanup;
+    FPE_STAT_LAP(ctx, convert_cycles, t);
+    
+    /* T || [0]^pad is the same for every round */
+    if (tweak_len > 0) {
+        memcpy(Q, tweak, tweak_len);
+    }
+    memset(Q + tweak_len, 0, s->padding_len);
+    unsigned char *Q_round = Q + tweak_len + s->padding_len;
+    unsigned char *Q_num = Q_round + 1;
+    
+    for (unsigned int r = 0; r < FF1_ROUNDS; r++) {
+        unsigned int i = encrypt ? r : FF1_ROUNDS - 1 - r;
         
-        /* Add tweak */
-        if (tweak_len > 0) {
-            memcpy(Q + Q_len, tweak, tweak_len);
-            Q_len += tweak_len;
+        if (!encrypt) {
+            fpe_limb *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
         }
         
-        /* Add padding: Q must be multiple of 16 bytes total */
-        /* Padding formula: (-t - b - 1) mod 16 */
-        int pad_amount = -(int)tweak_len - (int)b - 1;
-        unsigned int padding_len = ((pad_amount % 16) + 16) % 16;
-        memset(Q + Q_len, 0, padding_len);
-        Q_len += padding_len;
+        const fpe_limb *M = (i & 1) ? Mv : Mu;
+        size_t nM = (i & 1) ? nMv : nMu;
         
-        /* Add round number */
-        Q[Q_len++] = (unsigned char)i;
+        /* Q = T || [0]^pad || [i] || [NUM(B)]^b */
+        *Q_round = (unsigned char)i;
+        fpe_bn_to_bytes(Q_num, b, pB, kv);
         
-        /* Add NUMradix(B) - B is the OTHER part (len - m characters) */
-        unsigned char B_bytes[256];
-        memset(Q + Q_len, 0, b);  // Clear the b bytes first
-        num_to_bytes(pB, other_len, radix, B_bytes, b);
-        memcpy(Q + Q_len, B_bytes, b);  // Copy b bytes
-        Q_len += b;
+        if (ff1_prf(ctx, s->P, 16, Q, (unsigned int)q_len, S, d) != 0) goto cleanup;
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
-        #ifdef FF1_DEBUG
-        if (i == 0) {
-            printf("  NUM(B) bytes: ");
-            for (unsigned int j = 0; j < b; j++) printf("%02x ", B_bytes[j]);
-            printf(" (from pB=");
-            for (unsigned int j = 0; j < other_len; j++) printf("%u", pB[j]);
-            printf(")\n");
-        }
-        #endif
+        /* R = NUM(S) mod radix^m */
+        fpe_bn_from_bytes(Y, ky, S, d);
+        if (fpe_bn_divmod(NULL, R, Y, ky, M, nM, &ar) != 0) goto cleanup;
         
-        /* Compute S = PRF(P || Q) */
-        unsigned char S[256];
-        if (ff1_prf(ctx, P, 16, Q, Q_len, S, d) != 0) {
-            return -1;
+        if (encrypt) {
+            /* c = (A + y) mod radix^m; A < radix^m so one subtraction suffices */
+            fpe_bn_add(pA, pA, nM + 1, R, nM);
+            if (fpe_bn_cmp(pA, nM + 1, M, nM) >= 0) {
+                fpe_bn_sub(pA, pA, nM + 1, M, nM);
+            }
+            
+            fpe_limb *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
+        } else {
+            /* c = (A - y) mod radix^m */
+            if (fpe_bn_sub(pA, pA, nM, R, nM)) {
+                fpe_bn_add(pA, pA, nM, M, nM);
+            }
         }
+        FPE_STAT_LAP(ctx, arith_cycles, t);
+    }
+    
+    /* Concatenate STR^u(A) || STR^v(B) */
+    if (fpe_bn_to_digits(out, u, pA, kv, ctx->bn_powers, &ar) != 0) goto cleanup;
+    if (fpe_bn_to_digits(out + u, v, pB, kv, ctx->bn_powers, &ar) != 0) goto cleanup;
+    FPE_STAT_LAP(ctx, convert_cycles, t);
+    ret = 0;
+    
+cleanup:
+    /* Wipe only what was touched: the fixed limbs, the arena peak, Q and S */
+    fpe_secure_zero(scratch, (size_t)((unsigned char *)(R + kv) - scratch) +
+                             ar.peak * sizeof(fpe_limb));
+    fpe_secure_zero(Q, q_len + d);
+    return ret;
+}
+
+/**
+ * @brief FF1 Encryption
+ */
+int ff1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff1_shape s;
+    if (ff1_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff1_crypt_shaped(ctx, &s, in, out, tweak, 1);
+}
+
+/**
+ * @brief FF1 Decryption (reverse of encryption)
+ */
+int ff1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff1_shape s;
+    if (ff1_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff1_crypt_shaped(ctx, &s, in, out, tweak, 0);
+}
+
+/* ========================================================================= */
+/*                         Radix-256 Byte-String Kernel                      */
+/* ========================================================================= */
+
+/**
+ * @brief Shared FF1 Feistel loop for radix-256 byte strings
+ * 
+ * With radix 256, NUM(X) is X read as a big-endian integer and b = v, so
+ * NUM(B) is copied straight into Q and y mod 256^m is the last m bytes of S.
+ * The modular add/subtract is a byte-wise carry/borrow chain.
+ * 
+ * Scratch layout: A[v] | B[v] | Q[t + pad + 1 + b] | S[d]
+ */
+static int ff1_crypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                           unsigned int len, const unsigned char *tweak,
+                           unsigned int tweak_len, int encrypt) {
+    if (!ctx || !in || !out) return -1;
+    if (ctx->radix != 256) return -1;
+    if (len < 2) return -1;  /* Minimum length requirement */
+    if (tweak_len > 0 && !tweak) return -1;
+    
+    unsigned int u = len / 2;
+    unsigned int v = len - u;
+    
+    /* b = ceiling(v * log2(256) / 8) = v, d = 4 * ceiling(b / 4) + 4 */
+    unsigned int b = v;
+    unsigned int d = 4 * ceildiv(b, 4) + 4;
+    
+    /* Padding: (-t - b - 1) mod 16 */
+    unsigned int padding_len = (16 - (unsigned int)(((unsigned long long)tweak_len + b + 1) % 16)) % 16;
+    size_t q_len = (size_t)tweak_len + padding_len + 1 + b;
+    if (q_len > 0xFFFFFFFFu) return -1;
+    
+    size_t scratch_len = 2 * (size_t)v + q_len + d;
+    unsigned char *scratch = (unsigned char *)fpe_ctx_scratch(ctx, scratch_len);
+    if (!scratch) return -1;
+    
+    unsigned char *pA = scratch;
+    unsigned char *pB = scratch + v;
+    unsigned char *Q = pB + v;
+    unsigned char *S = Q + q_len;
+    
+    memcpy(pA, in, u);
+    memcpy(pB, in + u, v);
+    
+    unsigned char P[16];
+    ff1_build_p(P, 256, u, len, tweak_len);
+    
+    /* T || [0]^pad is the same for every round */
+    if (tweak_len > 0) {
+        memcpy(Q, tweak, tweak_len);
+    }
+    memset(Q + tweak_len, 0, padding_len);
+    unsigned char *Q_round = Q + tweak_len + padding_len;
+    unsigned char *Q_num = Q_round + 1;
+    
+    for (unsigned int r = 0; r < FF1_ROUNDS; r++) {
+        unsigned int i = encrypt ? r : FF1_ROUNDS - 1 - r;
         
-        #ifdef FF1_DEBUG
-        if (i == 0) {  // Only print for first round
-            printf("  Q (len=%u): ", Q_len);
-            for (unsigned int j = 0; j < Q_len; j++) printf("%02x ", Q[j]);
-            printf("\n");
-            printf("  S (first %u bytes): ", d);
-            for (unsigned int j = 0; j < d; j++) printf("%02x ", S[j]);
-            printf("\n");
+        if (!encrypt) {
+            /* Swap first (opposite of encryption) */
+            unsigned char *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
         }
-        #endif
         
-        /* Convert S to integer y */
-        unsigned char y_bytes[256];
-        memcpy(y_bytes, S, d);  // Use d bytes, not b bytes!
-        
-        /* Convert y_bytes to numeral */
-        unsigned int y_num[256];
-        bytes_to_num(y_bytes, d, y_num, m, radix);  // Use d bytes!
+        unsigned int m = (i & 1) ? v : u;
+        unsigned int other_len = len - m;
         
-        #ifdef FF1_DEBUG
-        if (i == 0) {
-            printf("  y_num: ");
-            for (unsigned int j = 0; j < m; j++) printf("%u", y_num[j]);
-            printf("\n");
-        }
-        #endif
+        /* Q = T || [0]^pad || [i] || NUM_256(B), B left-padded to b bytes */
+        *Q_round = (unsigned char)i;
+        memset(Q_num, 0, b - other_len);
+        memcpy(Q_num + (b - other_len), pB, other_len);
         
-        /* Compute c = (NUM(A) + y) mod radix^m */
-        /* Add A + y mod radix for each digit */
-        unsigned int carry = 0;
-        for (int j = (int)m - 1; j >= 0; j--) {
-            unsigned long long sum = (unsigned long long)pA[j] + y_num[j] + carry;
-            pA[j] = (unsigned int)(sum % radix);
-            carry = (unsigned int)(sum / radix);
+        if (ff1_prf(ctx, P, 16, Q, (unsigned int)q_len, S, d) != 0) {
+            fpe_secure_zero(scratch, scratch_len);
+            return -1;
         }
         
-        #ifdef FF1_DEBUG
-        printf("  After addition: pA=");
-        for (unsigned int j = 0; j < m; j++) printf("%u", pA[j]);
-        printf("\n");
-        #endif
-        
-        /* Swap pointers A and B after each round (including the last one) */
-        unsigned int *swap_ptr = pA;
-        pA = pB;
-        pB = swap_ptr;
+        /* y mod 256^m is the low-order m bytes of S (d > b >= m) */
+        const unsigned char *y = S + (d - m);
         
-        #ifdef FF1_DEBUG
-        printf("  After swap: pA=");
-        unsigned int check_len_a = (i & 1) ? u : v;  // After swap, what length?
-        // Actually after swap, pA points to what was pB
-        // In round 0: before swap pA had u elements, pB had v elements
-        // After swap: pA points to B (v elements), pB points to A (u elements)
-        // But wait, A and B arrays have fixed sizes!
-        // Let me just print 5 elements for now
-        for (unsigned int j = 0; j < 5; j++) printf("%u", pA[j]);
-        printf(", pB=");
-        for (unsigned int j = 0; j < 5; j++) printf("%u", pB[j]);
-        printf("\n");
-        #endif
+        if (encrypt) {
+            unsigned int carry = 0;
+            for (int j = (int)m - 1; j >= 0; j--) {
+                unsigned int sum = (unsigned int)pA[j] + y[j] + carry;
+                pA[j] = (unsigned char)sum;
+                carry = sum >> 8;
+            }
+            
+            /* Swap pointers A and B after each round */
+            unsigned char *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
+        } else {
+            unsigned int borrow = 0;
+            for (int j = (int)m - 1; j >= 0; j--) {
+                unsigned int diff = (unsigned int)pA[j] - y[j] - borrow;
+                pA[j] = (unsigned char)diff;
+                borrow = (diff >> 8) & 1;
+            }
+        }
     }
     
-    /* After 10 swaps (even number), pointers are back to original positions.
-     * pA points to A buffer, pB points to B buffer.
-     * Final output is A || B which is u characters followed by v characters.
-     */
-    #ifdef FF1_DEBUG
-    printf("Final: pA=");
-    for (unsigned int j = 0; j < u; j++) printf("%u", pA[j]);
-    printf(", pB=");
-    for (unsigned int j = 0; j < v; j++) printf("%u", pB[j]);
-    printf("\n");
-    printf("Output will be: pA || pB\n");
-    #endif
-    
     /* Concatenate A || B */
-    memcpy(out, pA, u * sizeof(unsigned int));
-    memcpy(out + u, pB, v * sizeof(unsigned int));
+    memcpy(out, pA, u);
+    memcpy(out + u, pB, v);
     
+    fpe_secure_zero(scratch, scratch_len);
     return 0;
 }
 
+int ff1_encrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                      unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    return ff1_crypt_bytes(ctx, in, out, len, tweak, tweak_len, 1);
+}
+
+int ff1_decrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                      unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    return ff1_crypt_bytes(ctx, in, out, len, tweak, tweak_len, 0);
+}
+
+/* ========================================================================= */
+/*                          Lane-Parallel Batch Kernel                       */
+/* ========================================================================= */
+
 /**
- * @brief FF1 Decryption (reverse of encryption)
+ * @brief ECB-encrypt blocks consecutive 16-byte blocks in one cipher call
  */
-int ff1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2) return -1;
+static int ff1_ecb_blocks(FPE_CTX *ctx, unsigned char *out, const unsigned char *in,
+                          unsigned int blocks) {
+    int outlen = 0;
+    FPE_STAT_ADD(ctx, cipher_blocks, blocks);
+    if (!EVP_EncryptUpdate(ctx->cipher_ctx, out, &outlen, in, (int)(blocks * FF1_BLOCK_SIZE))) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Shared FF1 Feistel loop over up to FPE_LANES equal-length records
+ * 
+ * Records are transposed so digit j of every lane is one contiguous row
+ * (see lanes.h); NUM/STR and the mod-radix add then process all lanes per
+ * instruction. The PRF is batched too: step k of every lane's CBC-MAC is a
+ * single ECB call over nl blocks, and the leading blocks of Q that hold only
+ * T || [0]^pad are chained once per call rather than once per round.
+ * 
+ * Scratch layout: A | B | Y | limbs (uint32 rows), then Q[FPE_LANES][q_len] |
+ * S[FPE_LANES][d] | X | R | T (FPE_LANES blocks each)
+ */
+static int ff1_crypt_lanes(FPE_CTX *ctx, const unsigned int *const *in,
+                           unsigned int *const *out, unsigned int nl, unsigned int len,
+                           const unsigned char *const *tweaks, unsigned int tweak_len,
+                           int encrypt) {
+    if (!ctx || !ctx->cipher_ctx || !in || !out) return -1;
+    if (nl == 0 || nl > FPE_LANES) return -1;
+    if (!ff1_lanes_supported(ctx->radix, len)) return -1;
+    if (tweak_len > 0 && !tweaks) return -1;
     
     unsigned int radix = ctx->radix;
-    
-    /* Compute split point */
     unsigned int u = len / 2;
     unsigned int v = len - u;
+    unsigned int b = ceildiv((unsigned int)ceil(v * log2((double)radix)), 8);
+    unsigned int d = 4 * ceildiv(b, 4) + 4;
     
-    /* Allocate working buffers for A and B */
-    unsigned int A[256], B[256];
-    if (len > 256) return -1;
+    unsigned int q_len = (tweak_len + b + 1 + 15) & ~15u;
+    unsigned int padding_len = q_len - tweak_len - b - 1;
+    unsigned int n_pre = (tweak_len + padding_len) / FF1_BLOCK_SIZE;
+    unsigned int n_q = q_len / FF1_BLOCK_SIZE;
+    unsigned int n_s = ceildiv(d, FF1_BLOCK_SIZE);
     
-    memcpy(A, in, u * sizeof(unsigned int));
-    memcpy(B, in + u, v * sizeof(unsigned int));
+    size_t row = (size_t)v * FPE_LANES;
+    size_t limb_rows = (size_t)(d / 2) * FPE_LANES;
+    size_t words = 3 * row + limb_rows;
+    size_t lane_blocks = (size_t)FPE_LANES * FF1_BLOCK_SIZE;
+    size_t scratch_len = words * sizeof(uint32_t) + (size_t)FPE_LANES * (q_len + d) +
+                         3 * lane_blocks;
     
-    /* Use pointers to track current A and B for swapping */
-    unsigned int *pA = A;
-    unsigned int *pB = B;
+    unsigned char *scratch = (unsigned char *)fpe_ctx_scratch(ctx, scratch_len);
+    if (!scratch) return -1;
     
-    /* Compute parameters (same as encryption) */
-    double log2_radix = log2((double)radix);
-    unsigned int b = ceildiv((unsigned int)ceil(v * log2_radix), 8);
-    unsigned int d = 4 * ceildiv(b, 4) + 4;
+    uint32_t *pA = (uint32_t *)scratch;
+    uint32_t *pB = pA + row;
+    uint32_t *Y = pB + row;
+    uint32_t *limbs = Y + row;
+    unsigned char *Q = (unsigned char *)(limbs + limb_rows);
+    unsigned char *S = Q + (size_t)FPE_LANES * q_len;
+    unsigned char *X = S + (size_t)FPE_LANES * d;
+    unsigned char *R = X + lane_blocks;
+    unsigned char *T = R + lane_blocks;
+    
+    int ret = -1;
+    
+    if (fpe_lanes_load(pA, in, nl, 0, u, radix) != 0) goto cleanup;
+    if (fpe_lanes_load(pB, in, nl, u, v, radix) != 0) goto cleanup;
     
-    /* Build P (same as encryption) */
+    /* Q rows start with T || [0]^pad; unused lanes stay zero */
+    memset(Q, 0, (size_t)FPE_LANES * q_len);
+    memset(S, 0, (size_t)FPE_LANES * d);
+    for (unsigned int l = 0; l < nl && tweak_len > 0; l++) {
+        if (!tweaks[l]) goto cleanup;
+        memcpy(Q + (size_t)l * q_len, tweaks[l], tweak_len);
+    }
+    
+    /* R = CIPH(P) is shared by every lane; then chain the tweak-only blocks */
     unsigned char P[16];
-    P[0] = 1;
-    P[1] = 2;
-    P[2] = 1;
-    P[3] = (unsigned char)((radix >> 16) & 0xFF);
-    P[4] = (unsigned char)((radix >> 8) & 0xFF);
-    P[5] = (unsigned char)(radix & 0xFF);
-    P[6] = 10;
-    P[7] = (unsigned char)(u & 0xFF);
-    P[8] = (unsigned char)((len >> 24) & 0xFF);
-    P[9] = (unsigned char)((len >> 16) & 0xFF);
-    P[10] = (unsigned char)((len >> 8) & 0xFF);
-    P[11] = (unsigned char)(len & 0xFF);
-    P[12] = (unsigned char)((tweak_len >> 24) & 0xFF);
-    P[13] = (unsigned char)((tweak_len >> 16) & 0xFF);
-    P[14] = (unsigned char)((tweak_len >> 8) & 0xFF);
-    P[15] = (unsigned char)(tweak_len & 0xFF);
+    ff1_build_p(P, radix, u, len, tweak_len);
+    if (ff1_ecb_blocks(ctx, R, P, 1) != 0) goto cleanup;
+    for (unsigned int l = 1; l < nl; l++) {
+        memcpy(R + l * FF1_BLOCK_SIZE, R, FF1_BLOCK_SIZE);
+    }
+    for (unsigned int k = 0; k < n_pre; k++) {
+        for (unsigned int l = 0; l < nl; l++) {
+            const unsigned char *q = Q + (size_t)l * q_len + k * FF1_BLOCK_SIZE;
+            for (int j = 0; j < FF1_BLOCK_SIZE; j++) {
+                X[l * FF1_BLOCK_SIZE + j] = q[j] ^ R[l * FF1_BLOCK_SIZE + j];
+            }
+        }
+        if (ff1_ecb_blocks(ctx, R, X, nl) != 0) goto cleanup;
+    }
+    memcpy(T, R, (size_t)nl * FF1_BLOCK_SIZE);  /* T = chaining value after the prefix */
     
-    /* 10 rounds in reverse */
-    for (int i = FF1_ROUNDS - 1; i >= 0; i--) {
-        /* Swap pointers A and B first (opposite of encryption where we swap after) */
-        unsigned int *swap_ptr = pA;
-        pA = pB;
-        pB = swap_ptr;
-        
-        /* m alternates between u and v based on round number */
+    unsigned int q_round = tweak_len + padding_len;
+    
+    for (unsigned int r = 0; r < FF1_ROUNDS; r++) {
+        unsigned int i = encrypt ? r : FF1_ROUNDS - 1 - r;
         unsigned int m = (i & 1) ? v : u;
-        unsigned int other_len = len - m;  /* Length of the B part */
         
-        /* Compute Q (same as encryption) */
-        unsigned char Q[256];
-        unsigned int Q_len = 0;
-        
-        if (tweak_len > 0) {
-            memcpy(Q + Q_len, tweak, tweak_len);
-            Q_len += tweak_len;
+        if (!encrypt) {
+            uint32_t *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
         }
         
-        /* Add padding: (-t - b - 1) mod 16 */
-        int pad_amount = -(int)tweak_len - (int)b - 1;
-        unsigned int padding_len = ((pad_amount % 16) + 16) % 16;
-        memset(Q + Q_len, 0, padding_len);
-        Q_len += padding_len;
+        /* Q = T || [0]^pad || [i] || [NUM(B)]^b in every lane */
+        for (unsigned int l = 0; l < FPE_LANES; l++) Q[(size_t)l * q_len + q_round] = (unsigned char)i;
+        fpe_lanes_num_to_bytes(pB, len - m, radix, Q + q_round + 1, q_len, b, limbs);
         
-        Q[Q_len++] = (unsigned char)i;
+        /* CBC-MAC over the remaining blocks of Q, all lanes per cipher call */
+        memcpy(R, T, (size_t)nl * FF1_BLOCK_SIZE);
+        for (unsigned int k = n_pre; k < n_q; k++) {
+            for (unsigned int l = 0; l < nl; l++) {
+                const unsigned char *q = Q + (size_t)l * q_len + k * FF1_BLOCK_SIZE;
+                for (int j = 0; j < FF1_BLOCK_SIZE; j++) {
+                    X[l * FF1_BLOCK_SIZE + j] = q[j] ^ R[l * FF1_BLOCK_SIZE + j];
+                }
+            }
+            if (ff1_ecb_blocks(ctx, R, X, nl) != 0) goto cleanup;
+        }
         
-        /* Add NUMradix(B) - B is the OTHER part (len - m characters) */
-        unsigned char B_bytes[256];
-        memset(Q + Q_len, 0, b);
-        num_to_bytes(pB, other_len, radix, B_bytes, b);
-        memcpy(Q + Q_len, B_bytes, b);
-        Q_len += b;
+        /* S = R || CIPH(R xor [1]) || CIPH(R xor [2]) ... truncated to d bytes */
+        for (unsigned int l = 0; l < nl; l++) {
+            unsigned int n = d < FF1_BLOCK_SIZE ? d : FF1_BLOCK_SIZE;
+            memcpy(S + (size_t)l * d, R + l * FF1_BLOCK_SIZE, n);
+        }
+        for (unsigned int j = 1; j < n_s; j++) {
+            for (unsigned int l = 0; l < nl; l++) {
+                memcpy(X + l * FF1_BLOCK_SIZE, R + l * FF1_BLOCK_SIZE, FF1_BLOCK_SIZE);
+                X[l * FF1_BLOCK_SIZE + 12] ^= (unsigned char)(j >> 24);
+                X[l * FF1_BLOCK_SIZE + 13] ^= (unsigned char)(j >> 16);
+                X[l * FF1_BLOCK_SIZE + 14] ^= (unsigned char)(j >> 8);
+                X[l * FF1_BLOCK_SIZE + 15] ^= (unsigned char)j;
+            }
+            if (ff1_ecb_blocks(ctx, X, X, nl) != 0) goto cleanup;
+            unsigned int n = (j == n_s - 1) ? d - j * FF1_BLOCK_SIZE : FF1_BLOCK_SIZE;
+            for (unsigned int l = 0; l < nl; l++) {
+                memcpy(S + (size_t)l * d + j * FF1_BLOCK_SIZE, X + l * FF1_BLOCK_SIZE, n);
+            }
+        }
         
-        /* Compute S */
-        unsigned char S[256];
-        if (ff1_prf(ctx, P, 16, Q, Q_len, S, d) != 0) {
+        /* y = NUM(S) mod radix^m, then A = A +/- y */
+        fpe_lanes_bytes_to_num(Y, m, radix, S, d, d, limbs);
+        
+        if (encrypt) {
+            fpe_lanes_add_mod(pA, Y, m, radix);
+            
+            uint32_t *swap_ptr = pA;
+            pA = pB;
+            pB = swap_ptr;
+        } else {
+            fpe_lanes_sub_mod(pA, Y, m, radix);
+        }
+    }
+    
+    fpe_lanes_store(out, pA, nl, 0, u);
+    fpe_lanes_store(out, pB, nl, u, v);
+    ret = 0;
+    
+cleanup:
+    FPE_STAT_OPS(ctx, encrypt, nl, (uint64_t)nl * len, 0, ret);
+    fpe_secure_zero(scratch, scratch_len);
+    return ret;
+}
+
+int ff1_lanes_supported(unsigned int radix, unsigned int len) {
+    if (len < 2 || radix < 2 || radix > 65536) return 0;
+    
+    double bits = ceil((len - len / 2) * log2((double)radix));
+    return bits <= 8.0 * FF1_LANES_MAX_BYTES;
+}
+
+int ff1_encrypt_lanes(FPE_CTX *ctx, const unsigned int *const *in, unsigned int *const *out,
+                      unsigned int nl, unsigned int len,
+                      const unsigned char *const *tweaks, unsigned int tweak_len) {
+    return ff1_crypt_lanes(ctx, in, out, nl, len, tweaks, tweak_len, 1);
+}
+
+int ff1_decrypt_lanes(FPE_CTX *ctx, const unsigned int *const *in, unsigned int *const *out,
+                      unsigned int nl, unsigned int len,
+                      const unsigned char *const *tweaks, unsigned int tweak_len) {
+    return ff1_crypt_lanes(ctx, in, out, nl, len, tweaks, tweak_len, 0);
+}
+
+/* ========================================================================= */
+/*                          Pipelined Batch Kernel                           */
+/* ========================================================================= */
+
+/* Where a record in flight is in its current PRF evaluation */
+enum {
+    FF1_PIPE_PREFIX,    /**< Chaining T || [0]^pad (once per record) */
+    FF1_PIPE_CHAIN,     /**< Chaining [i] || NUM(B), block k of Q */
+    FF1_PIPE_EXTEND     /**< Counter blocks extending S beyond 16 bytes */
+};
+
+/**
+ * @brief One record in flight through the FF1 integer Feistel network
+ */
+typedef struct {
+    unsigned int *out;              /**< Where the finished record goes */
+    unsigned int round;             /**< Rounds completed */
+    unsigned int phase;             /**< FF1_PIPE_* */
+    unsigned int k;                 /**< Next block of Q to chain */
+    unsigned int nblocks;           /**< Pending cipher blocks in X */
+    fpe_limb *pA, *pB, *Y, *R;      /**< Halves, NUM(S) and y (limbs) */
+    unsigned char *Q, *S, *X;       /**< Q, PRF output, pending blocks */
+    unsigned char chain[FF1_BLOCK_SIZE];    /**< CBC-MAC chaining value */
+    unsigned char prefix[FF1_BLOCK_SIZE];   /**< Chaining value after T || [0]^pad */
+} ff1_pipe_rec;
+
+/* State shared by every record of one pipelined call */
+typedef struct {
+    FPE_CTX *ctx;
+    const ff1_shape *s;
+    const fpe_limb *Mu, *Mv;
+    size_t nMu, nMv;
+    unsigned int n_pre, n_q, n_s;   /**< Prefix blocks, blocks of Q, blocks of S */
+    unsigned char cP[FF1_BLOCK_SIZE];   /**< CIPH(P), the same for every record */
+    fpe_bn_arena ar;
+    int encrypt;
+} ff1_pipe;
+
+/* X = Q[k] xor chain: the next CBC-MAC block */
+static void ff1_pipe_chain_block(ff1_pipe_rec *rec) {
+    const unsigned char *q = rec->Q + (size_t)rec->k * FF1_BLOCK_SIZE;
+    for (int j = 0; j < FF1_BLOCK_SIZE; j++) rec->X[j] = q[j] ^ rec->chain[j];
+    rec->nblocks = 1;
+}
+
+/**
+ * @brief Start the next round: build Q and issue its first chained block
+ * 
+ * @return 1 if a block is pending, 0 if the record is finished, -1 on error
+ */
+static int ff1_pipe_round(ff1_pipe *pl, ff1_pipe_rec *rec) {
+    const ff1_shape *s = pl->s;
+    
+    if (rec->round == FF1_ROUNDS) {
+        /* Concatenate STR^u(A) || STR^v(B) */
+        if (fpe_bn_to_digits(rec->out, s->u, rec->pA, s->kv, pl->ctx->bn_powers, &pl->ar) != 0 ||
+            fpe_bn_to_digits(rec->out + s->u, s->v, rec->pB, s->kv, pl->ctx->bn_powers, &pl->ar) != 0) {
             return -1;
         }
+        return 0;
+    }
+    
+    unsigned int i = pl->encrypt ? rec->round : FF1_ROUNDS - 1 - rec->round;
+    if (!pl->encrypt) {
+        fpe_limb *swap_ptr = rec->pA;
+        rec->pA = rec->pB;
+        rec->pB = swap_ptr;
+    }
+    
+    /* Q = T || [0]^pad || [i] || [NUM(B)]^b */
+    unsigned char *Q_round = rec->Q + s->tweak_len + s->padding_len;
+    *Q_round = (unsigned char)i;
+    fpe_bn_to_bytes(Q_round + 1, s->b, rec->pB, s->kv);
+    
+    memcpy(rec->chain, rec->prefix, FF1_BLOCK_SIZE);
+    rec->k = pl->n_pre;
+    rec->phase = FF1_PIPE_CHAIN;
+    ff1_pipe_chain_block(rec);
+    return 1;
+}
+
+/**
+ * @brief y = NUM(S) mod radix^m, A = A +/- y, end of the round
+ */
+static int ff1_pipe_math(ff1_pipe *pl, ff1_pipe_rec *rec) {
+    const ff1_shape *s = pl->s;
+    unsigned int i = pl->encrypt ? rec->round : FF1_ROUNDS - 1 - rec->round;
+    const fpe_limb *M = (i & 1) ? pl->Mv : pl->Mu;
+    size_t nM = (i & 1) ? pl->nMv : pl->nMu;
+    
+    fpe_bn_from_bytes(rec->Y, s->ky, rec->S, s->d);
+    if (fpe_bn_divmod(NULL, rec->R, rec->Y, s->ky, M, nM, &pl->ar) != 0) return -1;
+    
+    if (pl->encrypt) {
+        fpe_bn_add(rec->pA, rec->pA, nM + 1, rec->R, nM);
+        if (fpe_bn_cmp(rec->pA, nM + 1, M, nM) >= 0) {
+            fpe_bn_sub(rec->pA, rec->pA, nM + 1, M, nM);
+        }
         
-        /* Convert S to integer y - USE D BYTES, NOT B! */
-        unsigned char y_bytes[256];
-        memcpy(y_bytes, S, d);
-        
-        unsigned int y_num[256];
-        bytes_to_num(y_bytes, d, y_num, m, radix);
+        fpe_limb *swap_ptr = rec->pA;
+        rec->pA = rec->pB;
+        rec->pB = swap_ptr;
+    } else {
+        if (fpe_bn_sub(rec->pA, rec->pA, nM, rec->R, nM)) {
+            fpe_bn_add(rec->pA, rec->pA, nM, M, nM);
+        }
+    }
+    rec->round++;
+    return 0;
+}
+
+/**
+ * @brief Take in a record: NUM of both halves and the tweak prefix of Q
+ * 
+ * @return As ff1_pipe_round()
+ */
+static int ff1_pipe_admit(ff1_pipe *pl, ff1_pipe_rec *rec, const unsigned int *in,
+                          unsigned int *out, const unsigned char *tweak) {
+    const ff1_shape *s = pl->s;
+    FPE_CTX *ctx = pl->ctx;
+    
+    for (unsigned int i = 0; i < s->len; i++) {
+        if (in[i] >= ctx->radix) return -1;
+    }
+    if (fpe_bn_from_digits(rec->pA, s->kv, in, s->u, ctx->bn_powers, &pl->ar) != 0 ||
+        fpe_bn_from_digits(rec->pB, s->kv, in + s->u, s->v, ctx->bn_powers, &pl->ar) != 0) {
+        return -1;
+    }
+    
+    rec->out = out;
+    rec->round = 0;
+    if (s->tweak_len > 0) memcpy(rec->Q, tweak, s->tweak_len);
+    memset(rec->Q + s->tweak_len, 0, s->padding_len);
+    
+    /* R = CIPH(P), then chain the blocks holding only T || [0]^pad */
+    memcpy(rec->chain, pl->cP, FF1_BLOCK_SIZE);
+    if (pl->n_pre > 0) {
+        rec->k = 0;
+        rec->phase = FF1_PIPE_PREFIX;
+        ff1_pipe_chain_block(rec);
+        return 1;
+    }
+    memcpy(rec->prefix, rec->chain, FF1_BLOCK_SIZE);
+    return ff1_pipe_round(pl, rec);
+}
+
+/**
+ * @brief Consume the record's cipher output and run it to its next block
+ * 
+ * @return As ff1_pipe_round()
+ */
+static int ff1_pipe_resume(ff1_pipe *pl, ff1_pipe_rec *rec) {
+    const ff1_shape *s = pl->s;
+    
+    switch (rec->phase) {
+        case FF1_PIPE_PREFIX:
+            memcpy(rec->chain, rec->X, FF1_BLOCK_SIZE);
+            if (++rec->k < pl->n_pre) {
+                ff1_pipe_chain_block(rec);
+                return 1;
+            }
+            memcpy(rec->prefix, rec->chain, FF1_BLOCK_SIZE);
+            return ff1_pipe_round(pl, rec);
+            
+        case FF1_PIPE_CHAIN:
+            memcpy(rec->chain, rec->X, FF1_BLOCK_SIZE);
+            if (++rec->k < pl->n_q) {
+                ff1_pipe_chain_block(rec);
+                return 1;
+            }
+            
+            /* S = R || CIPH(R xor [1]) || CIPH(R xor [2]) ... truncated to d bytes */
+            memcpy(rec->S, rec->chain, s->d < FF1_BLOCK_SIZE ? s->d : FF1_BLOCK_SIZE);
+            if (pl->n_s > 1) {
+                for (unsigned int j = 1; j < pl->n_s; j++) {
+                    unsigned char *x = rec->X + (size_t)(j - 1) * FF1_BLOCK_SIZE;
+                    memcpy(x, rec->chain, FF1_BLOCK_SIZE);
+                    x[12] ^= (unsigned char)(j >> 24);
+                    x[13] ^= (unsigned char)(j >> 16);
+                    x[14] ^= (unsigned char)(j >> 8);
+                    x[15] ^= (unsigned char)j;
+                }
+                rec->phase = FF1_PIPE_EXTEND;
+                rec->nblocks = pl->n_s - 1;
+                return 1;
+            }
+            break;
+            
+        case FF1_PIPE_EXTEND:
+            memcpy(rec->S + FF1_BLOCK_SIZE, rec->X, s->d - FF1_BLOCK_SIZE);
+            break;
+            
+        default:
+            return -1;
+    }
+    
+    if (ff1_pipe_math(pl, rec) != 0) return -1;
+    return ff1_pipe_round(pl, rec);
+}
+
+int ff1_crypt_pipelined(FPE_CTX *ctx, const ff1_shape *s, const unsigned int *in,
+                        unsigned int *out, size_t count, const unsigned char *tweaks,
+                        size_t tweak_stride, int encrypt) {
+    if (!ctx->cipher_ctx) return -1;
+    if (s->tweak_len > 0 && !tweaks) return -1;
+    
+    ff1_pipe pl;
+    pl.ctx = ctx;
+    pl.s = s;
+    pl.encrypt = encrypt;
+    pl.n_pre = (s->tweak_len + s->padding_len) / FF1_BLOCK_SIZE;
+    pl.n_q = (unsigned int)(s->q_len / FF1_BLOCK_SIZE);
+    pl.n_s = ceildiv(s->d, FF1_BLOCK_SIZE);
+    
+    if (!ctx->bn_powers) {
+        FPE_STAT_ADD(ctx, cache_misses, 1);
+        ctx->bn_powers = fpe_bn_powers_new(ctx->radix);
+        if (!ctx->bn_powers) return -1;
+    } else {
+        FPE_STAT_ADD(ctx, cache_hits, 1);
+    }
+    if (fpe_bn_powers_reserve(ctx->bn_powers, s->v) != 0) return -1;
+    
+    /*
+     * Scratch layout: Mu | Mv | workspace | per record A | B | Y | R (limbs),
+     * then per record Q | S | X, then the gathered blocks G
+     */
+    size_t nb = pl.n_s > 1 ? pl.n_s - 1 : 1;
+    size_t rec_limbs = 3 * s->kv + s->ky;
+    size_t rec_bytes = s->q_len + s->d + nb * FF1_BLOCK_SIZE;
+    size_t limbs = s->ku + s->kv + s->ws + FPE_PIPE_DEPTH * rec_limbs;
+    size_t scratch_len = limbs * sizeof(fpe_limb) + FPE_PIPE_DEPTH * rec_bytes +
+                         FPE_PIPE_DEPTH * nb * FF1_BLOCK_SIZE;
+    
+    unsigned char *scratch = (unsigned char *)fpe_ctx_scratch(ctx, scratch_len);
+    if (!scratch) return -1;
+    
+    fpe_limb *Mu = (fpe_limb *)scratch;
+    fpe_limb *Mv = Mu + s->ku;
+    fpe_limb *ws = Mv + s->kv;
+    fpe_limb *rec_limb = ws + s->ws;
+    unsigned char *rec_byte = (unsigned char *)(rec_limb + FPE_PIPE_DEPTH * rec_limbs);
+    unsigned char *G = rec_byte + FPE_PIPE_DEPTH * rec_bytes;
+    fpe_bn_arena_init(&pl.ar, ws, s->ws * sizeof(fpe_limb));
+    
+    ff1_pipe_rec rec[FPE_PIPE_DEPTH];
+    ff1_pipe_rec *slot[FPE_PIPE_DEPTH];     /* Records in flight, slot[0..n) */
+    for (unsigned int l = 0; l < FPE_PIPE_DEPTH; l++) {
+        fpe_limb *L = rec_limb + l * rec_limbs;
+        unsigned char *B = rec_byte + l * rec_bytes;
+        rec[l].pA = L;
+        rec[l].pB = L + s->kv;
+        rec[l].R = L + 2 * s->kv;
+        rec[l].Y = L + 3 * s->kv;
+        rec[l].Q = B;
+        rec[l].S = B + s->q_len;
+        rec[l].X = B + s->q_len + s->d;
+    }
+    
+    unsigned int n = 0;
+    size_t next = 0, done = 0;
+    int ret = -1;
+    
+    /* Moduli radix^u and radix^v, and CIPH(P), once for every record */
+    if (s->Mu) {
+        pl.Mu = s->Mu;
+        pl.Mv = s->Mv;
+        pl.nMu = s->nMu;
+        pl.nMv = s->nMv;
+    } else {
+        if (fpe_bn_pow_ui(Mu, s->ku, ctx->radix, s->u, &pl.ar) != 0) goto cleanup;
+        if (fpe_bn_pow_ui(Mv, s->kv, ctx->radix, s->v, &pl.ar) != 0) goto cleanup;
+        pl.Mu = Mu;
+        pl.Mv = Mv;
+        pl.nMu = fpe_bn_trim(Mu, s->ku);
+        pl.nMv = fpe_bn_trim(Mv, s->kv);
+    }
+    if (ff1_ecb_blocks(ctx, pl.cP, s->P, 1) != 0) goto cleanup;
+    
+    while (n < FPE_PIPE_DEPTH && next < count) {
+        const unsigned char *tweak = s->tweak_len ? tweaks + next * tweak_stride : NULL;
+        int st = ff1_pipe_admit(&pl, &rec[n], in + next * s->len, out + next * s->len, tweak);
+        next++;
+        if (st < 0) goto cleanup;
+        if (st == 0) {
+            done++;
+        } else {
+            slot[n] = &rec[n];
+            n++;
+        }
+    }
+    
+    FPE_STAT_TIMER(t);
+    
+    while (n > 0) {
+        /* Issue: every pending block in one cipher call */
+        unsigned int total = 0;
+        for (unsigned int k = 0; k < n; k++) {
+            memcpy(G + (size_t)total * FF1_BLOCK_SIZE, slot[k]->X,
+                   (size_t)slot[k]->nblocks * FF1_BLOCK_SIZE);
+            total += slot[k]->nblocks;
+        }
+        if (ff1_ecb_blocks(ctx, G, G, total) != 0) goto cleanup;
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
-        /* Compute c = (NUM(A) - y) mod radix^m */
-        /* Subtract A - y mod radix for each digit */
-        int borrow = 0;
-        for (int j = (int)m - 1; j >= 0; j--) {
-            long long diff = (long long)pA[j] - y_num[j] - borrow;
-            if (diff < 0) {
-                diff += radix;
-                borrow = 1;
+        /* Resume each record up to its next block; refill finished slots */
+        total = 0;
+        for (unsigned int k = 0; k < n;) {
+            ff1_pipe_rec *r = slot[k];
+            memcpy(r->X, G + (size_t)total * FF1_BLOCK_SIZE, (size_t)r->nblocks * FF1_BLOCK_SIZE);
+            total += r->nblocks;
+            
+            int st = ff1_pipe_resume(&pl, r);
+            while (st == 0) {
+                done++;
+                if (next >= count) break;
+                const unsigned char *tweak = s->tweak_len ? tweaks + next * tweak_stride : NULL;
+                st = ff1_pipe_admit(&pl, r, in + next * s->len, out + next * s->len, tweak);
+                next++;
+            }
+            if (st < 0) goto cleanup;
+            if (st == 0) {
+                /* Keep the blocks of slots not yet resumed where they are */
+                memmove(slot + k, slot + k + 1, (n - k - 1) * sizeof(slot[0]));
+                n--;
             } else {
-                borrow = 0;
+                k++;
             }
-            pA[j] = (unsigned int)diff;
         }
+        FPE_STAT_LAP(ctx, arith_cycles, t);
     }
+    ret = 0;
     
-    /* Concatenate A || B */
-    memcpy(out, pA, u * sizeof(unsigned int));
-    memcpy(out + u, pB, v * sizeof(unsigned int));
-    
-    return 0;
+cleanup:
+    FPE_STAT_OPS(ctx, encrypt, done, (uint64_t)done * s->len, 0, ret);
+    fpe_secure_zero(scratch, scratch_len);
+    fpe_secure_zero(rec, sizeof(rec));
+    return ret;
+}
+
+#ifdef FPE_BENCH_INTERNALS
+/* ========================================================================= */
+/*                       Microbenchmark Entry Points                         */
+/* ========================================================================= */
+
+#include "bench_internals.h"
+
+int fpe_bench_ff1_prf(FPE_CTX *ctx, const unsigned char *P, unsigned int P_len,
+                      const unsigned char *Q, unsigned int Q_len,
+                      unsigned char *S, unsigned int S_len) {
+    return ff1_prf(ctx, P, P_len, Q, Q_len, S, S_len);
 }
+#endif /* FPE_BENCH_INTERNALS */
@@ -7,6 +7,56 @@
 #define FF1_H
 
 #include "fpe_internal.h"
+#include "bignum.h"
+
+/* Widest NUM(B), in bytes, for which the lane-parallel kernel beats the integer path */
+#if defined(__AVX2__)
+#define FF1_LANES_MAX_BYTES 24
+#else
+#define FF1_LANES_MAX_BYTES 16
+#endif
+
+/**
+ * @brief Everything the integer kernel derives from (radix, len, tweak_len)
+ * 
+ * Filled by ff1_shape_init() on every call of ff1_encrypt/ff1_decrypt, or
+ * once by a prepared plan (FPE_PLAN), which also precomputes the moduli.
+ */
+typedef struct ff1_shape {
+    unsigned int len, tweak_len;
+    unsigned int u, v;          /**< Split: u = floor(len/2) */
+    unsigned int b, d;          /**< Bytes of NUM(B) and of the PRF output */
+    unsigned int padding_len;   /**< Zero bytes between T and [i] in Q */
+    size_t q_len;               /**< Length of Q (multiple of 16) */
+    size_t ku, kv, ky, ws;      /**< Limb counts of the scratch layout */
+    unsigned char P[16];        /**< Header block P */
+    fpe_limb *Mu, *Mv;          /**< radix^u and radix^v, or NULL to compute per call */
+    size_t nMu, nMv;            /**< Significant limbs of Mu and Mv */
+} ff1_shape;
+
+/**
+ * @brief Validate a record shape and derive its kernel parameters
+ * 
+ * @return 0 on success, -1 if len < 2 or the shape overflows
+ */
+int ff1_shape_init(ff1_shape *s, unsigned int radix, unsigned int len,
+                   unsigned int tweak_len);
+
+/**
+ * @brief Precompute radix^u and radix^v into memory owned by the shape
+ */
+int ff1_shape_moduli(FPE_CTX *ctx, ff1_shape *s);
+
+/**
+ * @brief Free the moduli allocated by ff1_shape_moduli()
+ */
+void ff1_shape_release(ff1_shape *s);
+
+/**
+ * @brief FF1 integer kernel over a validated shape (encrypt != 0 to encrypt)
+ */
+int ff1_crypt_shaped(FPE_CTX *ctx, const ff1_shape *s, const unsigned int *in,
+                     unsigned int *out, const unsigned char *tweak, int encrypt);
 
 /**
  * @brief FF1 encryption function
@@ -20,4 +70,56 @@ int ff1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
 int ff1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
                 unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
 
+/**
+ * @brief FF1 encryption of a radix-256 byte string
+ * 
+ * Digits are the bytes themselves, so NUM/STR conversion reduces to a copy.
+ * Working memory comes from the context scratch arena, so len is not capped.
+ */
+int ff1_encrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                      unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief FF1 decryption of a radix-256 byte string
+ */
+int ff1_decrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                      unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
+
+/**
+ * @brief Whether records of len numerals in radix suit the lane kernel
+ */
+int ff1_lanes_supported(unsigned int radix, unsigned int len);
+
+/**
+ * @brief FF1 encryption of up to FPE_LANES equal-length records at once
+ * 
+ * Record l is in[l][0..len-1] with tweak tweaks[l] (all tweak_len bytes);
+ * results go to out[l]. The records are transposed internally so radix
+ * conversion and the AES calls run across lanes. Conversion is quadratic
+ * per lane, so only records accepted by ff1_lanes_supported() are allowed.
+ */
+int ff1_encrypt_lanes(FPE_CTX *ctx, const unsigned int *const *in, unsigned int *const *out,
+                      unsigned int nl, unsigned int len,
+                      const unsigned char *const *tweaks, unsigned int tweak_len);
+
+/**
+ * @brief FF1 decryption of up to FPE_LANES equal-length records at once
+ */
+int ff1_decrypt_lanes(FPE_CTX *ctx, const unsigned int *const *in, unsigned int *const *out,
+                      unsigned int nl, unsigned int len,
+                      const unsigned char *const *tweaks, unsigned int tweak_len);
+
+/**
+ * @brief FF1 over count records of one shape, FPE_PIPE_DEPTH in flight
+ * 
+ * Record r is in + r * len, its result out + r * len and its tweak
+ * tweaks + r * tweak_stride. For records too wide for the lane kernel;
+ * see pipeline.h.
+ * 
+ * @return 0 on success, -1 on error (e.g. a digit >= radix)
+ */
+int ff1_crypt_pipelined(FPE_CTX *ctx, const ff1_shape *s, const unsigned int *in,
+                        unsigned int *out, size_t count, const unsigned char *tweaks,
+                        size_t tweak_stride, int encrypt);
+
 #endif /* FF1_H */
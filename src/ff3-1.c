@@ -10,6 +10,8 @@
 
 #include "ff3-1.h"
 #include "utils.h"
+#include "stats.h"
+#include "pipeline.h"
 #include <string.h>
 #include <math.h>
 #include <openssl/evp.h>
@@ -105,13 +107,44 @@ static void bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
     }
 }
 
+/**
+ * @brief a = (a + y) mod radix^m, digits least significant first
+ */
+static void num_add_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                        unsigned int radix) {
+    unsigned int carry = 0;
+    for (unsigned int j = 0; j < m; j++) {
+        unsigned long long sum = (unsigned long long)a[j] + y[j] + carry;
+        a[j] = (unsigned int)(sum % radix);
+        carry = (unsigned int)(sum / radix);
+    }
+}
+
+/**
+ * @brief a = (a - y) mod radix^m, digits least significant first
+ */
+static void num_sub_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                        unsigned int radix) {
+    int borrow = 0;
+    for (unsigned int j = 0; j < m; j++) {
+        long long diff = (long long)a[j] - y[j] - borrow;
+        if (diff < 0) {
+            diff += radix;
+            borrow = 1;
+        } else {
+            borrow = 0;
+        }
+        a[j] = (unsigned int)diff;
+    }
+}
+
 /**
  * @brief FF3-1 Round Function using AES-ECB
  * 
  * Similar to FF3 but with modified tweak handling for security
  */
 static int ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
-                               const unsigned int *B, unsigned int B_len,
+                               const unsigned int *B, unsigned int B_len, unsigned int b,
                                unsigned int radix, unsigned char *W, unsigned int W_len) {
     if (!ctx->cipher_ctx) return -1;
     
@@ -131,9 +164,6 @@ static int ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned in
     plaintext[3] ^= (unsigned char)round;
     
     /* Add NUM(B) to the right side - use REVERSED order for FF3-1 */
-    unsigned int b = ceildiv((unsigned int)ceil(B_len * log2((double)radix)), 8);
-    if (b > 12) b = 12;
-    
     num_to_bytes_rev(B, B_len, radix, plaintext + (FF3_1_BLOCK_SIZE - b), b);
     
     /* Reverse bytes before encryption (FF3-1 spec requirement) */
@@ -143,6 +173,7 @@ static int ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned in
     unsigned char ciphertext[FF3_1_BLOCK_SIZE];
     int outlen = 0;
     
+    FPE_STAT_ADD(ctx, cipher_blocks, 1);
     if (!EVP_EncryptUpdate(ctx->cipher_ctx, ciphertext, &outlen, plaintext, FF3_1_BLOCK_SIZE)) {
         return -1;
     }
@@ -157,21 +188,13 @@ static int ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned in
 }
 
 /**
- * @brief FF3-1 Encryption
+ * @brief FF3-1 encryption over a shape from ff3_shape_init()
  */
-int ff3_1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                  unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2 || len > 256) return -1;
-    
-    /* FF3-1 requires exactly 56 bits (7 bytes) tweak, or 64 bits with 8 bits ignored */
-    if (tweak_len != 7 && tweak_len != 8 && tweak_len != 0) return -1;
-    
+int ff3_1_encrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                         unsigned int *out, const unsigned char *tweak) {
     unsigned int radix = ctx->radix;
-    
-    /* Compute split point - u should be the larger half for odd lengths */
-    unsigned int u = (len + 1) / 2;  /* Ceiling division */
-    unsigned int v = len - u;
+    unsigned int len = s->len, tweak_len = s->tweak_len;
+    unsigned int u = s->u, v = s->v;
     
     /* Working buffers */
     unsigned int A[256], B[256];
@@ -201,6 +224,8 @@ int ff3_1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         Tr[3] = tweak[6];
     }
     
+    FPE_STAT_TIMER(t);
+    
     /* 8 rounds */
     for (unsigned int i = 0; i < FF3_1_ROUNDS; i++) {
         /* Select tweak half based on round 
@@ -214,28 +239,23 @@ int ff3_1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         unsigned int other_len = len - m;
         
         /* Compute W = Round_Encrypt(T, i, B) */
-        unsigned int b = ceildiv((unsigned int)ceil(other_len * log2((double)radix)), 8);
-        if (b > 16) b = 16;
-        
         unsigned char W[16];
-        if (ff3_1_round_encrypt(ctx, T, i, pB, other_len, radix, W, 16) != 0) {
+        if (ff3_1_round_encrypt(ctx, T, i, pB, other_len, s->b[i & 1], radix, W, 16) != 0) {
             return -1;
         }
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
         /* Convert W to numeral - use full 16 bytes with REVERSED order */
         unsigned int y[256];
         bytes_to_num_rev(W, 16, y, m, radix);
+        FPE_STAT_LAP(ctx, convert_cycles, t);
         
         /* Compute c = (NUM(A) + y) mod radix^m
          * In reversed order, position 0 is least significant digit
          * So add from position 0 (low) to position m-1 (high)
          */
-        unsigned int carry = 0;
-        for (unsigned int j = 0; j < m; j++) {
-            unsigned long long sum = (unsigned long long)pA[j] + y[j] + carry;
-            pA[j] = (unsigned int)(sum % radix);
-            carry = (unsigned int)(sum / radix);
-        }
+        num_add_rev(pA, y, m, radix);
+        FPE_STAT_LAP(ctx, arith_cycles, t);
         
         /* Swap A and B after every round */
         unsigned int *swap = pA;
@@ -251,20 +271,13 @@ int ff3_1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
 }
 
 /**
- * @brief FF3-1 Decryption
+ * @brief FF3-1 decryption over a shape from ff3_shape_init()
  */
-int ff3_1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                  unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2 || len > 256) return -1;
-    
-    if (tweak_len != 7 && tweak_len != 8 && tweak_len != 0) return -1;
-    
+int ff3_1_decrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                         unsigned int *out, const unsigned char *tweak) {
     unsigned int radix = ctx->radix;
-    
-    /* Compute split point - u should be the larger half for odd lengths */
-    unsigned int u = (len + 1) / 2;  /* Ceiling division */
-    unsigned int v = len - u;
+    unsigned int len = s->len, tweak_len = s->tweak_len;
+    unsigned int u = s->u, v = s->v;
     
     /* Working buffers */
     unsigned int A[256], B[256];
@@ -293,6 +306,8 @@ int ff3_1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         Tr[3] = tweak[6];
     }
     
+    FPE_STAT_TIMER(t);
+    
     /* 8 rounds in reverse */
     for (int i = FF3_1_ROUNDS - 1; i >= 0; i--) {
         /* Swap first (opposite of encryption) */
@@ -311,33 +326,23 @@ int ff3_1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         unsigned int other_len = len - m;
         
         /* Compute W */
-        unsigned int b = ceildiv((unsigned int)ceil(other_len * log2((double)radix)), 8);
-        if (b > 16) b = 16;
-        
         unsigned char W[16];
-        if (ff3_1_round_encrypt(ctx, T, (unsigned int)i, pB, other_len, radix, W, 16) != 0) {
+        if (ff3_1_round_encrypt(ctx, T, (unsigned int)i, pB, other_len, s->b[i & 1], radix, W, 16) != 0) {
             return -1;
         }
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
         /* Convert W to numeral - use full 16 bytes with REVERSED order */
         unsigned int y[256];
         bytes_to_num_rev(W, 16, y, m, radix);
+        FPE_STAT_LAP(ctx, convert_cycles, t);
         
         /* Compute c = (NUM(A) - y) mod radix^m
          * In reversed order, position 0 is least significant digit
          * So subtract from position 0 (low) to position m-1 (high)
          */
-        int borrow = 0;
-        for (unsigned int j = 0; j < m; j++) {
-            long long diff = (long long)pA[j] - y[j] - borrow;
-            if (diff < 0) {
-                diff += radix;
-                borrow = 1;
-            } else {
-                borrow = 0;
-            }
-            pA[j] = (unsigned int)diff;
-        }
+        num_sub_rev(pA, y, m, radix);
+        FPE_STAT_LAP(ctx, arith_cycles, t);
     }
     
     /* Concatenate A || B */
@@ -346,3 +351,308 @@ int ff3_1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
     
     return 0;
 }
+
+/**
+ * @brief FF3-1 Encryption
+ */
+int ff3_1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                  unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff3_shape s;
+    if (ff3_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff3_1_encrypt_shaped(ctx, &s, in, out, tweak);
+}
+
+/**
+ * @brief FF3-1 Decryption
+ */
+int ff3_1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                  unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff3_shape s;
+    if (ff3_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff3_1_decrypt_shaped(ctx, &s, in, out, tweak);
+}
+
+/* ========================================================================= */
+/*                          Pipelined Batch Kernel                           */
+/* ========================================================================= */
+
+/**
+ * @brief One record in flight through the FF3-1 Feistel network
+ */
+typedef struct {
+    unsigned int *out;                  /**< Where the finished record goes */
+    unsigned int round;                 /**< Rounds completed */
+    unsigned int *pA, *pB;              /**< Current halves, into half[] */
+    unsigned int half[2][128];          /**< A and B (u, v <= 128) */
+    unsigned char Tl[4], Tr[4];         /**< Tweak halves */
+    unsigned char block[FF3_1_BLOCK_SIZE];  /**< Pending cipher block */
+} ff3_1_pipe_rec;
+
+/*
+ * Interleaved forms of num_to_bytes_rev, bytes_to_num_rev, num_add_rev and
+ * num_sub_rev over n records with the same digit counts: the inner step
+ * loops over records, so their carry and remainder chains run side by
+ * side. With radix <= 65536 every intermediate fits 32 bits.
+ */
+
+static void pipe_num_to_bytes_rev(ff3_1_pipe_rec *const *r, unsigned int n,
+                                  unsigned int len, unsigned int radix, unsigned int b) {
+    for (unsigned int k = 0; k < n; k++) {
+        memset(r[k]->block + FF3_1_BLOCK_SIZE - b, 0, b);
+    }
+    for (int i = (int)len - 1; i >= 0; i--) {
+        uint32_t carry[FPE_PIPE_DEPTH];
+        for (unsigned int k = 0; k < n; k++) carry[k] = r[k]->pB[i];
+        for (int j = FF3_1_BLOCK_SIZE - 1; j >= FF3_1_BLOCK_SIZE - (int)b; j--) {
+            for (unsigned int k = 0; k < n; k++) {
+                uint32_t tmp = (uint32_t)r[k]->block[j] * radix + carry[k];
+                r[k]->block[j] = (unsigned char)tmp;
+                carry[k] = tmp >> 8;
+            }
+        }
+    }
+}
+
+static void pipe_bytes_to_num_rev(ff3_1_pipe_rec *const *r, unsigned int n,
+                                  unsigned int (*y)[128], unsigned int m, unsigned int radix) {
+    for (unsigned int i = 0; i < m; i++) {
+        uint32_t rem[FPE_PIPE_DEPTH] = {0};
+        for (unsigned int j = 0; j < FF3_1_BLOCK_SIZE; j++) {
+            for (unsigned int k = 0; k < n; k++) {
+                uint32_t tmp = (rem[k] << 8) | r[k]->block[j];
+                r[k]->block[j] = (unsigned char)(tmp / radix);
+                rem[k] = tmp % radix;
+            }
+        }
+        for (unsigned int k = 0; k < n; k++) y[k][i] = rem[k];
+    }
+}
+
+static void pipe_add_rev(ff3_1_pipe_rec *const *r, unsigned int n,
+                         unsigned int (*y)[128], unsigned int m, unsigned int radix) {
+    uint32_t carry[FPE_PIPE_DEPTH] = {0};
+    for (unsigned int j = 0; j < m; j++) {
+        for (unsigned int k = 0; k < n; k++) {
+            uint32_t sum = r[k]->pA[j] + y[k][j] + carry[k];
+            carry[k] = sum >= radix;
+            r[k]->pA[j] = carry[k] ? sum - radix : sum;
+        }
+    }
+}
+
+static void pipe_sub_rev(ff3_1_pipe_rec *const *r, unsigned int n,
+                         unsigned int (*y)[128], unsigned int m, unsigned int radix) {
+    uint32_t borrow[FPE_PIPE_DEPTH] = {0};
+    for (unsigned int j = 0; j < m; j++) {
+        for (unsigned int k = 0; k < n; k++) {
+            uint32_t sub = y[k][j] + borrow[k];
+            borrow[k] = r[k]->pA[j] < sub;
+            r[k]->pA[j] = r[k]->pA[j] + (borrow[k] ? radix : 0) - sub;
+        }
+    }
+}
+
+/**
+ * @brief Take record in into a free slot
+ * 
+ * @return 0 on success, -1 if a digit is out of range
+ */
+static int pipe_admit(ff3_1_pipe_rec *rec, const ff3_shape *s, unsigned int radix,
+                      const unsigned int *in, unsigned int *out, const unsigned char *tweak) {
+    for (unsigned int i = 0; i < s->len; i++) {
+        if (in[i] >= radix) return -1;
+    }
+    
+    rec->out = out;
+    rec->round = 0;
+    rec->pA = rec->half[0];
+    rec->pB = rec->half[1];
+    memcpy(rec->pA, in, s->u * sizeof(unsigned int));
+    memcpy(rec->pB, in + s->u, s->v * sizeof(unsigned int));
+    
+    /* Tweak halves exactly as in ff3_1_encrypt_shaped */
+    memset(rec->Tl, 0, 4);
+    memset(rec->Tr, 0, 4);
+    if (s->tweak_len >= 7) {
+        rec->Tl[0] = tweak[0];
+        rec->Tl[1] = tweak[1];
+        rec->Tl[2] = tweak[2];
+        rec->Tl[3] = tweak[3] & 0xF0;
+        rec->Tr[0] = tweak[3] & 0x0F;
+        rec->Tr[1] = tweak[4];
+        rec->Tr[2] = tweak[5];
+        rec->Tr[3] = tweak[6];
+    }
+    return 0;
+}
+
+/**
+ * @brief Advance n records whose round index has parity p to their next cipher block
+ */
+static void pipe_stage(ff3_1_pipe_rec *const *r, unsigned int n, const ff3_shape *s,
+                       unsigned int radix, unsigned int p, int encrypt) {
+    for (unsigned int k = 0; k < n; k++) {
+        ff3_1_pipe_rec *rec = r[k];
+        unsigned int i = encrypt ? rec->round : FF3_1_ROUNDS - 1 - rec->round;
+        
+        if (!encrypt) {
+            unsigned int *swap = rec->pA;
+            rec->pA = rec->pB;
+            rec->pB = swap;
+        }
+        
+        memset(rec->block, 0, FF3_1_BLOCK_SIZE - s->b[p]);
+        memcpy(rec->block, (i & 1) ? rec->Tl : rec->Tr, 4);
+        rec->block[3] ^= (unsigned char)i;
+    }
+    
+    /* B has len - m numerals, m = v in odd rounds and u in even ones */
+    pipe_num_to_bytes_rev(r, n, p ? s->u : s->v, radix, s->b[p]);
+    
+    for (unsigned int k = 0; k < n; k++) fpe_reverse_bytes(r[k]->block, FF3_1_BLOCK_SIZE);
+}
+
+/**
+ * @brief Finish the round of n records of parity p from their cipher output
+ */
+static void pipe_resume(ff3_1_pipe_rec *const *r, unsigned int n, const ff3_shape *s,
+                        unsigned int radix, unsigned int p, int encrypt) {
+    unsigned int y[FPE_PIPE_DEPTH][128];
+    unsigned int m = p ? s->v : s->u;
+    
+    for (unsigned int k = 0; k < n; k++) fpe_reverse_bytes(r[k]->block, FF3_1_BLOCK_SIZE);
+    pipe_bytes_to_num_rev(r, n, y, m, radix);
+    
+    if (encrypt) {
+        pipe_add_rev(r, n, y, m, radix);
+    } else {
+        pipe_sub_rev(r, n, y, m, radix);
+    }
+    
+    for (unsigned int k = 0; k < n; k++) {
+        if (encrypt) {
+            unsigned int *swap = r[k]->pA;
+            r[k]->pA = r[k]->pB;
+            r[k]->pB = swap;
+        }
+        r[k]->round++;
+        fpe_secure_zero(y[k], m * sizeof(unsigned int));
+    }
+}
+
+int ff3_1_crypt_pipelined(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                          unsigned int *out, size_t count, const unsigned char *tweaks,
+                          size_t tweak_stride, int encrypt) {
+    if (!ctx->cipher_ctx) return -1;
+    if (s->tweak_len > 0 && !tweaks) return -1;
+    
+    unsigned int radix = ctx->radix;
+    unsigned int len = s->len;
+    ff3_1_pipe_rec rec[FPE_PIPE_DEPTH];
+    ff3_1_pipe_rec *slot[FPE_PIPE_DEPTH];   /* Records in flight, slot[0..n) */
+    ff3_1_pipe_rec *group[2][FPE_PIPE_DEPTH];
+    unsigned char blocks[FPE_PIPE_DEPTH * FF3_1_BLOCK_SIZE];
+    unsigned int n = 0;
+    size_t next = 0, done = 0;
+    int ret = -1;
+    
+    for (; n < FPE_PIPE_DEPTH && next < count; n++, next++) {
+        slot[n] = &rec[n];
+        if (pipe_admit(slot[n], s, radix, in + next * len, out + next * len,
+                       s->tweak_len ? tweaks + next * tweak_stride : NULL) != 0) goto cleanup;
+    }
+    
+    FPE_STAT_TIMER(t);
+    
+    while (n > 0) {
+        /* Records at the same round parity share their digit counts */
+        unsigned int ng[2] = {0, 0};
+        for (unsigned int k = 0; k < n; k++) {
+            unsigned int i = encrypt ? slot[k]->round : FF3_1_ROUNDS - 1 - slot[k]->round;
+            group[i & 1][ng[i & 1]++] = slot[k];
+        }
+        
+        /* Issue: every pending block in one cipher call */
+        for (unsigned int p = 0; p < 2; p++) {
+            if (ng[p]) pipe_stage(group[p], ng[p], s, radix, p, encrypt);
+        }
+        for (unsigned int k = 0; k < n; k++) {
+            memcpy(blocks + k * FF3_1_BLOCK_SIZE, slot[k]->block, FF3_1_BLOCK_SIZE);
+        }
+        FPE_STAT_LAP(ctx, convert_cycles, t);
+        
+        int outlen = 0;
+        FPE_STAT_ADD(ctx, cipher_blocks, n);
+        if (!EVP_EncryptUpdate(ctx->cipher_ctx, blocks, &outlen, blocks,
+                               (int)(n * FF3_1_BLOCK_SIZE))) {
+            goto cleanup;
+        }
+        FPE_STAT_LAP(ctx, prf_cycles, t);
+        
+        /* Resume: each record's radix math up to its next round */
+        for (unsigned int k = 0; k < n; k++) {
+            memcpy(slot[k]->block, blocks + k * FF3_1_BLOCK_SIZE, FF3_1_BLOCK_SIZE);
+        }
+        for (unsigned int p = 0; p < 2; p++) {
+            if (ng[p]) pipe_resume(group[p], ng[p], s, radix, p, encrypt);
+        }
+        FPE_STAT_LAP(ctx, arith_cycles, t);
+        
+        /* Retire finished records; the next record takes the slot */
+        for (unsigned int k = 0; k < n;) {
+            ff3_1_pipe_rec *r = slot[k];
+            if (r->round < FF3_1_ROUNDS) {
+                k++;
+                continue;
+            }
+            memcpy(r->out, r->pA, s->u * sizeof(unsigned int));
+            memcpy(r->out + s->u, r->pB, s->v * sizeof(unsigned int));
+            done++;
+            
+            if (next < count) {
+                if (pipe_admit(r, s, radix, in + next * len, out + next * len,
+                               s->tweak_len ? tweaks + next * tweak_stride : NULL) != 0) {
+                    goto cleanup;
+                }
+                next++;
+                k++;
+            } else {
+                slot[k] = slot[--n];
+            }
+        }
+    }
+    ret = 0;
+    
+cleanup:
+    FPE_STAT_OPS(ctx, encrypt, done, (uint64_t)done * len, 0, ret);
+    fpe_secure_zero(rec, sizeof(rec));
+    fpe_secure_zero(blocks, sizeof(blocks));
+    return ret;
+}
+
+#ifdef FPE_BENCH_INTERNALS
+/* ========================================================================= */
+/*                       Microbenchmark Entry Points                         */
+/* ========================================================================= */
+
+#include "bench_internals.h"
+
+/**
+ * @brief Bytes of NUM(B) fed to the round function for n numerals (at most 12)
+ */
+static unsigned int ff3_num_bytes(unsigned int radix, unsigned int n) {
+    unsigned int b = ceildiv((unsigned int)ceil(n * log2((double)radix)), 8);
+    return (b > 12) ? 12 : b;
+}
+
+int fpe_bench_ff3_1_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
+                                  const unsigned int *B, unsigned int B_len,
+                                  unsigned int radix, unsigned char *W, unsigned int W_len) {
+    return ff3_1_round_encrypt(ctx, T, round, B, B_len, ff3_num_bytes(radix, B_len),
+                               radix, W, W_len);
+}
+#endif /* FPE_BENCH_INTERNALS */
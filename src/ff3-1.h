@@ -7,6 +7,31 @@
 #define FF3_1_H
 
 #include "fpe_internal.h"
+#include "ff3.h"  /* ff3_shape */
+
+/**
+ * @brief FF3-1 encryption over a shape from ff3_shape_init()
+ */
+int ff3_1_encrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                         unsigned int *out, const unsigned char *tweak);
+
+/**
+ * @brief FF3-1 decryption over a shape from ff3_shape_init()
+ */
+int ff3_1_decrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                         unsigned int *out, const unsigned char *tweak);
+
+/**
+ * @brief FF3-1 over count records of one shape, FPE_PIPE_DEPTH in flight
+ * 
+ * Record r is in + r * len, its result out + r * len and its tweak
+ * tweaks + r * tweak_stride. See pipeline.h.
+ * 
+ * @return 0 on success, -1 on error (e.g. a digit >= radix)
+ */
+int ff3_1_crypt_pipelined(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                          unsigned int *out, size_t count, const unsigned char *tweaks,
+                          size_t tweak_stride, int encrypt);
 
 /**
  * @brief FF3-1 encryption function
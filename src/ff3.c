@@ -8,6 +8,7 @@
 
 #include "ff3.h"
 #include "utils.h"
+#include "stats.h"
 #include <string.h>
 #include <math.h>
 #include <openssl/evp.h>
@@ -105,6 +106,61 @@ static void bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
     }
 }
 
+/**
+ * @brief a = (a + y) mod radix^m, digits least significant first
+ */
+static void num_add_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                        unsigned int radix) {
+    unsigned int carry = 0;
+    for (unsigned int j = 0; j < m; j++) {
+        unsigned long long sum = (unsigned long long)a[j] + y[j] + carry;
+        a[j] = (unsigned int)(sum % radix);
+        carry = (unsigned int)(sum / radix);
+    }
+}
+
+/**
+ * @brief a = (a - y) mod radix^m, digits least significant first
+ */
+static void num_sub_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                        unsigned int radix) {
+    int borrow = 0;
+    for (unsigned int j = 0; j < m; j++) {
+        long long diff = (long long)a[j] - y[j] - borrow;
+        if (diff < 0) {
+            diff += radix;
+            borrow = 1;
+        } else {
+            borrow = 0;
+        }
+        a[j] = (unsigned int)diff;
+    }
+}
+
+/**
+ * @brief Bytes of NUM(B) fed to the round function for n numerals (at most 12)
+ */
+static unsigned int ff3_num_bytes(unsigned int radix, unsigned int n) {
+    unsigned int b = ceildiv((unsigned int)ceil(n * log2((double)radix)), 8);
+    return (b > 12) ? 12 : b;
+}
+
+int ff3_shape_init(ff3_shape *s, unsigned int radix, unsigned int len,
+                   unsigned int tweak_len) {
+    if (len < 2 || len > 256) return -1;
+    
+    /* 64-bit (8 byte) or 56-bit (7 byte) tweak, or none */
+    if (tweak_len != 8 && tweak_len != 7 && tweak_len != 0) return -1;
+    
+    s->len = len;
+    s->tweak_len = tweak_len;
+    s->u = (len + 1) / 2;  /* u is the larger half for odd lengths */
+    s->v = len - s->u;
+    s->b[0] = ff3_num_bytes(radix, s->v);  /* Even rounds: B has v numerals */
+    s->b[1] = ff3_num_bytes(radix, s->u);
+    return 0;
+}
+
 /**
  * @brief FF3 Round Function using AES-ECB
  * 
@@ -112,7 +168,7 @@ static void bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
  * Simplified: W = CIPH(T XOR [i] || NUM(B))
  */
 static int ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
-                             const unsigned int *B, unsigned int B_len,
+                             const unsigned int *B, unsigned int B_len, unsigned int b,
                              unsigned int radix, unsigned char *W, unsigned int W_len) {
     if (!ctx->cipher_ctx) return -1;
     
@@ -127,9 +183,6 @@ static int ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int
     plaintext[3] ^= (unsigned char)round;
     
     /* Last bytes: NUM(B) in big-endian - use REVERSED order for FF3 */
-    unsigned int b = ceildiv((unsigned int)ceil(B_len * log2((double)radix)), 8);
-    if (b > 12) b = 12;  /* Maximum 12 bytes for B */
-    
     num_to_bytes_rev(B, B_len, radix, plaintext + (FF3_BLOCK_SIZE - b), b);
     
     /* Reverse bytes before encryption (FF3 spec requirement) */
@@ -139,6 +192,7 @@ static int ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int
     unsigned char ciphertext[FF3_BLOCK_SIZE];
     int outlen = 0;
     
+    FPE_STAT_ADD(ctx, cipher_blocks, 1);
     if (!EVP_EncryptUpdate(ctx->cipher_ctx, ciphertext, &outlen, plaintext, FF3_BLOCK_SIZE)) {
         return -1;
     }
@@ -153,21 +207,13 @@ static int ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int
 }
 
 /**
- * @brief FF3 Encryption
+ * @brief FF3 encryption over a shape from ff3_shape_init()
  */
-int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2 || len > 256) return -1;
-    
-    /* FF3 requires 64-bit (8 byte) or 56-bit (7 byte) tweak */
-    if (tweak_len != 8 && tweak_len != 7 && tweak_len != 0) return -1;
-    
+int ff3_encrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                       unsigned int *out, const unsigned char *tweak) {
     unsigned int radix = ctx->radix;
-    
-    /* Compute split point - u should be the larger half for odd lengths */
-    unsigned int u = (len + 1) / 2;  /* Ceiling division */
-    unsigned int v = len - u;
+    unsigned int len = s->len, tweak_len = s->tweak_len;
+    unsigned int u = s->u, v = s->v;
     
     /* Working buffers */
     unsigned int A[256], B[256];
@@ -191,6 +237,8 @@ int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         memcpy(Tr, tweak + 4, 3);
     }
     
+    FPE_STAT_TIMER(t);
+    
     /* 8 rounds */
     for (unsigned int i = 0; i < FF3_ROUNDS; i++) {
         /* Select tweak half based on round 
@@ -204,28 +252,23 @@ int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         unsigned int other_len = len - m;
         
         /* Compute W = Round_Encrypt(T, i, B) */
-        unsigned int b = ceildiv((unsigned int)ceil(other_len * log2((double)radix)), 8);
-        if (b > 16) b = 16;
-        
         unsigned char W[16];
-        if (ff3_round_encrypt(ctx, T, i, pB, other_len, radix, W, 16) != 0) {
+        if (ff3_round_encrypt(ctx, T, i, pB, other_len, s->b[i & 1], radix, W, 16) != 0) {
             return -1;
         }
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
         /* Convert W to numeral - USE FULL 16 BYTES with REVERSED order */
         unsigned int y[256];
         bytes_to_num_rev(W, 16, y, m, radix);
+        FPE_STAT_LAP(ctx, convert_cycles, t);
         
         /* Compute c = (NUM(A) + y) mod radix^m 
          * In reversed order, position 0 is least significant digit
          * So add from position 0 (low) to position m-1 (high)
          */
-        unsigned int carry = 0;
-        for (unsigned int j = 0; j < m; j++) {
-            unsigned long long sum = (unsigned long long)pA[j] + y[j] + carry;
-            pA[j] = (unsigned int)(sum % radix);
-            carry = (unsigned int)(sum / radix);
-        }
+        num_add_rev(pA, y, m, radix);
+        FPE_STAT_LAP(ctx, arith_cycles, t);
         
         /* Swap A and B after every round (including the last) */
         unsigned int *swap = pA;
@@ -241,20 +284,13 @@ int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
 }
 
 /**
- * @brief FF3 Decryption
+ * @brief FF3 decryption over a shape from ff3_shape_init()
  */
-int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
-                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !in || !out) return -1;
-    if (len < 2 || len > 256) return -1;
-    
-    if (tweak_len != 8 && tweak_len != 7 && tweak_len != 0) return -1;
-    
+int ff3_decrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                       unsigned int *out, const unsigned char *tweak) {
     unsigned int radix = ctx->radix;
-    
-    /* Compute split point - u should be the larger half for odd lengths */
-    unsigned int u = (len + 1) / 2;  /* Ceiling division */
-    unsigned int v = len - u;
+    unsigned int len = s->len, tweak_len = s->tweak_len;
+    unsigned int u = s->u, v = s->v;
     
     /* Working buffers */
     unsigned int A[256], B[256];
@@ -278,6 +314,8 @@ int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         memcpy(Tr, tweak + 4, 3);
     }
     
+    FPE_STAT_TIMER(t);
+    
     /* 8 rounds in reverse */
     for (int i = FF3_ROUNDS - 1; i >= 0; i--) {
         /* Swap first (opposite of encryption) */
@@ -296,33 +334,23 @@ int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
         unsigned int other_len = len - m;
         
         /* Compute W */
-        unsigned int b = ceildiv((unsigned int)ceil(other_len * log2((double)radix)), 8);
-        if (b > 16) b = 16;
-        
         unsigned char W[16];
-        if (ff3_round_encrypt(ctx, T, (unsigned int)i, pB, other_len, radix, W, 16) != 0) {
+        if (ff3_round_encrypt(ctx, T, (unsigned int)i, pB, other_len, s->b[i & 1], radix, W, 16) != 0) {
             return -1;
         }
+        FPE_STAT_LAP(ctx, prf_cycles, t);
         
         /* Convert W to numeral - USE FULL 16 BYTES with REVERSED order */
         unsigned int y[256];
         bytes_to_num_rev(W, 16, y, m, radix);
+        FPE_STAT_LAP(ctx, convert_cycles, t);
         
         /* Compute c = (NUM(A) - y) mod radix^m 
          * In reversed order, position 0 is least significant digit
          * So subtract from position 0 (low) to position m-1 (high)
          */
-        int borrow = 0;
-        for (unsigned int j = 0; j < m; j++) {
-            long long diff = (long long)pA[j] - y[j] - borrow;
-            if (diff < 0) {
-                diff += radix;
-                borrow = 1;
-            } else {
-                borrow = 0;
-            }
-            pA[j] = (unsigned int)diff;
-        }
+        num_sub_rev(pA, y, m, radix);
+        FPE_STAT_LAP(ctx, arith_cycles, t);
     }
     
     /* Concatenate A || B */
@@ -331,3 +359,72 @@ int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
     
     return 0;
 }
+
+/**
+ * @brief FF3 Encryption
+ */
+int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff3_shape s;
+    if (ff3_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff3_encrypt_shaped(ctx, &s, in, out, tweak);
+}
+
+/**
+ * @brief FF3 Decryption
+ */
+int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
+                unsigned int len, const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    ff3_shape s;
+    if (ff3_shape_init(&s, ctx->radix, len, tweak_len) != 0) return -1;
+    return ff3_decrypt_shaped(ctx, &s, in, out, tweak);
+}
+
+#ifdef FPE_BENCH_INTERNALS
+/* ========================================================================= */
+/*                       Microbenchmark Entry Points                         */
+/* ========================================================================= */
+
+#include "bench_internals.h"
+
+void fpe_bench_num_to_bytes(const unsigned int *x, unsigned int len, unsigned int radix,
+                            unsigned char *out, unsigned int out_len) {
+    num_to_bytes(x, len, radix, out, out_len);
+}
+
+void fpe_bench_bytes_to_num(const unsigned char *bytes, unsigned int byte_len,
+                            unsigned int *x, unsigned int len, unsigned int radix) {
+    bytes_to_num(bytes, byte_len, x, len, radix);
+}
+
+void fpe_bench_num_to_bytes_rev(const unsigned int *x, unsigned int len, unsigned int radix,
+                                unsigned char *out, unsigned int out_len) {
+    num_to_bytes_rev(x, len, radix, out, out_len);
+}
+
+void fpe_bench_bytes_to_num_rev(const unsigned char *bytes, unsigned int byte_len,
+                                unsigned int *x, unsigned int len, unsigned int radix) {
+    bytes_to_num_rev(bytes, byte_len, x, len, radix);
+}
+
+int fpe_bench_ff3_round_encrypt(FPE_CTX *ctx, const unsigned char *T, unsigned int round,
+                                const unsigned int *B, unsigned int B_len,
+                                unsigned int radix, unsigned char *W, unsigned int W_len) {
+    return ff3_round_encrypt(ctx, T, round, B, B_len, ff3_num_bytes(radix, B_len),
+                             radix, W, W_len);
+}
+
+void fpe_bench_num_add_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                           unsigned int radix) {
+    num_add_rev(a, y, m, radix);
+}
+
+void fpe_bench_num_sub_rev(unsigned int *a, const unsigned int *y, unsigned int m,
+                           unsigned int radix) {
+    num_sub_rev(a, y, m, radix);
+}
+#endif /* FPE_BENCH_INTERNALS */
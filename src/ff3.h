@@ -8,6 +8,37 @@
 
 #include "fpe_internal.h"
 
+/**
+ * @brief Per-(radix, len, tweak_len) parameters of the FF3 and FF3-1 kernels
+ * 
+ * Both modes accept the same shapes, so FF3-1 shares this type.
+ */
+typedef struct ff3_shape {
+    unsigned int len, tweak_len;
+    unsigned int u, v;          /**< Split: u = ceil(len/2) */
+    unsigned int b[2];          /**< Bytes of NUM(B) in even / odd rounds */
+} ff3_shape;
+
+/**
+ * @brief Validate a record shape and derive its kernel parameters
+ * 
+ * @return 0 on success, -1 if len is outside 2..256 or tweak_len not 0, 7 or 8
+ */
+int ff3_shape_init(ff3_shape *s, unsigned int radix, unsigned int len,
+                   unsigned int tweak_len);
+
+/**
+ * @brief FF3 encryption over a validated shape
+ */
+int ff3_encrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                       unsigned int *out, const unsigned char *tweak);
+
+/**
+ * @brief FF3 decryption over a validated shape
+ */
+int ff3_decrypt_shaped(FPE_CTX *ctx, const ff3_shape *s, const unsigned int *in,
+                       unsigned int *out, const unsigned char *tweak);
+
 /**
  * @brief FF3 encryption function
  */
@@ -5,6 +5,9 @@
 
 #include "fpe_internal.h"
 #include "utils.h"
+#include "bignum.h"
+#include "stats.h"
+#include "probes.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,6 +17,11 @@ extern int ff1_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
 extern int ff1_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
                        unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
 
+extern int ff1_encrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                             unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
+extern int ff1_decrypt_bytes(FPE_CTX *ctx, const unsigned char *in, unsigned char *out,
+                             unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
+
 extern int ff3_encrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
                        unsigned int len, const unsigned char *tweak, unsigned int tweak_len);
 extern int ff3_decrypt(FPE_CTX *ctx, const unsigned int *in, unsigned int *out,
@@ -40,12 +48,26 @@ FPE_CTX *FPE_CTX_new(void) {
 void FPE_CTX_free(FPE_CTX *ctx) {
     if (!ctx) return;
     
+    FPE_PROBE1(ctx__free, ctx);
+    
+#ifdef FPE_ENABLE_STATS
+    FPE_CTX_reset_stats(ctx);  /* Fold into the global aggregate */
+#endif
+    
     /* Clean up OpenSSL contexts */
     if (ctx->cipher_ctx) {
         EVP_CIPHER_CTX_free(ctx->cipher_ctx);
     }
     /* Note: CMAC context removed - FF1 now uses ECB like FF3/FF3-1 */
     
+    /* Scratch may hold intermediate Feistel state */
+    if (ctx->scratch) {
+        fpe_secure_zero(ctx->scratch, ctx->scratch_size);
+        free(ctx->scratch);
+    }
+    fpe_bn_powers_free(ctx->bn_powers);
+    free(ctx->alphabet);
+    
     /* Securely zero sensitive data */
     fpe_secure_zero(ctx->key, sizeof(ctx->key));
     fpe_secure_zero(&ctx->params, sizeof(ctx->params));
@@ -53,12 +75,12 @@ void FPE_CTX_free(FPE_CTX *ctx) {
     free(ctx);
 }
 
-int FPE_CTX_init(FPE_CTX *ctx,
-                 FPE_MODE mode,
-                 FPE_ALGO algo,
-                 const unsigned char *key,
-                 unsigned int bits,
-                 unsigned int radix) {
+/**
+ * @brief FPE_CTX_init without the tracepoint
+ */
+static int fpe_ctx_configure(FPE_CTX *ctx, FPE_MODE mode, FPE_ALGO algo,
+                             const unsigned char *key, unsigned int bits,
+                             unsigned int radix) {
     if (!ctx || !key) return -1;
     
     /* Validate parameters */
@@ -73,6 +95,10 @@ int FPE_CTX_init(FPE_CTX *ctx,
         return -1;
     }
     
+    /* Drop caches derived from a previous configuration */
+    fpe_bn_powers_free(ctx->bn_powers);
+    ctx->bn_powers = NULL;
+    
     /* Store configuration */
     ctx->mode = mode;
     ctx->algo = algo;
@@ -158,6 +184,17 @@ int FPE_CTX_init(FPE_CTX *ctx,
     return 0;
 }
 
+int FPE_CTX_init(FPE_CTX *ctx,
+                 FPE_MODE mode,
+                 FPE_ALGO algo,
+                 const unsigned char *key,
+                 unsigned int bits,
+                 unsigned int radix) {
+    int ret = fpe_ctx_configure(ctx, mode, algo, key, bits, radix);
+    FPE_PROBE6(ctx__init, ctx, mode, algo, bits, radix, ret);
+    return ret;
+}
+
 /* ========================================================================= */
 /*                         Unified Generic Interface                         */
 /* ========================================================================= */
@@ -167,20 +204,32 @@ int FPE_encrypt(FPE_CTX *ctx,
                 const unsigned char *tweak, unsigned int tweak_len) {
     if (!ctx || !in || !out) return -1;
     
-    /* Validate tweak */
-    if (fpe_validate_tweak(ctx->mode, tweak_len) != 0) return -1;
-    
-    /* Dispatch to algorithm-specific function */
-    switch (ctx->mode) {
-        case FPE_MODE_FF1:
-            return ff1_encrypt(ctx, in, out, len, tweak, tweak_len);
-        case FPE_MODE_FF3:
-            return ff3_encrypt(ctx, in, out, len, tweak, tweak_len);
-        case FPE_MODE_FF3_1:
-            return ff3_1_encrypt(ctx, in, out, len, tweak, tweak_len);
-        default:
-            return -1;
+    FPE_PROBE4(encrypt__entry, ctx, ctx->mode, len, ctx->radix);
+    
+    int ret = -1;
+    uint64_t t0 = ctx->latency ? fpe_ticks() : 0;
+    
+    /* Validate tweak, then dispatch to algorithm-specific function */
+    if (fpe_validate_tweak(ctx->mode, tweak_len) == 0) {
+        switch (ctx->mode) {
+            case FPE_MODE_FF1:
+                ret = ff1_encrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            case FPE_MODE_FF3:
+                ret = ff3_encrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            case FPE_MODE_FF3_1:
+                ret = ff3_1_encrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            default:
+                break;
+        }
     }
+    
+    FPE_STAT_OP(ctx, 1, len, 0, ret);
+    if (ctx->latency) fpe_latency_record(ctx->latency, fpe_ticks() - t0);
+    FPE_PROBE5(encrypt__return, ctx, ctx->mode, len, ctx->radix, ret);
+    return ret;
 }
 
 int FPE_decrypt(FPE_CTX *ctx,
@@ -188,106 +237,207 @@ int FPE_decrypt(FPE_CTX *ctx,
                 const unsigned char *tweak, unsigned int tweak_len) {
     if (!ctx || !in || !out) return -1;
     
-    /* Validate tweak */
-    if (fpe_validate_tweak(ctx->mode, tweak_len) != 0) return -1;
-    
-    /* Dispatch to algorithm-specific function */
-    switch (ctx->mode) {
-        case FPE_MODE_FF1:
-            return ff1_decrypt(ctx, in, out, len, tweak, tweak_len);
-        case FPE_MODE_FF3:
-            return ff3_decrypt(ctx, in, out, len, tweak, tweak_len);
-        case FPE_MODE_FF3_1:
-            return ff3_1_decrypt(ctx, in, out, len, tweak, tweak_len);
-        default:
-            return -1;
+    FPE_PROBE4(decrypt__entry, ctx, ctx->mode, len, ctx->radix);
+    
+    int ret = -1;
+    uint64_t t0 = ctx->latency ? fpe_ticks() : 0;
+    
+    /* Validate tweak, then dispatch to algorithm-specific function */
+    if (fpe_validate_tweak(ctx->mode, tweak_len) == 0) {
+        switch (ctx->mode) {
+            case FPE_MODE_FF1:
+                ret = ff1_decrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            case FPE_MODE_FF3:
+                ret = ff3_decrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            case FPE_MODE_FF3_1:
+                ret = ff3_1_decrypt(ctx, in, out, len, tweak, tweak_len);
+                break;
+            default:
+                break;
+        }
     }
+    
+    FPE_STAT_OP(ctx, 0, len, 0, ret);
+    if (ctx->latency) fpe_latency_record(ctx->latency, fpe_ticks() - t0);
+    FPE_PROBE5(decrypt__return, ctx, ctx->mode, len, ctx->radix, ret);
+    return ret;
 }
 
 /* ========================================================================= */
 /*                         String / Helper Interface                         */
 /* ========================================================================= */
 
-int FPE_encrypt_str(FPE_CTX *ctx, const char *alphabet,
-                    const char *in, char *out,
-                    const unsigned char *tweak, unsigned int tweak_len) {
+/* Strings up to this length convert through stack buffers */
+#define FPE_STR_STACK_LEN 256
+
+const fpe_alphabet *fpe_ctx_alphabet(FPE_CTX *ctx, const char *alphabet) {
+    if (ctx->alphabet && strcmp(ctx->alphabet->source, alphabet) == 0) {
+        FPE_STAT_ADD(ctx, cache_hits, 1);
+        return ctx->alphabet;
+    }
+    FPE_STAT_ADD(ctx, cache_misses, 1);
+    
+    if (!ctx->alphabet) {
+        ctx->alphabet = (fpe_alphabet *)malloc(sizeof(fpe_alphabet));
+        if (!ctx->alphabet) return NULL;
+    }
+    
+    if (fpe_alphabet_compile(ctx->alphabet, alphabet) == 0) {
+        ctx->alphabet->source[0] = '\0';  /* Never matches a later lookup */
+        return NULL;
+    }
+    return ctx->alphabet;
+}
+
+/**
+ * @brief Shared driver for FPE_encrypt_str / FPE_decrypt_str
+ */
+static int fpe_str_crypt(FPE_CTX *ctx, const char *alphabet,
+                         const char *in, char *out,
+                         const unsigned char *tweak, unsigned int tweak_len,
+                         int encrypt) {
     if (!ctx || !alphabet || !in || !out) return -1;
     
     /* Validate alphabet and check radix matches */
-    unsigned int radix = fpe_validate_alphabet(alphabet);
-    if (radix == 0 || radix != ctx->radix) return -1;
-    
+    const fpe_alphabet *a = fpe_ctx_alphabet(ctx, alphabet);
     unsigned int len = (unsigned int)strlen(in);
-    if (len == 0) return -1;
-    
-    /* Allocate temporary arrays */
-    unsigned int *in_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
-    unsigned int *out_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
-    if (!in_arr || !out_arr) {
-        free(in_arr);
-        free(out_arr);
+    if (!a || a->radix != ctx->radix || len == 0) {
+        FPE_STAT_ADD(ctx, rejected, 1);
         return -1;
     }
     
-    /* Convert string to array */
-    if (fpe_str_to_array(alphabet, in, in_arr, len) != 0) {
-        free(in_arr);
-        free(out_arr);
-        return -1;
+    /* Short strings avoid the heap entirely */
+    unsigned int in_buf[FPE_STR_STACK_LEN], out_buf[FPE_STR_STACK_LEN];
+    unsigned int *in_arr = in_buf, *out_arr = out_buf;
+    if (len > FPE_STR_STACK_LEN) {
+        in_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
+        out_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
+        if (!in_arr || !out_arr) {
+            free(in_arr);
+            free(out_arr);
+            return -1;
+        }
     }
     
-    /* Encrypt */
-    int ret = FPE_encrypt(ctx, in_arr, out_arr, len, tweak, tweak_len);
+    /* Convert string to array, rejecting characters outside the alphabet */
+    FPE_STAT_TIMER(t);
+    int ret = fpe_alphabet_map(a, in, in_arr, len);
+    FPE_STAT_LAP(ctx, convert_cycles, t);
+    
+    if (ret == 0) {
+        ret = encrypt
+            ? FPE_encrypt(ctx, in_arr, out_arr, len, tweak, tweak_len)
+            : FPE_decrypt(ctx, in_arr, out_arr, len, tweak, tweak_len);
+    } else {
+        FPE_STAT_ADD(ctx, rejected, 1);
+    }
     
     if (ret == 0) {
         /* Convert array back to string */
-        ret = fpe_array_to_str(alphabet, out_arr, out, len);
+        FPE_STAT_TIMER(t2);
+        ret = fpe_alphabet_unmap(a, out_arr, out, len);
+        FPE_STAT_LAP(ctx, convert_cycles, t2);
+        if (ret == 0) {
+            out[len] = '\0';
+            FPE_STAT_ADD(ctx, bytes, len);
+        }
     }
     
-    free(in_arr);
-    free(out_arr);
+    if (in_arr != in_buf) {
+        free(in_arr);
+        free(out_arr);
+    }
     return ret;
 }
 
+int FPE_encrypt_str(FPE_CTX *ctx, const char *alphabet,
+                    const char *in, char *out,
+                    const unsigned char *tweak, unsigned int tweak_len) {
+    return fpe_str_crypt(ctx, alphabet, in, out, tweak, tweak_len, 1);
+}
+
 int FPE_decrypt_str(FPE_CTX *ctx, const char *alphabet,
                     const char *in, char *out,
                     const unsigned char *tweak, unsigned int tweak_len) {
-    if (!ctx || !alphabet || !in || !out) return -1;
+    return fpe_str_crypt(ctx, alphabet, in, out, tweak, tweak_len, 0);
+}
+
+/* ========================================================================= */
+/*                          Byte-String Interface                            */
+/* ========================================================================= */
+
+/**
+ * @brief Radix-256 fallback for FF3/FF3-1 through the numeral array API
+ */
+static int fpe_bytes_crypt_generic(FPE_CTX *ctx, const unsigned char *in,
+                                   unsigned char *out, unsigned int len,
+                                   const unsigned char *tweak, unsigned int tweak_len,
+                                   int encrypt) {
+    unsigned int digits[256];
+    if (len > 256) {  /* FF3/FF3-1 practical limit */
+        FPE_STAT_ADD(ctx, rejected, 1);
+        return -1;
+    }
     
-    /* Validate alphabet and check radix matches */
-    unsigned int radix = fpe_validate_alphabet(alphabet);
-    if (radix == 0 || radix != ctx->radix) return -1;
+    for (unsigned int i = 0; i < len; i++) {
+        digits[i] = in[i];
+    }
     
-    unsigned int len = (unsigned int)strlen(in);
-    if (len == 0) return -1;
+    int ret = encrypt ? FPE_encrypt(ctx, digits, digits, len, tweak, tweak_len)
+                      : FPE_decrypt(ctx, digits, digits, len, tweak, tweak_len);
     
-    /* Allocate temporary arrays */
-    unsigned int *in_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
-    unsigned int *out_arr = (unsigned int *)malloc(len * sizeof(unsigned int));
-    if (!in_arr || !out_arr) {
-        free(in_arr);
-        free(out_arr);
-        return -1;
+    if (ret == 0) {
+        for (unsigned int i = 0; i < len; i++) {
+            out[i] = (unsigned char)digits[i];
+        }
+        FPE_STAT_ADD(ctx, bytes, len);
     }
     
-    /* Convert string to array */
-    if (fpe_str_to_array(alphabet, in, in_arr, len) != 0) {
-        free(in_arr);
-        free(out_arr);
+    fpe_secure_zero(digits, sizeof(digits));
+    return ret;
+}
+
+int FPE_encrypt_bytes(FPE_CTX *ctx,
+                      const unsigned char *in, unsigned char *out, unsigned int len,
+                      const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    /* Validate radix and tweak */
+    if (ctx->radix != 256 || fpe_validate_tweak(ctx->mode, tweak_len) != 0) {
+        FPE_STAT_ADD(ctx, rejected, 1);
         return -1;
     }
     
-    /* Decrypt */
-    int ret = FPE_decrypt(ctx, in_arr, out_arr, len, tweak, tweak_len);
+    /* FF1 has a dedicated kernel: radix-256 digits are already NUM bytes */
+    if (ctx->mode == FPE_MODE_FF1) {
+        int ret = ff1_encrypt_bytes(ctx, in, out, len, tweak, tweak_len);
+        FPE_STAT_OP(ctx, 1, len, len, ret);
+        return ret;
+    }
     
-    if (ret == 0) {
-        /* Convert array back to string */
-        ret = fpe_array_to_str(alphabet, out_arr, out, len);
+    return fpe_bytes_crypt_generic(ctx, in, out, len, tweak, tweak_len, 1);
+}
+
+int FPE_decrypt_bytes(FPE_CTX *ctx,
+                      const unsigned char *in, unsigned char *out, unsigned int len,
+                      const unsigned char *tweak, unsigned int tweak_len) {
+    if (!ctx || !in || !out) return -1;
+    
+    /* Validate radix and tweak */
+    if (ctx->radix != 256 || fpe_validate_tweak(ctx->mode, tweak_len) != 0) {
+        FPE_STAT_ADD(ctx, rejected, 1);
+        return -1;
     }
     
-    free(in_arr);
-    free(out_arr);
-    return ret;
+    if (ctx->mode == FPE_MODE_FF1) {
+        int ret = ff1_decrypt_bytes(ctx, in, out, len, tweak, tweak_len);
+        FPE_STAT_OP(ctx, 0, len, len, ret);
+        return ret;
+    }
+    
+    return fpe_bytes_crypt_generic(ctx, in, out, len, tweak, tweak_len, 0);
 }
 
 /* ========================================================================= */
@@ -376,6 +526,33 @@ int FPE_decrypt_str_oneshot(FPE_MODE mode, FPE_ALGO algo,
 /*                          Internal Helper Functions                        */
 /* ========================================================================= */
 
+void *fpe_ctx_scratch(FPE_CTX *ctx, size_t size) {
+    if (!ctx) return NULL;
+    if (size <= ctx->scratch_size) return ctx->scratch;
+    
+    /* Grow geometrically; never realloc so old contents can be wiped */
+    size_t new_size = ctx->scratch_size ? ctx->scratch_size : 1024;
+    while (new_size < size) {
+        if (new_size > ((size_t)-1) / 2) {
+            new_size = size;
+            break;
+        }
+        new_size *= 2;
+    }
+    
+    unsigned char *mem = (unsigned char *)malloc(new_size);
+    if (!mem) return NULL;
+    
+    if (ctx->scratch) {
+        fpe_secure_zero(ctx->scratch, ctx->scratch_size);
+        free(ctx->scratch);
+    }
+    
+    ctx->scratch = mem;
+    ctx->scratch_size = new_size;
+    return mem;
+}
+
 void fpe_reverse_key(const unsigned char *key, unsigned char *reversed, unsigned int len) {
     for (unsigned int i = 0; i < len; i++) {
         reversed[i] = key[len - 1 - i];
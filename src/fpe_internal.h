@@ -33,6 +33,17 @@ struct fpe_ctx_st {
     /* OpenSSL cipher context - all modes use ECB */
     EVP_CIPHER_CTX *cipher_ctx;  /**< For ECB operations (FF1/FF3/FF3-1) */
     
+    /* Scratch arena for inputs that do not fit the fixed stack buffers */
+    unsigned char *scratch;      /**< Grown on demand, zeroed on free */
+    size_t scratch_size;         /**< Allocated size of scratch in bytes */
+    struct fpe_bn_powers *bn_powers;  /**< Radix power table (long FF1 inputs) */
+    struct fpe_alphabet *alphabet;    /**< Last alphabet used by the string API */
+    FPE_LATENCY *latency;        /**< Attached latency histogram, or NULL */
+
+#ifdef FPE_ENABLE_STATS
+    FPE_STATS stats;             /**< Operation counters (see stats.h) */
+#endif
+
     /* Algorithm-specific data */
     union {
         struct {
@@ -72,6 +83,35 @@ int fpe_init_sm4_context(FPE_CTX *ctx);
  */
 void fpe_reverse_key(const unsigned char *key, unsigned char *reversed, unsigned int len);
 
+/**
+ * @brief Get at least size bytes of per-context scratch memory
+ * 
+ * The arena is owned by the context and reused across calls, so the
+ * returned pointer is only valid until the next call on the same context.
+ * 
+ * @return Pointer to scratch memory, or NULL on allocation failure
+ */
+void *fpe_ctx_scratch(FPE_CTX *ctx, size_t size);
+
+/**
+ * @brief Compiled form of alphabet, cached on the context
+ * 
+ * Recompiles only when the alphabet differs from the previous call.
+ * 
+ * @return The compiled alphabet, or NULL if alphabet is invalid
+ */
+const struct fpe_alphabet *fpe_ctx_alphabet(FPE_CTX *ctx, const char *alphabet);
+
+/**
+ * @brief Check one FPE_*_iov field without modifying it
+ * 
+ * Covers the tweak, the mode's length limits and, unless a is NULL (the
+ * caller has already checked the characters), every character against a.
+ * 
+ * @return 0 if the field is valid for ctx, -1 otherwise
+ */
+int fpe_iov_check(FPE_CTX *ctx, const struct fpe_alphabet *a, const FPE_IOV *f);
+
 /**
  * @brief Securely zero memory
  */
@@ -0,0 +1,210 @@
+/**
+ * @file iov.c
+ * @brief Scatter/gather encryption of fields in place inside larger buffers
+ *
+ * Fields are validated up front so a failing call leaves every field
+ * untouched. FF1 fields short enough for the lane kernel are taken in
+ * windows, sorted by (len, tweak_len), and run FPE_LANES at a time;
+ * everything else goes through FPE_encrypt one field at a time.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include "ff1.h"
+#include "ff3.h"
+#include "lanes.h"
+#include "stats.h"
+#include "probes.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Fields considered together when forming lane groups */
+#define IOV_WINDOW 64
+
+/* Longest field taken by the lane path (fixes the stack buffer size) */
+#define IOV_LANE_MAX_LEN 128
+
+/* Longer single fields map through the heap */
+#define IOV_STACK_LEN 256
+
+/* ========================================================================= */
+/*                                 Helpers                                   */
+/* ========================================================================= */
+
+int fpe_iov_check(FPE_CTX *ctx, const fpe_alphabet *a, const FPE_IOV *f) {
+    if (!f->base || f->len < 2) return -1;
+    if (f->tweak_len > 0 && !f->tweak) return -1;
+    if (fpe_validate_tweak(ctx->mode, f->tweak_len) != 0) return -1;
+
+    /* Mode limits (e.g. FF3/FF3-1 len <= 256) fail here, not mid-call */
+    ff1_shape s1;
+    ff3_shape s3;
+    switch (ctx->mode) {
+        case FPE_MODE_FF1:
+            if (ff1_shape_init(&s1, ctx->radix, f->len, f->tweak_len) != 0) return -1;
+            break;
+        case FPE_MODE_FF3:
+        case FPE_MODE_FF3_1:
+            if (ff3_shape_init(&s3, ctx->radix, f->len, f->tweak_len) != 0) return -1;
+            break;
+        default:
+            return -1;
+    }
+
+    if (!a) return 0;
+
+    /* Map in chunks only to validate the characters */
+    unsigned int tmp[64];
+    for (unsigned int off = 0; off < f->len; off += 64) {
+        unsigned int n = f->len - off < 64 ? f->len - off : 64;
+        if (fpe_alphabet_map(a, f->base + off, tmp, n) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encrypt or decrypt one field through FPE_encrypt/FPE_decrypt
+ */
+static int iov_crypt_one(FPE_CTX *ctx, const fpe_alphabet *a, const FPE_IOV *f, int encrypt) {
+    unsigned int buf[IOV_STACK_LEN];
+    unsigned int *digits = buf;
+    if (f->len > IOV_STACK_LEN) {
+        digits = (unsigned int *)malloc(f->len * sizeof(unsigned int));
+        if (!digits) return -1;
+    }
+
+    int ret = fpe_alphabet_map(a, f->base, digits, f->len);
+    if (ret == 0) {
+        ret = encrypt
+            ? FPE_encrypt(ctx, digits, digits, f->len, f->tweak, f->tweak_len)
+            : FPE_decrypt(ctx, digits, digits, f->len, f->tweak, f->tweak_len);
+    }
+    if (ret == 0) ret = fpe_alphabet_unmap(a, digits, f->base, f->len);
+    if (ret == 0) FPE_STAT_ADD(ctx, bytes, f->len);
+
+    fpe_secure_zero(digits, f->len * sizeof(unsigned int));
+    if (digits != buf) free(digits);
+    return ret;
+}
+
+/**
+ * @brief Run nl fields of equal len and tweak_len through the FF1 lane kernel
+ */
+static int iov_crypt_lanes(FPE_CTX *ctx, const fpe_alphabet *a, const FPE_IOV *iov,
+                           const size_t *idx, unsigned int nl, int encrypt) {
+    unsigned int digits[FPE_LANES * IOV_LANE_MAX_LEN];
+    unsigned int *rows[FPE_LANES];
+    const unsigned char *tweaks[FPE_LANES];
+    unsigned int len = iov[idx[0]].len;
+    unsigned int tweak_len = iov[idx[0]].tweak_len;
+    int ret = 0;
+
+    for (unsigned int l = 0; l < nl && ret == 0; l++) {
+        const FPE_IOV *f = &iov[idx[l]];
+        rows[l] = digits + l * len;
+        tweaks[l] = f->tweak;
+        ret = fpe_alphabet_map(a, f->base, rows[l], len);
+    }
+
+    if (ret == 0) {
+        const unsigned int *const *in_rows = (const unsigned int *const *)rows;
+        ret = encrypt
+            ? ff1_encrypt_lanes(ctx, in_rows, rows, nl, len, tweaks, tweak_len)
+            : ff1_decrypt_lanes(ctx, in_rows, rows, nl, len, tweaks, tweak_len);
+    }
+
+    for (unsigned int l = 0; l < nl && ret == 0; l++) {
+        ret = fpe_alphabet_unmap(a, rows[l], iov[idx[l]].base, len);
+    }
+    if (ret == 0) FPE_STAT_ADD(ctx, bytes, (uint64_t)nl * len);
+
+    fpe_secure_zero(digits, (size_t)nl * len * sizeof(unsigned int));
+    return ret;
+}
+
+/* ========================================================================= */
+/*                                 Driver                                    */
+/* ========================================================================= */
+
+/**
+ * @brief Shared driver for FPE_encrypt_iov / FPE_decrypt_iov
+ */
+static int iov_crypt(FPE_CTX *ctx, const char *alphabet, const FPE_IOV *iov,
+                     size_t count, int encrypt) {
+    if (!ctx || !alphabet) return -1;
+    if (count == 0) return 0;
+    if (!iov) return -1;
+
+    const fpe_alphabet *a = fpe_ctx_alphabet(ctx, alphabet);
+    if (!a || a->radix != ctx->radix) {
+        FPE_STAT_ADD(ctx, rejected, 1);
+        return -1;
+    }
+
+    /* All or nothing: reject before any field is rewritten */
+    for (size_t i = 0; i < count; i++) {
+        if (fpe_iov_check(ctx, a, &iov[i]) != 0) {
+            FPE_STAT_ADD(ctx, rejected, 1);
+            return -1;
+        }
+    }
+
+    for (size_t w = 0; w < count; w += IOV_WINDOW) {
+        size_t nw = (count - w < IOV_WINDOW) ? count - w : IOV_WINDOW;
+        size_t idx[IOV_WINDOW];
+        size_t n = 0;
+
+        /* Lane candidates are sorted by (len, tweak_len); the rest run now */
+        for (size_t i = w; i < w + nw; i++) {
+            const FPE_IOV *f = &iov[i];
+            if (ctx->mode != FPE_MODE_FF1 || f->len > IOV_LANE_MAX_LEN ||
+                !ff1_lanes_supported(ctx->radix, f->len)) {
+                if (iov_crypt_one(ctx, a, f, encrypt) != 0) return -1;
+                continue;
+            }
+
+            size_t k = n++;
+            for (; k > 0; k--) {
+                const FPE_IOV *g = &iov[idx[k - 1]];
+                if (g->len < f->len || (g->len == f->len && g->tweak_len <= f->tweak_len)) break;
+                idx[k] = idx[k - 1];
+            }
+            idx[k] = i;
+        }
+
+        /* Walk runs of equal shape */
+        for (size_t r = 0; r < n;) {
+            const FPE_IOV *f = &iov[idx[r]];
+            size_t end = r + 1;
+            while (end < n && iov[idx[end]].len == f->len &&
+                   iov[idx[end]].tweak_len == f->tweak_len) {
+                end++;
+            }
+
+            while (end - r >= FPE_LANES_MIN) {
+                unsigned int nl = (end - r < FPE_LANES) ? (unsigned int)(end - r) : FPE_LANES;
+                if (iov_crypt_lanes(ctx, a, iov, idx + r, nl, encrypt) != 0) return -1;
+                r += nl;
+            }
+            for (; r < end; r++) {
+                if (iov_crypt_one(ctx, a, &iov[idx[r]], encrypt) != 0) return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int FPE_encrypt_iov(FPE_CTX *ctx, const char *alphabet, const FPE_IOV *iov, size_t count) {
+    FPE_PROBE3(iov__start, ctx, 1, count);
+    int ret = iov_crypt(ctx, alphabet, iov, count, 1);
+    FPE_PROBE4(iov__end, ctx, 1, count, ret);
+    return ret;
+}
+
+int FPE_decrypt_iov(FPE_CTX *ctx, const char *alphabet, const FPE_IOV *iov, size_t count) {
+    FPE_PROBE3(iov__start, ctx, 0, count);
+    int ret = iov_crypt(ctx, alphabet, iov, count, 0);
+    FPE_PROBE4(iov__end, ctx, 0, count, ret);
+    return ret;
+}
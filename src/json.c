@@ -0,0 +1,518 @@
+/**
+ * @file json.c
+ * @brief Streaming in-place tokenization of selected JSON values
+ *
+ * The scanner walks the buffer once with an explicit container stack and
+ * tracks, per container, the set of key paths that can still match below
+ * it. Containers no path can reach are skipped with an SSE2 scan for
+ * quotes and brackets, and string bodies are skipped with an SSE2 scan
+ * for '"' and '\'. A first pass checks every selected value without
+ * writing, so a bad value or malformed structure anywhere leaves the buffer
+ * untouched. The second pass queues selected string values as FPE_IOV
+ * fields and encrypts them in windows through FPE_encrypt_iov, so
+ * equal-length values share lane groups; selected integers are encrypted
+ * on the spot. Values keep their length, so the document is never
+ * re-serialized.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* String values queued per FPE_encrypt_iov call */
+#define JSON_WINDOW 64
+
+/* Longest integer value, in digits */
+#define JSON_NUMBER_MAX 256
+
+/* Returned by the scanning helpers on malformed input */
+#define JSON_ERR ((size_t)-1)
+
+typedef struct {
+    unsigned short off;  /**< Segment start in text */
+    unsigned short len;  /**< Segment length */
+} json_seg;
+
+typedef struct {
+    unsigned int nseg;
+    json_seg seg[FPE_JSON_MAX_DEPTH];
+    char text[FPE_JSON_MAX_PATH_LEN + 1];
+} json_path;
+
+struct fpe_json_st {
+    unsigned int npaths;
+    uint64_t all;                        /**< One bit per path */
+    json_path path[FPE_JSON_MAX_PATHS];
+    char alphabet[257];
+};
+
+/**
+ * @brief One open object or array
+ */
+typedef struct {
+    uint64_t mask;           /**< Paths that can still match below */
+    unsigned char seg;       /**< Path segment matched by keys of objects here */
+    unsigned char array;     /**< 1 for an array */
+    unsigned char selected;  /**< Array whose scalar elements are selected */
+} json_level;
+
+typedef struct {
+    FPE_CTX *ctx;
+    const FPE_JSON *json;
+    const unsigned char *tweak;
+    unsigned int tweak_len;
+    int encrypt;
+    int check;               /**< First pass: check values, write nothing */
+    const fpe_alphabet *a;   /**< Compiled on the first string checked */
+    int count;               /**< Values encrypted so far */
+    size_t npending;
+    FPE_IOV pending[JSON_WINDOW];
+} json_scan;
+
+/* ========================================================================= */
+/*                              Path Compilation                             */
+/* ========================================================================= */
+
+static int json_compile_path(json_path *p, const char *text) {
+    size_t len = strlen(text);
+    if (len == 0 || len > FPE_JSON_MAX_PATH_LEN) return -1;
+    memcpy(p->text, text, len + 1);
+
+    size_t start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i < len && text[i] != '.') continue;
+        if (i == start || p->nseg == FPE_JSON_MAX_DEPTH) return -1;  /* Empty segment */
+        p->seg[p->nseg].off = (unsigned short)start;
+        p->seg[p->nseg].len = (unsigned short)(i - start);
+        p->nseg++;
+        start = i + 1;
+    }
+    return 0;
+}
+
+FPE_JSON *FPE_JSON_new(const char *const *paths, size_t npaths, const char *alphabet) {
+    if (!paths || npaths == 0 || npaths > FPE_JSON_MAX_PATHS || !alphabet) return NULL;
+    if (fpe_validate_alphabet(alphabet) == 0) return NULL;
+
+    /* Encrypted strings must not be able to end the string or escape */
+    for (const unsigned char *c = (const unsigned char *)alphabet; *c; c++) {
+        if (*c == '"' || *c == '\\' || *c < 0x20) return NULL;
+    }
+
+    FPE_JSON *json = (FPE_JSON *)calloc(1, sizeof(FPE_JSON));
+    if (!json) return NULL;
+
+    for (size_t i = 0; i < npaths; i++) {
+        if (!paths[i] || json_compile_path(&json->path[i], paths[i]) != 0) {
+            free(json);
+            return NULL;
+        }
+        json->all |= (uint64_t)1 << i;
+    }
+    json->npaths = (unsigned int)npaths;
+    strcpy(json->alphabet, alphabet);
+    return json;
+}
+
+void FPE_JSON_free(FPE_JSON *json) {
+    free(json);
+}
+
+/* ========================================================================= */
+/*                            Structural Scanning                            */
+/* ========================================================================= */
+
+/**
+ * @brief Offset of the next '"' or '\' at or after i, or n
+ */
+static size_t json_find_quote(const char *b, size_t i, size_t n) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned int m = (unsigned int)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)));
+        if (m) return i + (unsigned int)__builtin_ctz(m);
+    }
+#endif
+    for (; i < n; i++) {
+        if (b[i] == '"' || b[i] == '\\') return i;
+    }
+    return n;
+}
+
+/**
+ * @brief Offset of the quote closing a string whose body starts at i
+ */
+static size_t json_string_end(const char *b, size_t i, size_t n) {
+    for (;;) {
+        i = json_find_quote(b, i, n);
+        if (i >= n) return JSON_ERR;
+        if (b[i] == '"') return i;
+        i += 2;  /* Skip the escaped character */
+    }
+}
+
+/**
+ * @brief Skip an object or array whose body starts at i
+ *
+ * Only quotes and brackets are looked at. '[' and ']' become '{' and '}'
+ * when 0x20 is ORed in, so three byte compares classify 16 bytes.
+ *
+ * @return Offset just past the matching close bracket, or JSON_ERR
+ */
+static size_t json_skip_container(const char *b, size_t i, size_t n) {
+    unsigned int depth = 1;
+
+    while (i < n) {
+#if defined(__SSE2__)
+        if (i + 16 <= n) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(b + i));
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            unsigned int m = (unsigned int)_mm_movemask_epi8(_mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+                             _mm_cmpeq_epi8(lower, _mm_set1_epi8('}')))));
+            size_t next = i + 16;
+
+            while (m) {
+                size_t p = i + (unsigned int)__builtin_ctz(m);
+                m &= m - 1;
+                if (b[p] == '"') {
+                    /* Restart the block scan after the string */
+                    size_t e = json_string_end(b, p + 1, n);
+                    if (e == JSON_ERR) return JSON_ERR;
+                    next = e + 1;
+                    break;
+                }
+                if (b[p] == '{' || b[p] == '[') {
+                    depth++;
+                } else if (--depth == 0) {
+                    return p + 1;
+                }
+            }
+            i = next;
+            continue;
+        }
+#endif
+        char c = b[i++];
+        if (c == '"') {
+            size_t e = json_string_end(b, i, n);
+            if (e == JSON_ERR) return JSON_ERR;
+            i = e + 1;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return i;
+        }
+    }
+    return JSON_ERR;
+}
+
+static size_t json_skip_ws(const char *b, size_t i, size_t n) {
+    while (i < n && (b[i] == ' ' || b[i] == '\n' || b[i] == '\r' || b[i] == '\t')) i++;
+    return i;
+}
+
+/**
+ * @brief Paths in mask whose segment seg equals the key key[0..len)
+ */
+static uint64_t json_match_key(const FPE_JSON *json, uint64_t mask, unsigned int seg,
+                               const char *key, size_t len) {
+    uint64_t hit = 0;
+    for (unsigned int p = 0; p < json->npaths; p++) {
+        if (!(mask >> p & 1)) continue;
+        const json_seg *s = &json->path[p].seg[seg];
+        if (s->len == len && memcmp(json->path[p].text + s->off, key, len) == 0) {
+            hit |= (uint64_t)1 << p;
+        }
+    }
+    return hit;
+}
+
+/* ========================================================================= */
+/*                              Value Rewriting                              */
+/* ========================================================================= */
+
+static int json_flush(json_scan *s) {
+    if (s->npending == 0) return 0;
+    int ret = s->encrypt
+        ? FPE_encrypt_iov(s->ctx, s->json->alphabet, s->pending, s->npending)
+        : FPE_decrypt_iov(s->ctx, s->json->alphabet, s->pending, s->npending);
+    s->npending = 0;
+    return ret;
+}
+
+/**
+ * @brief Check a selected value as an FPE_IOV field; a is NULL for integers
+ */
+static int json_check_field(json_scan *s, const fpe_alphabet *a,
+                            char *base, size_t len) {
+    FPE_IOV f;
+    f.base = base;
+    f.len = (unsigned int)len;
+    f.tweak = s->tweak;
+    f.tweak_len = s->tweak_len;
+    return fpe_iov_check(s->ctx, a, &f);
+}
+
+static int json_queue_string(json_scan *s, char *base, size_t len) {
+    if (len > 0xFFFFFFFFu) return -1;
+
+    if (s->check) {
+        if (!s->a) {
+            s->a = fpe_ctx_alphabet(s->ctx, s->json->alphabet);
+            if (!s->a || s->a->radix != s->ctx->radix) return -1;
+        }
+        return json_check_field(s, s->a, base, len);
+    }
+
+    FPE_IOV *f = &s->pending[s->npending++];
+    f->base = base;
+    f->len = (unsigned int)len;
+    f->tweak = s->tweak;
+    f->tweak_len = s->tweak_len;
+    s->count++;
+
+    return (s->npending == JSON_WINDOW) ? json_flush(s) : 0;
+}
+
+/**
+ * @brief Encrypt the digits of a JSON integer in place
+ *
+ * JSON forbids leading zeros, so the result is cycle-walked until its
+ * first digit is nonzero. The input has a nonzero first digit too, which
+ * makes decryption the same walk with FPE_decrypt.
+ */
+static int json_crypt_number(json_scan *s, char *p, size_t len) {
+    if (s->ctx->radix != 10 || len < 2 || len > JSON_NUMBER_MAX || p[0] == '0') return -1;
+    if (s->check) return json_check_field(s, NULL, p, len);
+
+    unsigned int digits[JSON_NUMBER_MAX];
+    unsigned int n = (unsigned int)len;
+    for (unsigned int k = 0; k < n; k++) digits[k] = (unsigned int)(p[k] - '0');
+
+    int ret;
+    do {
+        ret = s->encrypt
+            ? FPE_encrypt(s->ctx, digits, digits, n, s->tweak, s->tweak_len)
+            : FPE_decrypt(s->ctx, digits, digits, n, s->tweak, s->tweak_len);
+    } while (ret == 0 && digits[0] == 0);
+
+    if (ret == 0) {
+        for (unsigned int k = 0; k < n; k++) p[k] = (char)('0' + digits[k]);
+        s->count++;
+    }
+    fpe_secure_zero(digits, n * sizeof(unsigned int));
+    return ret;
+}
+
+/* ========================================================================= */
+/*                                  Scanner                                  */
+/* ========================================================================= */
+
+typedef enum {
+    JSON_TOP = 0,     /**< Between top-level documents */
+    JSON_VALUE,       /**< Expecting a value */
+    JSON_KEY,         /**< Expecting an object key */
+    JSON_OBJ_FIRST,   /**< Just after '{' */
+    JSON_ARR_FIRST,   /**< Just after '[' */
+    JSON_AFTER        /**< Just after a value */
+} json_state;
+
+static int json_scan_buf(json_scan *s, char *b, size_t n) {
+    json_level st[FPE_JSON_MAX_DEPTH];
+    unsigned int depth = 0;
+    json_state state = JSON_TOP;
+    size_t i = 0;
+
+    /* The value about to be parsed */
+    uint64_t vmask = 0;
+    unsigned int vseg = 0;
+    int vselected = 0;
+
+    for (;;) {
+        i = json_skip_ws(b, i, n);
+
+        switch (state) {
+        case JSON_TOP:
+            if (i == n) return json_flush(s);
+            vmask = s->json->all;
+            vseg = 0;
+            vselected = 0;
+            state = JSON_VALUE;
+            break;
+
+        case JSON_VALUE: {
+            if (i == n) return -1;
+            char c = b[i];
+
+            if (c == '{' || c == '[') {
+                int array = (c == '[');
+                if (vmask == 0 && !(array && vselected)) {
+                    i = json_skip_container(b, i + 1, n);
+                    if (i == JSON_ERR) return -1;
+                    state = JSON_AFTER;
+                    break;
+                }
+                if (depth == FPE_JSON_MAX_DEPTH) return -1;
+                st[depth].mask = vmask;
+                st[depth].seg = (unsigned char)vseg;
+                st[depth].array = (unsigned char)array;
+                st[depth].selected = (unsigned char)(array && vselected);
+                depth++;
+                i++;
+                state = array ? JSON_ARR_FIRST : JSON_OBJ_FIRST;
+            } else if (c == '"') {
+                size_t e = json_string_end(b, i + 1, n);
+                if (e == JSON_ERR) return -1;
+                if (vselected && json_queue_string(s, b + i + 1, e - i - 1) != 0) return -1;
+                i = e + 1;
+                state = JSON_AFTER;
+            } else if (c == '-' || (c >= '0' && c <= '9')) {
+                size_t d = i + (c == '-');
+                size_t e = d;
+                while (e < n && b[e] >= '0' && b[e] <= '9') e++;
+                size_t end = e;
+                while (end < n && (b[end] == '.' || b[end] == 'e' || b[end] == 'E' ||
+                                   b[end] == '+' || b[end] == '-' ||
+                                   (b[end] >= '0' && b[end] <= '9'))) {
+                    end++;
+                }
+                if (vselected && (end != e || json_crypt_number(s, b + d, e - d) != 0)) return -1;
+                i = end;
+                state = JSON_AFTER;
+            } else {
+                /* true, false, null */
+                size_t e = i;
+                while (e < n && b[e] >= 'a' && b[e] <= 'z') e++;
+                if (e == i) return -1;
+                i = e;
+                state = JSON_AFTER;
+            }
+            break;
+        }
+
+        case JSON_OBJ_FIRST:
+            if (i < n && b[i] == '}') {
+                depth--;
+                i++;
+                state = JSON_AFTER;
+            } else {
+                state = JSON_KEY;
+            }
+            break;
+
+        case JSON_ARR_FIRST:
+            if (i < n && b[i] == ']') {
+                depth--;
+                i++;
+                state = JSON_AFTER;
+            } else {
+                vmask = st[depth - 1].mask;
+                vseg = st[depth - 1].seg;
+                vselected = st[depth - 1].selected;
+                state = JSON_VALUE;
+            }
+            break;
+
+        case JSON_KEY: {
+            if (i == n || b[i] != '"') return -1;
+            size_t e = json_string_end(b, i + 1, n);
+            if (e == JSON_ERR) return -1;
+
+            const json_level *lv = &st[depth - 1];
+            uint64_t hit = json_match_key(s->json, lv->mask, lv->seg, b + i + 1, e - i - 1);
+            uint64_t done = 0;
+            for (unsigned int p = 0; p < s->json->npaths; p++) {
+                if ((hit >> p & 1) && s->json->path[p].nseg == lv->seg + 1u) done |= (uint64_t)1 << p;
+            }
+
+            i = json_skip_ws(b, e + 1, n);
+            if (i == n || b[i] != ':') return -1;
+            i++;
+
+            vmask = hit & ~done;
+            vseg = lv->seg + 1u;
+            vselected = (done != 0);
+            state = JSON_VALUE;
+            break;
+        }
+
+        case JSON_AFTER: {
+            if (depth == 0) {
+                state = JSON_TOP;
+                break;
+            }
+            if (i == n) return -1;
+
+            const json_level *lv = &st[depth - 1];
+            if (b[i] == ',') {
+                i++;
+                if (lv->array) {
+                    vmask = lv->mask;
+                    vseg = lv->seg;
+                    vselected = lv->selected;
+                    state = JSON_VALUE;
+                } else {
+                    state = JSON_KEY;
+                }
+            } else if (b[i] == (lv->array ? ']' : '}')) {
+                depth--;
+                i++;
+            } else {
+                return -1;
+            }
+            break;
+        }
+        }
+    }
+}
+
+/* ========================================================================= */
+/*                               Public API                                  */
+/* ========================================================================= */
+
+/**
+ * @brief Shared driver for FPE_encrypt_json / FPE_decrypt_json
+ */
+static int json_crypt(FPE_CTX *ctx, const FPE_JSON *json, char *buf, size_t len,
+                      const unsigned char *tweak, unsigned int tweak_len, int encrypt) {
+    if (!ctx || !json || (!buf && len > 0)) return -1;
+    if (tweak_len > 0 && !tweak) return -1;
+
+    json_scan s;
+    s.ctx = ctx;
+    s.json = json;
+    s.tweak = tweak;
+    s.tweak_len = tweak_len;
+    s.encrypt = encrypt;
+    s.a = NULL;
+    s.count = 0;
+    s.npending = 0;
+
+    /* All or nothing: reject before any value is rewritten */
+    s.check = 1;
+    if (json_scan_buf(&s, buf, len) != 0) return -1;
+
+    s.check = 0;
+    if (json_scan_buf(&s, buf, len) != 0) return -1;
+    return s.count;
+}
+
+int FPE_encrypt_json(FPE_CTX *ctx, const FPE_JSON *json, char *buf, size_t len,
+                     const unsigned char *tweak, unsigned int tweak_len) {
+    return json_crypt(ctx, json, buf, len, tweak, tweak_len, 1);
+}
+
+int FPE_decrypt_json(FPE_CTX *ctx, const FPE_JSON *json, char *buf, size_t len,
+                     const unsigned char *tweak, unsigned int tweak_len) {
+    return json_crypt(ctx, json, buf, len, tweak, tweak_len, 0);
+}
@@ -0,0 +1,310 @@
+/**
+ * @file lanes.c
+ * @brief Structure-of-arrays primitives for lane-parallel numeral strings
+ *
+ * Every inner loop walks one row of FPE_LANES 32-bit values. With AVX2
+ * available at compile time a row is a single __m256i; otherwise the same
+ * loops run per lane (and are simple enough for the auto-vectorizer).
+ */
+
+#include "lanes.h"
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Constant divisor with a 32-bit reciprocal
+ *
+ * q = (cur * inv) >> 32 underestimates cur / d by at most 2 for any 32-bit
+ * cur, so two conditional corrections give the exact quotient.
+ */
+typedef struct {
+    uint32_t d;
+    uint32_t inv;
+} lanes_div;
+
+static lanes_div lanes_div_init(uint32_t d) {
+    lanes_div v;
+    v.d = d;
+    v.inv = 0xFFFFFFFFu / d;
+    return v;
+}
+
+static inline uint32_t lanes_divmod(uint32_t cur, const lanes_div *v, uint32_t *rem) {
+    uint32_t q = (uint32_t)(((uint64_t)cur * v->inv) >> 32);
+    uint32_t r = cur - q * v->d;
+    if (r >= v->d) { q++; r -= v->d; }
+    if (r >= v->d) { q++; r -= v->d; }
+    *rem = r;
+    return q;
+}
+
+/**
+ * @brief Largest c with radix^c <= 65536, i.e. digits per 16-bit limb step
+ */
+static unsigned int lanes_chunk_digits(unsigned int radix) {
+    unsigned int c = 1;
+    uint32_t p = radix;
+    while ((uint64_t)p * radix <= 65536u) {
+        p *= radix;
+        c++;
+    }
+    return c;
+}
+
+static uint32_t lanes_pow(unsigned int radix, unsigned int e) {
+    uint32_t p = 1;
+    while (e--) p *= radix;
+    return p;
+}
+
+#if defined(__AVX2__)
+
+/* High 32 bits of the 32x32 products in all eight lanes */
+static inline __m256i lanes_mulhi_epu32(__m256i a, __m256i b) {
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, b), 32);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+/* All-ones where a >= b (unsigned) */
+static inline __m256i lanes_cmpge_epu32(__m256i a, __m256i b) {
+    return _mm256_cmpeq_epi32(_mm256_max_epu32(a, b), a);
+}
+
+static inline __m256i lanes_divmod_v(__m256i cur, __m256i d, __m256i inv, __m256i *rem) {
+    __m256i q = lanes_mulhi_epu32(cur, inv);
+    __m256i r = _mm256_sub_epi32(cur, _mm256_mullo_epi32(q, d));
+    for (int i = 0; i < 2; i++) {
+        __m256i ge = lanes_cmpge_epu32(r, d);
+        q = _mm256_sub_epi32(q, ge);
+        r = _mm256_sub_epi32(r, _mm256_and_si256(ge, d));
+    }
+    *rem = r;
+    return q;
+}
+
+#endif
+
+/* ========================================================================= */
+/*                                Transpose                                  */
+/* ========================================================================= */
+
+int fpe_lanes_load(uint32_t *x, const unsigned int *const *rows, unsigned int nl,
+                   unsigned int off, unsigned int len, unsigned int radix) {
+    unsigned int bad = 0;
+
+    if (nl < FPE_LANES) {
+        memset(x, 0, (size_t)len * FPE_LANES * sizeof(uint32_t));
+    }
+
+    for (unsigned int l = 0; l < nl; l++) {
+        const unsigned int *row = rows[l] + off;
+        for (unsigned int j = 0; j < len; j++) {
+            x[(size_t)j * FPE_LANES + l] = row[j];
+            bad |= (row[j] >= radix);
+        }
+    }
+
+    return bad ? -1 : 0;
+}
+
+void fpe_lanes_store(unsigned int *const *rows, const uint32_t *x, unsigned int nl,
+                     unsigned int off, unsigned int len) {
+    for (unsigned int l = 0; l < nl; l++) {
+        unsigned int *row = rows[l] + off;
+        for (unsigned int j = 0; j < len; j++) {
+            row[j] = x[(size_t)j * FPE_LANES + l];
+        }
+    }
+}
+
+/* ========================================================================= */
+/*                            Radix Conversion                               */
+/* ========================================================================= */
+
+void fpe_lanes_num_to_bytes(const uint32_t *x, unsigned int n, unsigned int radix,
+                            unsigned char *out, size_t stride, unsigned int b,
+                            uint32_t *limbs) {
+    unsigned int nlimbs = (b + 1) / 2;
+    unsigned int c = lanes_chunk_digits(radix);
+    unsigned int top = 0;
+
+    memset(limbs, 0, (size_t)nlimbs * FPE_LANES * sizeof(uint32_t));
+
+    /* Horner over chunks of c digits: N = N * radix^g + chunk */
+    unsigned int j = 0;
+    while (j < n) {
+        unsigned int g = (j == 0 && n % c) ? n % c : c;
+        uint32_t mult = lanes_pow(radix, g);
+        uint32_t chunk[FPE_LANES];
+
+        for (unsigned int l = 0; l < FPE_LANES; l++) chunk[l] = 0;
+        for (unsigned int i = 0; i < g; i++) {
+            const uint32_t *row = x + (size_t)(j + i) * FPE_LANES;
+            for (unsigned int l = 0; l < FPE_LANES; l++) {
+                chunk[l] = chunk[l] * radix + row[l];
+            }
+        }
+        j += g;
+
+        /* Each step adds at most 16 bits, i.e. one more limb */
+        if (top < nlimbs) top++;
+
+#if defined(__AVX2__)
+        __m256i vm = _mm256_set1_epi32((int)mult);
+        __m256i mask = _mm256_set1_epi32(0xFFFF);
+        __m256i carry = _mm256_loadu_si256((const __m256i *)chunk);
+        for (unsigned int k = 0; k < top; k++) {
+            __m256i *p = (__m256i *)(limbs + (size_t)k * FPE_LANES);
+            __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_loadu_si256(p), vm), carry);
+            _mm256_storeu_si256(p, _mm256_and_si256(t, mask));
+            carry = _mm256_srli_epi32(t, 16);
+        }
+#else
+        uint32_t *carry = chunk;
+        for (unsigned int k = 0; k < top; k++) {
+            uint32_t *row = limbs + (size_t)k * FPE_LANES;
+            for (unsigned int l = 0; l < FPE_LANES; l++) {
+                uint32_t t = row[l] * mult + carry[l];
+                row[l] = t & 0xFFFF;
+                carry[l] = t >> 16;
+            }
+        }
+#endif
+    }
+
+    /* Limb k holds bytes b-1-2k (low) and b-2-2k (high) */
+    for (unsigned int k = 0; k < nlimbs; k++) {
+        const uint32_t *row = limbs + (size_t)k * FPE_LANES;
+        unsigned int lo = b - 1 - 2 * k;
+        for (unsigned int l = 0; l < FPE_LANES; l++) {
+            unsigned char *o = out + l * stride;
+            o[lo] = (unsigned char)(row[l] & 0xFF);
+            if (lo > 0) o[lo - 1] = (unsigned char)(row[l] >> 8);
+        }
+    }
+}
+
+void fpe_lanes_bytes_to_num(uint32_t *y, unsigned int m, unsigned int radix,
+                            const unsigned char *in, size_t stride, unsigned int d,
+                            uint32_t *limbs) {
+    unsigned int nlimbs = d / 2;
+    unsigned int c = lanes_chunk_digits(radix);
+    lanes_div rdiv = lanes_div_init(radix);
+
+    for (unsigned int k = 0; k < nlimbs; k++) {
+        uint32_t *row = limbs + (size_t)k * FPE_LANES;
+        unsigned int lo = d - 1 - 2 * k;
+        for (unsigned int l = 0; l < FPE_LANES; l++) {
+            const unsigned char *p = in + l * stride;
+            row[l] = ((uint32_t)p[lo - 1] << 8) | p[lo];
+        }
+    }
+
+    /* Peel off least significant digits, c at a time, by dividing by radix^g */
+    unsigned int top = nlimbs;
+    unsigned int produced = 0;
+    while (produced < m) {
+        unsigned int g = (m - produced < c) ? m - produced : c;
+        lanes_div gdiv = lanes_div_init(lanes_pow(radix, g));
+        uint32_t rem[FPE_LANES];
+
+#if defined(__AVX2__)
+        __m256i vd = _mm256_set1_epi32((int)gdiv.d);
+        __m256i vinv = _mm256_set1_epi32((int)gdiv.inv);
+        __m256i r = _mm256_setzero_si256();
+        for (unsigned int k = top; k-- > 0;) {
+            __m256i *p = (__m256i *)(limbs + (size_t)k * FPE_LANES);
+            __m256i cur = _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_loadu_si256(p));
+            _mm256_storeu_si256(p, lanes_divmod_v(cur, vd, vinv, &r));
+        }
+        _mm256_storeu_si256((__m256i *)rem, r);
+#else
+        for (unsigned int l = 0; l < FPE_LANES; l++) rem[l] = 0;
+        for (unsigned int k = top; k-- > 0;) {
+            uint32_t *row = limbs + (size_t)k * FPE_LANES;
+            for (unsigned int l = 0; l < FPE_LANES; l++) {
+                row[l] = lanes_divmod((rem[l] << 16) | row[l], &gdiv, &rem[l]);
+            }
+        }
+#endif
+
+        /* Split the remainder (< radix^g) into g digits */
+        for (unsigned int i = 0; i < g; i++) {
+            uint32_t *row = y + (size_t)(m - 1 - produced - i) * FPE_LANES;
+            for (unsigned int l = 0; l < FPE_LANES; l++) {
+                rem[l] = lanes_divmod(rem[l], &rdiv, &row[l]);
+            }
+        }
+        produced += g;
+
+        /* Drop limbs that are now zero in every lane */
+        while (top > 0) {
+            const uint32_t *row = limbs + (size_t)(top - 1) * FPE_LANES;
+            uint32_t any = 0;
+            for (unsigned int l = 0; l < FPE_LANES; l++) any |= row[l];
+            if (any) break;
+            top--;
+        }
+    }
+}
+
+/* ========================================================================= */
+/*                           Modular Add / Subtract                          */
+/* ========================================================================= */
+
+void fpe_lanes_add_mod(uint32_t *a, const uint32_t *y, unsigned int m, unsigned int radix) {
+#if defined(__AVX2__)
+    __m256i vr = _mm256_set1_epi32((int)radix);
+    __m256i carry = _mm256_setzero_si256();
+    for (unsigned int j = m; j-- > 0;) {
+        __m256i *pa = (__m256i *)(a + (size_t)j * FPE_LANES);
+        __m256i vy = _mm256_loadu_si256((const __m256i *)(y + (size_t)j * FPE_LANES));
+        __m256i s = _mm256_add_epi32(_mm256_add_epi32(_mm256_loadu_si256(pa), vy), carry);
+        __m256i ge = lanes_cmpge_epu32(s, vr);
+        _mm256_storeu_si256(pa, _mm256_sub_epi32(s, _mm256_and_si256(ge, vr)));
+        carry = _mm256_srli_epi32(ge, 31);
+    }
+#else
+    uint32_t carry[FPE_LANES] = {0};
+    for (unsigned int j = m; j-- > 0;) {
+        uint32_t *ra = a + (size_t)j * FPE_LANES;
+        const uint32_t *ry = y + (size_t)j * FPE_LANES;
+        for (unsigned int l = 0; l < FPE_LANES; l++) {
+            uint32_t s = ra[l] + ry[l] + carry[l];
+            carry[l] = (s >= radix);
+            ra[l] = s - (carry[l] ? radix : 0);
+        }
+    }
+#endif
+}
+
+void fpe_lanes_sub_mod(uint32_t *a, const uint32_t *y, unsigned int m, unsigned int radix) {
+#if defined(__AVX2__)
+    __m256i vr = _mm256_set1_epi32((int)radix);
+    __m256i borrow = _mm256_setzero_si256();
+    for (unsigned int j = m; j-- > 0;) {
+        __m256i *pa = (__m256i *)(a + (size_t)j * FPE_LANES);
+        __m256i va = _mm256_loadu_si256(pa);
+        __m256i t = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(y + (size_t)j * FPE_LANES)),
+                                     borrow);
+        __m256i lt = _mm256_xor_si256(lanes_cmpge_epu32(va, t), _mm256_set1_epi32(-1));
+        _mm256_storeu_si256(pa, _mm256_add_epi32(_mm256_sub_epi32(va, t), _mm256_and_si256(lt, vr)));
+        borrow = _mm256_srli_epi32(lt, 31);
+    }
+#else
+    uint32_t borrow[FPE_LANES] = {0};
+    for (unsigned int j = m; j-- > 0;) {
+        uint32_t *ra = a + (size_t)j * FPE_LANES;
+        const uint32_t *ry = y + (size_t)j * FPE_LANES;
+        for (unsigned int l = 0; l < FPE_LANES; l++) {
+            uint32_t t = ry[l] + borrow[l];
+            borrow[l] = (ra[l] < t);
+            ra[l] = ra[l] - t + (borrow[l] ? radix : 0);
+        }
+    }
+#endif
+}
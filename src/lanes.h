@@ -0,0 +1,72 @@
+/**
+ * @file lanes.h
+ * @brief Structure-of-arrays primitives for lane-parallel numeral strings
+ *
+ * A batch of FPE_LANES equal-length records is stored transposed: digit j
+ * of lane l lives at x[j * FPE_LANES + l], so every step of a radix
+ * conversion or a mod-radix add touches one contiguous row of lanes and
+ * maps onto a single SIMD instruction.
+ *
+ * Big integers use 16-bit limbs held in 32-bit lanes (limb k of lane l at
+ * n[k * FPE_LANES + l], least significant first). With radix <= 65536 every
+ * intermediate of a multiply-accumulate or a divide step fits 32 bits, so
+ * no 64-bit lane arithmetic is needed.
+ */
+
+#ifndef FPE_LANES_H
+#define FPE_LANES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Records processed together by one lane kernel */
+#define FPE_LANES 8
+
+/* Smaller groups (tails, single records) are faster one at a time */
+#define FPE_LANES_MIN 4
+
+/**
+ * @brief Transpose rows[l][off .. off+len) into x (lanes >= nl are zeroed)
+ *
+ * @return 0 on success, -1 if any digit is >= radix
+ */
+int fpe_lanes_load(uint32_t *x, const unsigned int *const *rows, unsigned int nl,
+                   unsigned int off, unsigned int len, unsigned int radix);
+
+/**
+ * @brief Transpose x back into rows[l][off .. off+len) for the first nl lanes
+ */
+void fpe_lanes_store(unsigned int *const *rows, const uint32_t *x, unsigned int nl,
+                     unsigned int off, unsigned int len);
+
+/**
+ * @brief Per lane: [NUM_radix(x[0..n-1])]^b into out + l * stride (big-endian)
+ *
+ * @param limbs Scratch of (b + 1) / 2 * FPE_LANES entries.
+ */
+void fpe_lanes_num_to_bytes(const uint32_t *x, unsigned int n, unsigned int radix,
+                            unsigned char *out, size_t stride, unsigned int b,
+                            uint32_t *limbs);
+
+/**
+ * @brief Per lane: y = STR^m_radix(NUM(in[0..d-1]) mod radix^m)
+ *
+ * in + l * stride holds d big-endian bytes (d even).
+ *
+ * @param limbs Scratch of d / 2 * FPE_LANES entries.
+ */
+void fpe_lanes_bytes_to_num(uint32_t *y, unsigned int m, unsigned int radix,
+                            const unsigned char *in, size_t stride, unsigned int d,
+                            uint32_t *limbs);
+
+/**
+ * @brief Per lane: a = (a + y) mod radix^m, digit-wise with carry
+ */
+void fpe_lanes_add_mod(uint32_t *a, const uint32_t *y, unsigned int m, unsigned int radix);
+
+/**
+ * @brief Per lane: a = (a - y) mod radix^m, digit-wise with borrow
+ */
+void fpe_lanes_sub_mod(uint32_t *a, const uint32_t *y, unsigned int m, unsigned int radix);
+
+#endif /* FPE_LANES_H */
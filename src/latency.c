@@ -0,0 +1,184 @@
+/**
+ * @file latency.c
+ * @brief Lock-free log-linear latency histograms
+ *
+ * Calls are recorded in fpe_ticks() units with one relaxed atomic add to
+ * a bucket, so any number of threads can record into one histogram
+ * without a lock and without losing counts. Ticks are converted to
+ * nanoseconds only when a quantile is read, at a rate calibrated once
+ * against CLOCK_MONOTONIC over the first millisecond after the first
+ * histogram was created.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "stats.h"
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(FPE_HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+/* Exact below 32 ticks, then 32 buckets per power of two up to 2^64 */
+#define LATENCY_SUB 32
+#define LATENCY_BUCKETS (60 * LATENCY_SUB)
+
+struct fpe_latency_st {
+    uint64_t bucket[LATENCY_BUCKETS];
+};
+
+/* Relaxed atomics: buckets are independent counters with no ordering */
+#define LATENCY_ADD(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define LATENCY_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LATENCY_TAKE(p) __atomic_exchange_n((p), 0, __ATOMIC_RELAXED)
+#define LATENCY_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+
+/* ========================================================================= */
+/*                              Tick Calibration                             */
+/* ========================================================================= */
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t anchor_ns, anchor_ticks;
+static double tick_ns = 1.0;  /* fpe_ticks() is already nanoseconds off x86 */
+
+static void latency_anchor(void) {
+    anchor_ns = monotonic_ns();
+    anchor_ticks = fpe_ticks();
+}
+
+/**
+ * @brief Fix nanoseconds per tick, measured over at least 1 ms since the anchor
+ *
+ * Measured once: a ratio re-read on every quantile would shift with each
+ * preemption between the two clock reads, and two quantiles in the same
+ * bucket could then come out in the wrong order.
+ */
+static void latency_calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ns, ticks;
+    do {
+        /* Wait out a span under 1 ms so the ratio is good to ~0.1% */
+        ns = monotonic_ns();
+        ticks = fpe_ticks();
+    } while (ns - anchor_ns < 1000000u);
+    tick_ns = (double)(ns - anchor_ns) / (double)(ticks - anchor_ticks);
+#endif
+}
+
+#if defined(FPE_HAVE_PTHREAD)
+static pthread_once_t anchor_once = PTHREAD_ONCE_INIT;
+static pthread_once_t calibrate_once = PTHREAD_ONCE_INIT;
+#define LATENCY_ANCHOR() pthread_once(&anchor_once, latency_anchor)
+#define LATENCY_CALIBRATE() pthread_once(&calibrate_once, latency_calibrate)
+#else
+static int anchor_done, calibrate_done;
+#define LATENCY_ANCHOR() do { if (!anchor_done) { latency_anchor(); anchor_done = 1; } } while (0)
+#define LATENCY_CALIBRATE() do { if (!calibrate_done) { latency_calibrate(); calibrate_done = 1; } } while (0)
+#endif
+
+/**
+ * @brief Nanoseconds per tick, calibrated on the first call
+ */
+static double ns_per_tick(void) {
+    LATENCY_ANCHOR();
+    LATENCY_CALIBRATE();
+    return tick_ns;
+}
+
+/* ========================================================================= */
+/*                                 Buckets                                   */
+/* ========================================================================= */
+
+static unsigned int latency_index(uint64_t v) {
+    if (v < LATENCY_SUB) return (unsigned int)v;
+    unsigned int e = 63 - (unsigned int)__builtin_clzll(v);      /* e >= 5 */
+    return (e - 4) * LATENCY_SUB + (unsigned int)((v >> (e - 5)) & (LATENCY_SUB - 1));
+}
+
+/* Midpoint of bucket i in ticks */
+static double latency_value(unsigned int i) {
+    if (i < LATENCY_SUB) return (double)i;
+    unsigned int e = i / LATENCY_SUB + 4;
+    double width = (double)((uint64_t)1 << (e - 5));
+    return (double)(LATENCY_SUB + i % LATENCY_SUB) * width + 0.5 * width;
+}
+
+void fpe_latency_record(FPE_LATENCY *h, uint64_t ticks) {
+    LATENCY_ADD(&h->bucket[latency_index(ticks)], 1);
+}
+
+/* ========================================================================= */
+/*                                Public API                                 */
+/* ========================================================================= */
+
+FPE_LATENCY *FPE_LATENCY_new(void) {
+    LATENCY_ANCHOR();
+    return (FPE_LATENCY *)calloc(1, sizeof(FPE_LATENCY));
+}
+
+void FPE_LATENCY_free(FPE_LATENCY *h) {
+    free(h);
+}
+
+int FPE_CTX_set_latency(FPE_CTX *ctx, FPE_LATENCY *h) {
+    if (!ctx) return -1;
+    ctx->latency = h;
+    return 0;
+}
+
+int FPE_LATENCY_snapshot(FPE_LATENCY *h, FPE_LATENCY *snap, int reset) {
+    if (!h || !snap || h == snap) return -1;
+
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        uint64_t v = reset ? LATENCY_TAKE(&h->bucket[i]) : LATENCY_LOAD(&h->bucket[i]);
+        LATENCY_STORE(&snap->bucket[i], v);
+    }
+    return 0;
+}
+
+int FPE_LATENCY_merge(FPE_LATENCY *dst, const FPE_LATENCY *src) {
+    if (!dst || !src || dst == src) return -1;
+
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        uint64_t v = LATENCY_LOAD(&src->bucket[i]);
+        if (v) LATENCY_ADD(&dst->bucket[i], v);
+    }
+    return 0;
+}
+
+void FPE_LATENCY_reset(FPE_LATENCY *h) {
+    if (!h) return;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) LATENCY_STORE(&h->bucket[i], 0);
+}
+
+uint64_t FPE_LATENCY_count(const FPE_LATENCY *h) {
+    if (!h) return 0;
+
+    uint64_t n = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) n += LATENCY_LOAD(&h->bucket[i]);
+    return n;
+}
+
+double FPE_LATENCY_quantile(const FPE_LATENCY *h, double q) {
+    uint64_t n = FPE_LATENCY_count(h);
+    if (n == 0) return -1.0;
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = (uint64_t)ceil(q * (double)n), seen = 0;
+    if (rank == 0) rank = 1;
+
+    unsigned int i = 0;
+    for (; i < LATENCY_BUCKETS - 1; i++) {
+        seen += LATENCY_LOAD(&h->bucket[i]);
+        if (seen >= rank) break;
+    }
+    return latency_value(i) * ns_per_tick();
+}
@@ -0,0 +1,173 @@
+/**
+ * @file mask.c
+ * @brief Format masks: encrypt selected positions of a formatted string
+ *
+ * A pattern is compiled once into segments: spans of encrypted positions,
+ * spans kept in clear, and literal separators that the input must match.
+ * Encryption maps the encrypted spans straight out of the input into one
+ * numeral buffer, encrypts it as a single FPE input, and scatters it back.
+ * All per-call buffers live on the stack.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Segment kinds of a compiled mask
+ */
+typedef enum {
+    MASK_SEG_ENCRYPT = 0,  /**< '#': encrypted */
+    MASK_SEG_KEEP,         /**< '=': copied unchanged */
+    MASK_SEG_LITERAL       /**< Anything else: must match the pattern */
+} mask_seg_kind;
+
+typedef struct {
+    unsigned short off;   /**< First position in the formatted string */
+    unsigned short len;   /**< Positions covered */
+    unsigned char kind;   /**< mask_seg_kind */
+} mask_seg;
+
+struct fpe_mask_st {
+    unsigned int len;        /**< Length of a matching string */
+    unsigned int n_encrypt;  /**< Number of '#' positions */
+    unsigned int nseg;       /**< Number of segments */
+    mask_seg seg[FPE_MASK_MAX_LEN];
+    char literal[FPE_MASK_MAX_LEN + 1];  /**< Pattern with escapes resolved */
+    fpe_alphabet alphabet;
+};
+
+/* ========================================================================= */
+/*                              Mask Compilation                             */
+/* ========================================================================= */
+
+FPE_MASK *FPE_MASK_new(const char *pattern, const char *alphabet) {
+    if (!pattern || !alphabet) return NULL;
+
+    FPE_MASK *mask = (FPE_MASK *)calloc(1, sizeof(FPE_MASK));
+    if (!mask) return NULL;
+
+    if (fpe_alphabet_compile(&mask->alphabet, alphabet) == 0) {
+        free(mask);
+        return NULL;
+    }
+
+    for (const char *p = pattern; *p; p++) {
+        mask_seg_kind kind = MASK_SEG_LITERAL;
+        char c = *p;
+
+        if (c == '#') {
+            kind = MASK_SEG_ENCRYPT;
+        } else if (c == '=') {
+            kind = MASK_SEG_KEEP;
+        } else if (c == '\\') {
+            c = *++p;
+            if (c == '\0') goto fail;  /* Dangling escape */
+        }
+
+        if (mask->len == FPE_MASK_MAX_LEN) goto fail;
+
+        /* Extend the current segment or start a new one */
+        mask_seg *last = mask->nseg ? &mask->seg[mask->nseg - 1] : NULL;
+        if (last && last->kind == kind) {
+            last->len++;
+        } else {
+            mask_seg *seg = &mask->seg[mask->nseg++];
+            seg->off = (unsigned short)mask->len;
+            seg->len = 1;
+            seg->kind = (unsigned char)kind;
+        }
+
+        mask->literal[mask->len++] = c;
+        if (kind == MASK_SEG_ENCRYPT) mask->n_encrypt++;
+    }
+
+    /* FPE needs at least two numerals */
+    if (mask->n_encrypt < 2) goto fail;
+
+    return mask;
+
+fail:
+    free(mask);
+    return NULL;
+}
+
+void FPE_MASK_free(FPE_MASK *mask) {
+    free(mask);
+}
+
+unsigned int FPE_MASK_len(const FPE_MASK *mask) {
+    return mask ? mask->len : 0;
+}
+
+/* ========================================================================= */
+/*                            Masked Encryption                              */
+/* ========================================================================= */
+
+/**
+ * @brief Shared driver for FPE_encrypt_mask / FPE_decrypt_mask
+ */
+static int mask_crypt(FPE_CTX *ctx, const FPE_MASK *mask,
+                      const char *in, char *out,
+                      const unsigned char *tweak, unsigned int tweak_len,
+                      int encrypt) {
+    if (!ctx || !mask || !in || !out) return -1;
+    if (mask->alphabet.radix != ctx->radix) return -1;
+    if (strlen(in) != mask->len) return -1;
+
+    const fpe_alphabet *a = &mask->alphabet;
+    unsigned int digits[FPE_MASK_MAX_LEN];
+    char chars[FPE_MASK_MAX_LEN + 1];
+    unsigned int n = 0;
+    int ret = 0;
+
+    /* Gather: check literals, map encrypted spans, read-only on in */
+    for (unsigned int i = 0; i < mask->nseg && ret == 0; i++) {
+        const mask_seg *s = &mask->seg[i];
+        if (s->kind == MASK_SEG_ENCRYPT) {
+            ret = fpe_alphabet_map(a, in + s->off, digits + n, s->len);
+            n += s->len;
+        } else if (s->kind == MASK_SEG_LITERAL) {
+            if (memcmp(in + s->off, mask->literal + s->off, s->len) != 0) ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = encrypt
+            ? FPE_encrypt(ctx, digits, digits, n, tweak, tweak_len)
+            : FPE_decrypt(ctx, digits, digits, n, tweak, tweak_len);
+    }
+    if (ret == 0) ret = fpe_alphabet_unmap(a, digits, chars, n);
+
+    /* Scatter: encrypted spans from chars, everything else from in */
+    if (ret == 0) {
+        n = 0;
+        for (unsigned int i = 0; i < mask->nseg; i++) {
+            const mask_seg *s = &mask->seg[i];
+            if (s->kind == MASK_SEG_ENCRYPT) {
+                memcpy(out + s->off, chars + n, s->len);
+                n += s->len;
+            } else if (out != in) {
+                memcpy(out + s->off, in + s->off, s->len);
+            }
+        }
+        out[mask->len] = '\0';
+    }
+
+    fpe_secure_zero(digits, mask->n_encrypt * sizeof(unsigned int));
+    fpe_secure_zero(chars, mask->n_encrypt);
+    return ret;
+}
+
+int FPE_encrypt_mask(FPE_CTX *ctx, const FPE_MASK *mask,
+                     const char *in, char *out,
+                     const unsigned char *tweak, unsigned int tweak_len) {
+    return mask_crypt(ctx, mask, in, out, tweak, tweak_len, 1);
+}
+
+int FPE_decrypt_mask(FPE_CTX *ctx, const FPE_MASK *mask,
+                     const char *in, char *out,
+                     const unsigned char *tweak, unsigned int tweak_len) {
+    return mask_crypt(ctx, mask, in, out, tweak, tweak_len, 0);
+}
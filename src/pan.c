@@ -0,0 +1,218 @@
+/**
+ * @file pan.c
+ * @brief Card number (PAN) tokenization that keeps the Luhn check valid
+ *
+ * A PAN is split into kept digits (optionally the BIN and the last four),
+ * the encrypted span, and one fix-up digit: the last digit that is not
+ * kept. The span is encrypted with the context's mode, and the fix-up digit
+ * is then solved so the whole number passes Luhn again. Because the input
+ * must itself be Luhn-valid, the fix-up digit carries no information and
+ * decryption recovers it the same way.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Records converted per FPE_encrypt_batch call in the batch variant */
+#define PAN_BATCH_CHUNK 64
+
+static const char pan_alphabet[] = "0123456789";
+
+/* ========================================================================= */
+/*                               Luhn Checksum                               */
+/* ========================================================================= */
+
+/**
+ * @brief Luhn sum of a decimal string (before the final mod 10)
+ *
+ * The record is right-aligned in a 32-byte window padded with '0', so the
+ * doubled positions (odd distance from the last digit) are always the even
+ * bytes of the window and the whole sum is two SSE2 passes.
+ *
+ * @return The sum, or -1 if any character is not a decimal digit
+ */
+static int pan_luhn_sum(const char *digits, unsigned int len) {
+    unsigned char buf[32];
+    memset(buf, '0', sizeof(buf));
+    memcpy(buf + sizeof(buf) - len, digits, len);
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i four = _mm_set1_epi8(4);
+    const __m128i even = _mm_set1_epi16(0x00FF);
+    __m128i sum = _mm_setzero_si128();
+    unsigned int bad = 0;
+
+    for (unsigned int h = 0; h < sizeof(buf); h += 16) {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(buf + h)), zero);
+        bad |= (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d)) ^ 0xFFFFu;
+
+        /* Doubled digits: 2d, minus 9 when 2d > 9 */
+        __m128i dbl = _mm_and_si128(d, even);
+        __m128i t = _mm_add_epi8(d, dbl);
+        t = _mm_sub_epi8(t, _mm_and_si128(_mm_cmpgt_epi8(dbl, four), nine));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(t, _mm_setzero_si128()));
+    }
+    if (bad) return -1;
+
+    return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#else
+    int sum = 0;
+    for (unsigned int i = 0; i < sizeof(buf); i++) {
+        unsigned int d = (unsigned int)buf[i] - '0';
+        if (d > 9) return -1;
+        if ((i & 1) == 0) {
+            d *= 2;
+            if (d > 9) d -= 9;
+        }
+        sum += (int)d;
+    }
+    return sum;
+#endif
+}
+
+/**
+ * @brief Digit at distance k from the end that brings sum to 0 mod 10
+ *
+ * sum must have been computed with that digit set to '0'.
+ */
+static char pan_fixup_digit(int sum, unsigned int k) {
+    /* Inverse of d -> 2d (digit sum) for the doubled positions */
+    static const char undouble[10] = {'0', '5', '1', '6', '2', '7', '3', '8', '4', '9'};
+    int need = (10 - sum % 10) % 10;
+    return (k & 1) ? undouble[need] : (char)('0' + need);
+}
+
+/* ========================================================================= */
+/*                                PAN Driver                                 */
+/* ========================================================================= */
+
+/**
+ * @brief Encrypted span [*start, *fix) and fix-up position *fix for a PAN
+ *
+ * @return 0 on success, -1 if len or flags leave fewer than 2 digits to encrypt
+ */
+static int pan_layout(unsigned int len, unsigned int flags,
+                      unsigned int *start, unsigned int *fix) {
+    if (len < FPE_PAN_MIN_LEN || len > FPE_PAN_MAX_LEN) return -1;
+    if (flags & ~(unsigned int)(FPE_PAN_KEEP_BIN | FPE_PAN_KEEP_LAST4)) return -1;
+
+    unsigned int end = (flags & FPE_PAN_KEEP_LAST4) ? len - 4 : len;
+    *start = (flags & FPE_PAN_KEEP_BIN) ? 6 : 0;
+    *fix = end - 1;
+
+    return (*fix >= *start + 2) ? 0 : -1;
+}
+
+/**
+ * @brief Shared driver for the single and batch PAN functions
+ *
+ * Records are len characters each, packed back to back; out may equal in.
+ * Every record is Luhn-checked before any is written, so one bad card does
+ * not leave earlier chunks tokenized over the caller's input. Work then
+ * proceeds in chunks of PAN_BATCH_CHUNK records so the digit buffer stays
+ * on the stack, and each chunk goes through FPE_encrypt_batch.
+ */
+static int pan_crypt(FPE_CTX *ctx, const char *in, char *out,
+                     unsigned int len, size_t count, unsigned int flags,
+                     const unsigned char *tweaks, unsigned int tweak_len,
+                     size_t tweak_stride, int encrypt) {
+    if (!ctx) return -1;
+    if (count == 0) return 0;
+    if (!in || !out) return -1;
+    if (tweak_len > 0 && !tweaks) return -1;
+    if (ctx->radix != 10) return -1;
+
+    unsigned int start, fix;
+    if (pan_layout(len, flags, &start, &fix) != 0) return -1;
+    unsigned int n = fix - start;
+
+    const fpe_alphabet *a = fpe_ctx_alphabet(ctx, pan_alphabet);
+    if (!a) return -1;
+
+    /* Only Luhn-valid numbers have a recoverable fix-up digit */
+    for (size_t r = 0; r < count; r++) {
+        int sum = pan_luhn_sum(in + r * len, len);
+        if (sum < 0 || sum % 10 != 0) return -1;
+    }
+
+    unsigned int digits[PAN_BATCH_CHUNK * FPE_PAN_MAX_LEN];
+    size_t used = (count < PAN_BATCH_CHUNK ? count : PAN_BATCH_CHUNK) * n;
+    int ret = 0;
+
+    for (size_t r0 = 0; r0 < count && ret == 0; r0 += PAN_BATCH_CHUNK) {
+        size_t nr = (count - r0 < PAN_BATCH_CHUNK) ? count - r0 : PAN_BATCH_CHUNK;
+
+        for (size_t r = 0; r < nr && ret == 0; r++) {
+            ret = fpe_alphabet_map(a, in + (r0 + r) * len + start, digits + r * n, n);
+        }
+        if (ret != 0) break;
+
+        const unsigned char *tw = tweak_len > 0 ? tweaks + r0 * tweak_stride : NULL;
+        ret = encrypt
+            ? FPE_encrypt_batch(ctx, digits, digits, n, nr, tw, tweak_len, tweak_stride)
+            : FPE_decrypt_batch(ctx, digits, digits, n, nr, tw, tweak_len, tweak_stride);
+        if (ret != 0) break;
+
+        for (size_t r = 0; r < nr && ret == 0; r++) {
+            const char *src = in + (r0 + r) * len;
+            char *dst = out + (r0 + r) * len;
+
+            if (dst != src) {
+                memcpy(dst, src, start);
+                memcpy(dst + fix + 1, src + fix + 1, len - fix - 1);
+            }
+
+            ret = fpe_alphabet_unmap(a, digits + r * n, dst + start, n);
+            dst[fix] = '0';
+            dst[fix] = pan_fixup_digit(pan_luhn_sum(dst, len), len - 1 - fix);
+        }
+    }
+
+    fpe_secure_zero(digits, used * sizeof(unsigned int));
+    return ret;
+}
+
+/* ========================================================================= */
+/*                               Public API                                  */
+/* ========================================================================= */
+
+int FPE_encrypt_pan(FPE_CTX *ctx, const char *in, char *out, unsigned int flags,
+                    const unsigned char *tweak, unsigned int tweak_len) {
+    if (!in || !out) return -1;
+
+    unsigned int len = (unsigned int)strlen(in);
+    int ret = pan_crypt(ctx, in, out, len, 1, flags, tweak, tweak_len, 0, 1);
+    if (ret == 0) out[len] = '\0';
+    return ret;
+}
+
+int FPE_decrypt_pan(FPE_CTX *ctx, const char *in, char *out, unsigned int flags,
+                    const unsigned char *tweak, unsigned int tweak_len) {
+    if (!in || !out) return -1;
+
+    unsigned int len = (unsigned int)strlen(in);
+    int ret = pan_crypt(ctx, in, out, len, 1, flags, tweak, tweak_len, 0, 0);
+    if (ret == 0) out[len] = '\0';
+    return ret;
+}
+
+int FPE_encrypt_pan_batch(FPE_CTX *ctx, const char *in, char *out,
+                          unsigned int len, size_t count, unsigned int flags,
+                          const unsigned char *tweaks, unsigned int tweak_len,
+                          size_t tweak_stride) {
+    return pan_crypt(ctx, in, out, len, count, flags, tweaks, tweak_len, tweak_stride, 1);
+}
+
+int FPE_decrypt_pan_batch(FPE_CTX *ctx, const char *in, char *out,
+                          unsigned int len, size_t count, unsigned int flags,
+                          const unsigned char *tweaks, unsigned int tweak_len,
+                          size_t tweak_stride) {
+    return pan_crypt(ctx, in, out, len, count, flags, tweaks, tweak_len, tweak_stride, 0);
+}
@@ -0,0 +1,27 @@
+/**
+ * @file pipeline.h
+ * @brief Software-pipelined batch kernels: many records in flight per core
+ *
+ * Inside one Feistel network every step waits on the previous one: the
+ * cipher call needs NUM(B) from the last round's radix math, and the
+ * radix math needs the cipher output. A single record therefore leaves
+ * the core idle on AES latency and on the division chains of the radix
+ * conversion.
+ *
+ * The pipelined kernels keep up to FPE_PIPE_DEPTH independent records in
+ * flight, each an explicit state machine: its round index, its halves and
+ * its pending cipher block(s). One scheduler cycle issues the pending
+ * blocks of every record in a single ECB call, so AES-NI overlaps them,
+ * then resumes each record up to its next cipher block. Records at the
+ * same step run their radix math interleaved, so the division and
+ * multiply chains of different records overlap. A record that finishes
+ * hands its slot to the next one straight away.
+ */
+
+#ifndef FPE_PIPELINE_H
+#define FPE_PIPELINE_H
+
+/* Records in flight in one pipelined kernel */
+#define FPE_PIPE_DEPTH 8
+
+#endif /* FPE_PIPELINE_H */
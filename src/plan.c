@@ -0,0 +1,226 @@
+/**
+ * @file plan.c
+ * @brief Prepared plans: FPE_encrypt with the per-call setup hoisted out
+ *
+ * FPE_PLAN_new does what every FPE_encrypt call would otherwise repeat for
+ * a fixed (len, tweak_len): tweak validation, the mode switch, and the
+ * kernel's shape derivation (split, byte counts, the FF1 header block P
+ * and moduli radix^u, radix^v). The plan then calls the selected kernel
+ * through a function pointer on the stored shape.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include "ff1.h"
+#include "ff3.h"
+#include "ff3-1.h"
+#include "stats.h"
+#include "probes.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef int (*fpe_plan_kernel)(const FPE_PLAN *plan, const unsigned int *in,
+                               unsigned int *out, const unsigned char *tweak);
+
+struct fpe_plan_st {
+    FPE_CTX *ctx;
+    FPE_MODE mode;
+    unsigned int len;
+    unsigned int tweak_len;
+    fpe_plan_kernel encrypt;
+    fpe_plan_kernel decrypt;
+    union {
+        ff1_shape ff1;
+        ff3_shape ff3;              /**< FF3 and FF3-1 */
+    } shape;
+    fpe_alphabet *alphabet;         /**< Compiled alphabet, or NULL */
+    unsigned int *digits;           /**< String calls: in[len] | out[len] */
+};
+
+/* ========================================================================= */
+/*                                  Kernels                                  */
+/* ========================================================================= */
+
+static int plan_ff1_encrypt(const FPE_PLAN *plan, const unsigned int *in,
+                            unsigned int *out, const unsigned char *tweak) {
+    return ff1_crypt_shaped(plan->ctx, &plan->shape.ff1, in, out, tweak, 1);
+}
+
+static int plan_ff1_decrypt(const FPE_PLAN *plan, const unsigned int *in,
+                            unsigned int *out, const unsigned char *tweak) {
+    return ff1_crypt_shaped(plan->ctx, &plan->shape.ff1, in, out, tweak, 0);
+}
+
+static int plan_ff3_encrypt(const FPE_PLAN *plan, const unsigned int *in,
+                            unsigned int *out, const unsigned char *tweak) {
+    return ff3_encrypt_shaped(plan->ctx, &plan->shape.ff3, in, out, tweak);
+}
+
+static int plan_ff3_decrypt(const FPE_PLAN *plan, const unsigned int *in,
+                            unsigned int *out, const unsigned char *tweak) {
+    return ff3_decrypt_shaped(plan->ctx, &plan->shape.ff3, in, out, tweak);
+}
+
+static int plan_ff3_1_encrypt(const FPE_PLAN *plan, const unsigned int *in,
+                              unsigned int *out, const unsigned char *tweak) {
+    return ff3_1_encrypt_shaped(plan->ctx, &plan->shape.ff3, in, out, tweak);
+}
+
+static int plan_ff3_1_decrypt(const FPE_PLAN *plan, const unsigned int *in,
+                              unsigned int *out, const unsigned char *tweak) {
+    return ff3_1_decrypt_shaped(plan->ctx, &plan->shape.ff3, in, out, tweak);
+}
+
+/* ========================================================================= */
+/*                              Plan Lifecycle                               */
+/* ========================================================================= */
+
+FPE_PLAN *FPE_PLAN_new(FPE_CTX *ctx, unsigned int len, unsigned int tweak_len,
+                       const char *alphabet) {
+    if (!ctx || !ctx->cipher_ctx) return NULL;
+    if (fpe_validate_tweak(ctx->mode, tweak_len) != 0) return NULL;
+
+    FPE_PLAN *plan = (FPE_PLAN *)calloc(1, sizeof(FPE_PLAN));
+    if (!plan) return NULL;
+    plan->ctx = ctx;
+    plan->mode = ctx->mode;
+    plan->len = len;
+    plan->tweak_len = tweak_len;
+
+    switch (ctx->mode) {
+        case FPE_MODE_FF1:
+            if (ff1_shape_init(&plan->shape.ff1, ctx->radix, len, tweak_len) != 0 ||
+                ff1_shape_moduli(ctx, &plan->shape.ff1) != 0) {
+                goto fail;
+            }
+            plan->encrypt = plan_ff1_encrypt;
+            plan->decrypt = plan_ff1_decrypt;
+            break;
+        case FPE_MODE_FF3:
+            if (ff3_shape_init(&plan->shape.ff3, ctx->radix, len, tweak_len) != 0) goto fail;
+            plan->encrypt = plan_ff3_encrypt;
+            plan->decrypt = plan_ff3_decrypt;
+            break;
+        case FPE_MODE_FF3_1:
+            if (ff3_shape_init(&plan->shape.ff3, ctx->radix, len, tweak_len) != 0) goto fail;
+            plan->encrypt = plan_ff3_1_encrypt;
+            plan->decrypt = plan_ff3_1_decrypt;
+            break;
+        default:
+            goto fail;
+    }
+
+    if (alphabet) {
+        plan->alphabet = (fpe_alphabet *)malloc(sizeof(fpe_alphabet));
+        plan->digits = (unsigned int *)malloc(2 * (size_t)len * sizeof(unsigned int));
+        if (!plan->alphabet || !plan->digits) goto fail;
+        if (fpe_alphabet_compile(plan->alphabet, alphabet) != ctx->radix) goto fail;
+    }
+    return plan;
+
+fail:
+    FPE_PLAN_free(plan);
+    return NULL;
+}
+
+void FPE_PLAN_free(FPE_PLAN *plan) {
+    if (!plan) return;
+
+    if (plan->mode == FPE_MODE_FF1) {
+        ff1_shape_release(&plan->shape.ff1);
+    }
+    if (plan->digits) {
+        /* Holds the numerals of the last string call */
+        fpe_secure_zero(plan->digits, 2 * (size_t)plan->len * sizeof(unsigned int));
+        free(plan->digits);
+    }
+    free(plan->alphabet);
+    free(plan);
+}
+
+/* ========================================================================= */
+/*                                Operations                                 */
+/* ========================================================================= */
+
+int FPE_PLAN_encrypt(FPE_PLAN *plan, const unsigned int *in, unsigned int *out,
+                     const unsigned char *tweak) {
+    if (!plan || !in || !out) return -1;
+    if (plan->tweak_len > 0 && !tweak) return -1;
+
+    FPE_CTX *ctx = plan->ctx;
+    FPE_PROBE4(encrypt__entry, ctx, ctx->mode, plan->len, ctx->radix);
+    uint64_t t0 = ctx->latency ? fpe_ticks() : 0;
+
+    int ret = plan->encrypt(plan, in, out, tweak);
+
+    FPE_STAT_OP(ctx, 1, plan->len, 0, ret);
+    if (ctx->latency) fpe_latency_record(ctx->latency, fpe_ticks() - t0);
+    FPE_PROBE5(encrypt__return, ctx, ctx->mode, plan->len, ctx->radix, ret);
+    return ret;
+}
+
+int FPE_PLAN_decrypt(FPE_PLAN *plan, const unsigned int *in, unsigned int *out,
+                     const unsigned char *tweak) {
+    if (!plan || !in || !out) return -1;
+    if (plan->tweak_len > 0 && !tweak) return -1;
+
+    FPE_CTX *ctx = plan->ctx;
+    FPE_PROBE4(decrypt__entry, ctx, ctx->mode, plan->len, ctx->radix);
+    uint64_t t0 = ctx->latency ? fpe_ticks() : 0;
+
+    int ret = plan->decrypt(plan, in, out, tweak);
+
+    FPE_STAT_OP(ctx, 0, plan->len, 0, ret);
+    if (ctx->latency) fpe_latency_record(ctx->latency, fpe_ticks() - t0);
+    FPE_PROBE5(decrypt__return, ctx, ctx->mode, plan->len, ctx->radix, ret);
+    return ret;
+}
+
+/**
+ * @brief Shared driver for FPE_PLAN_encrypt_str / FPE_PLAN_decrypt_str
+ */
+static int fpe_plan_str(FPE_PLAN *plan, const char *in, char *out,
+                        const unsigned char *tweak, int encrypt) {
+    if (!plan || !plan->alphabet || !in || !out) return -1;
+
+    unsigned int len = plan->len;
+    if (strlen(in) != len) {
+        FPE_STAT_ADD(plan->ctx, rejected, 1);
+        return -1;
+    }
+
+    unsigned int *in_arr = plan->digits, *out_arr = plan->digits + len;
+
+    FPE_STAT_TIMER(t);
+    int ret = fpe_alphabet_map(plan->alphabet, in, in_arr, len);
+    FPE_STAT_LAP(plan->ctx, convert_cycles, t);
+
+    if (ret == 0) {
+        ret = encrypt
+            ? FPE_PLAN_encrypt(plan, in_arr, out_arr, tweak)
+            : FPE_PLAN_decrypt(plan, in_arr, out_arr, tweak);
+    } else {
+        FPE_STAT_ADD(plan->ctx, rejected, 1);
+    }
+
+    if (ret == 0) {
+        FPE_STAT_TIMER(t2);
+        ret = fpe_alphabet_unmap(plan->alphabet, out_arr, out, len);
+        FPE_STAT_LAP(plan->ctx, convert_cycles, t2);
+        if (ret == 0) {
+            out[len] = '\0';
+            FPE_STAT_ADD(plan->ctx, bytes, len);
+        }
+    }
+    return ret;
+}
+
+int FPE_PLAN_encrypt_str(FPE_PLAN *plan, const char *in, char *out,
+                         const unsigned char *tweak) {
+    return fpe_plan_str(plan, in, out, tweak, 1);
+}
+
+int FPE_PLAN_decrypt_str(FPE_PLAN *plan, const char *in, char *out,
+                         const unsigned char *tweak) {
+    return fpe_plan_str(plan, in, out, tweak, 0);
+}
@@ -0,0 +1,52 @@
+/**
+ * @file probes.h
+ * @brief USDT static tracepoints (provider "fpe") behind ENABLE_USDT
+ *
+ * With ENABLE_USDT and <sys/sdt.h> available, each FPE_PROBE site is a
+ * single nop plus an ELF note describing where its arguments live; it
+ * costs nothing until bpftrace or perf attaches. Otherwise the macros
+ * expand to nothing and the arguments are not evaluated.
+ *
+ * Probes (arguments in order):
+ *   ctx__init       ctx, mode, algo, key bits, radix, rc
+ *   ctx__free       ctx
+ *   encrypt__entry  ctx, mode, len, radix
+ *   encrypt__return ctx, mode, len, radix, rc
+ *   decrypt__entry  ctx, mode, len, radix
+ *   decrypt__return ctx, mode, len, radix, rc
+ *   batch__start    ctx, encrypt, len, count       (FPE_*_batch)
+ *   batch__end      ctx, encrypt, len, count, rc
+ *   iov__start      ctx, encrypt, count            (FPE_*_iov)
+ *   iov__end        ctx, encrypt, count, rc
+ *
+ * encrypt__* and decrypt__* fire only for records that pass through
+ * FPE_encrypt/FPE_decrypt or FPE_PLAN_encrypt/FPE_PLAN_decrypt, the same
+ * set FPE_CTX_set_latency times. FF1 and FF3-1 batches, FF1 iov lane
+ * groups and the FF1 byte kernel bypass them; use batch__* and iov__*
+ * for those, and nothing fires for the FF1 byte kernel.
+ */
+
+#ifndef FPE_PROBES_H
+#define FPE_PROBES_H
+
+#ifdef FPE_HAVE_SDT
+
+#include <sys/sdt.h>
+
+#define FPE_PROBE1(name, a) DTRACE_PROBE1(fpe, name, a)
+#define FPE_PROBE3(name, a, b, c) DTRACE_PROBE3(fpe, name, a, b, c)
+#define FPE_PROBE4(name, a, b, c, d) DTRACE_PROBE4(fpe, name, a, b, c, d)
+#define FPE_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5(fpe, name, a, b, c, d, e)
+#define FPE_PROBE6(name, a, b, c, d, e, f) DTRACE_PROBE6(fpe, name, a, b, c, d, e, f)
+
+#else
+
+#define FPE_PROBE1(name, a) ((void)0)
+#define FPE_PROBE3(name, a, b, c) ((void)0)
+#define FPE_PROBE4(name, a, b, c, d) ((void)0)
+#define FPE_PROBE5(name, a, b, c, d, e) ((void)0)
+#define FPE_PROBE6(name, a, b, c, d, e, f) ((void)0)
+
+#endif /* FPE_HAVE_SDT */
+
+#endif /* FPE_PROBES_H */
@@ -0,0 +1,88 @@
+/**
+ * @file stats.c
+ * @brief Per-context and process-wide operation counters
+ */
+
+#include "stats.h"
+#include <string.h>
+
+#ifdef FPE_ENABLE_STATS
+
+#if defined(FPE_HAVE_PTHREAD)
+#include <pthread.h>
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+#define GLOBAL_LOCK() pthread_mutex_lock(&global_lock)
+#define GLOBAL_UNLOCK() pthread_mutex_unlock(&global_lock)
+#else
+#define GLOBAL_LOCK() ((void)0)
+#define GLOBAL_UNLOCK() ((void)0)
+#endif
+
+/* Counters of freed and reset contexts */
+static FPE_STATS global_stats;
+
+static void stats_add(FPE_STATS *dst, const FPE_STATS *src) {
+    dst->encrypt_calls += src->encrypt_calls;
+    dst->decrypt_calls += src->decrypt_calls;
+    dst->cipher_blocks += src->cipher_blocks;
+    dst->digits += src->digits;
+    dst->bytes += src->bytes;
+    dst->rejected += src->rejected;
+    dst->cache_hits += src->cache_hits;
+    dst->cache_misses += src->cache_misses;
+    dst->prf_cycles += src->prf_cycles;
+    dst->convert_cycles += src->convert_cycles;
+    dst->arith_cycles += src->arith_cycles;
+}
+
+int FPE_CTX_get_stats(const FPE_CTX *ctx, FPE_STATS *stats) {
+    if (!ctx || !stats) return -1;
+    *stats = ctx->stats;
+    return 0;
+}
+
+void FPE_CTX_reset_stats(FPE_CTX *ctx) {
+    if (!ctx) return;
+
+    GLOBAL_LOCK();
+    stats_add(&global_stats, &ctx->stats);
+    GLOBAL_UNLOCK();
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
+int FPE_get_global_stats(FPE_STATS *stats) {
+    if (!stats) return -1;
+
+    GLOBAL_LOCK();
+    *stats = global_stats;
+    GLOBAL_UNLOCK();
+    return 0;
+}
+
+void FPE_reset_global_stats(void) {
+    GLOBAL_LOCK();
+    memset(&global_stats, 0, sizeof(global_stats));
+    GLOBAL_UNLOCK();
+}
+
+#else
+
+int FPE_CTX_get_stats(const FPE_CTX *ctx, FPE_STATS *stats) {
+    (void)ctx;
+    if (stats) memset(stats, 0, sizeof(*stats));
+    return -1;
+}
+
+void FPE_CTX_reset_stats(FPE_CTX *ctx) {
+    (void)ctx;
+}
+
+int FPE_get_global_stats(FPE_STATS *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    return -1;
+}
+
+void FPE_reset_global_stats(void) {
+}
+
+#endif /* FPE_ENABLE_STATS */
@@ -0,0 +1,93 @@
+/**
+ * @file stats.h
+ * @brief Operation counters behind ENABLE_STATS, and latency histograms
+ *
+ * The kernels count through the macros below, which expand to nothing
+ * unless FPE_ENABLE_STATS is defined, so a default build carries no
+ * counting code at all. Counters live in the context and are plain
+ * increments: a context is never used by two threads at once.
+ *
+ * Cycle accounting (FPE_ENABLE_STATS_CYCLES) splits a Feistel call into
+ * laps: FPE_STAT_TIMER starts a lap and each FPE_STAT_LAP charges the time
+ * since the previous lap to one phase, one timestamp per phase boundary.
+ *
+ * Latency histograms are not compiled out: they are attached at run time
+ * and cost one pointer test per call when no histogram is attached.
+ */
+
+#ifndef FPE_STATS_H
+#define FPE_STATS_H
+
+#include "fpe_internal.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @brief Cheap monotonic timestamp: TSC ticks on x86, nanoseconds elsewhere
+ */
+static inline uint64_t fpe_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef FPE_ENABLE_STATS
+
+#define FPE_STAT_ADD(ctx, field, n) ((ctx)->stats.field += (uint64_t)(n))
+
+/* A finished call over n records: ret != 0 counts as one rejection */
+#define FPE_STAT_OPS(ctx, encrypt, n, n_digits, n_bytes, ret) do {             \
+        if ((ret) != 0) {                                                       \
+            (ctx)->stats.rejected++;                                            \
+        } else {                                                                \
+            if (encrypt) (ctx)->stats.encrypt_calls += (uint64_t)(n);           \
+            else (ctx)->stats.decrypt_calls += (uint64_t)(n);                   \
+            (ctx)->stats.digits += (uint64_t)(n_digits);                        \
+            (ctx)->stats.bytes += (uint64_t)(n_bytes);                          \
+        }                                                                       \
+    } while (0)
+
+#define FPE_STAT_OP(ctx, encrypt, n_digits, n_bytes, ret) \
+    FPE_STAT_OPS(ctx, encrypt, 1, n_digits, n_bytes, ret)
+
+#else
+
+#define FPE_STAT_ADD(ctx, field, n) ((void)0)
+#define FPE_STAT_OPS(ctx, encrypt, n, n_digits, n_bytes, ret) ((void)0)
+#define FPE_STAT_OP(ctx, encrypt, n_digits, n_bytes, ret) ((void)0)
+
+#endif /* FPE_ENABLE_STATS */
+
+#ifdef FPE_ENABLE_STATS_CYCLES
+
+#define FPE_STAT_TIMER(t) uint64_t t = fpe_ticks()
+#define FPE_STAT_LAP(ctx, field, t) do {                                        \
+        uint64_t now_ = fpe_ticks();                                            \
+        (ctx)->stats.field += now_ - (t);                                       \
+        (t) = now_;                                                             \
+    } while (0)
+
+#else
+
+#define FPE_STAT_TIMER(t) ((void)0)
+#define FPE_STAT_LAP(ctx, field, t) ((void)0)
+
+#endif /* FPE_ENABLE_STATS_CYCLES */
+
+/**
+ * @brief Add one call of the given duration in fpe_ticks() units
+ * 
+ * Lock-free: contexts on different threads may share the histogram.
+ */
+void fpe_latency_record(FPE_LATENCY *h, uint64_t ticks);
+
+#endif /* FPE_STATS_H */
@@ -0,0 +1,377 @@
+/**
+ * @file stream.c
+ * @brief Streaming record encryption with bounded memory
+ *
+ * A stream owns two chunk buffers. One is filled by FPE_STREAM_write; when
+ * it is full, the complete records in it are submitted and the trailing
+ * partial record is carried into the other buffer, which must have been
+ * read out first. Submitted records are encrypted in place (lengths never
+ * change) through FPE_encrypt_iov, either inline or, with
+ * FPE_STREAM_ASYNC, on a background thread so encryption of one chunk
+ * overlaps the caller's I/O on the next.
+ */
+
+#include "fpe_internal.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FPE_HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+/* Records per FPE_encrypt_iov call */
+#define STREAM_WINDOW 64
+
+/* Chunks larger than this could hold a record longer than an FPE_IOV */
+#define STREAM_MAX_CHUNK ((size_t)1 << 30)
+
+typedef enum {
+    STREAM_FREE = 0,   /**< Read out, available for filling */
+    STREAM_FILLING,    /**< Receiving input */
+    STREAM_QUEUED,     /**< Submitted, not yet processed */
+    STREAM_DONE        /**< Processed, being read out */
+} stream_state;
+
+typedef struct {
+    char *data;
+    size_t len;        /**< Bytes filled */
+    size_t submit;     /**< Bytes submitted for processing */
+    size_t drained;    /**< Bytes already read out */
+    stream_state state;
+} stream_buf;
+
+struct fpe_stream_st {
+    FPE_CTX *ctx;
+    char alphabet[257];
+    unsigned char *tweak;
+    unsigned int tweak_len;
+    unsigned int flags;
+    size_t chunk;
+    stream_buf buf[2];
+    unsigned int fill;   /**< Buffer being filled; the other is the oldest submitted */
+    int finished;
+    int error;
+#if defined(FPE_HAVE_PTHREAD)
+    int async;
+    int stop;
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+};
+
+/* ========================================================================= */
+/*                              Chunk Processing                             */
+/* ========================================================================= */
+
+/**
+ * @brief Encrypt or decrypt every record in b->data[0 .. b->submit)
+ */
+static int stream_process(FPE_STREAM *s, stream_buf *b) {
+    FPE_IOV iov[STREAM_WINDOW];
+    size_t n = 0;
+    char *p = b->data;
+    char *end = b->data + b->submit;
+    int decrypt = (s->flags & FPE_STREAM_DECRYPT) != 0;
+
+    while (p < end) {
+        char *nl = (char *)memchr(p, '\n', (size_t)(end - p));
+        char *rec_end = nl ? nl : end;
+        size_t len = (size_t)(rec_end - p);
+        if (len > 0 && p[len - 1] == '\r') len--;
+
+        if (len > 0) {
+            iov[n].base = p;
+            iov[n].len = (unsigned int)len;
+            iov[n].tweak = s->tweak;
+            iov[n].tweak_len = s->tweak_len;
+            if (++n == STREAM_WINDOW) {
+                int ret = decrypt
+                    ? FPE_decrypt_iov(s->ctx, s->alphabet, iov, n)
+                    : FPE_encrypt_iov(s->ctx, s->alphabet, iov, n);
+                if (ret != 0) return -1;
+                n = 0;
+            }
+        }
+        p = nl ? nl + 1 : end;
+    }
+
+    if (n == 0) return 0;
+    return decrypt
+        ? FPE_decrypt_iov(s->ctx, s->alphabet, iov, n)
+        : FPE_encrypt_iov(s->ctx, s->alphabet, iov, n);
+}
+
+#if defined(FPE_HAVE_PTHREAD)
+static void *stream_worker(void *arg) {
+    FPE_STREAM *s = (FPE_STREAM *)arg;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        stream_buf *b = NULL;
+        while (!s->stop) {
+            if (s->buf[0].state == STREAM_QUEUED) b = &s->buf[0];
+            else if (s->buf[1].state == STREAM_QUEUED) b = &s->buf[1];
+            if (b) break;
+            pthread_cond_wait(&s->cond, &s->lock);
+        }
+        if (s->stop) break;
+        pthread_mutex_unlock(&s->lock);
+
+        int ret = stream_process(s, b);
+
+        pthread_mutex_lock(&s->lock);
+        if (ret != 0) s->error = 1;
+        b->state = STREAM_DONE;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Change a buffer's state, under the lock when a worker is running
+ */
+static void stream_set_state(FPE_STREAM *s, stream_buf *b, stream_state st) {
+#if defined(FPE_HAVE_PTHREAD)
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        b->state = st;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+#endif
+    b->state = st;
+}
+
+/**
+ * @brief Submit the first n bytes of the filling buffer and swap buffers
+ *
+ * The rest of the filling buffer (a partial record) moves to the other
+ * buffer, which must be free.
+ */
+static int stream_submit(FPE_STREAM *s, size_t n) {
+    stream_buf *b = &s->buf[s->fill];
+    stream_buf *next = &s->buf[s->fill ^ 1];
+
+    memcpy(next->data, b->data + n, b->len - n);
+    next->len = b->len - n;
+    next->submit = next->drained = 0;
+    stream_set_state(s, next, STREAM_FILLING);
+
+    b->submit = n;
+    b->drained = 0;
+    s->fill ^= 1;
+
+#if defined(FPE_HAVE_PTHREAD)
+    if (s->async) {
+        stream_set_state(s, b, STREAM_QUEUED);
+        return 0;
+    }
+#endif
+
+    b->state = STREAM_DONE;
+    return stream_process(s, b);
+}
+
+/**
+ * @brief Whether processing has failed (set by the worker under the lock)
+ */
+static int stream_failed(FPE_STREAM *s) {
+#if defined(FPE_HAVE_PTHREAD)
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        int error = s->error;
+        pthread_mutex_unlock(&s->lock);
+        return error;
+    }
+#endif
+    return s->error;
+}
+
+static void stream_set_failed(FPE_STREAM *s) {
+#if defined(FPE_HAVE_PTHREAD)
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        s->error = 1;
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+#endif
+    s->error = 1;
+}
+
+/**
+ * @brief State of the oldest submitted buffer, waiting out background work
+ */
+static stream_state stream_head_state(FPE_STREAM *s) {
+    stream_buf *h = &s->buf[s->fill ^ 1];
+#if defined(FPE_HAVE_PTHREAD)
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        while (h->state == STREAM_QUEUED) pthread_cond_wait(&s->cond, &s->lock);
+        stream_state st = h->state;
+        pthread_mutex_unlock(&s->lock);
+        return st;
+    }
+#endif
+    return h->state;
+}
+
+/* ========================================================================= */
+/*                               Public API                                  */
+/* ========================================================================= */
+
+FPE_STREAM *FPE_STREAM_new(FPE_CTX *ctx, const char *alphabet,
+                           const unsigned char *tweak, unsigned int tweak_len,
+                           size_t chunk_size, unsigned int flags) {
+    if (!ctx || !alphabet || (tweak_len > 0 && !tweak)) return NULL;
+    if (flags & ~(unsigned int)(FPE_STREAM_DECRYPT | FPE_STREAM_ASYNC)) return NULL;
+    if (chunk_size == 0) chunk_size = FPE_STREAM_DEFAULT_CHUNK;
+    if (chunk_size < 4 || chunk_size > STREAM_MAX_CHUNK) return NULL;
+
+    unsigned int radix = fpe_validate_alphabet(alphabet);
+    if (radix == 0 || radix != ctx->radix) return NULL;
+    if (fpe_validate_tweak(ctx->mode, tweak_len) != 0) return NULL;
+
+    FPE_STREAM *s = (FPE_STREAM *)calloc(1, sizeof(FPE_STREAM));
+    if (!s) return NULL;
+
+    s->ctx = ctx;
+    strcpy(s->alphabet, alphabet);
+    s->tweak_len = tweak_len;
+    s->flags = flags;
+    s->chunk = chunk_size;
+    s->buf[0].data = (char *)malloc(chunk_size);
+    s->buf[1].data = (char *)malloc(chunk_size);
+    s->tweak = (unsigned char *)malloc(tweak_len > 0 ? tweak_len : 1);
+    if (!s->buf[0].data || !s->buf[1].data || !s->tweak) goto fail;
+    if (tweak_len > 0) memcpy(s->tweak, tweak, tweak_len);
+    s->buf[0].state = STREAM_FILLING;
+
+#if defined(FPE_HAVE_PTHREAD)
+    if (flags & FPE_STREAM_ASYNC) {
+        if (pthread_mutex_init(&s->lock, NULL) != 0) goto fail;
+        if (pthread_cond_init(&s->cond, NULL) != 0) {
+            pthread_mutex_destroy(&s->lock);
+            goto fail;
+        }
+        if (pthread_create(&s->worker, NULL, stream_worker, s) != 0) {
+            pthread_cond_destroy(&s->cond);
+            pthread_mutex_destroy(&s->lock);
+            goto fail;
+        }
+        s->async = 1;
+    }
+#endif
+
+    return s;
+
+fail:
+    free(s->buf[0].data);
+    free(s->buf[1].data);
+    free(s->tweak);
+    free(s);
+    return NULL;
+}
+
+int FPE_STREAM_write(FPE_STREAM *stream, const char *in, size_t len, size_t *consumed) {
+    if (consumed) *consumed = 0;
+    if (!stream || (!in && len > 0) || !consumed) return -1;
+    if (stream->finished || stream_failed(stream)) return -1;
+
+    size_t taken = 0;
+    while (taken < len) {
+        stream_buf *b = &stream->buf[stream->fill];
+        size_t space = stream->chunk - b->len;
+
+        if (space > 0) {
+            size_t n = (len - taken < space) ? len - taken : space;
+            memcpy(b->data + b->len, in + taken, n);
+            b->len += n;
+            taken += n;
+            continue;
+        }
+
+        /* Full: everything up to the last newline is complete records */
+        size_t cut = b->len;
+        while (cut > 0 && b->data[cut - 1] != '\n') cut--;
+        if (cut == 0) {
+            stream_set_failed(stream);   /* Record longer than a chunk */
+            return -1;
+        }
+        if (stream_head_state(stream) != STREAM_FREE) break;
+        if (stream_submit(stream, cut) != 0) {
+            stream_set_failed(stream);
+            return -1;
+        }
+    }
+
+    *consumed = taken;
+    return 0;
+}
+
+int FPE_STREAM_finish(FPE_STREAM *stream) {
+    if (!stream || stream_failed(stream)) return -1;
+    stream->finished = 1;
+    return 0;
+}
+
+int FPE_STREAM_read(FPE_STREAM *stream, char *out, size_t cap, size_t *produced) {
+    if (produced) *produced = 0;
+    if (!stream || (!out && cap > 0) || !produced) return -1;
+
+    for (;;) {
+        stream_state st = stream_head_state(stream);
+        if (stream_failed(stream)) return -1;
+
+        stream_buf *h = &stream->buf[stream->fill ^ 1];
+        if (st == STREAM_DONE) {
+            size_t n = h->submit - h->drained;
+            if (n > cap) n = cap;
+            memcpy(out, h->data + h->drained, n);
+            h->drained += n;
+            if (h->drained == h->submit) {
+                fpe_secure_zero(h->data, h->submit);
+                stream_set_state(stream, h, STREAM_FREE);
+            }
+            *produced = n;
+            return 0;
+        }
+
+        /* Nothing in flight: after finish, the last chunk goes out whole */
+        stream_buf *b = &stream->buf[stream->fill];
+        if (!stream->finished || b->len == 0) return 0;
+        if (stream_submit(stream, b->len) != 0) {
+            stream_set_failed(stream);
+            return -1;
+        }
+    }
+}
+
+void FPE_STREAM_free(FPE_STREAM *stream) {
+    if (!stream) return;
+
+#if defined(FPE_HAVE_PTHREAD)
+    if (stream->async) {
+        pthread_mutex_lock(&stream->lock);
+        stream->stop = 1;
+        pthread_cond_broadcast(&stream->cond);
+        pthread_mutex_unlock(&stream->lock);
+        pthread_join(stream->worker, NULL);
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->lock);
+    }
+#endif
+
+    for (int i = 0; i < 2; i++) {
+        fpe_secure_zero(stream->buf[i].data, stream->chunk);
+        free(stream->buf[i].data);
+    }
+    fpe_secure_zero(stream->tweak, stream->tweak_len);
+    free(stream->tweak);
+    free(stream);
+}
@@ -9,6 +9,16 @@
 #include <ctype.h>
 #include <sys/time.h>
 
+/* Below this length the stateless helpers map character by character */
+#define FPE_ALPHABET_COMPILE_MIN 64
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
 /* ========================================================================= */
 /*                         String/Alphabet Utilities                         */
 /* ========================================================================= */
@@ -35,6 +45,12 @@ int fpe_str_to_array(const char *alphabet, const char *str,
                      unsigned int *arr, unsigned int len) {
     if (!alphabet || !str || !arr) return -1;
     
+    /* Long strings amortize compiling the alphabet for the vectorized path */
+    fpe_alphabet a;
+    if (len >= FPE_ALPHABET_COMPILE_MIN && fpe_alphabet_compile(&a, alphabet) != 0) {
+        return fpe_alphabet_map(&a, str, arr, len);
+    }
+    
     for (unsigned int i = 0; i < len; i++) {
         int idx = fpe_char_to_index(alphabet, str[i]);
         if (idx < 0) return -1;  /* Invalid character */
@@ -48,6 +64,13 @@ int fpe_array_to_str(const char *alphabet, const unsigned int *arr,
                      char *str, unsigned int len) {
     if (!alphabet || !arr || !str) return -1;
     
+    fpe_alphabet a;
+    if (len >= FPE_ALPHABET_COMPILE_MIN && fpe_alphabet_compile(&a, alphabet) != 0) {
+        if (fpe_alphabet_unmap(&a, arr, str, len) != 0) return -1;
+        str[len] = '\0';  /* Null termination */
+        return 0;
+    }
+    
     size_t radix = strlen(alphabet);
     
     for (unsigned int i = 0; i < len; i++) {
@@ -59,6 +82,278 @@ int fpe_array_to_str(const char *alphabet, const unsigned int *arr,
     return 0;
 }
 
+/* ========================================================================= */
+/*                            Compiled Alphabets                             */
+/* ========================================================================= */
+
+#if defined(__SSSE3__)
+/**
+ * @brief The 4-bit hash used by NIBBLE alphabets
+ */
+static inline unsigned int alphabet_hash(const fpe_alphabet *a, unsigned char c) {
+    return (c + a->hash_hi[c >> 4]) & 15;
+}
+
+/**
+ * @brief Rotate a 16-bit set of low nibbles by off positions
+ */
+static inline unsigned int nibble_rotate(unsigned int set, unsigned int off) {
+    return ((set << off) | (set >> (16 - off))) & 0xFFFF;
+}
+
+/**
+ * @brief Pick per-high-nibble offsets so the rotated low-nibble sets are disjoint
+ * 
+ * groups[k] is the set of low nibbles used under high nibble his[k]. Plain
+ * backtracking; there are at most 16 groups of at most 16 candidates.
+ */
+static int alphabet_place_groups(fpe_alphabet *a, const unsigned int *groups,
+                                 const unsigned int *his, unsigned int k,
+                                 unsigned int n, unsigned int used) {
+    if (k == n) return 0;
+    
+    for (unsigned int off = 0; off < 16; off++) {
+        unsigned int set = off ? nibble_rotate(groups[k], off) : groups[k];
+        if (set & used) continue;
+        a->hash_hi[his[k]] = (unsigned char)off;
+        if (alphabet_place_groups(a, groups, his, k + 1, n, used | set) == 0) return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Look for a perfect 4-bit hash of the alphabet
+ */
+static int alphabet_find_hash(fpe_alphabet *a) {
+    unsigned int sets[16] = {0};
+    for (unsigned int i = 0; i < a->radix; i++) {
+        sets[a->chars[i] >> 4] |= 1u << (a->chars[i] & 15);
+    }
+    
+    /* Place the largest groups first; they are the hardest to fit */
+    unsigned int groups[16], his[16], sizes[16], n = 0;
+    for (unsigned int hi = 0; hi < 16; hi++) {
+        if (!sets[hi]) continue;
+        unsigned int size = 0;
+        for (unsigned int b = sets[hi]; b; b &= b - 1) size++;
+        
+        unsigned int k = n++;
+        for (; k > 0 && sizes[k - 1] < size; k--) {
+            groups[k] = groups[k - 1];
+            his[k] = his[k - 1];
+            sizes[k] = sizes[k - 1];
+        }
+        groups[k] = sets[hi];
+        his[k] = hi;
+        sizes[k] = size;
+    }
+    
+    memset(a->hash_hi, 0, sizeof(a->hash_hi));
+    return alphabet_place_groups(a, groups, his, 0, n, 0);
+}
+#endif /* __SSSE3__ */
+
+unsigned int fpe_alphabet_compile(fpe_alphabet *a, const char *alphabet) {
+    if (!a || !alphabet) return 0;
+    
+    size_t len = strlen(alphabet);
+    if (len < 2 || len > 255) return 0;
+    
+    memset(a->index, 0xFF, sizeof(a->index));
+    memset(a->chars, 0, sizeof(a->chars));
+    a->radix = (unsigned int)len;
+    
+    /* One pass builds both tables and catches duplicates in O(n) */
+    unsigned int runs = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)alphabet[i];
+        if (a->index[c] != 0xFF) return 0;  /* Duplicate found */
+        a->index[c] = (unsigned char)i;
+        a->chars[i] = c;
+        
+        /* Split into runs of consecutive ascending characters */
+        if (i > 0 && c == (unsigned char)(a->chars[i - 1] + 1)) {
+            if (runs <= FPE_ALPHABET_MAX_RUNS) a->run_len[runs - 1]++;
+        } else if (++runs <= FPE_ALPHABET_MAX_RUNS) {
+            a->run_first[runs - 1] = c;
+            a->run_base[runs - 1] = (unsigned char)i;
+            a->run_len[runs - 1] = 1;
+        }
+    }
+    
+    memcpy(a->source, alphabet, len + 1);
+    a->first = a->chars[0];
+    a->nruns = runs;
+    
+    if (runs == 1) {
+        a->kind = FPE_ALPHABET_RANGE;
+#if defined(__SSSE3__)
+    } else if (len <= 16 && alphabet_find_hash(a) == 0) {
+        a->kind = FPE_ALPHABET_NIBBLE;
+        memset(a->hash_lut, 0x80, sizeof(a->hash_lut));
+        for (size_t i = 0; i < len; i++) {
+            a->hash_lut[alphabet_hash(a, a->chars[i])] = (unsigned char)i;
+        }
+#endif
+    } else if (runs <= FPE_ALPHABET_MAX_RUNS) {
+        a->kind = FPE_ALPHABET_RUNS;
+    } else {
+        a->kind = FPE_ALPHABET_TABLE;
+    }
+    
+    return a->radix;
+}
+
+#if defined(__SSE2__)
+/* Widen 16 byte indices to 16 unsigned ints */
+static inline void alphabet_store_indices(unsigned int *arr, __m128i idx) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(idx, zero);
+    __m128i hi = _mm_unpackhi_epi8(idx, zero);
+    _mm_storeu_si128((__m128i *)arr, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(arr + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(arr + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i *)(arr + 12), _mm_unpackhi_epi16(hi, zero));
+}
+#endif
+
+int fpe_alphabet_map(const fpe_alphabet *a, const char *str,
+                     unsigned int *arr, unsigned int len) {
+    if (!a || !str || !arr) return -1;
+    
+    const unsigned char *s = (const unsigned char *)str;
+    unsigned int bad = 0;
+    unsigned int i = 0;
+    
+#if defined(__SSE2__)
+    if (a->kind == FPE_ALPHABET_RANGE) {
+        /* index = c - first; valid iff index <= radix - 1 (unsigned) */
+        __m128i first = _mm_set1_epi8((char)a->first);
+        __m128i limit = _mm_set1_epi8((char)(a->radix - 1));
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i idx = _mm_sub_epi8(v, first);
+            __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(idx, limit), idx);
+            bad |= (unsigned int)_mm_movemask_epi8(ok) ^ 0xFFFFu;
+            alphabet_store_indices(arr + i, idx);
+        }
+    }
+    if (a->kind == FPE_ALPHABET_RUNS) {
+        /* Each run matches by range and contributes c - first + base */
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i idx = _mm_setzero_si128();
+            __m128i hit = _mm_setzero_si128();
+            for (unsigned int r = 0; r < a->nruns; r++) {
+                __m128i off = _mm_sub_epi8(v, _mm_set1_epi8((char)a->run_first[r]));
+                __m128i in = _mm_cmpeq_epi8(
+                    _mm_min_epu8(off, _mm_set1_epi8((char)(a->run_len[r] - 1))), off);
+                off = _mm_add_epi8(off, _mm_set1_epi8((char)a->run_base[r]));
+                idx = _mm_or_si128(idx, _mm_and_si128(in, off));
+                hit = _mm_or_si128(hit, in);
+            }
+            bad |= (unsigned int)_mm_movemask_epi8(hit) ^ 0xFFFFu;
+            alphabet_store_indices(arr + i, idx);
+        }
+    }
+#endif
+#if defined(__SSSE3__)
+    if (a->kind == FPE_ALPHABET_NIBBLE) {
+        /* index = lut[h(c)]; valid iff chars[index] == c */
+        __m128i lut = _mm_loadu_si128((const __m128i *)a->hash_lut);
+        __m128i chars = _mm_loadu_si128((const __m128i *)a->chars);
+        __m128i hash_hi = _mm_loadu_si128((const __m128i *)a->hash_hi);
+        __m128i nib = _mm_set1_epi8(0x0F);
+        for (; i + 16 <= len; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+            __m128i h = _mm_and_si128(_mm_add_epi8(v, _mm_shuffle_epi8(hash_hi, hi)), nib);
+            __m128i idx = _mm_shuffle_epi8(lut, h);
+            __m128i ok = _mm_cmpeq_epi8(_mm_shuffle_epi8(chars, idx), v);
+            bad |= ((unsigned int)_mm_movemask_epi8(ok) ^ 0xFFFFu) |
+                   (unsigned int)_mm_movemask_epi8(idx);
+            alphabet_store_indices(arr + i, idx);
+        }
+    }
+#endif
+    
+    /* Table lookup for the tail and for TABLE alphabets; no branches */
+    for (; i < len; i++) {
+        unsigned char idx = a->index[s[i]];
+        bad |= (idx == 0xFF);
+        arr[i] = idx;
+    }
+    
+    return bad ? -1 : 0;
+}
+
+int fpe_alphabet_unmap(const fpe_alphabet *a, const unsigned int *arr,
+                       char *str, unsigned int len) {
+    if (!a || !arr || !str) return -1;
+    
+    unsigned char *s = (unsigned char *)str;
+    unsigned int bad = 0;
+    unsigned int i = 0;
+    
+#if defined(__SSE2__)
+    if (a->kind == FPE_ALPHABET_RANGE || a->kind == FPE_ALPHABET_RUNS
+#if defined(__SSSE3__)
+        || a->kind == FPE_ALPHABET_NIBBLE
+#endif
+        ) {
+        /* Unsigned compare against radix - 1 via a sign-bit bias */
+        __m128i bias = _mm_set1_epi32((int)0x80000000u);
+        __m128i limit = _mm_set1_epi32((int)((a->radix - 1) ^ 0x80000000u));
+        __m128i first = _mm_set1_epi8((char)a->first);
+#if defined(__SSSE3__)
+        __m128i chars = _mm_loadu_si128((const __m128i *)a->chars);
+#endif
+        for (; i + 16 <= len; i += 16) {
+            __m128i x0 = _mm_loadu_si128((const __m128i *)(arr + i));
+            __m128i x1 = _mm_loadu_si128((const __m128i *)(arr + i + 4));
+            __m128i x2 = _mm_loadu_si128((const __m128i *)(arr + i + 8));
+            __m128i x3 = _mm_loadu_si128((const __m128i *)(arr + i + 12));
+            __m128i gt = _mm_or_si128(
+                _mm_or_si128(_mm_cmpgt_epi32(_mm_xor_si128(x0, bias), limit),
+                             _mm_cmpgt_epi32(_mm_xor_si128(x1, bias), limit)),
+                _mm_or_si128(_mm_cmpgt_epi32(_mm_xor_si128(x2, bias), limit),
+                             _mm_cmpgt_epi32(_mm_xor_si128(x3, bias), limit)));
+            bad |= (unsigned int)_mm_movemask_epi8(gt);
+            
+            __m128i idx = _mm_packus_epi16(_mm_packs_epi32(x0, x1), _mm_packs_epi32(x2, x3));
+            __m128i out;
+#if defined(__SSSE3__)
+            if (a->kind == FPE_ALPHABET_NIBBLE) {
+                out = _mm_shuffle_epi8(chars, idx);
+            } else
+#endif
+            if (a->kind == FPE_ALPHABET_RUNS) {
+                /* Each run matches by index range and contributes idx - base + first */
+                out = _mm_setzero_si128();
+                for (unsigned int r = 0; r < a->nruns; r++) {
+                    __m128i off = _mm_sub_epi8(idx, _mm_set1_epi8((char)a->run_base[r]));
+                    __m128i in = _mm_cmpeq_epi8(
+                        _mm_min_epu8(off, _mm_set1_epi8((char)(a->run_len[r] - 1))), off);
+                    off = _mm_add_epi8(off, _mm_set1_epi8((char)a->run_first[r]));
+                    out = _mm_or_si128(out, _mm_and_si128(in, off));
+                }
+            } else {
+                out = _mm_add_epi8(idx, first);
+            }
+            _mm_storeu_si128((__m128i *)(s + i), out);
+        }
+    }
+#endif
+    
+    for (; i < len; i++) {
+        unsigned int idx = arr[i];
+        bad |= (idx >= a->radix);
+        s[i] = a->chars[idx & 0xFF];
+    }
+    
+    return bad ? -1 : 0;
+}
+
 /* ========================================================================= */
 /*                           Validation Functions                            */
 /* ========================================================================= */
@@ -69,13 +364,12 @@ unsigned int fpe_validate_alphabet(const char *alphabet) {
     size_t len = strlen(alphabet);
     if (len < 2 || len > 65536) return 0;
     
-    /* Check for duplicates using a simple O(n^2) approach */
+    /* Check for duplicates with a seen-table in one pass */
+    unsigned char seen[256] = {0};
     for (size_t i = 0; i < len; i++) {
-        for (size_t j = i + 1; j < len; j++) {
-            if (alphabet[i] == alphabet[j]) {
-                return 0;  /* Duplicate found */
-            }
-        }
+        unsigned char c = (unsigned char)alphabet[i];
+        if (seen[c]) return 0;  /* Duplicate found */
+        seen[c] = 1;
     }
     
     return (unsigned int)len;
@@ -55,6 +55,66 @@ int fpe_str_to_array(const char *alphabet, const char *str,
 int fpe_array_to_str(const char *alphabet, const unsigned int *arr,
                      char *str, unsigned int len);
 
+/* ========================================================================= */
+/*                            Compiled Alphabets                             */
+/* ========================================================================= */
+
+/**
+ * @brief Mapping strategy chosen for an alphabet
+ */
+typedef enum {
+    FPE_ALPHABET_RANGE = 0,  /**< Consecutive characters: index = c - first */
+    FPE_ALPHABET_NIBBLE,     /**< <= 16 characters: pshufb lookup on a 4-bit hash (SSSE3) */
+    FPE_ALPHABET_RUNS,       /**< A few consecutive runs: one range compare per run */
+    FPE_ALPHABET_TABLE       /**< Anything else: 256-entry byte tables */
+} fpe_alphabet_kind;
+
+/* Most runs a RUNS alphabet may have (base64 needs 5) */
+#define FPE_ALPHABET_MAX_RUNS 8
+
+/**
+ * @brief Alphabet precompiled for vectorized string <-> numeral mapping
+ */
+typedef struct fpe_alphabet {
+    fpe_alphabet_kind kind;
+    unsigned int radix;
+    unsigned char first;          /**< RANGE: alphabet[0] */
+    unsigned char hash_hi[16];    /**< NIBBLE: h(c) = (c + hash_hi[c >> 4]) & 15 */
+    unsigned char hash_lut[16];   /**< NIBBLE: h(c) -> index (0x80 if unused) */
+    unsigned int nruns;           /**< RUNS: number of runs */
+    unsigned char run_first[FPE_ALPHABET_MAX_RUNS];  /**< RUNS: first character */
+    unsigned char run_base[FPE_ALPHABET_MAX_RUNS];   /**< RUNS: index of run_first */
+    unsigned char run_len[FPE_ALPHABET_MAX_RUNS];    /**< RUNS: characters in the run */
+    unsigned char chars[256];     /**< index -> character */
+    unsigned char index[256];     /**< character -> index, 0xFF if absent */
+    char source[256];             /**< The alphabet string it was built from */
+} fpe_alphabet;
+
+/**
+ * @brief Compile an alphabet (2..255 distinct characters)
+ * 
+ * @param a Output
+ * @param alphabet The alphabet string
+ * @return radix on success, 0 on error (too short/long or duplicates)
+ */
+unsigned int fpe_alphabet_compile(fpe_alphabet *a, const char *alphabet);
+
+/**
+ * @brief Map str[0..len-1] to indices, validating every character
+ * 
+ * @return 0 on success, -1 if any character is not in the alphabet
+ */
+int fpe_alphabet_map(const fpe_alphabet *a, const char *str,
+                     unsigned int *arr, unsigned int len);
+
+/**
+ * @brief Map indices back to characters (str is not NUL-terminated)
+ * 
+ * @return 0 on success, -1 if any index is >= radix
+ */
+int fpe_alphabet_unmap(const fpe_alphabet *a, const unsigned int *arr,
+                       char *str, unsigned int len);
+
 /* ========================================================================= */
 /*                           Validation Functions                            */
 /* ========================================================================= */
@@ -0,0 +1,284 @@
+/**
+ * @file test_arrow.c
+ * @brief Unit tests for Arrow C Data Interface column encryption
+ */
+
+#include "test_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char digits[] = "0123456789";
+
+/* Input arrays live on the stack; release only has to be non-NULL */
+static void no_release(struct ArrowArray *array) {
+    array->release = NULL;
+}
+
+static struct ArrowSchema schema_of(const char *format) {
+    struct ArrowSchema schema;
+    memset(&schema, 0, sizeof(schema));
+    schema.format = format;
+    schema.flags = ARROW_FLAG_NULLABLE;
+    return schema;
+}
+
+static struct ArrowArray array_of(int64_t length, int64_t null_count, int64_t offset,
+                                  int64_t n_buffers, const void **buffers) {
+    struct ArrowArray array;
+    memset(&array, 0, sizeof(array));
+    array.length = length;
+    array.null_count = null_count;
+    array.offset = offset;
+    array.n_buffers = n_buffers;
+    array.buffers = buffers;
+    array.release = no_release;
+    return array;
+}
+
+/* ========================================================================= */
+/*                               String Columns                              */
+/* ========================================================================= */
+
+/* "4111111111111111", null, "", "123456", "9876543210" */
+static const char utf8_data[] = "4111111111111111" "000000" "123456" "9876543210";
+static const int32_t utf8_offsets[] = {0, 16, 22, 22, 28, 38};
+static const unsigned char utf8_validity[] = {0x1D};   /* 0b11101 */
+
+void test_arrow_utf8_matches_str_and_round_trips(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    struct ArrowSchema schema = schema_of("u");
+    const void *buffers[3] = {utf8_validity, utf8_offsets, utf8_data};
+    struct ArrowArray in = array_of(5, 1, 0, 3, buffers);
+    struct ArrowArray enc, dec;
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_arrow_utf8(ctx, digits, &schema, &in, &enc, test_tweak, 8));
+    TEST_ASSERT_NOT_NULL(enc.release);
+    TEST_ASSERT_EQUAL_INT(5, (int)enc.length);
+    TEST_ASSERT_EQUAL_INT(1, (int)enc.null_count);
+    TEST_ASSERT_EQUAL_INT(0, (int)enc.offset);
+    TEST_ASSERT_EQUAL_INT(3, (int)enc.n_buffers);
+
+    /* Same offsets and validity */
+    TEST_ASSERT_EQUAL_MEMORY(utf8_offsets, enc.buffers[1], sizeof(utf8_offsets));
+    TEST_ASSERT_EQUAL_UINT8(0x1D, ((const unsigned char *)enc.buffers[0])[0]);
+
+    /* Valid cells match the string API; the null slot is wiped */
+    const char *data = (const char *)enc.buffers[2];
+    char expect[32];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "4111111111111111", expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, data, 16);
+    TEST_ASSERT_EQUAL_MEMORY("\0\0\0\0\0\0", data + 16, 6);
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "123456", expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, data + 22, 6);
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "9876543210", expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, data + 28, 10);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_arrow_utf8(ctx, digits, &schema, &enc, &dec, test_tweak, 8));
+    const char *plain = (const char *)dec.buffers[2];
+    TEST_ASSERT_EQUAL_MEMORY(utf8_data, plain, 16);
+    TEST_ASSERT_EQUAL_MEMORY(utf8_data + 22, plain + 22, 16);
+
+    enc.release(&enc);
+    TEST_ASSERT_NULL(enc.release);
+    dec.release(&dec);
+    FPE_CTX_free(ctx);
+}
+
+void test_arrow_utf8_sliced(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    struct ArrowSchema schema = schema_of("u");
+    const void *buffers[3] = {utf8_validity, utf8_offsets, utf8_data};
+    /* Cells 1..4: null, "", "123456", "9876543210" */
+    struct ArrowArray in = array_of(4, 1, 1, 3, buffers);
+    struct ArrowArray enc;
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_arrow_utf8(ctx, digits, &schema, &in, &enc, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(0, (int)enc.offset);
+
+    const int32_t rebased[] = {0, 6, 6, 12, 22};
+    TEST_ASSERT_EQUAL_MEMORY(rebased, enc.buffers[1], sizeof(rebased));
+    TEST_ASSERT_EQUAL_UINT8(0x0E, ((const unsigned char *)enc.buffers[0])[0] & 0x0F);
+
+    /* The sliced-off cell is not in the output */
+    const char *data = (const char *)enc.buffers[2];
+    char expect[32];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "9876543210", expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, data + 12, 10);
+
+    enc.release(&enc);
+    FPE_CTX_free(ctx);
+}
+
+void test_arrow_large_utf8_many_cells(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 36);
+    const char *alnum = "0123456789abcdefghijklmnopqrstuvwxyz";
+    struct ArrowSchema schema = schema_of("U");
+
+    /* More cells than one batch window, no validity buffer */
+    enum { N = 1000 };
+    int64_t *offsets = (int64_t *)malloc((N + 1) * sizeof(int64_t));
+    char *data = (char *)malloc(N * 20);
+    int64_t pos = 0;
+    for (int i = 0; i < N; i++) {
+        offsets[i] = pos;
+        int len = 4 + i % 16;
+        for (int j = 0; j < len; j++) data[pos++] = alnum[(i * 7 + j * 13) % 36];
+    }
+    offsets[N] = pos;
+
+    const void *buffers[3] = {NULL, offsets, data};
+    struct ArrowArray in = array_of(N, 0, 0, 3, buffers);
+    struct ArrowArray enc, dec;
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_arrow_utf8(ctx, alnum, &schema, &in, &enc, test_tweak, 8));
+    TEST_ASSERT_NULL(enc.buffers[0]);
+    TEST_ASSERT_EQUAL_MEMORY(offsets, enc.buffers[1], (N + 1) * sizeof(int64_t));
+    TEST_ASSERT_TRUE(memcmp(data, enc.buffers[2], (size_t)pos) != 0);
+
+    char plain[32], expect[32];
+    memcpy(plain, data + offsets[N - 1], (size_t)(pos - offsets[N - 1]));
+    plain[pos - offsets[N - 1]] = '\0';
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, alnum, plain, expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, (const char *)enc.buffers[2] + offsets[N - 1],
+                             strlen(expect));
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_arrow_utf8(ctx, alnum, &schema, &enc, &dec, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(data, dec.buffers[2], (size_t)pos);
+
+    enc.release(&enc);
+    dec.release(&dec);
+    free(offsets);
+    free(data);
+    FPE_CTX_free(ctx);
+}
+
+void test_arrow_utf8_rejects_bad_input(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    struct ArrowSchema schema = schema_of("u");
+    struct ArrowSchema binary = schema_of("z");
+    const void *buffers[3] = {utf8_validity, utf8_offsets, utf8_data};
+    struct ArrowArray in = array_of(5, 1, 0, 3, buffers);
+    struct ArrowArray out;
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(ctx, digits, &binary, &in, &out, test_tweak, 8));
+    TEST_ASSERT_NULL(out.release);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(ctx, "0123456789abcdef", &schema, &in,
+                                                     &out, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(NULL, digits, &schema, &in, &out, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(ctx, digits, &schema, &in, NULL, test_tweak, 8));
+
+    /* A character outside the alphabet fails the column */
+    const char bad[] = "41111111x1111111";
+    const int32_t offsets[] = {0, 16};
+    const void *bad_buffers[3] = {NULL, offsets, bad};
+    struct ArrowArray bad_in = array_of(1, 0, 0, 3, bad_buffers);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(ctx, digits, &schema, &bad_in, &out, test_tweak, 8));
+    TEST_ASSERT_NULL(out.release);
+
+    /* Offsets must not decrease */
+    const int32_t backwards[] = {0, 10, 4};
+    const void *back_buffers[3] = {NULL, backwards, utf8_data};
+    struct ArrowArray back_in = array_of(2, 0, 0, 3, back_buffers);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_utf8(ctx, digits, &schema, &back_in, &out, test_tweak, 8));
+
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                               int64 Columns                               */
+/* ========================================================================= */
+
+static int digit_count(int64_t v) {
+    uint64_t mag = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+    int n = 1;
+    while (mag >= 10) {
+        mag /= 10;
+        n++;
+    }
+    return n;
+}
+
+void test_arrow_int64_round_trip(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    struct ArrowSchema schema = schema_of("l");
+
+    const int64_t values[] = {
+        4111111111111111LL, 10, -99, 0, 123456789,
+        INT64_MAX, INT64_MIN, 9000000000000000000LL, -9223372036854775807LL, 1000000
+    };
+    const unsigned char validity[] = {0xF7, 0x03};   /* Cell 3 is null */
+    const void *buffers[2] = {validity, values};
+    struct ArrowArray in = array_of(10, 1, 0, 2, buffers);
+    struct ArrowArray enc, dec;
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_arrow_int64(ctx, &schema, &in, &enc, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(2, (int)enc.n_buffers);
+
+    const int64_t *out = (const int64_t *)enc.buffers[1];
+    for (int i = 0; i < 10; i++) {
+        if (i == 3) {
+            TEST_ASSERT_TRUE(out[i] == 0);
+            continue;
+        }
+        /* Sign and digit count are kept */
+        TEST_ASSERT_EQUAL_INT(values[i] < 0, out[i] < 0);
+        TEST_ASSERT_EQUAL_INT(digit_count(values[i]), digit_count(out[i]));
+    }
+    TEST_ASSERT_TRUE(out[0] != values[0]);
+
+    char expect[32];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "123456789", expect, test_tweak, 8));
+    if (expect[0] != '0') TEST_ASSERT_TRUE(strtoll(expect, NULL, 10) == out[4]);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_arrow_int64(ctx, &schema, &enc, &dec, test_tweak, 8));
+    const int64_t *plain = (const int64_t *)dec.buffers[1];
+    for (int i = 0; i < 10; i++) {
+        if (i != 3) TEST_ASSERT_TRUE(values[i] == plain[i]);
+    }
+
+    enc.release(&enc);
+    dec.release(&dec);
+    FPE_CTX_free(ctx);
+}
+
+void test_arrow_int64_rejects_bad_input(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_CTX *hex = test_new_ctx(FPE_MODE_FF1, 16);
+    struct ArrowSchema schema = schema_of("l");
+    struct ArrowSchema int32 = schema_of("i");
+    struct ArrowArray out;
+
+    const int64_t values[] = {123456, 7};
+    const void *buffers[2] = {NULL, values};
+    struct ArrowArray in = array_of(1, 0, 0, 2, buffers);
+    struct ArrowArray single = array_of(1, 0, 1, 2, buffers);
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_int64(ctx, &int32, &in, &out, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_int64(hex, &schema, &in, &out, test_tweak, 8));
+    /* One digit is too short to encrypt */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_int64(ctx, &schema, &single, &out, test_tweak, 8));
+    TEST_ASSERT_NULL(out.release);
+
+    in.n_buffers = 3;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_arrow_int64(ctx, &schema, &in, &out, test_tweak, 8));
+
+    FPE_CTX_free(hex);
+    FPE_CTX_free(ctx);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_arrow_utf8_matches_str_and_round_trips);
+    RUN_TEST(test_arrow_utf8_sliced);
+    RUN_TEST(test_arrow_large_utf8_many_cells);
+    RUN_TEST(test_arrow_utf8_rejects_bad_input);
+    RUN_TEST(test_arrow_int64_round_trip);
+    RUN_TEST(test_arrow_int64_rejects_bad_input);
+
+    return UNITY_END();
+}
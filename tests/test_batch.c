@@ -0,0 +1,292 @@
+/**
+ * @file test_batch.c
+ * @brief Unit tests for the batch API, the lane-parallel FF1 kernel and the
+ *        pipelined kernels
+ */
+
+#include "../include/fpe.h"
+#include "../src/utils.h"
+#include "unity/src/unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const unsigned char test_key[16] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+    0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+/*
+ * Encrypt count records with the batch API and with FPE_encrypt one at a
+ * time; the results must agree and decrypt back.
+ */
+static void check_batch_matches_single(FPE_MODE mode, unsigned int radix,
+                                       unsigned int len, size_t count,
+                                       unsigned int tweak_len, size_t tweak_stride) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, mode, FPE_ALGO_AES, test_key, 128, radix));
+
+    size_t n = (size_t)len * count;
+    unsigned int *in = (unsigned int *)malloc(n * sizeof(unsigned int));
+    unsigned int *batch = (unsigned int *)malloc(n * sizeof(unsigned int));
+    unsigned int *single = (unsigned int *)malloc(n * sizeof(unsigned int));
+    unsigned int *back = (unsigned int *)malloc(n * sizeof(unsigned int));
+    size_t tweak_bytes = tweak_stride * count + tweak_len + 1;
+    unsigned char *tweaks = (unsigned char *)malloc(tweak_bytes);
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_NOT_NULL(single);
+    TEST_ASSERT_NOT_NULL(back);
+    TEST_ASSERT_NOT_NULL(tweaks);
+
+    for (size_t i = 0; i < n; i++) in[i] = (unsigned int)((i * 2654435761u) % radix);
+    for (size_t i = 0; i < tweak_bytes; i++) tweaks[i] = (unsigned char)(i * 37 + 11);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, in, batch, len, count,
+                                               tweaks, tweak_len, tweak_stride));
+
+    for (size_t r = 0; r < count; r++) {
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, in + r * len, single + r * len, len,
+                                             tweaks + r * tweak_stride, tweak_len));
+    }
+    TEST_ASSERT_EQUAL_UINT_ARRAY(single, batch, n);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_batch(ctx, batch, back, len, count,
+                                               tweaks, tweak_len, tweak_stride));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(in, back, n);
+
+    free(in);
+    free(batch);
+    free(single);
+    free(back);
+    free(tweaks);
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                           FF1 Lane Kernel                                 */
+/* ========================================================================= */
+
+void test_batch_ff1_radix10_lengths(void) {
+    const unsigned int lens[] = {2, 3, 9, 16, 19, 33, 64, 100, 128};
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF1, 10, lens[i], 21, 8, 8);
+    }
+}
+
+void test_batch_ff1_radices(void) {
+    const unsigned int radices[] = {2, 7, 26, 36, 62, 255, 256, 1000, 65535, 65536};
+
+    for (size_t i = 0; i < sizeof(radices) / sizeof(radices[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF1, radices[i], 24, 11, 8, 8);
+        check_batch_matches_single(FPE_MODE_FF1, radices[i], 7, 9, 3, 3);
+    }
+}
+
+void test_batch_ff1_partial_groups(void) {
+    /* Counts around the lane width exercise padded lanes */
+    const size_t counts[] = {1, 2, 7, 8, 9, 15, 16, 17};
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF1, 10, 16, counts[i], 8, 8);
+    }
+}
+
+void test_batch_ff1_tweak_layouts(void) {
+    /* Shared tweak, empty tweak, and tweaks spanning several Q blocks */
+    check_batch_matches_single(FPE_MODE_FF1, 10, 16, 20, 8, 0);
+    check_batch_matches_single(FPE_MODE_FF1, 10, 16, 20, 0, 0);
+    check_batch_matches_single(FPE_MODE_FF1, 36, 20, 20, 45, 50);
+    check_batch_matches_single(FPE_MODE_FF1, 36, 20, 20, 100, 0);
+}
+
+void test_batch_ff1_nist_vector(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, test_key, 128, 10));
+
+    /* Three copies of NIST FF1 sample 2 */
+    unsigned int in[30], out[30];
+    unsigned int expected[10] = {6, 1, 2, 4, 2, 0, 0, 7, 7, 3};
+    for (int i = 0; i < 30; i++) in[i] = i % 10;
+
+    unsigned char tweak[10];
+    fpe_hex_to_bytes("39383736353433323130", tweak, 10);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, in, out, 10, 3, tweak, 10, 0));
+    for (int r = 0; r < 3; r++) {
+        TEST_ASSERT_EQUAL_UINT_ARRAY(expected, out + r * 10, 10);
+    }
+
+    FPE_CTX_free(ctx);
+}
+
+void test_batch_in_place(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, test_key, 128, 10));
+
+    unsigned int data[12 * 16], orig[12 * 16];
+    for (int i = 0; i < 12 * 16; i++) data[i] = orig[i] = (i * 7) % 10;
+    unsigned char tweak[4] = {1, 2, 3, 4};
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, data, data, 16, 12, tweak, 4, 0));
+    TEST_ASSERT_TRUE(memcmp(data, orig, sizeof(data)) != 0);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_batch(ctx, data, data, 16, 12, tweak, 4, 0));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(orig, data, 12 * 16);
+
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                             Pipelined Kernels                             */
+/* ========================================================================= */
+
+void test_batch_ff1_long_records(void) {
+    /* Beyond the lane kernel's limit records go through the pipelined kernel */
+    check_batch_matches_single(FPE_MODE_FF1, 10, 300, 5, 8, 8);
+    check_batch_matches_single(FPE_MODE_FF1, 65536, 80, 9, 8, 8);
+}
+
+void test_batch_ff1_pipelined_shapes(void) {
+    /* Counts around the pipeline depth; slots are refilled mid-flight */
+    const size_t counts[] = {1, 7, 8, 9, 25};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF1, 10, 101, counts[i], 8, 8);
+    }
+
+    /* Empty tweak, shared tweak, and a tweak filling whole prefix blocks */
+    check_batch_matches_single(FPE_MODE_FF1, 10, 257, 10, 0, 0);
+    check_batch_matches_single(FPE_MODE_FF1, 36, 120, 10, 10, 0);
+    check_batch_matches_single(FPE_MODE_FF1, 36, 120, 10, 45, 50);
+
+    /* S spans many extension blocks */
+    check_batch_matches_single(FPE_MODE_FF1, 65536, 200, 11, 3, 3);
+}
+
+void test_batch_ff3_1_pipelined(void) {
+    const unsigned int radices[] = {2, 10, 36, 256, 65536};
+    for (size_t i = 0; i < sizeof(radices) / sizeof(radices[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF3_1, radices[i], 8, 12, 7, 7);
+    }
+
+    const unsigned int lens[] = {2, 3, 16, 19, 56, 256};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF3_1, 10, lens[i], 13, 7, 9);
+    }
+
+    const size_t counts[] = {1, 7, 8, 9, 25};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        check_batch_matches_single(FPE_MODE_FF3_1, 36, 17, counts[i], 7, 7);
+    }
+
+    check_batch_matches_single(FPE_MODE_FF3_1, 10, 16, 10, 7, 0);
+    check_batch_matches_single(FPE_MODE_FF3_1, 10, 16, 10, 0, 0);
+}
+
+void test_batch_pipelined_in_place(void) {
+    const FPE_MODE modes[] = {FPE_MODE_FF1, FPE_MODE_FF3_1};
+    const unsigned int lens[] = {150, 20};
+
+    for (int m = 0; m < 2; m++) {
+        FPE_CTX *ctx = FPE_CTX_new();
+        TEST_ASSERT_NOT_NULL(ctx);
+        TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, modes[m], FPE_ALGO_AES, test_key, 128, 10));
+
+        unsigned int len = lens[m];
+        unsigned int data[11 * 150], orig[11 * 150], single[11 * 150];
+        for (unsigned int i = 0; i < 11 * len; i++) data[i] = orig[i] = (i * 7) % 10;
+        unsigned char tweak[7] = {1, 2, 3, 4, 5, 6, 7};
+
+        for (unsigned int r = 0; r < 11; r++) {
+            TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, orig + r * len, single + r * len,
+                                                 len, tweak, 7));
+        }
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, data, data, len, 11, tweak, 7, 0));
+        TEST_ASSERT_EQUAL_UINT_ARRAY(single, data, 11 * len);
+        TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_batch(ctx, data, data, len, 11, tweak, 7, 0));
+        TEST_ASSERT_EQUAL_UINT_ARRAY(orig, data, 11 * len);
+
+        FPE_CTX_free(ctx);
+    }
+}
+
+void test_batch_ff3_modes(void) {
+    /* FF3 still runs one record at a time */
+    check_batch_matches_single(FPE_MODE_FF3, 10, 16, 10, 8, 8);
+}
+
+/* ========================================================================= */
+/*                               Error Handling                              */
+/* ========================================================================= */
+
+void test_batch_invalid_arguments(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, test_key, 128, 10));
+
+    unsigned int in[20] = {0}, out[20];
+    unsigned char tweak[8] = {0};
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(NULL, in, out, 10, 2, tweak, 8, 0));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, NULL, out, 10, 2, tweak, 8, 0));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, NULL, 10, 2, tweak, 8, 0));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 10, 2, NULL, 8, 0));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 1, 2, tweak, 8, 0));
+
+    /* An empty batch is a no-op */
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, NULL, NULL, 10, 0, NULL, 0, 0));
+
+    /* A digit out of range in any record fails the whole call */
+    in[13] = 10;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 10, 2, tweak, 8, 0));
+
+    FPE_CTX_free(ctx);
+
+    /* Also in the pipelined FF3-1 kernel, including records admitted late */
+    ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF3_1, FPE_ALGO_AES, test_key, 128, 10));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 10, 2, tweak, 7, 0));
+    in[13] = 0;
+    in[19] = 10;    /* Record 9 of 10, past the pipeline depth */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 2, 10, tweak, 7, 0));
+    in[19] = 0;
+    FPE_CTX_free(ctx);
+
+    /* FF3 tweak length is still enforced */
+    ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF3, FPE_ALGO_AES, test_key, 128, 10));
+    in[13] = 0;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_batch(ctx, in, out, 10, 2, tweak, 5, 0));
+    FPE_CTX_free(ctx);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* FF1 lane kernel */
+    RUN_TEST(test_batch_ff1_radix10_lengths);
+    RUN_TEST(test_batch_ff1_radices);
+    RUN_TEST(test_batch_ff1_partial_groups);
+    RUN_TEST(test_batch_ff1_tweak_layouts);
+    RUN_TEST(test_batch_ff1_nist_vector);
+    RUN_TEST(test_batch_in_place);
+
+    /* Pipelined kernels */
+    RUN_TEST(test_batch_ff1_long_records);
+    RUN_TEST(test_batch_ff1_pipelined_shapes);
+    RUN_TEST(test_batch_ff3_1_pipelined);
+    RUN_TEST(test_batch_pipelined_in_place);
+    RUN_TEST(test_batch_ff3_modes);
+
+    /* Error handling */
+    RUN_TEST(test_batch_invalid_arguments);
+
+    return UNITY_END();
+}
@@ -0,0 +1,276 @@
+/**
+ * @file test_bignum.c
+ * @brief Unit tests for the internal multi-precision arithmetic
+ */
+
+#include "../src/bignum.h"
+#include "unity/src/unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_LIMBS (1u << 20)
+
+static fpe_limb *arena_mem;
+static fpe_bn_arena arena;
+
+void setUp(void) {
+    arena_mem = (fpe_limb *)malloc(ARENA_LIMBS * sizeof(fpe_limb));
+    TEST_ASSERT_NOT_NULL(arena_mem);
+    fpe_bn_arena_init(&arena, arena_mem, ARENA_LIMBS * sizeof(fpe_limb));
+}
+
+void tearDown(void) {
+    free(arena_mem);
+    arena_mem = NULL;
+}
+
+/* Deterministic xorshift so failures are reproducible */
+static uint32_t rng_state = 0x12345678u;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void random_limbs(fpe_limb *x, size_t n) {
+    for (size_t i = 0; i < n; i++) x[i] = rng_next();
+    if (n > 0 && x[n - 1] == 0) x[n - 1] = 1;
+}
+
+/* Reference schoolbook product, independent of the library */
+static void ref_mul(fpe_limb *r, const fpe_limb *a, size_t na,
+                    const fpe_limb *b, size_t nb) {
+    memset(r, 0, (na + nb) * sizeof(fpe_limb));
+    for (size_t i = 0; i < na; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < nb; j++) {
+            uint64_t t = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (fpe_limb)t;
+            carry = t >> 32;
+        }
+        r[i + nb] = (fpe_limb)carry;
+    }
+}
+
+/* Reference Horner evaluation x = x * radix + d */
+static void ref_from_digits(fpe_limb *x, size_t nx, const unsigned int *d,
+                            size_t n, unsigned int radix) {
+    memset(x, 0, nx * sizeof(fpe_limb));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t carry = d[i];
+        for (size_t j = 0; j < nx; j++) {
+            uint64_t t = (uint64_t)x[j] * radix + carry;
+            x[j] = (fpe_limb)t;
+            carry = t >> 32;
+        }
+    }
+}
+
+/* ========================================================================= */
+/*                            Arithmetic Tests                               */
+/* ========================================================================= */
+
+void test_bn_add_sub_carry(void) {
+    fpe_limb a[3] = {0xFFFFFFFFu, 0xFFFFFFFFu, 0};
+    fpe_limb one[1] = {1};
+    fpe_limb r[3];
+
+    TEST_ASSERT_EQUAL_UINT32(0, fpe_bn_add(r, a, 3, one, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, r[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, r[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, r[2]);
+
+    TEST_ASSERT_EQUAL_UINT32(0, fpe_bn_sub(r, r, 3, one, 1));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(a, r, 3);
+
+    fpe_limb zero[3] = {0, 0, 0};
+    TEST_ASSERT_EQUAL_UINT32(1, fpe_bn_sub(r, zero, 3, one, 1));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, r[2]);
+}
+
+void test_bn_cmp_ignores_leading_zeros(void) {
+    fpe_limb a[3] = {5, 0, 0};
+    fpe_limb b[1] = {5};
+    fpe_limb c[2] = {4, 1};
+
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_cmp(a, 3, b, 1));
+    TEST_ASSERT_EQUAL_INT(-1, fpe_bn_cmp(a, 3, c, 2));
+    TEST_ASSERT_EQUAL_INT(1, fpe_bn_cmp(c, 2, b, 1));
+    TEST_ASSERT_EQUAL_size_t(1, fpe_bn_trim(a, 3));
+}
+
+void test_bn_mul_matches_schoolbook(void) {
+    /* Sizes straddle the Karatsuba threshold, including unbalanced operands */
+    const size_t sizes[][2] = {
+        {1, 1}, {7, 3}, {31, 31}, {32, 32}, {33, 33},
+        {64, 64}, {100, 37}, {257, 256}, {500, 499}
+    };
+
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++) {
+        size_t na = sizes[t][0], nb = sizes[t][1];
+        fpe_limb *a = fpe_bn_alloc(&arena, na);
+        fpe_limb *b = fpe_bn_alloc(&arena, nb);
+        fpe_limb *r = fpe_bn_alloc(&arena, na + nb);
+        fpe_limb *expect = fpe_bn_alloc(&arena, na + nb);
+        TEST_ASSERT_NOT_NULL(expect);
+
+        random_limbs(a, na);
+        random_limbs(b, nb);
+        ref_mul(expect, a, na, b, nb);
+
+        TEST_ASSERT_EQUAL_INT(0, fpe_bn_mul(r, a, na, b, nb, &arena));
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(expect, r, na + nb);
+    }
+}
+
+void test_bn_divmod_identity(void) {
+    /* (q * m + r) / m must give back q and r for every r < m */
+    const size_t sizes[][2] = {{1, 1}, {5, 1}, {8, 3}, {40, 40}, {300, 120}};
+
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++) {
+        size_t nq = sizes[t][0], nm = sizes[t][1];
+        fpe_limb *q = fpe_bn_alloc(&arena, nq);
+        fpe_limb *m = fpe_bn_alloc(&arena, nm);
+        fpe_limb *r = fpe_bn_alloc(&arena, nm);
+        fpe_limb *a = fpe_bn_alloc(&arena, nq + nm);
+        fpe_limb *q2 = fpe_bn_alloc(&arena, nq + 1);
+        fpe_limb *r2 = fpe_bn_alloc(&arena, nm);
+        TEST_ASSERT_NOT_NULL(r2);
+
+        random_limbs(q, nq);
+        random_limbs(m, nm);
+        random_limbs(r, nm);
+        r[nm - 1] = m[nm - 1] > 0 ? m[nm - 1] - 1 : 0;
+
+        ref_mul(a, q, nq, m, nm);
+        TEST_ASSERT_EQUAL_UINT32(0, fpe_bn_add(a, a, nq + nm, r, nm));
+
+        TEST_ASSERT_EQUAL_INT(0, fpe_bn_divmod(q2, r2, a, nq + nm, m, nm, &arena));
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(q, q2, nq);
+        TEST_ASSERT_EQUAL_UINT32(0, q2[nq]);
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(r, r2, nm);
+    }
+}
+
+void test_bn_divmod_by_zero(void) {
+    fpe_limb a[2] = {1, 2};
+    fpe_limb z[1] = {0};
+    fpe_limb r[1];
+
+    TEST_ASSERT_EQUAL_INT(-1, fpe_bn_divmod(NULL, r, a, 2, z, 1, &arena));
+}
+
+void test_bn_pow_ui(void) {
+    fpe_limb r[4];
+
+    /* 10^19 = 0x8AC7230489E80000 */
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_pow_ui(r, 4, 10, 19, &arena));
+    TEST_ASSERT_EQUAL_UINT32(0x89E80000u, r[0]);
+    TEST_ASSERT_EQUAL_UINT32(0x8AC72304u, r[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, r[2]);
+
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_pow_ui(r, 4, 7, 0, &arena));
+    TEST_ASSERT_EQUAL_UINT32(1, r[0]);
+
+    /* 2^128 needs five limbs */
+    TEST_ASSERT_EQUAL_INT(-1, fpe_bn_pow_ui(r, 4, 2, 128, &arena));
+}
+
+/* ========================================================================= */
+/*                          Radix Conversion Tests                           */
+/* ========================================================================= */
+
+static void check_digits_roundtrip(unsigned int radix, size_t n) {
+    fpe_bn_powers *p = fpe_bn_powers_new(radix);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_powers_reserve(p, n));
+
+    unsigned int *d = (unsigned int *)malloc(n * sizeof(unsigned int));
+    unsigned int *back = (unsigned int *)malloc(n * sizeof(unsigned int));
+    TEST_ASSERT_NOT_NULL(d);
+    TEST_ASSERT_NOT_NULL(back);
+
+    for (size_t i = 0; i < n; i++) d[i] = rng_next() % radix;
+    /* Exercise the extremes: leading zeros and a run of maximal digits */
+    d[0] = 0;
+    for (size_t i = n / 2; i < n / 2 + n / 8; i++) d[i] = radix - 1;
+
+    size_t nx = fpe_bn_limbs_for_digits(radix, n);
+    size_t mark = arena.used;
+    fpe_limb *x = fpe_bn_alloc(&arena, nx);
+    fpe_limb *expect = fpe_bn_alloc(&arena, nx);
+    TEST_ASSERT_NOT_NULL(expect);
+
+    ref_from_digits(expect, nx, d, n, radix);
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_from_digits(x, nx, d, n, p, &arena));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expect, x, nx);
+
+    TEST_ASSERT_EQUAL_INT(0, fpe_bn_to_digits(back, n, x, nx, p, &arena));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(d, back, n);
+
+    arena.used = mark;
+    free(d);
+    free(back);
+    fpe_bn_powers_free(p);
+}
+
+void test_bn_digits_roundtrip_small(void) {
+    check_digits_roundtrip(10, 1);
+    check_digits_roundtrip(10, 9);
+    check_digits_roundtrip(2, 31);
+    check_digits_roundtrip(65536, 3);
+}
+
+void test_bn_digits_roundtrip_divide_and_conquer(void) {
+    /* Lengths well past the leaf size force several table levels */
+    check_digits_roundtrip(10, 3001);
+    check_digits_roundtrip(2, 20000);
+    check_digits_roundtrip(36, 2500);
+    check_digits_roundtrip(65536, 1500);
+    check_digits_roundtrip(7, 4321);
+}
+
+void test_bn_bytes_roundtrip(void) {
+    unsigned char in[37], out[37];
+    fpe_limb x[10];
+
+    for (size_t i = 0; i < sizeof(in); i++) in[i] = (unsigned char)(rng_next() & 0xFF);
+
+    fpe_bn_from_bytes(x, 10, in, sizeof(in));
+    fpe_bn_to_bytes(out, sizeof(out), x, 10);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in, out, sizeof(in));
+
+    /* Big-endian: the last byte is the least significant */
+    TEST_ASSERT_EQUAL_UINT32(in[36], x[0] & 0xFF);
+}
+
+void test_bn_arena_exhaustion(void) {
+    unsigned char small[64];
+    fpe_bn_arena ar;
+
+    fpe_bn_arena_init(&ar, small, sizeof(small));
+    TEST_ASSERT_NOT_NULL(fpe_bn_alloc(&ar, 8));
+    TEST_ASSERT_NULL(fpe_bn_alloc(&ar, 16));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* Arithmetic */
+    RUN_TEST(test_bn_add_sub_carry);
+    RUN_TEST(test_bn_cmp_ignores_leading_zeros);
+    RUN_TEST(test_bn_mul_matches_schoolbook);
+    RUN_TEST(test_bn_divmod_identity);
+    RUN_TEST(test_bn_divmod_by_zero);
+    RUN_TEST(test_bn_pow_ui);
+
+    /* Radix conversion */
+    RUN_TEST(test_bn_digits_roundtrip_small);
+    RUN_TEST(test_bn_digits_roundtrip_divide_and_conquer);
+    RUN_TEST(test_bn_bytes_roundtrip);
+    RUN_TEST(test_bn_arena_exhaustion);
+
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/**
+ * @file test_bytes.c
+ * @brief Unit tests for the radix-256 byte-string API
+ */
+
+#include "../include/fpe.h"
+#include "unity/src/unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char key[16] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+    0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+static FPE_CTX *ctx = NULL;
+
+void setUp(void) {
+    ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 256));
+}
+
+void tearDown(void) {
+    FPE_CTX_free(ctx);
+    ctx = NULL;
+}
+
+static void fill_pattern(unsigned char *buf, unsigned int len, unsigned int seed) {
+    for (unsigned int i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = (unsigned char)(seed >> 16);
+    }
+}
+
+/* ========================================================================= */
+/*                    Equivalence With the Numeral API                       */
+/* ========================================================================= */
+
+static void check_matches_numeral_api(unsigned int len, const unsigned char *tweak,
+                                      unsigned int tweak_len) {
+    unsigned char in[256], out[256];
+    unsigned int in_num[256], out_num[256];
+    
+    fill_pattern(in, len, len * 31 + tweak_len);
+    for (unsigned int i = 0; i < len; i++) in_num[i] = in[i];
+    
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ctx, in, out, len, tweak, tweak_len));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, in_num, out_num, len, tweak, tweak_len));
+    
+    for (unsigned int i = 0; i < len; i++) {
+        TEST_ASSERT_EQUAL_UINT(out_num[i], out[i]);
+    }
+}
+
+void test_bytes_matches_numeral_api(void) {
+    const unsigned char tweak[10] = {0x39, 0x38, 0x37, 0x36, 0x35, 0x34, 0x33, 0x32, 0x31, 0x30};
+    const unsigned int lens[] = {2, 3, 15, 16, 17, 33, 100, 255, 256};
+    
+    for (unsigned int i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        check_matches_numeral_api(lens[i], NULL, 0);
+        check_matches_numeral_api(lens[i], tweak, 7);
+        check_matches_numeral_api(lens[i], tweak, 10);
+    }
+}
+
+/* ========================================================================= */
+/*                             Round-Trip Tests                              */
+/* ========================================================================= */
+
+void test_bytes_uuid_roundtrip(void) {
+    unsigned char uuid[16], enc[16], dec[16];
+    unsigned char tweak[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+    fill_pattern(uuid, 16, 7);
+    
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ctx, uuid, enc, 16, tweak, 4));
+    TEST_ASSERT_TRUE(memcmp(uuid, enc, 16) != 0);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_bytes(ctx, enc, dec, 16, tweak, 4));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(uuid, dec, 16);
+}
+
+void test_bytes_long_roundtrip(void) {
+    const unsigned int lens[] = {257, 1000, 4097, 65536};
+    unsigned char tweak[3] = {1, 2, 3};
+    
+    for (unsigned int i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        unsigned int len = lens[i];
+        unsigned char *in = (unsigned char *)malloc(len);
+        unsigned char *enc = (unsigned char *)malloc(len);
+        unsigned char *dec = (unsigned char *)malloc(len);
+        TEST_ASSERT_NOT_NULL(in);
+        TEST_ASSERT_NOT_NULL(enc);
+        TEST_ASSERT_NOT_NULL(dec);
+        
+        fill_pattern(in, len, len);
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ctx, in, enc, len, tweak, 3));
+        TEST_ASSERT_TRUE(memcmp(in, enc, len) != 0);
+        TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_bytes(ctx, enc, dec, len, tweak, 3));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(in, dec, len);
+        
+        free(in);
+        free(enc);
+        free(dec);
+    }
+}
+
+void test_bytes_inplace(void) {
+    unsigned char buf[32], orig[32];
+    fill_pattern(orig, 32, 99);
+    memcpy(buf, orig, 32);
+    
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ctx, buf, buf, 32, NULL, 0));
+    TEST_ASSERT_TRUE(memcmp(buf, orig, 32) != 0);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_bytes(ctx, buf, buf, 32, NULL, 0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(orig, buf, 32);
+}
+
+void test_bytes_ff3_1_roundtrip(void) {
+    unsigned char in[16], enc[16], dec[16];
+    unsigned char tweak[7] = {0xD8, 0xE7, 0x92, 0x0A, 0xFA, 0x33, 0x0A};
+    FPE_CTX *ff3_1 = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ff3_1);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ff3_1, FPE_MODE_FF3_1, FPE_ALGO_AES, key, 128, 256));
+    
+    fill_pattern(in, 16, 5);
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ff3_1, in, enc, 16, tweak, 7));
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_bytes(ff3_1, enc, dec, 16, tweak, 7));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in, dec, 16);
+    
+    FPE_CTX_free(ff3_1);
+}
+
+/* ========================================================================= */
+/*                             Error Handling                                */
+/* ========================================================================= */
+
+void test_bytes_rejects_invalid_input(void) {
+    unsigned char in[16] = {0}, out[16];
+    FPE_CTX *radix10 = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(radix10);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(radix10, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 10));
+    
+    TEST_ASSERT_NOT_EQUAL(0, FPE_encrypt_bytes(radix10, in, out, 16, NULL, 0));
+    TEST_ASSERT_NOT_EQUAL(0, FPE_encrypt_bytes(ctx, in, out, 1, NULL, 0));
+    TEST_ASSERT_NOT_EQUAL(0, FPE_encrypt_bytes(ctx, NULL, out, 16, NULL, 0));
+    TEST_ASSERT_NOT_EQUAL(0, FPE_encrypt_bytes(ctx, in, NULL, 16, NULL, 0));
+    TEST_ASSERT_NOT_EQUAL(0, FPE_decrypt_bytes(NULL, in, out, 16, NULL, 0));
+    
+    FPE_CTX_free(radix10);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    
+    RUN_TEST(test_bytes_matches_numeral_api);
+    RUN_TEST(test_bytes_uuid_roundtrip);
+    RUN_TEST(test_bytes_long_roundtrip);
+    RUN_TEST(test_bytes_inplace);
+    RUN_TEST(test_bytes_ff3_1_roundtrip);
+    RUN_TEST(test_bytes_rejects_invalid_input);
+    
+    return UNITY_END();
+}
@@ -0,0 +1,31 @@
+/**
+ * @file test_common.h
+ * @brief Shared fixtures for the unit tests: key, tweak and context setup
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include "../include/fpe.h"
+#include "unity/src/unity.h"
+
+/* AES-128 key of the NIST SP 800-38G samples */
+static const unsigned char test_key[16] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+    0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+
+/* An 8-byte tweak, valid for every mode (FF3-1 uses the first 7 bytes) */
+static const unsigned char test_tweak[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+/**
+ * @brief New context under test_key with AES-128; fails the test on error
+ */
+static inline FPE_CTX *test_new_ctx(FPE_MODE mode, unsigned int radix) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, mode, FPE_ALGO_AES, test_key, 128, radix));
+    return ctx;
+}
+
+#endif /* TEST_COMMON_H */
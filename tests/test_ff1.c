@@ -7,6 +7,7 @@
 #include "../src/utils.h"
 #include "unity/src/unity.h"
 #include "vectors.h"
+#include <stdlib.h>
 #include <string.h>
 
 void setUp(void) {}
@@ -281,6 +282,153 @@ void test_ff1_nist_aes128_with_tweak(void) {
     FPE_CTX_free(ctx);
 }
 
+/* ========================================================================= */
+/*                     FF1 Long Inputs (beyond 256 digits)                   */
+/* ========================================================================= */
+
+void test_ff1_long_input_known_answer(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16];
+    fpe_hex_to_bytes("2B7E151628AED2A6ABF7158809CF4F3C", key, 16);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 10));
+
+    unsigned char tweak[10];
+    fpe_hex_to_bytes("39383736353433323130", tweak, 10);
+
+    /* 300 digits 0123456789..., computed with an independent implementation */
+    const char *expected_str =
+        "198527912142264050556177739876077494348251277640700290943331"
+        "147096147715344369480547470804849071475097222355752898644137"
+        "965714134051768354729665314497939002786111286159849620549399"
+        "690666582434457547983333436009619477682452980179384048060197"
+        "279117264765511518333864151806755813991583792246923090255962";
+
+    unsigned int plaintext[300], expected[300], ciphertext[300], decrypted[300];
+    for (int i = 0; i < 300; i++) {
+        plaintext[i] = i % 10;
+        expected[i] = (unsigned int)(expected_str[i] - '0');
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, plaintext, ciphertext, 300, tweak, 10));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(expected, ciphertext, 300);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt(ctx, ciphertext, decrypted, 300, tweak, 10));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(plaintext, decrypted, 300);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_ff1_long_tweak_known_answer(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16];
+    fpe_hex_to_bytes("2B7E151628AED2A6ABF7158809CF4F3C", key, 16);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 36));
+
+    /* A 300-byte tweak no longer fits the fixed Q buffer */
+    unsigned char tweak[300];
+    for (int i = 0; i < 300; i++) tweak[i] = (unsigned char)i;
+
+    unsigned int plaintext[40], ciphertext[40], decrypted[40];
+    for (int i = 0; i < 40; i++) plaintext[i] = i % 36;
+    unsigned int expected[40] = {
+        22, 8, 27, 26, 19, 13, 19, 15, 1, 34, 7, 18, 4, 11, 1, 21, 6, 4, 30, 2,
+        3, 12, 34, 33, 34, 26, 16, 10, 23, 28, 32, 28, 29, 33, 3, 14, 27, 32, 4, 0
+    };
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, plaintext, ciphertext, 40, tweak, 300));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(expected, ciphertext, 40);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt(ctx, ciphertext, decrypted, 40, tweak, 300));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(plaintext, decrypted, 40);
+
+    FPE_CTX_free(ctx);
+}
+
+static void check_ff1_long_roundtrip(unsigned int radix, unsigned int len) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16] = {0};
+    for (int i = 0; i < 16; i++) key[i] = (unsigned char)(i * 7 + 1);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, radix));
+
+    unsigned int *plaintext = (unsigned int *)malloc(len * sizeof(unsigned int));
+    unsigned int *ciphertext = (unsigned int *)malloc(len * sizeof(unsigned int));
+    unsigned int *decrypted = (unsigned int *)malloc(len * sizeof(unsigned int));
+    TEST_ASSERT_NOT_NULL(plaintext);
+    TEST_ASSERT_NOT_NULL(ciphertext);
+    TEST_ASSERT_NOT_NULL(decrypted);
+
+    for (unsigned int i = 0; i < len; i++) plaintext[i] = (i * 2654435761u) % radix;
+
+    unsigned char tweak[5] = {1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, plaintext, ciphertext, len, tweak, 5));
+    TEST_ASSERT_TRUE(memcmp(plaintext, ciphertext, len * sizeof(unsigned int)) != 0);
+    for (unsigned int i = 0; i < len; i++) TEST_ASSERT_TRUE(ciphertext[i] < radix);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt(ctx, ciphertext, decrypted, len, tweak, 5));
+    TEST_ASSERT_EQUAL_UINT_ARRAY(plaintext, decrypted, len);
+
+    free(plaintext);
+    free(ciphertext);
+    free(decrypted);
+    FPE_CTX_free(ctx);
+}
+
+void test_ff1_long_input_roundtrip(void) {
+    check_ff1_long_roundtrip(10, 257);
+    check_ff1_long_roundtrip(10, 10000);
+    check_ff1_long_roundtrip(2, 5000);
+    check_ff1_long_roundtrip(36, 3333);
+    /* radix 65536 at 256 digits already overflows the fixed round buffers */
+    check_ff1_long_roundtrip(65536, 256);
+    check_ff1_long_roundtrip(65536, 1200);
+}
+
+void test_ff1_long_matches_bytes_api(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16];
+    fpe_hex_to_bytes("2B7E151628AED2A6ABF7158809CF4F3C", key, 16);
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 256));
+
+    /* The radix-256 byte kernel never converts, so it is an independent check */
+    enum { LEN = 2000 };
+    unsigned int digits[LEN], via_digits[LEN];
+    unsigned char bytes[LEN], via_bytes[LEN];
+    for (int i = 0; i < LEN; i++) {
+        bytes[i] = (unsigned char)(i * 31 + 7);
+        digits[i] = bytes[i];
+    }
+
+    unsigned char tweak[3] = {9, 8, 7};
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, digits, via_digits, LEN, tweak, 3));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_bytes(ctx, bytes, via_bytes, LEN, tweak, 3));
+
+    for (int i = 0; i < LEN; i++) TEST_ASSERT_EQUAL_UINT(via_bytes[i], via_digits[i]);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_ff1_long_rejects_invalid_digit(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16] = {0};
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 10));
+
+    unsigned int in[600], out[600];
+    for (int i = 0; i < 600; i++) in[i] = i % 10;
+    in[599] = 10;
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt(ctx, in, out, 600, NULL, 0));
+
+    FPE_CTX_free(ctx);
+}
+
 int main(void) {
     UNITY_BEGIN();
     
@@ -304,6 +452,13 @@ int main(void) {
     /* NIST test vectors */
     RUN_TEST(test_ff1_nist_aes128_empty_tweak);
     RUN_TEST(test_ff1_nist_aes128_with_tweak);
+
+    /* Long inputs */
+    RUN_TEST(test_ff1_long_input_known_answer);
+    RUN_TEST(test_ff1_long_tweak_known_answer);
+    RUN_TEST(test_ff1_long_input_roundtrip);
+    RUN_TEST(test_ff1_long_matches_bytes_api);
+    RUN_TEST(test_ff1_long_rejects_invalid_digit);
     
     return UNITY_END();
 }
@@ -7,12 +7,15 @@
  * - Throughput (TPS - Transactions Per Second)
  * - AES-128 vs AES-192 vs AES-256 performance
  * - AES vs SM4 performance comparison
+ * - Scaling with input length beyond 256 digits
+ * - Batch API versus one call per record
  */
 
 #include "../include/fpe.h"
 #include "../src/utils.h"
 #include "unity/src/unity.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -162,6 +165,94 @@ void test_ff1_aes_vs_sm4_comparison(void) {
 #endif
 }
 
+/* Test FF1 cost as the numeral string grows past the 256-digit stack path */
+void test_ff1_long_input_scaling(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16] = {0};
+    for (int i = 0; i < 16; i++) key[i] = i;
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 10));
+
+    const unsigned int lens[] = {256, 1024, 4096, 16384};
+    const unsigned int max_len = 16384;
+    unsigned int *plaintext = (unsigned int *)malloc(max_len * sizeof(unsigned int));
+    unsigned int *ciphertext = (unsigned int *)malloc(max_len * sizeof(unsigned int));
+    TEST_ASSERT_NOT_NULL(plaintext);
+    TEST_ASSERT_NOT_NULL(ciphertext);
+    for (unsigned int i = 0; i < max_len; i++) plaintext[i] = i % 10;
+
+    unsigned char tweak[8] = {1,2,3,4,5,6,7,8};
+
+    printf("\n  FF1 AES-128 radix 10 long-input scaling:\n");
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+        unsigned int len = lens[k];
+        int iterations = (int)(65536 / len);
+
+        /* Warm up (also grows the context scratch and power table) */
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, plaintext, ciphertext, len, tweak, 8));
+
+        uint64_t start = fpe_get_time_usec();
+        for (int i = 0; i < iterations; i++) {
+            FPE_encrypt(ctx, plaintext, ciphertext, len, tweak, 8);
+        }
+        uint64_t elapsed = fpe_get_time_usec() - start;
+
+        double us_per_op = (double)elapsed / iterations;
+        printf("    len %5u: %10.1f us/op  %8.1f ns/digit\n",
+               len, us_per_op, us_per_op * 1000.0 / len);
+        TEST_ASSERT_TRUE(us_per_op > 0);
+    }
+
+    free(plaintext);
+    free(ciphertext);
+    FPE_CTX_free(ctx);
+}
+
+/* Test FPE_encrypt_batch against one FPE_encrypt call per record */
+void test_ff1_batch_vs_single(void) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    TEST_ASSERT_NOT_NULL(ctx);
+
+    unsigned char key[16] = {0};
+    for (int i = 0; i < 16; i++) key[i] = i;
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, key, 128, 10));
+
+    const unsigned int lens[] = {8, 16, 32, 64};
+    const size_t count = 4096;
+    unsigned int *plaintext = (unsigned int *)malloc(count * 64 * sizeof(unsigned int));
+    unsigned int *ciphertext = (unsigned int *)malloc(count * 64 * sizeof(unsigned int));
+    TEST_ASSERT_NOT_NULL(plaintext);
+    TEST_ASSERT_NOT_NULL(ciphertext);
+    for (size_t i = 0; i < count * 64; i++) plaintext[i] = (unsigned int)(i % 10);
+
+    unsigned char tweak[8] = {1,2,3,4,5,6,7,8};
+
+    printf("\n  FF1 AES-128 radix 10, %zu records:\n", count);
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+        unsigned int len = lens[k];
+
+        uint64_t start = fpe_get_time_usec();
+        for (size_t r = 0; r < count; r++) {
+            FPE_encrypt(ctx, plaintext + r * len, ciphertext + r * len, len, tweak, 8);
+        }
+        uint64_t single = fpe_get_time_usec() - start;
+
+        start = fpe_get_time_usec();
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, plaintext, ciphertext, len, count,
+                                                   tweak, 8, 0));
+        uint64_t batch = fpe_get_time_usec() - start;
+
+        printf("    len %3u: single %6.2f us/rec  batch %6.2f us/rec  (%.1fx)\n",
+               len, (double)single / count, (double)batch / count,
+               batch > 0 ? (double)single / batch : 0.0);
+    }
+
+    free(plaintext);
+    free(ciphertext);
+    FPE_CTX_free(ctx);
+}
+
 int main(void) {
     UNITY_BEGIN();
     
@@ -173,6 +264,8 @@ int main(void) {
     RUN_TEST(test_ff1_sm4_performance);
     RUN_TEST(test_ff1_aes_key_size_comparison);
     RUN_TEST(test_ff1_aes_vs_sm4_comparison);
+    RUN_TEST(test_ff1_long_input_scaling);
+    RUN_TEST(test_ff1_batch_vs_single);
     
     return UNITY_END();
 }
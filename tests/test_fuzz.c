@@ -202,7 +202,7 @@ void test_fuzz_zero_length_inputs(void) {
     printf("\n=== Testing zero and minimal length inputs ===\n");
 
     unsigned char key[16] = {0};
-    unsigned int arr[10];
+    unsigned int arr[10] = {0};
     unsigned int out[10];
     unsigned char tweak[8] = {0};
 
@@ -344,7 +344,10 @@ void test_fuzz_boundary_values(void) {
 
     unsigned char large_tweak[64];
     memset(large_tweak, 0xAA, 64);
-    TEST_ASSERT_EQUAL(0, FPE_encrypt(ctx, plaintext, ciphertext, 10, large_tweak, 64));
+    for (unsigned int i = 0; i < 10; i++) {
+        plaintext[i] = i;
+    }
+    TEST_ASSERT_EQUAL(0,FPE_encrypt(ctx, plaintext, ciphertext, 10, large_tweak, 64));
     printf("✓ Successfully encrypted with 64-byte tweak\n");
 
     FPE_CTX_free(ctx);
@@ -0,0 +1,199 @@
+/**
+ * @file test_iov.c
+ * @brief Unit tests for scatter/gather (iovec) field encryption
+ */
+
+#include "test_common.h"
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char digits[] = "0123456789";
+
+/*
+ * Lay count fields of the given lengths out in one buffer, separated by
+ * '|' guard bytes, encrypt them in place, and compare every field with
+ * FPE_encrypt_str on a copy. Guard bytes must survive and decryption must
+ * restore the buffer.
+ */
+static void check_fields(FPE_MODE mode, const unsigned int *lens, size_t count,
+                         const unsigned int *tweak_lens) {
+    FPE_CTX *ctx = test_new_ctx(mode, 10);
+
+    size_t total = 1;
+    for (size_t i = 0; i < count; i++) total += lens[i] + 1;
+
+    char *buf = (char *)malloc(total);
+    char *orig = (char *)malloc(total);
+    FPE_IOV *iov = (FPE_IOV *)malloc(count * sizeof(FPE_IOV));
+    unsigned char *tweaks = (unsigned char *)malloc(count * 8);
+    TEST_ASSERT_NOT_NULL(buf);
+    TEST_ASSERT_NOT_NULL(orig);
+    TEST_ASSERT_NOT_NULL(iov);
+    TEST_ASSERT_NOT_NULL(tweaks);
+
+    size_t off = 0;
+    buf[off++] = '|';
+    for (size_t i = 0; i < count; i++) {
+        iov[i].base = buf + off;
+        iov[i].len = lens[i];
+        iov[i].tweak = tweaks + i * 8;
+        iov[i].tweak_len = tweak_lens[i % 3];
+        for (unsigned int j = 0; j < lens[i]; j++) buf[off++] = (char)('0' + (i * 7 + j * 3) % 10);
+        buf[off++] = '|';
+    }
+    for (size_t i = 0; i < count * 8; i++) tweaks[i] = (unsigned char)(i * 13 + 5);
+    memcpy(orig, buf, total);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_iov(ctx, digits, iov, count));
+
+    char plain[512], expect[512];
+    off = 1;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(plain, orig + off, lens[i]);
+        plain[lens[i]] = '\0';
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, plain, expect,
+                                                 iov[i].tweak, iov[i].tweak_len));
+        TEST_ASSERT_EQUAL_MEMORY(expect, buf + off, lens[i]);
+        off += lens[i];
+        TEST_ASSERT_EQUAL_CHAR('|', buf[off]);
+        off++;
+    }
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_iov(ctx, digits, iov, count));
+    TEST_ASSERT_EQUAL_MEMORY(orig, buf, total);
+
+    free(buf);
+    free(orig);
+    free(iov);
+    free(tweaks);
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                              Field Layouts                                */
+/* ========================================================================= */
+
+void test_iov_mixed_lengths(void) {
+    /* Groups big enough for lanes, stragglers, and one long field */
+    const unsigned int lens[] = {16, 9, 16, 16, 4, 16, 9, 16, 300, 16, 9, 16, 16, 9, 2, 16};
+    const unsigned int tweak_lens[] = {8, 8, 8};
+    check_fields(FPE_MODE_FF1, lens, sizeof(lens) / sizeof(lens[0]), tweak_lens);
+}
+
+void test_iov_mixed_tweak_lengths(void) {
+    unsigned int lens[40];
+    for (int i = 0; i < 40; i++) lens[i] = 12;
+    const unsigned int tweak_lens[] = {8, 0, 5};
+    check_fields(FPE_MODE_FF1, lens, 40, tweak_lens);
+}
+
+void test_iov_many_windows(void) {
+    unsigned int lens[200];
+    for (int i = 0; i < 200; i++) lens[i] = 6 + (i % 5) * 5;
+    const unsigned int tweak_lens[] = {8, 8, 8};
+    check_fields(FPE_MODE_FF1, lens, 200, tweak_lens);
+}
+
+void test_iov_ff3_1(void) {
+    const unsigned int lens[] = {10, 10, 10, 10, 10, 7, 20};
+    const unsigned int tweak_lens[] = {7, 7, 7};
+    check_fields(FPE_MODE_FF3_1, lens, sizeof(lens) / sizeof(lens[0]), tweak_lens);
+}
+
+/* ========================================================================= */
+/*                               Error Handling                              */
+/* ========================================================================= */
+
+void test_iov_invalid_fields_leave_buffer_untouched(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned char tweak[8] = {0};
+    char buf[] = "1234567890|1234567890|12345x7890";
+    char orig[sizeof(buf)];
+    memcpy(orig, buf, sizeof(buf));
+
+    FPE_IOV iov[3] = {
+        {buf, 10, tweak, 8}, {buf + 11, 10, tweak, 8}, {buf + 22, 10, tweak, 8}
+    };
+
+    /* Bad character in the last field */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 3));
+    TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+
+    /* Too short, NULL base, tweak without bytes */
+    iov[2].len = 1;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 3));
+    iov[2].len = 5;
+    iov[1].base = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 3));
+    iov[1].base = buf + 11;
+    iov[0].tweak = NULL;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 3));
+    TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+    iov[0].tweak = tweak;
+
+    /* Alphabet must match the context radix */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, "0123456789abcdef", iov, 2));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(NULL, digits, iov, 2));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, NULL, 2));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_iov(ctx, digits, NULL, 0));
+    FPE_CTX_free(ctx);
+
+    /* FF3 tweak length is enforced per field */
+    ctx = test_new_ctx(FPE_MODE_FF3, 10);
+    iov[1].tweak_len = 5;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 2));
+    TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+    FPE_CTX_free(ctx);
+}
+
+void test_iov_mode_limits_leave_buffer_untouched(void) {
+    /* FF3/FF3-1 take at most 256 numerals; the long field comes last */
+    const FPE_MODE modes[] = {FPE_MODE_FF3, FPE_MODE_FF3_1};
+    static char buf[8 * 11 + 300], orig[sizeof(buf)];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = orig[i] = (char)('0' + i % 10);
+
+    FPE_IOV iov[9];
+    for (unsigned int i = 0; i < 8; i++) {
+        iov[i].base = buf + i * 11;
+        iov[i].len = 10;
+        iov[i].tweak = test_tweak;
+        iov[i].tweak_len = 7;
+    }
+    iov[8].base = buf + 8 * 11;
+    iov[8].len = 300;
+    iov[8].tweak = test_tweak;
+    iov[8].tweak_len = 7;
+
+    for (int m = 0; m < 2; m++) {
+        FPE_CTX *ctx = test_new_ctx(modes[m], 10);
+        TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_iov(ctx, digits, iov, 9));
+        TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL_INT(-1, FPE_decrypt_iov(ctx, digits, iov, 9));
+        TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+
+        /* The same fields without the long one go through */
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_iov(ctx, digits, iov, 8));
+        TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_iov(ctx, digits, iov, 8));
+        TEST_ASSERT_EQUAL_MEMORY(orig, buf, sizeof(buf));
+        FPE_CTX_free(ctx);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* Field layouts */
+    RUN_TEST(test_iov_mixed_lengths);
+    RUN_TEST(test_iov_mixed_tweak_lengths);
+    RUN_TEST(test_iov_many_windows);
+    RUN_TEST(test_iov_ff3_1);
+
+    /* Error handling */
+    RUN_TEST(test_iov_invalid_fields_leave_buffer_untouched);
+    RUN_TEST(test_iov_mode_limits_leave_buffer_untouched);
+
+    return UNITY_END();
+}
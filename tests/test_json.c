@@ -0,0 +1,306 @@
+/**
+ * @file test_json.c
+ * @brief Unit tests for the in-place JSON field tokenizer
+ */
+
+#include "test_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char digits[] = "0123456789";
+
+/*
+ * Expect the string value starting at offset off of buf (length len) to be
+ * the FPE_encrypt_str result of the same bytes in orig.
+ */
+static void check_string_value(FPE_CTX *ctx, const char *orig, const char *buf,
+                               size_t off, size_t len) {
+    char plain[64], expect[64];
+    memcpy(plain, orig + off, len);
+    plain[len] = '\0';
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, plain, expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(expect, buf + off, len);
+}
+
+/* Offset of the first occurrence of needle in orig */
+static size_t offset_of(const char *orig, const char *needle) {
+    const char *p = strstr(orig, needle);
+    TEST_ASSERT_NOT_NULL(p);
+    return (size_t)(p - orig);
+}
+
+/* ========================================================================= */
+/*                             Value Selection                               */
+/* ========================================================================= */
+
+void test_json_top_level_keys(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char *paths[] = {"pan", "ssn"};
+    FPE_JSON *json = FPE_JSON_new(paths, 2, digits);
+    TEST_ASSERT_NOT_NULL(json);
+
+    const char orig[] = "{\"id\": 7, \"pan\": \"4111111111111111\", \"name\": \"pan\", "
+                        "\"x\": {\"pan\": \"1234\"}, \"ssn\": 123456789}";
+    char buf[sizeof(orig)];
+    memcpy(buf, orig, sizeof(orig));
+
+    TEST_ASSERT_EQUAL_INT(2, FPE_encrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8));
+    check_string_value(ctx, orig, buf, offset_of(orig, "4111"), 16);
+
+    /* The number keeps its length and a nonzero leading digit */
+    size_t ssn = offset_of(orig, "123456789");
+    TEST_ASSERT_TRUE(buf[ssn] >= '1' && buf[ssn] <= '9');
+    TEST_ASSERT_EQUAL_CHAR('}', buf[ssn + 9]);
+    TEST_ASSERT_FALSE(memcmp(buf + ssn, "123456789", 9) == 0);
+
+    /* Everything outside the two values is untouched, including the nested "pan" */
+    for (size_t i = 0; i < sizeof(orig); i++) {
+        int in_pan = i >= offset_of(orig, "4111") && i < offset_of(orig, "4111") + 16;
+        int in_ssn = i >= ssn && i < ssn + 9;
+        if (!in_pan && !in_ssn) TEST_ASSERT_EQUAL_CHAR(orig[i], buf[i]);
+    }
+
+    TEST_ASSERT_EQUAL_INT(2, FPE_decrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8));
+    TEST_ASSERT_EQUAL_STRING(orig, buf);
+
+    FPE_JSON_free(json);
+    FPE_CTX_free(ctx);
+}
+
+void test_json_nested_paths_and_arrays(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char *paths[] = {"card.pan", "items.sku", "pans"};
+    FPE_JSON *json = FPE_JSON_new(paths, 3, digits);
+    TEST_ASSERT_NOT_NULL(json);
+
+    const char orig[] =
+        "{\"card\":{\"pan\":\"5500000000000004\",\"exp\":\"1230\"},"
+        "\"items\":[{\"sku\":\"12345\"},{\"sku\":\"67890\"},{\"other\":{\"sku\":\"111\"}}],"
+        "\"pans\":[\"123456\",\"654321\",null,[\"9876\"]],"
+        "\"skip\":{\"note\":\"brackets ]}[{ and \\\"quotes\\\" in a string\",\"deep\":[[[{}]]]}}";
+    char buf[sizeof(orig)];
+    memcpy(buf, orig, sizeof(orig));
+
+    TEST_ASSERT_EQUAL_INT(6, FPE_encrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8));
+    check_string_value(ctx, orig, buf, offset_of(orig, "5500"), 16);
+    check_string_value(ctx, orig, buf, offset_of(orig, "12345"), 5);
+    check_string_value(ctx, orig, buf, offset_of(orig, "67890"), 5);
+    check_string_value(ctx, orig, buf, offset_of(orig, "123456\""), 6);
+    check_string_value(ctx, orig, buf, offset_of(orig, "654321"), 6);
+    check_string_value(ctx, orig, buf, offset_of(orig, "9876"), 4);
+    TEST_ASSERT_EQUAL_MEMORY(orig + offset_of(orig, "1230"), buf + offset_of(orig, "1230"), 4);
+    TEST_ASSERT_EQUAL_MEMORY(orig + offset_of(orig, "111\""), buf + offset_of(orig, "111\""), 3);
+    TEST_ASSERT_EQUAL_STRING(orig + offset_of(orig, "\"skip\""), buf + offset_of(orig, "\"skip\""));
+
+    TEST_ASSERT_EQUAL_INT(6, FPE_decrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8));
+    TEST_ASSERT_EQUAL_STRING(orig, buf);
+
+    FPE_JSON_free(json);
+    FPE_CTX_free(ctx);
+}
+
+void test_json_event_stream(void) {
+    /* Newline-delimited events: enough values to fill several windows */
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char *paths[] = {"user.pan", "amount"};
+    FPE_JSON *json = FPE_JSON_new(paths, 2, digits);
+    TEST_ASSERT_NOT_NULL(json);
+
+    enum { EVENTS = 300 };
+    size_t cap = EVENTS * 160;
+    char *orig = (char *)malloc(cap);
+    char *buf = (char *)malloc(cap);
+    size_t *pan_off = (size_t *)malloc(EVENTS * sizeof(size_t));
+    TEST_ASSERT_NOT_NULL(orig);
+    TEST_ASSERT_NOT_NULL(buf);
+    TEST_ASSERT_NOT_NULL(pan_off);
+
+    size_t len = 0;
+    for (int e = 0; e < EVENTS; e++) {
+        unsigned int pan_len = 13 + (unsigned int)(e % 4) * 2;
+        len += (size_t)sprintf(orig + len, "{\"ts\":%d,\"tags\":[\"a\",\"b{\"],\"user\":{\"pan\":\"", e);
+        pan_off[e] = len;
+        for (unsigned int k = 0; k < pan_len; k++) orig[len++] = (char)('0' + (e + k * 7) % 10);
+        len += (size_t)sprintf(orig + len, "\"},\"amount\":%d}\n", 1000 + e * 37);
+    }
+    memcpy(buf, orig, len);
+
+    TEST_ASSERT_EQUAL_INT(2 * EVENTS, FPE_encrypt_json(ctx, json, buf, len, test_tweak, 8));
+    for (int e = 0; e < EVENTS; e++) {
+        check_string_value(ctx, orig, buf, pan_off[e], 13 + (size_t)(e % 4) * 2);
+    }
+
+    TEST_ASSERT_EQUAL_INT(2 * EVENTS, FPE_decrypt_json(ctx, json, buf, len, test_tweak, 8));
+    TEST_ASSERT_EQUAL_MEMORY(orig, buf, len);
+
+    free(orig);
+    free(buf);
+    free(pan_off);
+    FPE_JSON_free(json);
+    FPE_CTX_free(ctx);
+}
+
+void test_json_numbers_stay_valid(void) {
+    /* Short numbers often encrypt to a leading zero and must be walked */
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    const char *paths[] = {"n"};
+    FPE_JSON *json = FPE_JSON_new(paths, 1, digits);
+    TEST_ASSERT_NOT_NULL(json);
+    unsigned char tw7[7] = {9, 8, 7, 6, 5, 4, 3};
+
+    for (int v = 10; v < 400; v += 7) {
+        char orig[32], buf[32];
+        int n = sprintf(orig, "[{\"n\":%s%d}]", (v & 1) ? "-" : "", v * 13);
+        memcpy(buf, orig, (size_t)n + 1);
+
+        TEST_ASSERT_EQUAL_INT(1, FPE_encrypt_json(ctx, json, buf, (size_t)n, tw7, 7));
+        const char *num = buf + 6 + (v & 1);
+        TEST_ASSERT_TRUE(num[0] >= '1' && num[0] <= '9');
+
+        TEST_ASSERT_EQUAL_INT(1, FPE_decrypt_json(ctx, json, buf, (size_t)n, tw7, 7));
+        TEST_ASSERT_EQUAL_STRING(orig, buf);
+    }
+
+    FPE_JSON_free(json);
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                               Error Handling                              */
+/* ========================================================================= */
+
+void test_json_invalid_specs(void) {
+    const char *good[] = {"pan"};
+    const char *empty_seg[] = {"a..b"};
+    const char *trailing_dot[] = {"a."};
+    const char *empty[] = {""};
+    const char *null_path[] = {NULL};
+
+    TEST_ASSERT_NULL(FPE_JSON_new(good, 1, "0123\"56789"));  /* Quote in alphabet */
+    TEST_ASSERT_NULL(FPE_JSON_new(good, 1, "0123\\56789"));  /* Backslash in alphabet */
+    TEST_ASSERT_NULL(FPE_JSON_new(good, 1, "0012"));
+    TEST_ASSERT_NULL(FPE_JSON_new(empty_seg, 1, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(trailing_dot, 1, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(empty, 1, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(null_path, 1, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(good, 0, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(good, FPE_JSON_MAX_PATHS + 1, digits));
+    TEST_ASSERT_NULL(FPE_JSON_new(NULL, 1, digits));
+    FPE_JSON_free(NULL);
+}
+
+void test_json_invalid_documents(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char *paths[] = {"pan"};
+    FPE_JSON *json = FPE_JSON_new(paths, 1, digits);
+    TEST_ASSERT_NOT_NULL(json);
+
+    static const char *const bad[] = {
+        "{\"pan\":\"41x1\"}",             /* Character outside the alphabet */
+        "{\"pan\":\"4\"}",                /* Too short */
+        "{\"pan\":12.5}",                 /* Not an integer */
+        "{\"pan\":1e5}",
+        "{\"pan\":\"1234\"",              /* Unterminated object */
+        "{\"pan\" \"1234\"}",             /* Missing colon */
+        "{\"a\":{\"b\":\"c\"}",           /* Unterminated skipped container */
+        "{\"a\":\"unterminated}",
+        "{\"pan\":\"1234\"]",             /* Mismatched bracket */
+        "[1,2,",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char buf[64];
+        strcpy(buf, bad[i]);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(-1, FPE_encrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8), bad[i]);
+    }
+
+    char buf[] = "{\"pan\":\"1234\"}";
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_json(ctx, json, buf, 0, test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_json(NULL, json, buf, strlen(buf), test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_json(ctx, NULL, buf, strlen(buf), test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_json(ctx, json, NULL, 4, test_tweak, 8));
+    FPE_CTX_free(ctx);
+
+    /* Numbers need a radix-10 context; strings need a matching alphabet */
+    ctx = test_new_ctx(FPE_MODE_FF1, 16);
+    char num[] = "{\"pan\":1234}";
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_json(ctx, json, num, strlen(num), test_tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_json(ctx, json, buf, strlen(buf), test_tweak, 8));
+    FPE_CTX_free(ctx);
+
+    FPE_JSON_free(json);
+}
+
+/* Expect a failing call to leave every byte of doc in place */
+static void check_untouched(FPE_CTX *ctx, const FPE_JSON *json, const char *doc) {
+    size_t n = strlen(doc);
+    char *buf = (char *)malloc(n + 1);
+    TEST_ASSERT_NOT_NULL(buf);
+    memcpy(buf, doc, n + 1);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(-1, FPE_encrypt_json(ctx, json, buf, n, test_tweak, 8), doc);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(doc, buf, n), doc);
+    free(buf);
+}
+
+void test_json_failure_leaves_buffer_untouched(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char *paths[] = {"a", "b"};
+    FPE_JSON *json = FPE_JSON_new(paths, 2, digits);
+    TEST_ASSERT_NOT_NULL(json);
+
+    /* Selected values before the bad one would already be rewritten */
+    static const char *const bad[] = {
+        "{\"b\":123456,\"a\":\"7\"}",          /* Too short */
+        "{\"b\":123456,\"a\":7}",
+        "{\"b\":123456,\"a\":0}",
+        "{\"a\":\"1234\",\"b\":12.5}",         /* Not an integer */
+        "{\"a\":\"1234\",\"b\":\"12\\u0033\"}",  /* Escaped */
+        "{\"a\":\"1234\",\"b\":\"\"}",          /* Empty */
+        "{\"a\":\"1234\",\"b\":\"12x4\"}",      /* Outside the alphabet */
+        "{\"a\":\"1234\",\"b\":98765} {\"a\":",  /* Malformed later document */
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        check_untouched(ctx, json, bad[i]);
+    }
+
+    /* Past the first window of queued strings */
+    char doc[2048];
+    size_t n = 0;
+    doc[n++] = '[';
+    for (int i = 0; i < 100; i++) {
+        n += (size_t)sprintf(doc + n, "{\"a\":\"%06d\"},", 100000 + i);
+    }
+    strcpy(doc + n, "{\"a\":\"1\"}]");
+    check_untouched(ctx, json, doc);
+    FPE_CTX_free(ctx);
+
+    /* FF3 length limits count too: a 300-digit string after a good integer */
+    ctx = test_new_ctx(FPE_MODE_FF3, 10);
+    n = (size_t)sprintf(doc, "{\"a\":123456,\"b\":\"");
+    memset(doc + n, '5', 300);
+    strcpy(doc + n + 300, "\"}");
+    check_untouched(ctx, json, doc);
+    FPE_CTX_free(ctx);
+
+    FPE_JSON_free(json);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* Value selection */
+    RUN_TEST(test_json_top_level_keys);
+    RUN_TEST(test_json_nested_paths_and_arrays);
+    RUN_TEST(test_json_event_stream);
+    RUN_TEST(test_json_numbers_stay_valid);
+
+    /* Error handling */
+    RUN_TEST(test_json_invalid_specs);
+    RUN_TEST(test_json_invalid_documents);
+    RUN_TEST(test_json_failure_leaves_buffer_untouched);
+
+    return UNITY_END();
+}
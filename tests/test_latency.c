@@ -0,0 +1,148 @@
+/**
+ * @file test_latency.c
+ * @brief Tests for latency histograms attached to contexts
+ */
+
+#include "test_common.h"
+#include <pthread.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void run_ops(FPE_CTX *ctx, int n) {
+    unsigned int buf[16] = {4, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2};
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, buf, buf, 16, NULL, 0));
+    }
+}
+
+void test_latency_empty(void) {
+    FPE_LATENCY *h = FPE_LATENCY_new();
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)FPE_LATENCY_count(h));
+    TEST_ASSERT_TRUE(FPE_LATENCY_quantile(h, 0.5) < 0.0);
+    TEST_ASSERT_TRUE(FPE_LATENCY_quantile(NULL, 0.5) < 0.0);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_CTX_set_latency(NULL, h));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_LATENCY_snapshot(h, h, 0));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_LATENCY_merge(h, NULL));
+    FPE_LATENCY_free(h);
+}
+
+void test_latency_records_calls(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_LATENCY *h = FPE_LATENCY_new();
+    TEST_ASSERT_NOT_NULL(h);
+
+    run_ops(ctx, 10);  /* Not attached yet */
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_set_latency(ctx, h));
+    run_ops(ctx, 1000);
+
+    /* String calls run through FPE_encrypt; rejected calls are timed too */
+    char out[8];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, "0123456789", "123456", out, NULL, 0));
+    unsigned int one[1] = {5};
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt(ctx, one, one, 1, NULL, 0));
+    TEST_ASSERT_EQUAL_UINT32(1002, (uint32_t)FPE_LATENCY_count(h));
+
+    double p50 = FPE_LATENCY_quantile(h, 0.5);
+    double p99 = FPE_LATENCY_quantile(h, 0.99);
+    double p999 = FPE_LATENCY_quantile(h, 0.999);
+    double max = FPE_LATENCY_quantile(h, 1.0);
+    TEST_ASSERT_TRUE(p50 > 0.0);
+    TEST_ASSERT_TRUE(p50 < 1e7);  /* A 16-digit FF1 call is microseconds */
+    TEST_ASSERT_TRUE(p50 <= p99);
+    TEST_ASSERT_TRUE(p99 <= p999);
+    TEST_ASSERT_TRUE(p999 <= max);
+    TEST_ASSERT_TRUE(max == FPE_LATENCY_quantile(h, 1.0));  /* Rate is fixed once calibrated */
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_set_latency(ctx, NULL));
+    run_ops(ctx, 10);
+    TEST_ASSERT_EQUAL_UINT32(1002, (uint32_t)FPE_LATENCY_count(h));
+
+    FPE_CTX_free(ctx);
+    FPE_LATENCY_free(h);
+}
+
+void test_latency_snapshot_reset_and_merge(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_LATENCY *h = FPE_LATENCY_new();
+    FPE_LATENCY *snap = FPE_LATENCY_new();
+    FPE_LATENCY *total = FPE_LATENCY_new();
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_NOT_NULL(snap);
+    TEST_ASSERT_NOT_NULL(total);
+    FPE_CTX_set_latency(ctx, h);
+
+    run_ops(ctx, 100);
+    TEST_ASSERT_EQUAL_INT(0, FPE_LATENCY_snapshot(h, snap, 0));
+    TEST_ASSERT_EQUAL_UINT32(100, (uint32_t)FPE_LATENCY_count(snap));
+    TEST_ASSERT_EQUAL_UINT32(100, (uint32_t)FPE_LATENCY_count(h));
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_LATENCY_snapshot(h, snap, 1));
+    TEST_ASSERT_EQUAL_UINT32(100, (uint32_t)FPE_LATENCY_count(snap));
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)FPE_LATENCY_count(h));
+    TEST_ASSERT_EQUAL_INT(0, FPE_LATENCY_merge(total, snap));
+
+    run_ops(ctx, 50);
+    TEST_ASSERT_EQUAL_INT(0, FPE_LATENCY_snapshot(h, snap, 1));
+    TEST_ASSERT_EQUAL_INT(0, FPE_LATENCY_merge(total, snap));
+    TEST_ASSERT_EQUAL_UINT32(150, (uint32_t)FPE_LATENCY_count(total));
+
+    FPE_LATENCY_reset(total);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)FPE_LATENCY_count(total));
+
+    FPE_CTX_free(ctx);
+    FPE_LATENCY_free(h);
+    FPE_LATENCY_free(snap);
+    FPE_LATENCY_free(total);
+}
+
+#define POOL_THREADS 4
+#define POOL_OPS 2000
+
+static void *pool_worker(void *arg) {
+    FPE_CTX *ctx = FPE_CTX_new();
+    if (!ctx) return NULL;
+    FPE_CTX_init(ctx, FPE_MODE_FF1, FPE_ALGO_AES, test_key, 128, 10);
+    FPE_CTX_set_latency(ctx, (FPE_LATENCY *)arg);
+
+    unsigned int buf[16] = {0};
+    for (int i = 0; i < POOL_OPS; i++) FPE_encrypt(ctx, buf, buf, 16, NULL, 0);
+    FPE_CTX_free(ctx);
+    return NULL;
+}
+
+void test_latency_shared_across_threads(void) {
+    FPE_LATENCY *h = FPE_LATENCY_new();
+    FPE_LATENCY *snap = FPE_LATENCY_new();
+    TEST_ASSERT_NOT_NULL(h);
+    TEST_ASSERT_NOT_NULL(snap);
+
+    /* Snapshots taken while the workers record must not lose calls */
+    pthread_t threads[POOL_THREADS];
+    for (int t = 0; t < POOL_THREADS; t++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, pool_worker, h));
+    }
+    uint64_t taken = 0;
+    for (int i = 0; i < 20; i++) {
+        FPE_LATENCY_snapshot(h, snap, 1);
+        taken += FPE_LATENCY_count(snap);
+    }
+    for (int t = 0; t < POOL_THREADS; t++) pthread_join(threads[t], NULL);
+
+    taken += FPE_LATENCY_count(h);
+    TEST_ASSERT_EQUAL_UINT32(POOL_THREADS * POOL_OPS, (uint32_t)taken);
+
+    FPE_LATENCY_free(h);
+    FPE_LATENCY_free(snap);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_latency_empty);
+    RUN_TEST(test_latency_records_calls);
+    RUN_TEST(test_latency_snapshot_reset_and_merge);
+    RUN_TEST(test_latency_shared_across_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_mask.c
+ * @brief Unit tests for compiled format masks
+ */
+
+#include "test_common.h"
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char digits[] = "0123456789";
+
+/*
+ * Encrypt with the mask and check that the result matches FPE_encrypt_str
+ * on the '#' characters alone, that other positions are untouched, and
+ * that it decrypts back (in place). layout marks encrypted positions with
+ * '#' (the pattern itself, unless it contains escapes).
+ */
+static void check_mask_layout(FPE_CTX *ctx, const char *pattern, const char *layout,
+                              const char *alphabet, const char *in, const char *hash_chars) {
+    unsigned char tweak[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    FPE_MASK *mask = FPE_MASK_new(pattern, alphabet);
+    TEST_ASSERT_NOT_NULL(mask);
+    TEST_ASSERT_EQUAL_UINT(strlen(in), FPE_MASK_len(mask));
+
+    char out[FPE_MASK_MAX_LEN + 1], enc[FPE_MASK_MAX_LEN + 1];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_mask(ctx, mask, in, out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, alphabet, hash_chars, enc, tweak, 8));
+
+    size_t k = 0;
+    for (size_t i = 0; in[i]; i++) {
+        if (layout[i] == '#') {
+            TEST_ASSERT_EQUAL_CHAR(enc[k++], out[i]);
+        } else {
+            TEST_ASSERT_EQUAL_CHAR(in[i], out[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(strlen(hash_chars), k);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_mask(ctx, mask, out, out, tweak, 8));
+    TEST_ASSERT_EQUAL_STRING(in, out);
+
+    FPE_MASK_free(mask);
+}
+
+static void check_mask(FPE_CTX *ctx, const char *pattern, const char *alphabet,
+                       const char *in, const char *hash_chars) {
+    check_mask_layout(ctx, pattern, pattern, alphabet, in, hash_chars);
+}
+
+/* ========================================================================= */
+/*                             Common Formats                                */
+/* ========================================================================= */
+
+void test_mask_card_number(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    check_mask(ctx, "####-####-####-####", digits, "4111-1111-1111-1111", "4111111111111111");
+    check_mask(ctx, "====-==##-####-====", digits, "4111-1122-3344-1111", "223344");
+    FPE_CTX_free(ctx);
+}
+
+void test_mask_phone_and_ssn(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    check_mask(ctx, "(###) ###-####", digits, "(555) 123-4567", "5551234567");
+    check_mask(ctx, "###-##-####", digits, "123-45-6789", "123456789");
+    FPE_CTX_free(ctx);
+}
+
+void test_mask_escapes_and_alphabets(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 26);
+    /* '\#' and '\=' are literals; '\\' is a literal backslash */
+    check_mask_layout(ctx, "\\####\\=##\\\\", "-###-##-", "abcdefghijklmnopqrstuvwxyz",
+                      "#abc=de\\", "abcde");
+    FPE_CTX_free(ctx);
+
+    ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    unsigned char tweak[7] = {0};
+    FPE_MASK *mask = FPE_MASK_new("##/##/####", digits);
+    TEST_ASSERT_NOT_NULL(mask);
+    char buf[11] = "12/31/1999";
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_mask(ctx, mask, buf, buf, tweak, 7));
+    TEST_ASSERT_EQUAL_CHAR('/', buf[2]);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_mask(ctx, mask, buf, buf, tweak, 7));
+    TEST_ASSERT_EQUAL_STRING("12/31/1999", buf);
+    FPE_MASK_free(mask);
+    FPE_CTX_free(ctx);
+}
+
+void test_mask_long_pattern(void) {
+    /* Full-length pattern: spans long enough for the SIMD mapping */
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    char pattern[FPE_MASK_MAX_LEN + 1], in[FPE_MASK_MAX_LEN + 1], hash[FPE_MASK_MAX_LEN + 1];
+    size_t k = 0;
+    for (int i = 0; i < FPE_MASK_MAX_LEN; i++) {
+        pattern[i] = (i % 40 == 39) ? '-' : (i % 50 == 7 ? '=' : '#');
+        in[i] = pattern[i] == '-' ? '-' : (char)('0' + (i * 7) % 10);
+        if (pattern[i] == '#') hash[k++] = in[i];
+    }
+    pattern[FPE_MASK_MAX_LEN] = in[FPE_MASK_MAX_LEN] = hash[k] = '\0';
+
+    check_mask(ctx, pattern, digits, in, hash);
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                               Error Handling                              */
+/* ========================================================================= */
+
+void test_mask_invalid_patterns(void) {
+    char pattern[FPE_MASK_MAX_LEN + 2];
+    memset(pattern, '#', sizeof(pattern) - 1);
+    pattern[sizeof(pattern) - 1] = '\0';
+
+    TEST_ASSERT_NULL(FPE_MASK_new(pattern, digits));     /* Too long */
+    TEST_ASSERT_NULL(FPE_MASK_new("#-=", digits));       /* One encrypted position */
+    TEST_ASSERT_NULL(FPE_MASK_new("", digits));
+    TEST_ASSERT_NULL(FPE_MASK_new("###\\", digits));     /* Dangling escape */
+    TEST_ASSERT_NULL(FPE_MASK_new("###", "0012"));       /* Duplicate in alphabet */
+    TEST_ASSERT_NULL(FPE_MASK_new(NULL, digits));
+    TEST_ASSERT_NULL(FPE_MASK_new("###", NULL));
+    FPE_MASK_free(NULL);
+}
+
+void test_mask_invalid_inputs(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned char tweak[8] = {0};
+    char out[32];
+    FPE_MASK *mask = FPE_MASK_new("###-##-####", digits);
+    TEST_ASSERT_NOT_NULL(mask);
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "123 45-6789", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "12a-45-6789", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "123-45-678", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "123-45-67890", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(NULL, mask, "123-45-6789", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, NULL, "123-45-6789", out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, NULL, out, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "123-45-6789", NULL, tweak, 8));
+    FPE_CTX_free(ctx);
+
+    /* Context radix must match the mask's alphabet */
+    ctx = test_new_ctx(FPE_MODE_FF1, 16);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_mask(ctx, mask, "123-45-6789", out, tweak, 8));
+    FPE_CTX_free(ctx);
+
+    FPE_MASK_free(mask);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* Common formats */
+    RUN_TEST(test_mask_card_number);
+    RUN_TEST(test_mask_phone_and_ssn);
+    RUN_TEST(test_mask_escapes_and_alphabets);
+    RUN_TEST(test_mask_long_pattern);
+
+    /* Error handling */
+    RUN_TEST(test_mask_invalid_patterns);
+    RUN_TEST(test_mask_invalid_inputs);
+
+    return UNITY_END();
+}
@@ -0,0 +1,230 @@
+/**
+ * @file test_pan.c
+ * @brief Unit tests for Luhn-preserving card number (PAN) tokenization
+ */
+
+#include "test_common.h"
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const unsigned int all_flags[] = {
+    FPE_PAN_KEEP_NONE, FPE_PAN_KEEP_BIN, FPE_PAN_KEEP_LAST4,
+    FPE_PAN_KEEP_BIN | FPE_PAN_KEEP_LAST4
+};
+
+/* Plain scalar Luhn, independent of the library's SIMD version */
+static int luhn_valid(const char *pan, unsigned int len) {
+    int sum = 0;
+    for (unsigned int i = 0; i < len; i++) {
+        int d = pan[len - 1 - i] - '0';
+        if (i & 1) {
+            d *= 2;
+            if (d > 9) d -= 9;
+        }
+        sum += d;
+    }
+    return sum % 10 == 0;
+}
+
+/* Deterministic pseudo-random Luhn-valid PAN of len digits */
+static void make_pan(char *pan, unsigned int len, unsigned int seed) {
+    unsigned int x = seed * 2654435761u + 12345;
+    for (unsigned int i = 0; i < len; i++) {
+        x = x * 1103515245u + 12345;
+        pan[i] = (char)('0' + (x >> 16) % 10);
+    }
+    pan[len] = '\0';
+
+    for (char c = '0'; c <= '9'; c++) {
+        pan[len - 1] = c;
+        if (luhn_valid(pan, len)) return;
+    }
+}
+
+/* ========================================================================= */
+/*                              Single PANs                                  */
+/* ========================================================================= */
+
+void test_pan_round_trip_all_lengths(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned char tweak[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    char pan[20], tok[20], back[20];
+
+    for (unsigned int len = FPE_PAN_MIN_LEN; len <= FPE_PAN_MAX_LEN; len++) {
+        for (size_t f = 0; f < sizeof(all_flags) / sizeof(all_flags[0]); f++) {
+            unsigned int flags = all_flags[f];
+            unsigned int start = (flags & FPE_PAN_KEEP_BIN) ? 6 : 0;
+            unsigned int end = (flags & FPE_PAN_KEEP_LAST4) ? len - 4 : len;
+            if (end - 1 < start + 2) continue;  /* Too few digits to encrypt */
+
+            make_pan(pan, len, len * 4 + (unsigned int)f);
+            TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan(ctx, pan, tok, flags, tweak, 8));
+            TEST_ASSERT_EQUAL_size_t(len, strlen(tok));
+            TEST_ASSERT_TRUE(luhn_valid(tok, len));
+            TEST_ASSERT_TRUE(strcmp(pan, tok) != 0);
+
+            /* Kept digits are untouched */
+            TEST_ASSERT_EQUAL_MEMORY(pan, tok, start);
+            TEST_ASSERT_EQUAL_MEMORY(pan + end, tok + end, len - end);
+
+            TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_pan(ctx, tok, back, flags, tweak, 8));
+            TEST_ASSERT_EQUAL_STRING(pan, back);
+        }
+    }
+
+    FPE_CTX_free(ctx);
+}
+
+void test_pan_matches_string_api(void) {
+    /* The encrypted span is exactly FPE_encrypt_str of those digits */
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned char tweak[4] = {0, 0, 0, 0x7B};
+    const char *pan = "4111111111111111";
+    char tok[17], span[17], enc[17];
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan(ctx, pan, tok, FPE_PAN_KEEP_BIN, tweak, 4));
+
+    memcpy(span, pan + 6, 9);
+    span[9] = '\0';
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, "0123456789", span, enc, tweak, 4));
+    TEST_ASSERT_EQUAL_MEMORY("411111", tok, 6);
+    TEST_ASSERT_EQUAL_MEMORY(enc, tok + 6, 9);
+    TEST_ASSERT_TRUE(luhn_valid(tok, 16));
+
+    FPE_CTX_free(ctx);
+}
+
+void test_pan_in_place_and_ff3_1(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    unsigned char tweak[7] = {9, 8, 7, 6, 5, 4, 3};
+    char pan[20], orig[20];
+
+    make_pan(pan, 16, 99);
+    strcpy(orig, pan);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan(ctx, pan, pan, FPE_PAN_KEEP_LAST4, tweak, 7));
+    TEST_ASSERT_TRUE(luhn_valid(pan, 16));
+    TEST_ASSERT_EQUAL_MEMORY(orig + 12, pan + 12, 4);
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_pan(ctx, pan, pan, FPE_PAN_KEEP_LAST4, tweak, 7));
+    TEST_ASSERT_EQUAL_STRING(orig, pan);
+
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                                 Batches                                   */
+/* ========================================================================= */
+
+static void check_batch_matches_single(unsigned int len, size_t count, unsigned int flags,
+                                       size_t tweak_stride) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+
+    char *in = (char *)malloc(count * len);
+    char *out = (char *)malloc(count * len);
+    unsigned char *tweaks = (unsigned char *)malloc(count * 8 + 8);
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_NOT_NULL(tweaks);
+
+    char pan[20], tok[20];
+    for (size_t r = 0; r < count; r++) {
+        make_pan(pan, len, (unsigned int)r + 1);
+        memcpy(in + r * len, pan, len);
+    }
+    for (size_t i = 0; i < count * 8 + 8; i++) tweaks[i] = (unsigned char)(i * 31 + 7);
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan_batch(ctx, in, out, len, count, flags,
+                                                   tweaks, 8, tweak_stride));
+    for (size_t r = 0; r < count; r++) {
+        memcpy(pan, in + r * len, len);
+        pan[len] = '\0';
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan(ctx, pan, tok, flags,
+                                                 tweaks + r * tweak_stride, 8));
+        TEST_ASSERT_EQUAL_MEMORY(tok, out + r * len, len);
+    }
+
+    /* Decrypt in place */
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_pan_batch(ctx, out, out, len, count, flags,
+                                                   tweaks, 8, tweak_stride));
+    TEST_ASSERT_EQUAL_MEMORY(in, out, count * len);
+
+    free(in);
+    free(out);
+    free(tweaks);
+    FPE_CTX_free(ctx);
+}
+
+void test_pan_batch_matches_single(void) {
+    check_batch_matches_single(16, 150, FPE_PAN_KEEP_NONE, 8);
+    check_batch_matches_single(16, 70, FPE_PAN_KEEP_BIN | FPE_PAN_KEEP_LAST4, 0);
+    check_batch_matches_single(15, 9, FPE_PAN_KEEP_BIN, 8);
+    check_batch_matches_single(19, 1, FPE_PAN_KEEP_LAST4, 8);
+}
+
+/* ========================================================================= */
+/*                               Error Handling                              */
+/* ========================================================================= */
+
+void test_pan_invalid_inputs(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned char tweak[8] = {0};
+    char out[32];
+
+    /* Luhn failure, non-digits, and lengths outside 12..19 */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "4111111111111112", out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_decrypt_pan(ctx, "4111111111111112", out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "4111-11111111111", out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "42424242424", out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "41111111111111111113", out, 0, tweak, 8));
+
+    /* 12 digits keeping BIN and last 4 leave a single digit to encrypt */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "411111111117", out,
+                                              FPE_PAN_KEEP_BIN | FPE_PAN_KEEP_LAST4, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan(ctx, "411111111117", out, FPE_PAN_KEEP_BIN, tweak, 8));
+
+    /* Unknown flags and NULL arguments */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "4111111111111111", out, 0x80, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(NULL, "4111111111111111", out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, NULL, out, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "4111111111111111", NULL, 0, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_pan_batch(ctx, NULL, NULL, 16, 0, 0, NULL, 0, 0));
+
+    /* A bad record anywhere fails the whole batch */
+    char batch[3 * 16 + 1] = "411111111111111141111111111111114111111111111112";
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan_batch(ctx, batch, batch, 16, 3, 0, tweak, 8, 0));
+
+    /* In place, a bad last record must not cost the caller earlier chunks */
+    char many[100 * 16 + 1], orig[100 * 16 + 1];
+    for (int r = 0; r < 100; r++) memcpy(many + r * 16, "4111111111111111", 16);
+    many[99 * 16 + 15] = '2';
+    memcpy(orig, many, sizeof(many));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan_batch(ctx, many, many, 16, 100, 0, tweak, 8, 0));
+    TEST_ASSERT_EQUAL_MEMORY(orig, many, 100 * 16);
+
+    FPE_CTX_free(ctx);
+
+    /* PANs need a radix-10 context */
+    ctx = test_new_ctx(FPE_MODE_FF1, 36);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_pan(ctx, "4111111111111111", out, 0, tweak, 8));
+    FPE_CTX_free(ctx);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    /* Single PANs */
+    RUN_TEST(test_pan_round_trip_all_lengths);
+    RUN_TEST(test_pan_matches_string_api);
+    RUN_TEST(test_pan_in_place_and_ff3_1);
+
+    /* Batches */
+    RUN_TEST(test_pan_batch_matches_single);
+
+    /* Error handling */
+    RUN_TEST(test_pan_invalid_inputs);
+
+    return UNITY_END();
+}
@@ -0,0 +1,131 @@
+/**
+ * @file test_plan.c
+ * @brief Tests for prepared operation plans (FPE_PLAN)
+ */
+
+#include "test_common.h"
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const unsigned char nist_tweak[10] = {
+    0x39, 0x38, 0x37, 0x36, 0x35, 0x34, 0x33, 0x32, 0x31, 0x30
+};
+
+static unsigned int next_rand(unsigned int *state) {
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+/* Plans must give the same result as FPE_encrypt/FPE_decrypt */
+static void check_matches(FPE_MODE mode, unsigned int radix, unsigned int len,
+                          unsigned int tweak_len) {
+    FPE_CTX *ctx = test_new_ctx(mode, radix);
+    FPE_PLAN *plan = FPE_PLAN_new(ctx, len, tweak_len, NULL);
+    TEST_ASSERT_NOT_NULL(plan);
+
+    static unsigned int in[300], expect[300], got[300], back[300];
+    unsigned int seed = len * 31u + radix;
+    for (int rec = 0; rec < 8; rec++) {
+        for (unsigned int i = 0; i < len; i++) in[i] = next_rand(&seed) % radix;
+
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, in, expect, len, nist_tweak, tweak_len));
+        TEST_ASSERT_EQUAL_INT(0, FPE_PLAN_encrypt(plan, in, got, nist_tweak));
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(expect, got, len);
+
+        TEST_ASSERT_EQUAL_INT(0, FPE_PLAN_decrypt(plan, got, back, nist_tweak));
+        TEST_ASSERT_EQUAL_UINT32_ARRAY(in, back, len);
+    }
+
+    FPE_PLAN_free(plan);
+    FPE_CTX_free(ctx);
+}
+
+void test_plan_matches_ff1(void) {
+    check_matches(FPE_MODE_FF1, 10, 2, 0);
+    check_matches(FPE_MODE_FF1, 10, 16, 10);
+    check_matches(FPE_MODE_FF1, 36, 19, 7);
+    check_matches(FPE_MODE_FF1, 10, 300, 10);  /* Multi-limb moduli */
+    check_matches(FPE_MODE_FF1, 65536, 9, 3);
+}
+
+void test_plan_matches_ff3(void) {
+    check_matches(FPE_MODE_FF3, 10, 18, 8);
+    check_matches(FPE_MODE_FF3, 26, 19, 7);
+    check_matches(FPE_MODE_FF3_1, 10, 16, 7);
+    check_matches(FPE_MODE_FF3_1, 36, 23, 0);
+}
+
+void test_plan_nist_vector(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_PLAN *plan = FPE_PLAN_new(ctx, 10, sizeof(nist_tweak), "0123456789");
+    TEST_ASSERT_NOT_NULL(plan);
+
+    char out[11], back[11];
+    TEST_ASSERT_EQUAL_INT(0, FPE_PLAN_encrypt_str(plan, "0123456789", out, nist_tweak));
+    TEST_ASSERT_EQUAL_STRING("6124200773", out);
+    TEST_ASSERT_EQUAL_INT(0, FPE_PLAN_decrypt_str(plan, out, back, nist_tweak));
+    TEST_ASSERT_EQUAL_STRING("0123456789", back);
+
+    FPE_PLAN_free(plan);
+    FPE_CTX_free(ctx);
+}
+
+void test_plan_rejects_invalid_shapes(void) {
+    FPE_CTX *uninit = FPE_CTX_new();
+    TEST_ASSERT_NULL(FPE_PLAN_new(NULL, 10, 0, NULL));
+    TEST_ASSERT_NULL(FPE_PLAN_new(uninit, 10, 0, NULL));
+    FPE_CTX_free(uninit);
+
+    FPE_CTX *ff1 = test_new_ctx(FPE_MODE_FF1, 10);
+    TEST_ASSERT_NULL(FPE_PLAN_new(ff1, 1, 0, NULL));
+    TEST_ASSERT_NULL(FPE_PLAN_new(ff1, 10, 0, "0123456789abcdef"));  /* radix 16 != 10 */
+    TEST_ASSERT_NULL(FPE_PLAN_new(ff1, 10, 0, "00123456789"));       /* duplicate */
+    FPE_CTX_free(ff1);
+
+    FPE_CTX *ff3 = test_new_ctx(FPE_MODE_FF3_1, 10);
+    TEST_ASSERT_NULL(FPE_PLAN_new(ff3, 257, 7, NULL));
+    TEST_ASSERT_NULL(FPE_PLAN_new(ff3, 16, 5, NULL));
+    FPE_CTX_free(ff3);
+
+    FPE_PLAN_free(NULL);
+}
+
+void test_plan_rejects_bad_records(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_PLAN *plan = FPE_PLAN_new(ctx, 6, 4, "0123456789");
+    FPE_PLAN *bare = FPE_PLAN_new(ctx, 6, 4, NULL);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_NOT_NULL(bare);
+
+    char out[16];
+    unsigned int digits[6] = {1, 2, 3, 4, 5, 10};  /* 10 is out of range */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt(plan, digits, digits, nist_tweak));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt(plan, digits, digits, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt(NULL, digits, digits, nist_tweak));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt_str(plan, "12345", out, nist_tweak));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt_str(plan, "1234567", out, nist_tweak));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt_str(plan, "12a456", out, nist_tweak));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_PLAN_encrypt_str(bare, "123456", out, nist_tweak));
+
+    /* The plan still works after rejections */
+    char expect[16];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, "0123456789", "123456", expect, nist_tweak, 4));
+    TEST_ASSERT_EQUAL_INT(0, FPE_PLAN_encrypt_str(plan, "123456", out, nist_tweak));
+    TEST_ASSERT_EQUAL_STRING(expect, out);
+
+    FPE_PLAN_free(bare);
+    FPE_PLAN_free(plan);
+    FPE_CTX_free(ctx);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_plan_matches_ff1);
+    RUN_TEST(test_plan_matches_ff3);
+    RUN_TEST(test_plan_nist_vector);
+    RUN_TEST(test_plan_rejects_invalid_shapes);
+    RUN_TEST(test_plan_rejects_bad_records);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/**
+ * @file test_sqlite.c
+ * @brief Tests for the SQLite loadable extension (in-memory database)
+ */
+
+#include "test_common.h"
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static sqlite3 *db;
+
+#define KEY_SQL "x'2B7E151628AED2A6ABF7158809CF4F3C'"
+#define TWEAK_SQL "x'0102030405060708'"
+
+void setUp(void) {
+    char *err = NULL;
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, sqlite3_open(":memory:", &db));
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, sqlite3_enable_load_extension(db, 1));
+    int rc = sqlite3_load_extension(db, FPE_SQLITE_EXTENSION, "sqlite3_fpesqlite_init", &err);
+    if (rc != SQLITE_OK) printf("load_extension: %s\n", err ? err : "?");
+    sqlite3_free(err);
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, rc);
+}
+
+void tearDown(void) {
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, sqlite3_close(db));
+    db = NULL;
+}
+
+static void exec(const char *sql) {
+    char *err = NULL;
+    int rc = sqlite3_exec(db, sql, NULL, NULL, &err);
+    if (rc != SQLITE_OK) printf("%s: %s\n", sql, err ? err : "?");
+    sqlite3_free(err);
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, rc);
+}
+
+/*
+ * Run a single-row, single-column query. Returns the text result in out
+ * (empty for NULL) and the SQLite result code of the step.
+ */
+static int query(const char *sql, char *out, size_t cap) {
+    sqlite3_stmt *stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    TEST_ASSERT_EQUAL_INT(SQLITE_OK, rc);
+
+    out[0] = '\0';
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        const unsigned char *text = sqlite3_column_text(stmt, 0);
+        if (text) snprintf(out, cap, "%s", (const char *)text);
+    }
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+/* ========================================================================= */
+/*                                Functions                                  */
+/* ========================================================================= */
+
+void test_sqlite_encrypt_matches_str(void) {
+    char result[64], expect[64];
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+
+    exec("SELECT fpe_set_key('k1', " KEY_SQL ")");
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(
+        "SELECT fpe_encrypt('FF1', 'k1', '0123456789', '4111111111111111', " TWEAK_SQL ")",
+        result, sizeof(result)));
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, "0123456789", "4111111111111111",
+                                             expect, test_tweak, 8));
+    TEST_ASSERT_EQUAL_STRING(expect, result);
+
+    /* Without a tweak argument the tweak is empty */
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(
+        "SELECT fpe_encrypt('ff1', 'k1', '0123456789', '123456789')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, "0123456789", "123456789", expect, NULL, 0));
+    TEST_ASSERT_EQUAL_STRING(expect, result);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_sqlite_table_round_trip(void) {
+    exec("SELECT fpe_set_key('k1', " KEY_SQL ")");
+    exec("CREATE TABLE cards(id INTEGER PRIMARY KEY, pan TEXT, alphabet TEXT)");
+    exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 500) "
+         "INSERT INTO cards SELECT i, printf('%016d', i * 7919), "
+         "CASE WHEN i % 2 THEN '0123456789' ELSE '0123456789abcdef' END FROM n");
+    exec("INSERT INTO cards VALUES (1000, NULL, '0123456789')");
+
+    /* Constant arguments (aux-data path) and a per-row alphabet */
+    exec("CREATE TABLE tokens AS SELECT id, "
+         "fpe_encrypt('FF1', 'k1', '0123456789', pan, " TWEAK_SQL ") AS t1, "
+         "fpe_encrypt('FF3-1', 'k1', alphabet, pan, x'01020304050607') AS t2, "
+         "alphabet FROM cards");
+
+    char result[64];
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(
+        "SELECT count(*) FROM cards c JOIN tokens t USING (id) WHERE "
+        "t1 <> c.pan AND length(t1) = 16 AND "
+        "fpe_decrypt('FF1', 'k1', '0123456789', t1, " TWEAK_SQL ") = c.pan AND "
+        "fpe_decrypt('FF3-1', 'k1', t.alphabet, t2, x'01020304050607') = c.pan",
+        result, sizeof(result)));
+    TEST_ASSERT_EQUAL_STRING("500", result);
+
+    /* NULL in, NULL out */
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(
+        "SELECT t1 IS NULL AND t2 IS NULL FROM tokens WHERE id = 1000", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_STRING("1", result);
+}
+
+void test_sqlite_rekey(void) {
+    char before[64], after[64];
+    const char *sql = "SELECT fpe_encrypt('FF1', 'k1', '0123456789', '4111111111111111')";
+
+    exec("SELECT fpe_set_key('k1', " KEY_SQL ")");
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(sql, before, sizeof(before)));
+
+    exec("SELECT fpe_set_key('k1', x'000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F')");
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(sql, after, sizeof(after)));
+    TEST_ASSERT_TRUE(strcmp(before, after) != 0);
+
+    exec("SELECT fpe_set_key('k1', " KEY_SQL ")");
+    TEST_ASSERT_EQUAL_INT(SQLITE_ROW, query(sql, after, sizeof(after)));
+    TEST_ASSERT_EQUAL_STRING(before, after);
+}
+
+/* ========================================================================= */
+/*                                 Errors                                    */
+/* ========================================================================= */
+
+void test_sqlite_errors(void) {
+    char result[64];
+    exec("SELECT fpe_set_key('k1', " KEY_SQL ")");
+
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_encrypt('FF1', 'missing', '0123456789', '123456')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_encrypt('FF2', 'k1', '0123456789', '123456')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_encrypt('FF1', 'k1', '0123456789', '12x456')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_encrypt('FF3', 'k1', '0123456789', '123456', x'01')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_set_key('k2', x'0102')", result, sizeof(result)));
+    TEST_ASSERT_EQUAL_INT(SQLITE_ERROR, query(
+        "SELECT fpe_set_key('k2', " KEY_SQL ", 'DES')", result, sizeof(result)));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sqlite_encrypt_matches_str);
+    RUN_TEST(test_sqlite_table_round_trip);
+    RUN_TEST(test_sqlite_rekey);
+    RUN_TEST(test_sqlite_errors);
+
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+/**
+ * @file test_stats.c
+ * @brief Tests for per-context and global operation counters
+ *
+ * Counters exist only in ENABLE_STATS builds; elsewhere the getters must
+ * fail cleanly and the remaining tests are ignored.
+ */
+
+#include "test_common.h"
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const unsigned char tweak[8] = {0xD8, 0xE7, 0x92, 0x0A, 0xFA, 0x33, 0x0A, 0x73};
+
+static int stats_enabled(void) {
+    FPE_STATS s;
+    return FPE_get_global_stats(&s) == 0;
+}
+
+static FPE_STATS get_stats(const FPE_CTX *ctx) {
+    FPE_STATS s;
+    TEST_ASSERT_EQUAL_INT(0, FPE_CTX_get_stats(ctx, &s));
+    return s;
+}
+
+void test_stats_compiled_out(void) {
+    if (stats_enabled()) TEST_IGNORE_MESSAGE("built with ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_STATS s;
+    memset(&s, 0xAA, sizeof(s));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_CTX_get_stats(ctx, &s));
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)s.encrypt_calls);
+    FPE_CTX_reset_stats(ctx);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_null_arguments(void) {
+    FPE_STATS s;
+    TEST_ASSERT_EQUAL_INT(-1, FPE_CTX_get_stats(NULL, &s));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_get_global_stats(NULL));
+    FPE_CTX_reset_stats(NULL);
+}
+
+void test_stats_ff1_counts(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}, out[10];
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, in, out, 10, NULL, 0));
+    }
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt(ctx, out, out, 10, NULL, 0));
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(in, out, 10);
+
+    FPE_STATS s = get_stats(ctx);
+    TEST_ASSERT_EQUAL_UINT32(3, (uint32_t)s.encrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)s.decrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(40, (uint32_t)s.digits);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)s.rejected);
+
+    /* b = 3, so Q is one block: P plus one CBC-MAC block per round */
+    TEST_ASSERT_EQUAL_UINT32(4 * 10 * 2, (uint32_t)s.cipher_blocks);
+
+    /* The radix power table is built once and reused */
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)s.cache_misses);
+    TEST_ASSERT_EQUAL_UINT32(3, (uint32_t)s.cache_hits);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_ff3_1_blocks(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    unsigned int in[12] = {8, 9, 0, 1, 2, 1, 2, 3, 4, 5, 6, 7}, out[12];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(ctx, in, out, 12, tweak, 7));
+
+    FPE_STATS s = get_stats(ctx);
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)s.encrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(8, (uint32_t)s.cipher_blocks);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_rejected_inputs(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    unsigned int bad[4] = {1, 2, 3, 4}, out[4];
+    char buf[8];
+
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt(ctx, bad, out, 4, tweak, 5));   /* tweak */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt(ctx, bad, out, 1, tweak, 7));   /* length */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_str(ctx, "0123456789", "12a4", buf, tweak, 7));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_encrypt_bytes(ctx, (const unsigned char *)"ab",
+                                                (unsigned char *)buf, 2, tweak, 7));
+
+    FPE_STATS s = get_stats(ctx);
+    TEST_ASSERT_EQUAL_UINT32(4, (uint32_t)s.rejected);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)s.encrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)s.digits);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_string_api(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 36);
+    const char *alphabet = "0123456789abcdefghijklmnopqrstuvwxyz";
+    char ct[16], pt[16];
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, alphabet, "0123456789abcde", ct, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt_str(ctx, alphabet, ct, pt, NULL, 0));
+    TEST_ASSERT_EQUAL_STRING("0123456789abcde", pt);
+
+    /* Alphabet compiled once, then radix powers built once: one miss each */
+    FPE_STATS s = get_stats(ctx);
+    TEST_ASSERT_EQUAL_UINT32(30, (uint32_t)s.bytes);
+    TEST_ASSERT_EQUAL_UINT32(30, (uint32_t)s.digits);
+    TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)s.cache_misses);
+    TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)s.cache_hits);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_batch_counts_records(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    unsigned int buf[19 * 16];
+    for (unsigned int i = 0; i < 19 * 16; i++) buf[i] = i % 10;
+
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_batch(ctx, buf, buf, 16, 19, NULL, 0, 0));
+
+    FPE_STATS s = get_stats(ctx);
+    TEST_ASSERT_EQUAL_UINT32(19, (uint32_t)s.encrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(19 * 16, (uint32_t)s.digits);
+    FPE_CTX_free(ctx);
+}
+
+void test_stats_global_aggregate(void) {
+    if (!stats_enabled()) TEST_IGNORE_MESSAGE("built without ENABLE_STATS");
+
+    FPE_reset_global_stats();
+    unsigned int in[6] = {1, 2, 3, 4, 5, 6}, out[6];
+
+    FPE_CTX *a = test_new_ctx(FPE_MODE_FF1, 10);
+    FPE_CTX *b = test_new_ctx(FPE_MODE_FF3, 10);
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(a, in, out, 6, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt(b, in, out, 6, tweak, 8));
+    TEST_ASSERT_EQUAL_INT(0, FPE_decrypt(b, out, out, 6, tweak, 8));
+
+    /* Reset folds a's counters into the aggregate; free folds b's */
+    FPE_CTX_reset_stats(a);
+    FPE_STATS s = get_stats(a);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)s.encrypt_calls);
+    FPE_CTX_free(b);
+
+    FPE_STATS g;
+    TEST_ASSERT_EQUAL_INT(0, FPE_get_global_stats(&g));
+    TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)g.encrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)g.decrypt_calls);
+    TEST_ASSERT_EQUAL_UINT32(18, (uint32_t)g.digits);
+
+    FPE_CTX_free(a);  /* Nothing left to add */
+    TEST_ASSERT_EQUAL_INT(0, FPE_get_global_stats(&g));
+    TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)g.encrypt_calls);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_stats_compiled_out);
+    RUN_TEST(test_stats_null_arguments);
+    RUN_TEST(test_stats_ff1_counts);
+    RUN_TEST(test_stats_ff3_1_blocks);
+    RUN_TEST(test_stats_rejected_inputs);
+    RUN_TEST(test_stats_string_api);
+    RUN_TEST(test_stats_batch_counts_records);
+    RUN_TEST(test_stats_global_aggregate);
+    return UNITY_END();
+}
@@ -0,0 +1,269 @@
+/**
+ * @file test_stream.c
+ * @brief Unit tests for the streaming record API
+ */
+
+#include "test_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char digits[] = "0123456789";
+
+/* Records of 6..29 digits, one per line */
+static char *make_records(size_t nrec, size_t *out_len) {
+    char *text = (char *)malloc(nrec * 32);
+    TEST_ASSERT_NOT_NULL(text);
+    size_t len = 0;
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < nrec; i++) {
+        size_t rlen = 6 + i % 24;
+        for (size_t j = 0; j < rlen; j++) {
+            seed = seed * 1103515245u + 12345u;
+            text[len++] = digits[(seed >> 16) % 10];
+        }
+        text[len++] = '\n';
+    }
+    *out_len = len;
+    return text;
+}
+
+/*
+ * Push len bytes of in through the stream using write sizes of wstep and
+ * read sizes of rstep, collecting the output. Returns the output length.
+ */
+static size_t pump(FPE_STREAM *s, const char *in, size_t len, char *out,
+                   size_t wstep, size_t rstep) {
+    size_t pos = 0, olen = 0;
+    int finished = 0;
+
+    for (;;) {
+        if (pos < len) {
+            size_t n = (len - pos < wstep) ? len - pos : wstep;
+            size_t used = 0;
+            TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_write(s, in + pos, n, &used));
+            pos += used;
+        } else if (!finished) {
+            TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_finish(s));
+            finished = 1;
+        }
+
+        size_t got;
+        do {
+            TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_read(s, out + olen, rstep, &got));
+            olen += got;
+        } while (got > 0);
+
+        if (finished) return olen;
+    }
+}
+
+/* Expect each line of out to be FPE_encrypt_str of the same line of in */
+static void check_lines(FPE_CTX *ctx, const char *in, const char *out, size_t len) {
+    char plain[64], expect[64];
+    size_t i = 0;
+    while (i < len) {
+        const char *nl = memchr(in + i, '\n', len - i);
+        size_t rlen = nl ? (size_t)(nl - (in + i)) : len - i;
+        if (rlen > 0 && in[i + rlen - 1] == '\r') rlen--;
+        if (rlen > 0) {
+            memcpy(plain, in + i, rlen);
+            plain[rlen] = '\0';
+            TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, plain, expect, test_tweak, 8));
+            TEST_ASSERT_EQUAL_MEMORY(expect, out + i, rlen);
+        }
+        i += (nl ? (size_t)(nl - (in + i)) + 1 : len - i);
+    }
+}
+
+static void round_trip(unsigned int flags, size_t chunk, size_t wstep, size_t rstep) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    size_t len;
+    char *in = make_records(500, &len);
+    char *enc = (char *)malloc(len);
+    char *dec = (char *)malloc(len);
+
+    FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 8, chunk, flags);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, pump(s, in, len, enc, wstep, rstep));
+    FPE_STREAM_free(s);
+
+    TEST_ASSERT_TRUE(memcmp(in, enc, len) != 0);
+    check_lines(ctx, in, enc, len);
+
+    s = FPE_STREAM_new(ctx, digits, test_tweak, 8, chunk, flags | FPE_STREAM_DECRYPT);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, pump(s, enc, len, dec, wstep, rstep));
+    FPE_STREAM_free(s);
+
+    TEST_ASSERT_EQUAL_MEMORY(in, dec, len);
+
+    free(in);
+    free(enc);
+    free(dec);
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                              Round Trips                                  */
+/* ========================================================================= */
+
+void test_stream_round_trip_sync(void) {
+    round_trip(0, 256, 97, 41);
+}
+
+void test_stream_round_trip_async(void) {
+    round_trip(FPE_STREAM_ASYNC, 256, 97, 41);
+}
+
+void test_stream_round_trip_large_writes(void) {
+    round_trip(0, 1024, 5000, 5000);
+    round_trip(FPE_STREAM_ASYNC, 0, 100000, 100000);
+}
+
+void test_stream_byte_at_a_time(void) {
+    round_trip(FPE_STREAM_ASYNC, 64, 1, 1);
+}
+
+/* ========================================================================= */
+/*                              Record Framing                               */
+/* ========================================================================= */
+
+void test_stream_crlf_empty_lines_and_last_record(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char in[] = "123456\r\n\n\n9876543210\r\n7777777";
+    size_t len = sizeof(in) - 1;
+    char out[sizeof(in)];
+
+    FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 8, 16, 0);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, pump(s, in, len, out, 7, 3));
+    FPE_STREAM_free(s);
+
+    /* Line endings and blank lines pass through untouched */
+    TEST_ASSERT_EQUAL_MEMORY("\r\n\n\n", out + 6, 4);
+    TEST_ASSERT_EQUAL_MEMORY("\r\n", out + 20, 2);
+    check_lines(ctx, in, out, len);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_stream_ff3_1(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF3_1, 10);
+    const char in[] = "1234567890\n0987654321\n5555555555\n";
+    size_t len = sizeof(in) - 1;
+    char enc[sizeof(in)], dec[sizeof(in)];
+
+    FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 7, 16, FPE_STREAM_ASYNC);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, pump(s, in, len, enc, 5, 5));
+    FPE_STREAM_free(s);
+
+    char expect[16];
+    TEST_ASSERT_EQUAL_INT(0, FPE_encrypt_str(ctx, digits, "0987654321", expect, test_tweak, 7));
+    TEST_ASSERT_EQUAL_MEMORY(expect, enc + 11, 10);
+
+    s = FPE_STREAM_new(ctx, digits, test_tweak, 7, 16, FPE_STREAM_DECRYPT);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, pump(s, enc, len, dec, 64, 64));
+    FPE_STREAM_free(s);
+    TEST_ASSERT_EQUAL_MEMORY(in, dec, len);
+
+    FPE_CTX_free(ctx);
+}
+
+/* ========================================================================= */
+/*                              Error Handling                               */
+/* ========================================================================= */
+
+void test_stream_new_rejects_bad_args(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+
+    TEST_ASSERT_NULL(FPE_STREAM_new(NULL, digits, test_tweak, 8, 0, 0));
+    TEST_ASSERT_NULL(FPE_STREAM_new(ctx, NULL, test_tweak, 8, 0, 0));
+    TEST_ASSERT_NULL(FPE_STREAM_new(ctx, digits, NULL, 8, 0, 0));
+    TEST_ASSERT_NULL(FPE_STREAM_new(ctx, "0123456789abcdef", test_tweak, 8, 0, 0));
+    TEST_ASSERT_NULL(FPE_STREAM_new(ctx, digits, test_tweak, 8, 2, 0));
+    TEST_ASSERT_NULL(FPE_STREAM_new(ctx, digits, test_tweak, 8, 0, 0x80));
+
+    FPE_CTX *ff3 = test_new_ctx(FPE_MODE_FF3, 10);
+    TEST_ASSERT_NULL(FPE_STREAM_new(ff3, digits, test_tweak, 5, 0, 0));
+    FPE_CTX_free(ff3);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_stream_record_longer_than_chunk(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char in[] = "12345678901234567890\n";
+    size_t used;
+
+    FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 8, 16, 0);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_INT(-1, FPE_STREAM_write(s, in, sizeof(in) - 1, &used));
+    TEST_ASSERT_EQUAL_size_t(0, used);
+    /* The stream stays failed */
+    TEST_ASSERT_EQUAL_INT(-1, FPE_STREAM_write(s, "1", 1, &used));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_STREAM_finish(s));
+    FPE_STREAM_free(s);
+
+    FPE_CTX_free(ctx);
+}
+
+void test_stream_invalid_character(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    const char in[] = "123456\n12x456\n";
+    char out[sizeof(in)];
+    size_t used, got;
+
+    for (unsigned int flags = 0; flags <= FPE_STREAM_ASYNC; flags += FPE_STREAM_ASYNC) {
+        FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 8, 0, flags);
+        TEST_ASSERT_NOT_NULL(s);
+        TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_write(s, in, sizeof(in) - 1, &used));
+        TEST_ASSERT_EQUAL_size_t(sizeof(in) - 1, used);
+        TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_finish(s));
+        TEST_ASSERT_EQUAL_INT(-1, FPE_STREAM_read(s, out, sizeof(out), &got));
+        TEST_ASSERT_EQUAL_size_t(0, got);
+        FPE_STREAM_free(s);
+    }
+
+    FPE_CTX_free(ctx);
+}
+
+void test_stream_write_after_finish(void) {
+    FPE_CTX *ctx = test_new_ctx(FPE_MODE_FF1, 10);
+    size_t used, got;
+    char out[8];
+
+    FPE_STREAM *s = FPE_STREAM_new(ctx, digits, test_tweak, 8, 0, 0);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_finish(s));
+    TEST_ASSERT_EQUAL_INT(-1, FPE_STREAM_write(s, "123456\n", 7, &used));
+    /* An empty stream reads out nothing */
+    TEST_ASSERT_EQUAL_INT(0, FPE_STREAM_read(s, out, sizeof(out), &got));
+    TEST_ASSERT_EQUAL_size_t(0, got);
+    FPE_STREAM_free(s);
+
+    FPE_STREAM_free(NULL);
+    FPE_CTX_free(ctx);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_stream_round_trip_sync);
+    RUN_TEST(test_stream_round_trip_async);
+    RUN_TEST(test_stream_round_trip_large_writes);
+    RUN_TEST(test_stream_byte_at_a_time);
+    RUN_TEST(test_stream_crlf_empty_lines_and_last_record);
+    RUN_TEST(test_stream_ff3_1);
+    RUN_TEST(test_stream_new_rejects_bad_args);
+    RUN_TEST(test_stream_record_longer_than_chunk);
+    RUN_TEST(test_stream_invalid_character);
+    RUN_TEST(test_stream_write_after_finish);
+
+    return UNITY_END();
+}
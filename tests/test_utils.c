@@ -118,6 +118,136 @@ void test_array_to_str_null_termination(void) {
     TEST_ASSERT_EQUAL_CHAR('\0', str[3]);
 }
 
+/* ========================================================================= */
+/*                        Compiled Alphabet Tests                            */
+/* ========================================================================= */
+
+/*
+ * Map and unmap strings of every length up to 70 (several full SIMD blocks
+ * plus every tail size) and compare against the strchr-based helpers.
+ */
+static void check_alphabet_round_trip(const char *alphabet) {
+    fpe_alphabet a;
+    unsigned int radix = (unsigned int)strlen(alphabet);
+    TEST_ASSERT_EQUAL_UINT(radix, fpe_alphabet_compile(&a, alphabet));
+    
+    char str[71], back[72];
+    unsigned int arr[70];
+    for (unsigned int len = 1; len <= 70; len++) {
+        for (unsigned int i = 0; i < len; i++) {
+            str[i] = alphabet[(i * 7 + len) % radix];
+        }
+        str[len] = '\0';
+        
+        TEST_ASSERT_EQUAL_INT(0, fpe_alphabet_map(&a, str, arr, len));
+        for (unsigned int i = 0; i < len; i++) {
+            TEST_ASSERT_EQUAL_INT(fpe_char_to_index(alphabet, str[i]), (int)arr[i]);
+        }
+        
+        memset(back, 'X', sizeof(back));
+        TEST_ASSERT_EQUAL_INT(0, fpe_alphabet_unmap(&a, arr, back, len));
+        TEST_ASSERT_EQUAL_MEMORY(str, back, len);
+        TEST_ASSERT_EQUAL_CHAR('X', back[len]);  /* No terminator written */
+    }
+}
+
+/*
+ * A single bad character or index anywhere in the block or the tail must
+ * fail the whole conversion.
+ */
+static void check_alphabet_rejects(const char *alphabet, char bad) {
+    fpe_alphabet a;
+    unsigned int radix = (unsigned int)strlen(alphabet);
+    TEST_ASSERT_EQUAL_UINT(radix, fpe_alphabet_compile(&a, alphabet));
+    
+    char str[41], out[41];
+    unsigned int arr[40];
+    for (unsigned int pos = 0; pos < 40; pos++) {
+        for (unsigned int i = 0; i < 40; i++) str[i] = alphabet[i % radix];
+        str[40] = '\0';
+        str[pos] = bad;
+        TEST_ASSERT_EQUAL_INT(-1, fpe_alphabet_map(&a, str, arr, 40));
+        
+        for (unsigned int i = 0; i < 40; i++) arr[i] = i % radix;
+        arr[pos] = radix + pos;
+        TEST_ASSERT_EQUAL_INT(-1, fpe_alphabet_unmap(&a, arr, out, 40));
+        arr[pos] = 0x80000000u | pos;
+        TEST_ASSERT_EQUAL_INT(-1, fpe_alphabet_unmap(&a, arr, out, 40));
+    }
+}
+
+void test_alphabet_compile_kinds(void) {
+    fpe_alphabet a;
+    
+    TEST_ASSERT_EQUAL_UINT(10, fpe_alphabet_compile(&a, "0123456789"));
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_RANGE, a.kind);
+    TEST_ASSERT_EQUAL_UINT(26, fpe_alphabet_compile(&a, "abcdefghijklmnopqrstuvwxyz"));
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_RANGE, a.kind);
+    TEST_ASSERT_EQUAL_UINT(62, fpe_alphabet_compile(&a,
+        "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_RUNS, a.kind);
+    TEST_ASSERT_EQUAL_UINT(3, a.nruns);
+    TEST_ASSERT_EQUAL_UINT(20, fpe_alphabet_compile(&a, "qwertyuiopasdfghjklz"));
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_TABLE, a.kind);
+    
+    /* Short scattered alphabets use pshufb when it is available */
+    TEST_ASSERT_EQUAL_UINT(16, fpe_alphabet_compile(&a, "0123456789abcdef"));
+#if defined(__SSSE3__)
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_NIBBLE, a.kind);
+#else
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_RUNS, a.kind);
+#endif
+    TEST_ASSERT_EQUAL_UINT(10, fpe_alphabet_compile(&a, "9876543210"));
+#if defined(__SSSE3__)
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_NIBBLE, a.kind);
+#else
+    TEST_ASSERT_EQUAL_INT(FPE_ALPHABET_TABLE, a.kind);
+#endif
+}
+
+void test_alphabet_compile_invalid(void) {
+    fpe_alphabet a;
+    
+    TEST_ASSERT_EQUAL_UINT(0, fpe_alphabet_compile(&a, "0123456780"));
+    TEST_ASSERT_EQUAL_UINT(0, fpe_alphabet_compile(&a, "0"));
+    TEST_ASSERT_EQUAL_UINT(0, fpe_alphabet_compile(&a, NULL));
+    TEST_ASSERT_EQUAL_UINT(0, fpe_alphabet_compile(NULL, "01"));
+}
+
+void test_alphabet_round_trip(void) {
+    check_alphabet_round_trip("0123456789");
+    check_alphabet_round_trip("01");
+    check_alphabet_round_trip("abcdefghijklmnopqrstuvwxyz");
+    check_alphabet_round_trip("0123456789abcdef");
+    check_alphabet_round_trip("ACGT");
+    check_alphabet_round_trip("9876543210");
+    check_alphabet_round_trip("qwertyuiopasdfghjklz");
+    check_alphabet_round_trip("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+    check_alphabet_round_trip("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ");
+}
+
+void test_alphabet_rejects_invalid(void) {
+    check_alphabet_rejects("0123456789", 'a');
+    check_alphabet_rejects("0123456789", '/');
+    check_alphabet_rejects("0123456789abcdef", 'g');
+    check_alphabet_rejects("0123456789abcdef", 'F');
+    check_alphabet_rejects("ACGT", (char)0xC1);
+    check_alphabet_rejects("qwertyuiopasdfghjklz", 'b');
+    check_alphabet_rejects("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/", '=');
+    check_alphabet_rejects("0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ", '-');
+}
+
+void test_alphabet_high_bytes(void) {
+    /* Alphabets beyond ASCII must not confuse the signed SIMD compares */
+    char alphabet[17];
+    for (int i = 0; i < 16; i++) alphabet[i] = (char)(0xF0 + i);
+    alphabet[16] = '\0';
+    
+    check_alphabet_round_trip(alphabet);
+    check_alphabet_rejects(alphabet, (char)0xEF);
+    check_alphabet_rejects(alphabet, '0');
+}
+
 /* ========================================================================= */
 /*                           Validation Tests                                */
 /* ========================================================================= */
@@ -332,6 +462,13 @@ int main(void) {
     RUN_TEST(test_array_to_str_out_of_bounds);
     RUN_TEST(test_array_to_str_null_termination);
     
+    /* Compiled alphabets */
+    RUN_TEST(test_alphabet_compile_kinds);
+    RUN_TEST(test_alphabet_compile_invalid);
+    RUN_TEST(test_alphabet_round_trip);
+    RUN_TEST(test_alphabet_rejects_invalid);
+    RUN_TEST(test_alphabet_high_bytes);
+    
     /* Validation */
     RUN_TEST(test_validate_alphabet_valid);
     RUN_TEST(test_validate_alphabet_with_duplicates);
@@ -0,0 +1,866 @@
+/**
+ * @file fpe_tool.c
+ * @brief fpe-tool: tokenize CSV/TSV columns with FPE
+ *
+ * The input file is memory-mapped and cut into chunks at record
+ * boundaries. Worker threads each own one FPE context per column spec,
+ * copy a chunk into a reorder-buffer slot, rewrite the selected fields in
+ * place (values keep their length) through FPE_encrypt_iov, and mark the
+ * slot ready. The main thread writes slots strictly in chunk order, so the
+ * output matches the input record for record.
+ *
+ * Usage:
+ *   fpe-tool encrypt|decrypt -k HEXKEY -c SPEC [-c SPEC ...] [options] FILE
+ *
+ * Column spec:  COLUMN=MODE:ALPHABET[:TWEAK]
+ *   COLUMN    1-based column number, or a header name with -H
+ *   MODE      ff1, ff3 or ff3-1
+ *   ALPHABET  digits, hex, HEX, lower, upper, alnum, ALNUM, or literal
+ *             characters (without ':')
+ *   TWEAK     template of hex bytes and {COLUMN} references, e.g.
+ *             "0a0b{3}" uses 0x0a 0x0b followed by the raw text of column 3.
+ *             At most 64 bytes (FF1), 8 (FF3) or 7 (FF3-1); shorter FF3
+ *             and FF3-1 tweaks are padded with zero bytes
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "fpe.h"
+
+#define TOOL_MAX_SPECS 32
+#define TOOL_MAX_COLUMNS 1024
+#define TOOL_MAX_TWEAK 64
+#define TOOL_FF3_MAX_LEN 256
+#define TOOL_MAX_TWEAK_PARTS 16
+
+/* Fields per column queued for one FPE_encrypt_iov call */
+#define TOOL_WINDOW 256
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================
+ */
+
+typedef struct {
+    int column;              /* Referenced column, or -1 for literal bytes */
+    unsigned char lit[TOOL_MAX_TWEAK];
+    unsigned int lit_len;
+} tweak_part;
+
+typedef struct {
+    const char *column_name; /* As given on the command line */
+    unsigned int column;     /* 0-based, resolved */
+    FPE_MODE mode;
+    char alphabet[257];
+    unsigned int radix;
+    unsigned char allowed[256];
+    unsigned int nparts;
+    tweak_part parts[TOOL_MAX_TWEAK_PARTS];
+    char tweak_names[TOOL_MAX_TWEAK_PARTS][64];
+} column_spec;
+
+typedef struct {
+    int encrypt;
+    FPE_ALGO algo;
+    unsigned char key[32];
+    unsigned int key_bits;
+    char delim;
+    int header;
+    int pass_invalid;
+    unsigned int threads;
+    size_t chunk_size;
+    const char *input;
+    const char *output;
+    unsigned int nspecs;
+    column_spec specs[TOOL_MAX_SPECS];
+    unsigned int ncolumns;   /* Columns a record must be parsed up to */
+} tool_config;
+
+static const struct {
+    const char *name;
+    const char *chars;
+} named_alphabets[] = {
+    {"digits", "0123456789"},
+    {"hex", "0123456789abcdef"},
+    {"HEX", "0123456789ABCDEF"},
+    {"lower", "abcdefghijklmnopqrstuvwxyz"},
+    {"upper", "ABCDEFGHIJKLMNOPQRSTUVWXYZ"},
+    {"alnum", "0123456789abcdefghijklmnopqrstuvwxyz"},
+    {"ALNUM", "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"},
+};
+
+static void usage(FILE *f) {
+    fprintf(f,
+        "Usage: fpe-tool encrypt|decrypt -k HEXKEY -c SPEC [-c SPEC ...] [options] FILE\n"
+        "\n"
+        "  -c SPEC     COLUMN=MODE:ALPHABET[:TWEAK], repeated once per column\n"
+        "              COLUMN    1-based number, or header name with -H\n"
+        "              MODE      ff1 | ff3 | ff3-1\n"
+        "              ALPHABET  digits hex HEX lower upper alnum ALNUM, or literal chars\n"
+        "              TWEAK     hex bytes and {COLUMN} references, e.g. 0a0b{3}\n"
+        "                        At most 64 bytes (ff1), 8 (ff3) or 7 (ff3-1); shorter\n"
+        "                        ff3/ff3-1 tweaks are padded with zero bytes. A record\n"
+        "                        whose tweak comes out longer is an invalid field\n"
+        "  -k HEXKEY   Key as 32, 48 or 64 hex digits (default: $FPE_TOOL_KEY)\n"
+        "  -A ALGO     aes (default) or sm4\n"
+        "  -d DELIM    Field delimiter: a character, or 'tab' (default ',')\n"
+        "  -H          First record is a header; copy it and allow column names\n"
+        "  -s          Leave invalid fields unchanged instead of failing\n"
+        "  -t N        Worker threads (default: online CPUs)\n"
+        "  -C KB       Chunk size in KiB (default 4096)\n"
+        "  -o FILE     Output file (default: stdout)\n"
+        "\n"
+        "Empty fields are always left unchanged. Throughput is reported on stderr.\n");
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Decode len hex digits into out; returns bytes written or -1 */
+static int parse_hex(const char *s, size_t len, unsigned char *out, size_t cap) {
+    if (len % 2 != 0 || len / 2 > cap) return -1;
+    for (size_t i = 0; i < len; i += 2) {
+        int hi = hex_value(s[i]), lo = hex_value(s[i + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        out[i / 2] = (unsigned char)(hi << 4 | lo);
+    }
+    return (int)(len / 2);
+}
+
+static int parse_key(tool_config *cfg, const char *hex) {
+    int n = parse_hex(hex, strlen(hex), cfg->key, sizeof(cfg->key));
+    if (n != 16 && n != 24 && n != 32) return -1;
+    cfg->key_bits = (unsigned int)n * 8;
+    return 0;
+}
+
+/* Longest tweak a mode takes; FF3 and FF3-1 tweaks are padded up to it */
+static unsigned int tweak_limit(FPE_MODE mode) {
+    if (mode == FPE_MODE_FF3) return 8;
+    if (mode == FPE_MODE_FF3_1) return 7;
+    return TOOL_MAX_TWEAK;
+}
+
+/*
+ * Parse the tweak template: runs of hex digits become literal parts and
+ * {COLUMN} becomes a reference, resolved once the header is known. The
+ * literal bytes alone must fit the mode's tweak.
+ */
+static int parse_tweak(column_spec *spec, const char *t) {
+    unsigned int literal = 0;
+    while (*t) {
+        if (spec->nparts == TOOL_MAX_TWEAK_PARTS) return -1;
+        tweak_part *p = &spec->parts[spec->nparts];
+
+        if (*t == '{') {
+            const char *close = strchr(t, '}');
+            size_t n = close ? (size_t)(close - t - 1) : 0;
+            if (n == 0 || n >= sizeof(spec->tweak_names[0])) return -1;
+            memcpy(spec->tweak_names[spec->nparts], t + 1, n);
+            spec->tweak_names[spec->nparts][n] = '\0';
+            p->column = 0;
+            t = close + 1;
+        } else {
+            size_t n = strcspn(t, "{");
+            int bytes = parse_hex(t, n, p->lit, sizeof(p->lit));
+            if (bytes < 0) return -1;
+            p->column = -1;
+            p->lit_len = (unsigned int)bytes;
+            literal += (unsigned int)bytes;
+            t += n;
+        }
+        spec->nparts++;
+    }
+    return literal <= tweak_limit(spec->mode) ? 0 : -1;
+}
+
+static int parse_spec(tool_config *cfg, char *arg) {
+    if (cfg->nspecs == TOOL_MAX_SPECS) return -1;
+    column_spec *spec = &cfg->specs[cfg->nspecs];
+
+    char *eq = strchr(arg, '=');
+    if (!eq || eq == arg) return -1;
+    *eq = '\0';
+    spec->column_name = arg;
+
+    char *mode = eq + 1;
+    char *alpha = strchr(mode, ':');
+    if (!alpha) return -1;
+    *alpha++ = '\0';
+    char *tweak = strchr(alpha, ':');
+    if (tweak) *tweak++ = '\0';
+
+    if (strcmp(mode, "ff1") == 0) spec->mode = FPE_MODE_FF1;
+    else if (strcmp(mode, "ff3") == 0) spec->mode = FPE_MODE_FF3;
+    else if (strcmp(mode, "ff3-1") == 0) spec->mode = FPE_MODE_FF3_1;
+    else return -1;
+
+    const char *chars = alpha;
+    for (size_t i = 0; i < sizeof(named_alphabets) / sizeof(named_alphabets[0]); i++) {
+        if (strcmp(alpha, named_alphabets[i].name) == 0) chars = named_alphabets[i].chars;
+    }
+    size_t radix = strlen(chars);
+    if (radix < 2 || radix > 256) return -1;
+    memcpy(spec->alphabet, chars, radix + 1);
+    spec->radix = (unsigned int)radix;
+    for (size_t i = 0; i < radix; i++) {
+        unsigned char c = (unsigned char)chars[i];
+        if (spec->allowed[c]) return -1;  /* Duplicate */
+        spec->allowed[c] = 1;
+    }
+
+    if (tweak && parse_tweak(spec, tweak) != 0) return -1;
+    cfg->nspecs++;
+    return 0;
+}
+
+/* Resolve a column name: a 1-based number, or a header field */
+static int resolve_column(const char *name, char **header, unsigned int nheader) {
+    char *end;
+    long n = strtol(name, &end, 10);
+    if (*end == '\0' && n >= 1 && n <= TOOL_MAX_COLUMNS) return (int)n - 1;
+    for (unsigned int i = 0; i < nheader; i++) {
+        if (strcmp(header[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* ============================================================================
+ * Record Parsing
+ * ============================================================================
+ */
+
+typedef struct {
+    size_t off;   /* Field content start, relative to the chunk */
+    size_t len;   /* Content length (without quotes) */
+} field_pos;
+
+/*
+ * Split one record starting at p into fields up to ncols. Quoted fields
+ * may contain delimiters and newlines; "" inside quotes stays in the
+ * content. Returns the offset just past the record's newline.
+ */
+static size_t parse_record(const char *b, size_t p, size_t end, char delim,
+                           field_pos *fields, unsigned int ncols, unsigned int *nfields) {
+    unsigned int nf = 0;
+
+    for (;;) {
+        size_t start = p, len;
+        if (p < end && b[p] == '"') {
+            start = ++p;
+            while (p < end && !(b[p] == '"' && (p + 1 >= end || b[p + 1] != '"'))) {
+                p += (b[p] == '"') ? 2 : 1;
+            }
+            len = p - start;
+            if (p < end) p++;  /* Closing quote */
+            while (p < end && b[p] != delim && b[p] != '\n') p++;
+        } else {
+            while (p < end && b[p] != delim && b[p] != '\n') p++;
+            len = p - start;
+            if (len > 0 && (p == end || b[p] == '\n') && b[p - 1] == '\r') len--;
+        }
+
+        if (nf < ncols) {
+            fields[nf].off = start;
+            fields[nf].len = len;
+        }
+        nf++;
+
+        if (p >= end) break;
+        if (b[p++] == '\n') break;
+    }
+
+    *nfields = nf;
+    return p;
+}
+
+/*
+ * End of the chunk that starts at start: the first record boundary at or
+ * after start + target, tracking quotes so newlines inside quoted fields
+ * are not taken as boundaries.
+ */
+static size_t find_chunk_end(const char *b, size_t start, size_t len, size_t target) {
+    size_t stop = (target < len - start) ? start + target : len;
+    size_t p = start;
+    int quoted = 0;
+
+    /* Quote parity up to the target, jumping from quote to quote */
+    while (p < stop) {
+        const char *q = memchr(b + p, '"', stop - p);
+        if (!q) break;
+        quoted = !quoted;
+        p = (size_t)(q - b) + 1;
+    }
+    p = stop;
+
+    /* First newline outside quotes */
+    while (p < len) {
+        const char *nl = memchr(b + p, '\n', len - p);
+        if (!nl) return len;
+        size_t n = (size_t)(nl - b);
+        const char *q = memchr(b + p, '"', n - p);
+        if (!q) {
+            if (!quoted) return n + 1;
+            p = n + 1;
+        } else {
+            quoted = !quoted;
+            p = (size_t)(q - b) + 1;
+        }
+    }
+    return len;
+}
+
+/* ============================================================================
+ * Worker Threads and Reorder Buffer
+ * ============================================================================
+ */
+
+typedef enum { SLOT_FREE = 0, SLOT_BUSY, SLOT_READY } slot_state;
+
+typedef struct {
+    slot_state state;
+    size_t seq;
+    char *buf;
+    size_t len;
+    size_t cap;
+} reorder_slot;
+
+typedef struct {
+    const tool_config *cfg;
+    const char *data;
+    size_t data_len;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t split_pos;        /* Start of the next chunk */
+    size_t next_seq;         /* Sequence number of the next chunk */
+    int done_splitting;
+    int failed;
+    char error[256];
+
+    unsigned int nslots;
+    reorder_slot *slots;
+
+    /* Totals, updated under lock */
+    size_t records;
+    size_t tokenized;
+    size_t invalid;
+} tool_state;
+
+typedef struct {
+    FPE_IOV iov[TOOL_WINDOW];
+    unsigned char tweaks[TOOL_WINDOW][TOOL_MAX_TWEAK];
+    size_t offsets[TOOL_WINDOW];   /* For error messages */
+    unsigned int n;
+} field_window;
+
+typedef struct {
+    tool_state *st;
+    FPE_CTX *ctx[TOOL_MAX_SPECS];
+    field_window win[TOOL_MAX_SPECS];
+    field_pos fields[TOOL_MAX_COLUMNS];
+    size_t tokenized;
+    size_t invalid;
+} worker;
+
+static void fail(tool_state *st, const char *msg) {
+    pthread_mutex_lock(&st->lock);
+    if (!st->failed) {
+        st->failed = 1;
+        snprintf(st->error, sizeof(st->error), "%s", msg);
+    }
+    pthread_cond_broadcast(&st->cond);
+    pthread_mutex_unlock(&st->lock);
+}
+
+static void fail_field(tool_state *st, size_t offset, unsigned int column) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "invalid field at byte %zu (column %u)", offset, column);
+    fail(st, msg);
+}
+
+/*
+ * Run one column's queued fields; on failure retry singly to find the
+ * culprit. The fields are first restored from the untouched source bytes
+ * in src, so none is ever encrypted twice.
+ */
+static int flush_window(worker *w, unsigned int s, const char *src, size_t chunk_off) {
+    const tool_config *cfg = w->st->cfg;
+    field_window *win = &w->win[s];
+    const char *alphabet = cfg->specs[s].alphabet;
+    int ret = 0;
+
+    if (win->n == 0) return 0;
+
+    int ok = cfg->encrypt
+        ? FPE_encrypt_iov(w->ctx[s], alphabet, win->iov, win->n)
+        : FPE_decrypt_iov(w->ctx[s], alphabet, win->iov, win->n);
+
+    if (ok == 0) {
+        w->tokenized += win->n;
+    } else {
+        for (unsigned int i = 0; i < win->n; i++) {
+            memcpy(win->iov[i].base, src + win->offsets[i], win->iov[i].len);
+        }
+        for (unsigned int i = 0; i < win->n && ret == 0; i++) {
+            ok = cfg->encrypt
+                ? FPE_encrypt_iov(w->ctx[s], alphabet, &win->iov[i], 1)
+                : FPE_decrypt_iov(w->ctx[s], alphabet, &win->iov[i], 1);
+            if (ok == 0) {
+                w->tokenized++;
+            } else if (cfg->pass_invalid) {
+                w->invalid++;
+            } else {
+                fail_field(w->st, chunk_off + win->offsets[i], cfg->specs[s].column + 1);
+                ret = -1;
+            }
+        }
+    }
+
+    win->n = 0;
+    return ret;
+}
+
+/* Tokenize every record of one chunk in place in buf */
+static int process_chunk(worker *w, const char *src, char *buf, size_t len,
+                         size_t chunk_off, size_t *records) {
+    const tool_config *cfg = w->st->cfg;
+    size_t p = 0;
+
+    while (p < len) {
+        unsigned int nf;
+        size_t rec = p;
+        p = parse_record(buf, p, len, cfg->delim, w->fields, cfg->ncolumns, &nf);
+
+        /* A blank line is not a record with empty fields */
+        if (p - rec <= 2 && (buf[rec] == '\n' || buf[rec] == '\r')) continue;
+        (*records)++;
+
+        for (unsigned int s = 0; s < cfg->nspecs; s++) {
+            const column_spec *spec = &cfg->specs[s];
+            if (spec->column >= nf || w->fields[spec->column].len == 0) continue;
+
+            const field_pos *f = &w->fields[spec->column];
+            field_window *win = &w->win[s];
+
+            /* Build the tweak from the untouched source bytes */
+            unsigned char *tw = win->tweaks[win->n];
+            unsigned int tlen = 0, tmax = tweak_limit(spec->mode);
+            int valid = 1;
+            for (unsigned int k = 0; k < spec->nparts && valid; k++) {
+                const tweak_part *part = &spec->parts[k];
+                const unsigned char *bytes = part->lit;
+                size_t n = part->lit_len;
+                if (part->column >= 0) {
+                    if ((unsigned int)part->column < nf) {
+                        bytes = (const unsigned char *)src + w->fields[part->column].off;
+                        n = w->fields[part->column].len;
+                    } else {
+                        n = 0;
+                    }
+                }
+                valid = n <= tmax - tlen;
+                if (valid) {
+                    memcpy(tw + tlen, bytes, n);
+                    tlen += (unsigned int)n;
+                }
+            }
+
+            /* FF3 takes exactly 8 bytes, FF3-1 exactly 7: pad with zeros */
+            if (spec->mode != FPE_MODE_FF1) {
+                memset(tw + tlen, 0, tmax - tlen);
+                tlen = tmax;
+            }
+
+            FPE_IOV *iov = &win->iov[win->n];
+            iov->base = buf + f->off;
+            iov->len = (unsigned int)f->len;
+            iov->tweak = tw;
+            iov->tweak_len = tlen;
+            win->offsets[win->n] = f->off;
+
+            /* Cheap pre-check keeps one bad field from failing its window */
+            size_t max_len = spec->mode == FPE_MODE_FF1 ? 0xFFFFFFFFu : TOOL_FF3_MAX_LEN;
+            valid = valid && f->len >= 2 && f->len <= max_len;
+            for (size_t i = 0; i < f->len && valid; i++) {
+                valid = spec->allowed[(unsigned char)buf[f->off + i]];
+            }
+            if (!valid) {
+                if (!cfg->pass_invalid) {
+                    fail_field(w->st, chunk_off + f->off, spec->column + 1);
+                    return -1;
+                }
+                w->invalid++;
+                continue;
+            }
+
+            if (++win->n == TOOL_WINDOW && flush_window(w, s, src, chunk_off) != 0) return -1;
+        }
+    }
+
+    for (unsigned int s = 0; s < cfg->nspecs; s++) {
+        if (flush_window(w, s, src, chunk_off) != 0) return -1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    worker *w = (worker *)arg;
+    tool_state *st = w->st;
+
+    for (;;) {
+        pthread_mutex_lock(&st->lock);
+        reorder_slot *slot = NULL;
+        size_t start = 0, end = 0, seq = 0;
+
+        while (!st->failed && !st->done_splitting) {
+            slot = &st->slots[st->next_seq % st->nslots];
+            if (slot->state == SLOT_FREE) break;
+            slot = NULL;
+            pthread_cond_wait(&st->cond, &st->lock);
+        }
+        if (st->failed || st->done_splitting) {
+            pthread_mutex_unlock(&st->lock);
+            break;
+        }
+
+        start = st->split_pos;
+        end = find_chunk_end(st->data, start, st->data_len, st->cfg->chunk_size);
+        seq = st->next_seq++;
+        st->split_pos = end;
+        if (end == st->data_len) st->done_splitting = 1;
+        slot->state = SLOT_BUSY;
+        slot->seq = seq;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->lock);
+
+        size_t len = end - start;
+        if (len > slot->cap) {
+            char *nb = (char *)realloc(slot->buf, len);
+            if (!nb) {
+                fail(st, "out of memory");
+                break;
+            }
+            slot->buf = nb;
+            slot->cap = len;
+        }
+        memcpy(slot->buf, st->data + start, len);
+        slot->len = len;
+
+        size_t records = 0;
+        w->tokenized = w->invalid = 0;
+        if (process_chunk(w, st->data + start, slot->buf, len, start, &records) != 0) break;
+
+        pthread_mutex_lock(&st->lock);
+        st->records += records;
+        st->tokenized += w->tokenized;
+        st->invalid += w->invalid;
+        slot->state = SLOT_READY;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->lock);
+    }
+    return NULL;
+}
+
+static int write_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Write slots in sequence order until the last chunk is out */
+static int write_ordered(tool_state *st, int fd) {
+    for (size_t seq = 0;; seq++) {
+        reorder_slot *slot = &st->slots[seq % st->nslots];
+
+        pthread_mutex_lock(&st->lock);
+        while (!st->failed && !(slot->state == SLOT_READY && slot->seq == seq) &&
+               !(st->done_splitting && seq >= st->next_seq)) {
+            pthread_cond_wait(&st->cond, &st->lock);
+        }
+        int finished = st->failed || (st->done_splitting && seq >= st->next_seq);
+        pthread_mutex_unlock(&st->lock);
+        if (finished) return st->failed ? -1 : 0;
+
+        if (write_all(fd, slot->buf, slot->len) != 0) {
+            fail(st, "write failed");
+            return -1;
+        }
+
+        pthread_mutex_lock(&st->lock);
+        slot->state = SLOT_FREE;
+        pthread_cond_broadcast(&st->cond);
+        pthread_mutex_unlock(&st->lock);
+    }
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================
+ */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Copy the header record, split it into names, and resolve every column */
+static int resolve_columns(tool_config *cfg, const char *data, size_t len, size_t *body) {
+    static field_pos fields[TOOL_MAX_COLUMNS];
+    static char names[TOOL_MAX_COLUMNS][64];
+    char *header[TOOL_MAX_COLUMNS];
+    unsigned int nheader = 0;
+
+    *body = 0;
+    if (cfg->header && len > 0) {
+        *body = parse_record(data, 0, len, cfg->delim, fields, TOOL_MAX_COLUMNS, &nheader);
+        if (nheader > TOOL_MAX_COLUMNS) nheader = TOOL_MAX_COLUMNS;
+        for (unsigned int i = 0; i < nheader; i++) {
+            size_t n = fields[i].len < 63 ? fields[i].len : 63;
+            memcpy(names[i], data + fields[i].off, n);
+            names[i][n] = '\0';
+            header[i] = names[i];
+        }
+    }
+
+    cfg->ncolumns = 0;
+    for (unsigned int s = 0; s < cfg->nspecs; s++) {
+        column_spec *spec = &cfg->specs[s];
+        int col = resolve_column(spec->column_name, header, nheader);
+        if (col < 0) {
+            fprintf(stderr, "fpe-tool: unknown column '%s'\n", spec->column_name);
+            return -1;
+        }
+        /* A name and a number may reach the same column; it can be tokenized once */
+        for (unsigned int t = 0; t < s; t++) {
+            if (cfg->specs[t].column == (unsigned int)col) {
+                fprintf(stderr, "fpe-tool: column '%s' is tokenized twice\n", spec->column_name);
+                return -1;
+            }
+        }
+        spec->column = (unsigned int)col;
+        if (spec->column + 1 > cfg->ncolumns) cfg->ncolumns = spec->column + 1;
+    }
+
+    for (unsigned int s = 0; s < cfg->nspecs; s++) {
+        column_spec *spec = &cfg->specs[s];
+        for (unsigned int k = 0; k < spec->nparts; k++) {
+            if (spec->parts[k].column < 0) continue;
+            int col = resolve_column(spec->tweak_names[k], header, nheader);
+            if (col < 0) {
+                fprintf(stderr, "fpe-tool: unknown tweak column '%s'\n", spec->tweak_names[k]);
+                return -1;
+            }
+            /* Decryption must see the same tweak, so it cannot be a tokenized column */
+            for (unsigned int t = 0; t < cfg->nspecs; t++) {
+                if (cfg->specs[t].column == (unsigned int)col) {
+                    fprintf(stderr, "fpe-tool: tweak column '%s' is itself tokenized\n",
+                            spec->tweak_names[k]);
+                    return -1;
+                }
+            }
+            spec->parts[k].column = col;
+            if ((unsigned int)col + 1 > cfg->ncolumns) cfg->ncolumns = (unsigned int)col + 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_args(tool_config *cfg, int argc, char **argv) {
+    if (argc < 2) return -1;
+    if (strcmp(argv[1], "encrypt") == 0) cfg->encrypt = 1;
+    else if (strcmp(argv[1], "decrypt") == 0) cfg->encrypt = 0;
+    else return -1;
+
+    cfg->algo = FPE_ALGO_AES;
+    cfg->delim = ',';
+    cfg->chunk_size = 4096 * 1024;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg->threads = cpus > 0 ? (unsigned int)cpus : 1;
+
+    const char *key = getenv("FPE_TOOL_KEY");
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "c:k:A:d:Hst:C:o:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (parse_spec(cfg, optarg) != 0) {
+                fprintf(stderr, "fpe-tool: invalid column spec\n");
+                return -1;
+            }
+            break;
+        case 'k': key = optarg; break;
+        case 'A':
+            if (strcmp(optarg, "aes") == 0) cfg->algo = FPE_ALGO_AES;
+            else if (strcmp(optarg, "sm4") == 0) cfg->algo = FPE_ALGO_SM4;
+            else return -1;
+            break;
+        case 'd':
+            if (strcmp(optarg, "tab") == 0 || strcmp(optarg, "\\t") == 0) cfg->delim = '\t';
+            else if (strlen(optarg) == 1 && optarg[0] != '"' && optarg[0] != '\n') cfg->delim = optarg[0];
+            else return -1;
+            break;
+        case 'H': cfg->header = 1; break;
+        case 's': cfg->pass_invalid = 1; break;
+        case 't': cfg->threads = (unsigned int)atoi(optarg); break;
+        case 'C': cfg->chunk_size = (size_t)atol(optarg) * 1024; break;
+        case 'o': cfg->output = optarg; break;
+        default: return -1;
+        }
+    }
+    if (optind != argc - 1 || cfg->nspecs == 0 || cfg->threads == 0 || cfg->chunk_size == 0) {
+        return -1;
+    }
+    cfg->input = argv[optind];
+
+    if (!key || parse_key(cfg, key) != 0) {
+        fprintf(stderr, "fpe-tool: a 128, 192 or 256-bit hex key is required (-k or FPE_TOOL_KEY)\n");
+        return -1;
+    }
+
+    /* Tokenized text must not be able to break the record structure */
+    for (unsigned int s = 0; s < cfg->nspecs; s++) {
+        const column_spec *spec = &cfg->specs[s];
+        if (spec->allowed[(unsigned char)cfg->delim] || spec->allowed['"'] ||
+            spec->allowed['\n'] || spec->allowed['\r']) {
+            fprintf(stderr, "fpe-tool: alphabet of column '%s' contains a delimiter or quote\n",
+                    spec->column_name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static tool_config cfg;
+    if (argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        usage(stdout);
+        return 0;
+    }
+    if (parse_args(&cfg, argc, argv) != 0) {
+        usage(stderr);
+        return 2;
+    }
+
+    int in = open(cfg.input, O_RDONLY);
+    struct stat sb;
+    if (in < 0 || fstat(in, &sb) != 0) {
+        fprintf(stderr, "fpe-tool: cannot open %s: %s\n", cfg.input, strerror(errno));
+        return 1;
+    }
+    size_t len = (size_t)sb.st_size;
+    const char *data = "";
+    if (len > 0) {
+        void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, in, 0);
+        if (m == MAP_FAILED) {
+            fprintf(stderr, "fpe-tool: cannot map %s: %s\n", cfg.input, strerror(errno));
+            return 1;
+        }
+        madvise(m, len, MADV_SEQUENTIAL);
+        data = (const char *)m;
+    }
+
+    int out = cfg.output ? open(cfg.output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+    if (out < 0) {
+        fprintf(stderr, "fpe-tool: cannot open %s: %s\n", cfg.output, strerror(errno));
+        return 1;
+    }
+
+    size_t body;
+    if (resolve_columns(&cfg, data, len, &body) != 0) return 2;
+
+    double t0 = now_sec();
+    if (write_all(out, data, body) != 0) {
+        fprintf(stderr, "fpe-tool: write failed\n");
+        return 1;
+    }
+
+    tool_state st;
+    memset(&st, 0, sizeof(st));
+    st.cfg = &cfg;
+    st.data = data;
+    st.data_len = len;
+    st.split_pos = body;
+    st.done_splitting = (body == len);
+    st.nslots = cfg.threads * 2;
+    st.slots = (reorder_slot *)calloc(st.nslots, sizeof(reorder_slot));
+    pthread_mutex_init(&st.lock, NULL);
+    pthread_cond_init(&st.cond, NULL);
+
+    pthread_t *tids = (pthread_t *)calloc(cfg.threads, sizeof(pthread_t));
+    worker *workers = (worker *)calloc(cfg.threads, sizeof(worker));
+    if (!st.slots || !tids || !workers) {
+        fprintf(stderr, "fpe-tool: out of memory\n");
+        return 1;
+    }
+
+    /* One context per column spec per thread */
+    for (unsigned int t = 0; t < cfg.threads; t++) {
+        workers[t].st = &st;
+        for (unsigned int s = 0; s < cfg.nspecs; s++) {
+            FPE_CTX *ctx = FPE_CTX_new();
+            if (!ctx || FPE_CTX_init(ctx, cfg.specs[s].mode, cfg.algo, cfg.key,
+                                     cfg.key_bits, cfg.specs[s].radix) != 0) {
+                fprintf(stderr, "fpe-tool: cannot initialize context for column '%s'\n",
+                        cfg.specs[s].column_name);
+                return 1;
+            }
+            workers[t].ctx[s] = ctx;
+        }
+    }
+    memset(cfg.key, 0, sizeof(cfg.key));
+
+    for (unsigned int t = 0; t < cfg.threads; t++) {
+        pthread_create(&tids[t], NULL, worker_main, &workers[t]);
+    }
+    int ret = write_ordered(&st, out);
+    for (unsigned int t = 0; t < cfg.threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    double secs = now_sec() - t0;
+
+    if (ret != 0) {
+        fprintf(stderr, "fpe-tool: %s\n", st.error);
+    } else {
+        double mb = (double)len / (1024.0 * 1024.0);
+        fprintf(stderr,
+                "fpe-tool: %zu records, %zu fields %s, %zu invalid left unchanged, "
+                "%.1f MiB in %.3f s (%.1f MB/s, %.0f records/s, %u threads)\n",
+                st.records, st.tokenized, cfg.encrypt ? "encrypted" : "decrypted",
+                st.invalid, mb, secs, secs > 0 ? (double)len / 1e6 / secs : 0.0,
+                secs > 0 ? (double)st.records / secs : 0.0, cfg.threads);
+    }
+
+    for (unsigned int t = 0; t < cfg.threads; t++) {
+        for (unsigned int s = 0; s < cfg.nspecs; s++) FPE_CTX_free(workers[t].ctx[s]);
+    }
+    for (unsigned int i = 0; i < st.nslots; i++) free(st.slots[i].buf);
+    free(st.slots);
+    free(tids);
+    free(workers);
+    if (len > 0) munmap((void *)data, len);
+    close(in);
+    if (cfg.output && close(out) != 0) ret = -1;
+
+    return ret == 0 ? 0 : 1;
+}